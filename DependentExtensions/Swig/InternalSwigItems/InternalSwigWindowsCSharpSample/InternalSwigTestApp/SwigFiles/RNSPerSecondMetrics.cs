@@ -16,6 +16,7 @@ public enum RNSPerSecondMetrics {
   USER_MESSAGE_BYTES_RECEIVED_IGNORED,
   ACTUAL_BYTES_SENT,
   ACTUAL_BYTES_RECEIVED,
+  USER_MESSAGE_BYTES_DISCARDED,
   RNS_PER_SECOND_METRICS_COUNT
 }
 
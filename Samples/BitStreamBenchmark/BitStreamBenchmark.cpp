@@ -0,0 +1,761 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+// Measures how fast BitStream writes and reads fields that are not byte aligned, in bits per second.
+// ReferenceBitStream has the byte at a time WriteBits() and ReadBits() from before the word at a time versions, to check the results match and to compare speed.
+// Also compares BitStreamSchema with the same class serialized by hand, a call per member, and the batched quantized vector calls with one call per vector,
+// measures deltas of a snapshot against the last one, compares WriteArray() and ReadArray() with a call per element,
+// and compares reading serialization messages with BitStreamView in place with copying each channel out.
+
+#include "BitStream.h"
+#include "BitStreamSchema.h"
+#include "BitStreamArena.h"
+#include "BitStreamView.h"
+#include "ReferenceBitStream.h"
+#include "GetTime.h"
+#include "Rand.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+using namespace RakNet;
+
+// Writes random fields at random offsets both ways, and checks the streams and what is read back are the same
+static bool Verify(void)
+{
+	unsigned char input[64], output[64], referenceOutput[64];
+	for (int round=0; round < 2000; round++)
+	{
+		BitStream bitStream;
+		ReferenceBitStream referenceBitStream(4096);
+		int fieldCount = 1 + randomMT() % 40;
+		BitSize_t fieldSizes[40];
+		int i;
+		for (i=0; i < fieldCount; i++)
+		{
+			fieldSizes[i] = 1 + randomMT() % (sizeof(input)*8);
+			fillBufferMT(input, sizeof(input));
+			// The old version needed the unused bits of a partial byte cleared
+			bool rightAlignedBits = (randomMT() & 1)!=0;
+			if ((fieldSizes[i] & 7) && rightAlignedBits)
+				input[fieldSizes[i]>>3] &= 0xFF >> (8-(fieldSizes[i]&7));
+			else if (fieldSizes[i] & 7)
+				input[fieldSizes[i]>>3] &= 0xFF << (8-(fieldSizes[i]&7));
+			bitStream.WriteBits(input, fieldSizes[i], rightAlignedBits);
+			referenceBitStream.WriteBits(input, fieldSizes[i], rightAlignedBits);
+		}
+		if (bitStream.GetNumberOfBitsUsed()!=referenceBitStream.GetNumberOfBitsUsed() ||
+			memcmp(bitStream.GetData(), referenceBitStream.GetData(), BITS_TO_BYTES(bitStream.GetNumberOfBitsUsed()))!=0)
+			return false;
+
+		for (i=0; i < fieldCount; i++)
+		{
+			bool alignBitsToRight = (randomMT() & 1)!=0;
+			if (bitStream.ReadBits(output, fieldSizes[i], alignBitsToRight)==false)
+				return false;
+			referenceBitStream.ReadBits(referenceOutput, fieldSizes[i], alignBitsToRight);
+			if (alignBitsToRight==false && (fieldSizes[i] & 7))
+			{
+				// The old version left the bits that follow the field in the last byte
+				referenceOutput[fieldSizes[i]>>3] &= 0xFF << (8-(fieldSizes[i]&7));
+			}
+			if (memcmp(output, referenceOutput, BITS_TO_BYTES(fieldSizes[i]))!=0)
+				return false;
+		}
+	}
+	return true;
+}
+
+// Writes then reads fieldCount fields of fieldBits each, after one bit so they are not aligned. Returns bits per second through each of write and read, from the fastest of several passes.
+template <class StreamType>
+static void Measure(StreamType &bitStream, BitSize_t fieldBits, int fieldCount, double &writeBitsPerSecond, double &readBitsPerSecond)
+{
+	unsigned char field[1024], output[1024];
+	fillBufferMT(field, sizeof(field));
+	const unsigned char one=1;
+	RakNet::TimeUS writeTime=(RakNet::TimeUS)-1, readTime=(RakNet::TimeUS)-1;
+	for (int iteration=0; iteration < 20; iteration++)
+	{
+		int i;
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		bitStream.Reset();
+		bitStream.WriteBits(&one, 1, true);
+		for (i=0; i < fieldCount; i++)
+			bitStream.WriteBits(field, fieldBits, true);
+		RakNet::TimeUS midTime=RakNet::GetTimeUS();
+		bitStream.SetReadOffset(1);
+		for (i=0; i < fieldCount; i++)
+			bitStream.ReadBits(output, fieldBits, true);
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (midTime-startTime < writeTime)
+			writeTime=midTime-startTime;
+		if (endTime-midTime < readTime)
+			readTime=endTime-midTime;
+	}
+	double totalBits = (double) fieldBits * fieldCount;
+	writeBitsPerSecond = totalBits / ((double) (writeTime ? writeTime : 1) / 1000000.0);
+	readBitsPerSecond = totalBits / ((double) (readTime ? readTime : 1) / 1000000.0);
+}
+
+// A typical replicated object
+struct Player
+{
+	float x, y, z;
+	float yaw;
+	int health;
+	short ammo;
+	unsigned char team;
+	unsigned int playerId;
+	bool isCrouching, isFiring, isReloading;
+};
+
+typedef BitStreamSchema<
+	SchemaFloat<Player, &Player::x, -4096, 4096, 16>,
+	SchemaFloat<Player, &Player::y, -4096, 4096, 16>,
+	SchemaFloat<Player, &Player::z, -4096, 4096, 16>,
+	SchemaFloat<Player, &Player::yaw, -4, 4, 16>,
+	SchemaRange<Player, int, &Player::health, 0, 100>,
+	SchemaRange<Player, short, &Player::ammo, 0, 999>,
+	SchemaInteger<Player, unsigned char, &Player::team>,
+	SchemaInteger<Player, unsigned int, &Player::playerId>,
+	SchemaBool<Player, &Player::isCrouching>,
+	SchemaBool<Player, &Player::isFiring>,
+	SchemaBool<Player, &Player::isReloading> > PlayerSchema;
+
+// The same fields written the usual way
+static void SerializePlayer(BitStream *bitStream, const Player &player)
+{
+	bitStream->WriteFloat16(player.x, -4096, 4096);
+	bitStream->WriteFloat16(player.y, -4096, 4096);
+	bitStream->WriteFloat16(player.z, -4096, 4096);
+	bitStream->WriteFloat16(player.yaw, -4, 4);
+	bitStream->WriteBitsFromIntegerRange(player.health, 0, 100);
+	bitStream->WriteBitsFromIntegerRange(player.ammo, (short) 0, (short) 999);
+	bitStream->Write(player.team);
+	bitStream->Write(player.playerId);
+	bitStream->Write(player.isCrouching);
+	bitStream->Write(player.isFiring);
+	bitStream->Write(player.isReloading);
+}
+static bool DeserializePlayer(BitStream *bitStream, Player &player)
+{
+	bitStream->ReadFloat16(player.x, -4096, 4096);
+	bitStream->ReadFloat16(player.y, -4096, 4096);
+	bitStream->ReadFloat16(player.z, -4096, 4096);
+	bitStream->ReadFloat16(player.yaw, -4, 4);
+	bitStream->ReadBitsFromIntegerRange(player.health, 0, 100);
+	bitStream->ReadBitsFromIntegerRange(player.ammo, (short) 0, (short) 999);
+	bitStream->Read(player.team);
+	bitStream->Read(player.playerId);
+	bitStream->Read(player.isCrouching);
+	bitStream->Read(player.isFiring);
+	return bitStream->Read(player.isReloading);
+}
+
+static float FloatAbs(float f) {return f < 0 ? -f : f;}
+static bool PlayersMatch(const Player &a, const Player &b)
+{
+	return FloatAbs(a.x-b.x) < .2f && FloatAbs(a.y-b.y) < .2f && FloatAbs(a.z-b.z) < .2f && FloatAbs(a.yaw-b.yaw) < .001f &&
+		a.health==b.health && a.ammo==b.ammo && a.team==b.team && a.playerId==b.playerId &&
+		a.isCrouching==b.isCrouching && a.isFiring==b.isFiring && a.isReloading==b.isReloading;
+}
+
+// Writes then reads playerCount players, either through PlayerSchema or by hand. Returns players per second through each of write and read, from the fastest of several passes.
+static bool MeasurePlayers(const Player *players, Player *output, int playerCount, bool useSchema, double &writesPerSecond, double &readsPerSecond, BitSize_t &bitsPerPlayer)
+{
+	BitStream bitStream(playerCount * 32);
+	RakNet::TimeUS writeTime=(RakNet::TimeUS)-1, readTime=(RakNet::TimeUS)-1;
+	for (int iteration=0; iteration < 20; iteration++)
+	{
+		int i;
+		bitStream.Reset();
+		// Start unaligned, as after a message ID and some other fields
+		bitStream.Write1();
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		if (useSchema)
+		{
+			for (i=0; i < playerCount; i++)
+				PlayerSchema::Serialize(&bitStream, players[i]);
+		}
+		else
+		{
+			for (i=0; i < playerCount; i++)
+				SerializePlayer(&bitStream, players[i]);
+		}
+		RakNet::TimeUS midTime=RakNet::GetTimeUS();
+		bitStream.SetReadOffset(1);
+		if (useSchema)
+		{
+			for (i=0; i < playerCount; i++)
+				PlayerSchema::Deserialize(&bitStream, output[i]);
+		}
+		else
+		{
+			for (i=0; i < playerCount; i++)
+				DeserializePlayer(&bitStream, output[i]);
+		}
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (midTime-startTime < writeTime)
+			writeTime=midTime-startTime;
+		if (endTime-midTime < readTime)
+			readTime=endTime-midTime;
+	}
+	bitsPerPlayer = (bitStream.GetNumberOfBitsUsed()-1) / playerCount;
+	writesPerSecond = playerCount / ((double) (writeTime ? writeTime : 1) / 1000000.0);
+	readsPerSecond = playerCount / ((double) (readTime ? readTime : 1) / 1000000.0);
+	for (int i=0; i < playerCount; i++)
+	{
+		if (PlayersMatch(players[i], output[i])==false)
+			return false;
+	}
+	return true;
+}
+
+static bool CompareSchema(void)
+{
+	const int playerCount=20000;
+	Player *players = new Player[playerCount];
+	Player *output = new Player[playerCount];
+	for (int i=0; i < playerCount; i++)
+	{
+		players[i].x = frandomMT() * 8192.0f - 4096.0f;
+		players[i].y = frandomMT() * 8192.0f - 4096.0f;
+		players[i].z = frandomMT() * 8192.0f - 4096.0f;
+		players[i].yaw = frandomMT() * 6.28f - 3.14f;
+		players[i].health = randomMT() % 101;
+		players[i].ammo = (short) (randomMT() % 1000);
+		players[i].team = (unsigned char) randomMT();
+		players[i].playerId = randomMT();
+		players[i].isCrouching = (randomMT() & 1)!=0;
+		players[i].isFiring = (randomMT() & 1)!=0;
+		players[i].isReloading = (randomMT() & 1)!=0;
+	}
+
+	double handWrite, handRead, schemaWrite, schemaRead;
+	BitSize_t handBits, schemaBits;
+	bool success = MeasurePlayers(players, output, playerCount, false, handWrite, handRead, handBits) &&
+		MeasurePlayers(players, output, playerCount, true, schemaWrite, schemaRead, schemaBits);
+	delete [] players;
+	delete [] output;
+	if (success==false)
+		return false;
+
+	printf("%-24s %16s %16s %16s\n", "Benchmark", "Writes/s", "Reads/s", "Bits each");
+	printf("%-24s %16.0f %16.0f %16i\n", "BM_Player/ByHand", handWrite, handRead, handBits);
+	printf("%-24s %16.0f %16.0f %16i\n", "BM_Player/Schema", schemaWrite, schemaRead, schemaBits);
+	return true;
+}
+
+// A frame of serialization as ReplicaManager3 does it: each replica writes some of its channels, and a stream the channels are copied into, all destroyed before the next replica.
+// Returns frames per second, from the fastest of several frames.
+static double MeasureFrames(const unsigned short *channelBytes, int replicaCount, int channelCount, BitStreamArena *arena)
+{
+	static const unsigned char payload[2048] = {0};
+	RakNet::TimeUS frameTime=(RakNet::TimeUS)-1;
+	for (int frame=0; frame < 20; frame++)
+	{
+		if (arena)
+			arena->Reset();
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		for (int replica=0; replica < replicaCount; replica++)
+		{
+			BitStream channels[16];
+			BitStream out(arena);
+			int channel;
+			for (channel=0; channel < channelCount; channel++)
+			{
+				channels[channel].SetArena(arena);
+				// Written a field at a time, so the stream grows as it would
+				for (unsigned int written=0; written < channelBytes[replica*channelCount+channel]; written+=64)
+					channels[channel].WriteAlignedBytes(payload, 64);
+			}
+			for (channel=0; channel < channelCount; channel++)
+				out.Write(channels[channel]);
+		}
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (endTime-startTime < frameTime)
+			frameTime=endTime-startTime;
+	}
+	return 1000000.0 / (double) (frameTime ? frameTime : 1);
+}
+
+static void CompareArena(void)
+{
+	const int replicaCount=500, channelCount=16;
+	unsigned short *channelBytes = new unsigned short[replicaCount*channelCount];
+	// Mostly small channels that fit in BITSTREAM_STACK_ALLOCATION_SIZE, and some that do not
+	for (int i=0; i < replicaCount*channelCount; i++)
+		channelBytes[i] = (unsigned short) ((randomMT() % 4)==0 ? 256 + randomMT() % 1024 : randomMT() % 192);
+
+	BitStreamArena arena(4*1024*1024);
+	double heapFrames = MeasureFrames(channelBytes, replicaCount, channelCount, 0);
+	double arenaFrames = MeasureFrames(channelBytes, replicaCount, channelCount, &arena);
+	delete [] channelBytes;
+
+	printf("%-24s %16s %16s %16s\n", "Benchmark", "Frames/s", "High water KB", "Overflows");
+	printf("%-24s %16.1f %16s %16s\n", "BM_Frame/Heap", heapFrames, "-", "-");
+	printf("%-24s %16.1f %16.1f %16i\n", "BM_Frame/Arena", arenaFrames, arena.GetHighWaterMark()/1024.0, arena.GetOverflowCount());
+}
+
+// Positions, normals and rotations of replicated objects, as separate arrays so they can be written with the batched calls
+struct Transforms
+{
+	float *positions, *normals, *rotations;
+};
+
+static const float WORLD_SIZE=4096.0f;
+
+// Writes then reads transformCount transforms, either a BitStream call per vector or one call per array. Returns transforms per second through each of write and read, from the fastest of several passes.
+static void MeasureTransforms(const Transforms &input, Transforms &output, int transformCount, bool batched, double &writesPerSecond, double &readsPerSecond, BitSize_t &bitsPerTransform)
+{
+	BitStream bitStream(transformCount * 16);
+	RakNet::TimeUS writeTime=(RakNet::TimeUS)-1, readTime=(RakNet::TimeUS)-1;
+	for (int iteration=0; iteration < 20; iteration++)
+	{
+		int i;
+		bitStream.Reset();
+		// Start unaligned, as after a message ID and some other fields
+		bitStream.Write1();
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		if (batched)
+		{
+			bitStream.WriteFloat16Array(input.positions, transformCount*3, -WORLD_SIZE, WORLD_SIZE);
+			bitStream.WriteNormVectorArray(input.normals, transformCount);
+			bitStream.WriteSmallestThreeQuatArray(input.rotations, transformCount, 15);
+		}
+		else
+		{
+			for (i=0; i < transformCount; i++)
+			{
+				const float *p=input.positions+i*3, *n=input.normals+i*3, *r=input.rotations+i*4;
+				bitStream.WriteFloat16(p[0], -WORLD_SIZE, WORLD_SIZE);
+				bitStream.WriteFloat16(p[1], -WORLD_SIZE, WORLD_SIZE);
+				bitStream.WriteFloat16(p[2], -WORLD_SIZE, WORLD_SIZE);
+				bitStream.WriteNormVector(n[0], n[1], n[2]);
+				bitStream.WriteNormQuat(r[0], r[1], r[2], r[3]);
+			}
+		}
+		RakNet::TimeUS midTime=RakNet::GetTimeUS();
+		bitStream.SetReadOffset(1);
+		if (batched)
+		{
+			bitStream.ReadFloat16Array(output.positions, transformCount*3, -WORLD_SIZE, WORLD_SIZE);
+			bitStream.ReadNormVectorArray(output.normals, transformCount);
+			bitStream.ReadSmallestThreeQuatArray(output.rotations, transformCount, 15);
+		}
+		else
+		{
+			for (i=0; i < transformCount; i++)
+			{
+				float *p=output.positions+i*3, *n=output.normals+i*3, *r=output.rotations+i*4;
+				bitStream.ReadFloat16(p[0], -WORLD_SIZE, WORLD_SIZE);
+				bitStream.ReadFloat16(p[1], -WORLD_SIZE, WORLD_SIZE);
+				bitStream.ReadFloat16(p[2], -WORLD_SIZE, WORLD_SIZE);
+				bitStream.ReadNormVector(n[0], n[1], n[2]);
+				bitStream.ReadNormQuat(r[0], r[1], r[2], r[3]);
+			}
+		}
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (midTime-startTime < writeTime)
+			writeTime=midTime-startTime;
+		if (endTime-midTime < readTime)
+			readTime=endTime-midTime;
+	}
+	bitsPerTransform = (bitStream.GetNumberOfBitsUsed()-1) / transformCount;
+	writesPerSecond = transformCount / ((double) (writeTime ? writeTime : 1) / 1000000.0);
+	readsPerSecond = transformCount / ((double) (readTime ? readTime : 1) / 1000000.0);
+}
+
+// Largest difference between what was written and read back, for each of position, normal component, and rotation in degrees
+static void MeasureError(const Transforms &input, const Transforms &output, int transformCount, float &positionError, float &normalError, float &rotationDegrees)
+{
+	positionError=0.0f;
+	normalError=0.0f;
+	rotationDegrees=0.0f;
+	for (int i=0; i < transformCount; i++)
+	{
+		int j;
+		for (j=0; j < 3; j++)
+		{
+			if (FloatAbs(input.positions[i*3+j]-output.positions[i*3+j]) > positionError)
+				positionError=FloatAbs(input.positions[i*3+j]-output.positions[i*3+j]);
+			if (FloatAbs(input.normals[i*3+j]-output.normals[i*3+j]) > normalError)
+				normalError=FloatAbs(input.normals[i*3+j]-output.normals[i*3+j]);
+		}
+		// q and -q are the same rotation
+		float dot=0.0f;
+		for (j=0; j < 4; j++)
+			dot+=input.rotations[i*4+j]*output.rotations[i*4+j];
+		dot=FloatAbs(dot);
+		if (dot>1.0f)
+			dot=1.0f;
+		float degrees = 2.0f * acosf(dot) * 57.2957795f;
+		if (degrees > rotationDegrees)
+			rotationDegrees=degrees;
+	}
+}
+
+static void RandomUnitVector(float *v, int components)
+{
+	float length;
+	do
+	{
+		length=0.0f;
+		for (int i=0; i < components; i++)
+		{
+			v[i]=frandomMT()*2.0f-1.0f;
+			length+=v[i]*v[i];
+		}
+	} while (length < .0001f || length > 1.0f);
+	length=sqrtf(length);
+	for (int i=0; i < components; i++)
+		v[i]/=length;
+}
+
+static bool CompareQuantization(void)
+{
+	const int transformCount=20000;
+	Transforms input, output;
+	input.positions=new float[transformCount*3];
+	input.normals=new float[transformCount*3];
+	input.rotations=new float[transformCount*4];
+	output.positions=new float[transformCount*3];
+	output.normals=new float[transformCount*3];
+	output.rotations=new float[transformCount*4];
+	for (int i=0; i < transformCount; i++)
+	{
+		for (int j=0; j < 3; j++)
+			input.positions[i*3+j]=frandomMT() * 2.0f * WORLD_SIZE - WORLD_SIZE;
+		RandomUnitVector(input.normals+i*3, 3);
+		RandomUnitVector(input.rotations+i*4, 4);
+	}
+
+	// The batched floats must give the same bits as WriteFloat16() one at a time, so either side can read the other
+	BitStream perValue, batched;
+	for (int i=0; i < transformCount*3; i++)
+		perValue.WriteFloat16(input.positions[i], -WORLD_SIZE, WORLD_SIZE);
+	batched.WriteFloat16Array(input.positions, transformCount*3, -WORLD_SIZE, WORLD_SIZE);
+	bool success = perValue.GetNumberOfBitsUsed()==batched.GetNumberOfBitsUsed() &&
+		memcmp(perValue.GetData(), batched.GetData(), perValue.GetNumberOfBytesUsed())==0;
+
+	double perValueWrite, perValueRead, batchedWrite, batchedRead;
+	BitSize_t perValueBits, batchedBits;
+	float perValueErrors[3], batchedErrors[3];
+	MeasureTransforms(input, output, transformCount, false, perValueWrite, perValueRead, perValueBits);
+	MeasureError(input, output, transformCount, perValueErrors[0], perValueErrors[1], perValueErrors[2]);
+	MeasureTransforms(input, output, transformCount, true, batchedWrite, batchedRead, batchedBits);
+	MeasureError(input, output, transformCount, batchedErrors[0], batchedErrors[1], batchedErrors[2]);
+	delete [] input.positions;
+	delete [] input.normals;
+	delete [] input.rotations;
+	delete [] output.positions;
+	delete [] output.normals;
+	delete [] output.rotations;
+	// Half a step of WriteFloat16() for positions and normals, and well under a degree for rotations
+	if (success==false || batchedErrors[0] > WORLD_SIZE/65535.0f*2.0f || batchedErrors[1] > 2.0f/65535.0f*2.0f || batchedErrors[2] > .1f)
+		return false;
+
+	printf("%-24s %16s %16s %16s\n", "Benchmark", "Writes/s", "Reads/s", "Bits each");
+	printf("%-24s %16.0f %16.0f %16i\n", "BM_Transform/PerValue", perValueWrite, perValueRead, perValueBits);
+	printf("%-24s %16.0f %16.0f %16i\n", "BM_Transform/Batched", batchedWrite, batchedRead, batchedBits);
+	printf("%-24s %16s %16s %16s\n", "Max error", "Position", "Normal", "Degrees");
+	printf("%-24s %16.4f %16.6f %16.4f\n", "BM_Transform/PerValue", perValueErrors[0], perValueErrors[1], perValueErrors[2]);
+	printf("%-24s %16.4f %16.6f %16.4f\n", "BM_Transform/Batched", batchedErrors[0], batchedErrors[1], batchedErrors[2]);
+	return true;
+}
+
+// Deltas of a snapshot of many objects against the last one, with a few bytes of some objects changed, as from one network tick to the next.
+// Prints megabytes of snapshot per second through WriteBitStreamDelta() and ReadBitStreamDelta(), and the size of the delta.
+static bool CompareDelta(void)
+{
+	const unsigned int snapshotBytes=256*1024;
+	BitStream baseline(snapshotBytes), current(snapshotBytes), delta(snapshotBytes), result(snapshotBytes);
+	unsigned char *snapshot = new unsigned char[snapshotBytes];
+	fillBufferMT(snapshot, snapshotBytes);
+	baseline.WriteAlignedBytes(snapshot, snapshotBytes);
+	// About one object in 50, of 64 bytes each, moves
+	for (unsigned int object=0; object < snapshotBytes/64; object++)
+	{
+		if (randomMT() % 50 == 0)
+			snapshot[object*64 + randomMT() % 56] ^= (unsigned char) (1 + randomMT() % 255);
+	}
+	current.WriteAlignedBytes(snapshot, snapshotBytes);
+	delete [] snapshot;
+
+	RakNet::TimeUS writeTime=(RakNet::TimeUS)-1, readTime=(RakNet::TimeUS)-1;
+	for (int iteration=0; iteration < 20; iteration++)
+	{
+		delta.Reset();
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		delta.WriteBitStreamDelta(&current, &baseline);
+		RakNet::TimeUS midTime=RakNet::GetTimeUS();
+		if (delta.ReadBitStreamDelta(&baseline, &result)==false)
+			return false;
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (midTime-startTime < writeTime)
+			writeTime=midTime-startTime;
+		if (endTime-midTime < readTime)
+			readTime=endTime-midTime;
+	}
+	if (result.GetNumberOfBitsUsed()!=current.GetNumberOfBitsUsed() || memcmp(result.GetData(), current.GetData(), snapshotBytes)!=0)
+		return false;
+
+	printf("%-24s %16s %16s %16s\n", "Benchmark", "Write MB/s", "Read MB/s", "Delta bytes");
+	printf("%-24s %16.1f %16.1f %16i\n", "BM_SnapshotDelta/256K", snapshotBytes / (double) (writeTime ? writeTime : 1), snapshotBytes / (double) (readTime ? readTime : 1), delta.GetNumberOfBytesUsed());
+	return true;
+}
+
+// Writes then reads valueCount values of templateType, a Write() or Read() per element or one WriteArray() or ReadArray(). Returns megabytes per second each way, from the fastest of several passes.
+template <class templateType>
+static bool MeasureArray(const templateType *values, templateType *output, int valueCount, bool useArray, double &writeMBPerSecond, double &readMBPerSecond)
+{
+	BitStream bitStream(valueCount * sizeof(templateType) + 16);
+	RakNet::TimeUS writeTime=(RakNet::TimeUS)-1, readTime=(RakNet::TimeUS)-1;
+	for (int iteration=0; iteration < 20; iteration++)
+	{
+		int i;
+		bitStream.Reset();
+		// Start unaligned, as after a message ID and some other fields
+		bitStream.Write1();
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		if (useArray)
+			bitStream.WriteArray(values, valueCount);
+		else
+		{
+			for (i=0; i < valueCount; i++)
+				bitStream.Write(values[i]);
+		}
+		RakNet::TimeUS midTime=RakNet::GetTimeUS();
+		bitStream.SetReadOffset(1);
+		if (useArray)
+			bitStream.ReadArray(output, valueCount);
+		else
+		{
+			for (i=0; i < valueCount; i++)
+				bitStream.Read(output[i]);
+		}
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (midTime-startTime < writeTime)
+			writeTime=midTime-startTime;
+		if (endTime-midTime < readTime)
+			readTime=endTime-midTime;
+	}
+	writeMBPerSecond = valueCount * sizeof(templateType) / (double) (writeTime ? writeTime : 1);
+	readMBPerSecond = valueCount * sizeof(templateType) / (double) (readTime ? readTime : 1);
+	return memcmp(values, output, valueCount * sizeof(templateType))==0;
+}
+
+template <class templateType>
+static bool CompareArray(const char *name, const templateType *values, templateType *output, int valueCount)
+{
+	double elementWrite, elementRead, arrayWrite, arrayRead;
+	if (MeasureArray(values, output, valueCount, false, elementWrite, elementRead)==false ||
+		MeasureArray(values, output, valueCount, true, arrayWrite, arrayRead)==false)
+		return false;
+	char rowName[64];
+	sprintf(rowName, "BM_%s/PerElement", name);
+	printf("%-24s %16.1f %16.1f\n", rowName, elementWrite, elementRead);
+	sprintf(rowName, "BM_%s/Array", name);
+	printf("%-24s %16.1f %16.1f\n", rowName, arrayWrite, arrayRead);
+	return true;
+}
+
+static bool CompareArrays(void)
+{
+	const int valueCount=65536;
+	unsigned short *shorts = new unsigned short[valueCount*2];
+	unsigned int *ints = new unsigned int[valueCount*2];
+	float *floats = new float[valueCount*2];
+	uint64_t *int64s = new uint64_t[valueCount*2];
+	fillBufferMT(shorts, valueCount * sizeof(unsigned short));
+	fillBufferMT(ints, valueCount * sizeof(unsigned int));
+	fillBufferMT(int64s, valueCount * sizeof(uint64_t));
+	for (int i=0; i < valueCount; i++)
+		floats[i]=frandomMT();
+
+	printf("%-24s %16s %16s\n", "Benchmark", "Write MB/s", "Read MB/s");
+	bool success = CompareArray("Short", shorts, shorts+valueCount, valueCount) &&
+		CompareArray("Int", ints, ints+valueCount, valueCount) &&
+		CompareArray("Float", floats, floats+valueCount, valueCount) &&
+		CompareArray("Int64", int64s, int64s+valueCount, valueCount);
+	delete [] shorts;
+	delete [] ints;
+	delete [] floats;
+	delete [] int64s;
+	return success;
+}
+
+// Reads messages laid out as ReplicaManager3 sends serializations: an id, then each channel that was written as its bit length and its bits from a byte boundary.
+// Each channel is copied to its own BitStream, as ReplicaManager3 does by default, or pointed at with BitStreamView::ReadView(), as it does after SetDeserializeInPlace(true), then its first bytes read.
+// Returns messages per second, from the fastest of several passes, and a sum of what was read to check both ways read the same.
+static double MeasureMessages(BitStream *messages, int messageCount, bool useView, unsigned int &checksum)
+{
+	RakNet::TimeUS bestTime=(RakNet::TimeUS)-1;
+	for (int pass=0; pass < 20; pass++)
+	{
+		checksum=0;
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		for (int message=0; message < messageCount; message++)
+		{
+			BitStream channels[16];
+			BitStreamView view(messages[message].GetData(), messages[message].GetNumberOfBytesUsed());
+			BitStream bsIn(messages[message].GetData(), messages[message].GetNumberOfBytesUsed(), false);
+			uint64_t id;
+			bool written;
+			BitSize_t bitsUsed;
+			int channel;
+			if (useView)
+			{
+				view.Read(id);
+				for (channel=0; channel < 16; channel++)
+				{
+					view.Read(written);
+					if (written)
+					{
+						view.ReadCompressed(bitsUsed);
+						view.AlignReadToByteBoundary();
+						view.ReadView(&channels[channel], bitsUsed);
+					}
+				}
+			}
+			else
+			{
+				bsIn.Read(id);
+				for (channel=0; channel < 16; channel++)
+				{
+					bsIn.Read(written);
+					if (written)
+					{
+						bsIn.ReadCompressed(bitsUsed);
+						bsIn.AlignReadToByteBoundary();
+						bsIn.Read(channels[channel], bitsUsed);
+					}
+				}
+			}
+			for (channel=0; channel < 16; channel++)
+			{
+				unsigned int value=0;
+				channels[channel].Read(value);
+				checksum+=value;
+			}
+		}
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (endTime-startTime < bestTime)
+			bestTime=endTime-startTime;
+	}
+	return messageCount * 1000000.0 / (double) (bestTime ? bestTime : 1);
+}
+
+static bool CompareViews(void)
+{
+	const int messageCount=500;
+	BitStream *messages = new BitStream[messageCount];
+	unsigned char payload[2048];
+	fillBufferMT(payload, sizeof(payload));
+	for (int message=0; message < messageCount; message++)
+	{
+		messages[message].Write((uint64_t) message);
+		for (int channel=0; channel < 16; channel++)
+		{
+			// Half the channels are written, mostly small, as in CompareArena()
+			bool written = (randomMT() % 2)==0;
+			messages[message].Write(written);
+			if (written)
+			{
+				BitSize_t bitsUsed = BYTES_TO_BITS((randomMT() % 4)==0 ? 256 + randomMT() % 1024 : 4 + randomMT() % 188);
+				messages[message].WriteCompressed(bitsUsed);
+				messages[message].AlignWriteToByteBoundary();
+				messages[message].WriteAlignedBytes(payload + randomMT() % 512, BITS_TO_BYTES(bitsUsed));
+			}
+		}
+	}
+
+	unsigned int copyChecksum, viewChecksum;
+	double copyMessages = MeasureMessages(messages, messageCount, false, copyChecksum);
+	double viewMessages = MeasureMessages(messages, messageCount, true, viewChecksum);
+	delete [] messages;
+
+	printf("%-24s %16s\n", "Benchmark", "Messages/s");
+	printf("%-24s %16.0f\n", "BM_Deserialize/Copy", copyMessages);
+	printf("%-24s %16.0f\n", "BM_Deserialize/View", viewMessages);
+	return copyChecksum==viewChecksum;
+}
+
+int main(void)
+{
+	printf("Compares the throughput of BitStream::WriteBits() and ReadBits() at unaligned offsets\nwith the byte at a time versions they replaced, of BitStreamSchema with\nserializing by hand, of serializing a frame with and without BitStreamArena,\nof quantizing transforms a vector at a time and in batches, measures\nsnapshot deltas, compares array writes with a write per element, and\ncompares reading messages in place with copying them.\n");
+	printf("Difficulty: Beginner\n\n");
+
+	seedMT((unsigned int) RakNet::GetTimeMS());
+	if (Verify()==false)
+	{
+		printf("FAILED: BitStream results differ from the reference\n");
+		return 1;
+	}
+	printf("Results match the reference.\n\n");
+
+	// Flags and small enums, a byte, quantized values, ints, int64s, and bulk data
+	const BitSize_t fieldSizes[] = {1, 3, 8, 13, 16, 32, 64, 256, 8192};
+	// About 2 megabits per pass, allocated up front so only the bit packing is timed
+	const int bufferSize=1024*1024;
+	BitStream bitStream(bufferSize);
+	ReferenceBitStream referenceBitStream(bufferSize);
+	printf("%-24s %16s %16s %16s %16s\n", "Benchmark", "Old write Mb/s", "New write Mb/s", "Old read Mb/s", "New read Mb/s");
+	for (unsigned int i=0; i < sizeof(fieldSizes)/sizeof(fieldSizes[0]); i++)
+	{
+		int fieldCount = (int) (2000000 / fieldSizes[i]);
+		double oldWrite, oldRead, newWrite, newRead;
+		Measure(referenceBitStream, fieldSizes[i], fieldCount, oldWrite, oldRead);
+		Measure(bitStream, fieldSizes[i], fieldCount, newWrite, newRead);
+		char name[64];
+		sprintf(name, "BM_UnalignedBits/%i", fieldSizes[i]);
+		printf("%-24s %16.1f %16.1f %16.1f %16.1f\n", name, oldWrite/1000000.0, newWrite/1000000.0, oldRead/1000000.0, newRead/1000000.0);
+	}
+	printf("\n");
+
+	if (CompareSchema()==false)
+	{
+		printf("FAILED: Players read back do not match what was written\n");
+		return 1;
+	}
+	printf("\n");
+
+	CompareArena();
+	printf("\n");
+
+	if (CompareQuantization()==false)
+	{
+		printf("FAILED: Batched quantization differs from WriteFloat16() or is not accurate enough\n");
+		return 1;
+	}
+	printf("\n");
+
+	if (CompareDelta()==false)
+	{
+		printf("FAILED: A snapshot read back from its delta differs\n");
+		return 1;
+	}
+	printf("\n");
+
+	if (CompareArrays()==false)
+	{
+		printf("FAILED: An array read back differently\n");
+		return 1;
+	}
+	printf("\n");
+
+	if (CompareViews()==false)
+	{
+		printf("FAILED: Channels read through BitStreamView differ from copies\n");
+		return 1;
+	}
+
+	return 0;
+}
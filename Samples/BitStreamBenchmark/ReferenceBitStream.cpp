@@ -0,0 +1,140 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "ReferenceBitStream.h"
+#include "RakAssert.h"
+#include <stdlib.h>
+#include <string.h>
+
+using namespace RakNet;
+
+ReferenceBitStream::ReferenceBitStream(unsigned int bufferSize)
+{
+	data=(unsigned char*) calloc(bufferSize, 1);
+	numberOfBitsAllocated=BYTES_TO_BITS(bufferSize);
+	Reset();
+}
+ReferenceBitStream::~ReferenceBitStream()
+{
+	free(data);
+}
+void ReferenceBitStream::Reset(void)
+{
+	numberOfBitsUsed=0;
+	readOffset=0;
+}
+// Only checks there is room, as the buffer does not grow
+void ReferenceBitStream::AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite )
+{
+	RakAssert(numberOfBitsUsed + numberOfBitsToWrite <= numberOfBitsAllocated);
+}
+void ReferenceBitStream::WriteBits( const unsigned char* inByteArray, BitSize_t numberOfBitsToWrite, const bool rightAlignedBits )
+{
+	AddBitsAndReallocate( numberOfBitsToWrite );
+
+	const BitSize_t numberOfBitsUsedMod8 = numberOfBitsUsed & 7;
+
+	// If currently aligned and numberOfBits is a multiple of 8, just memcpy for speed
+	if (numberOfBitsUsedMod8==0 && (numberOfBitsToWrite&7)==0)
+	{
+		memcpy( data + ( numberOfBitsUsed >> 3 ), inByteArray, numberOfBitsToWrite>>3);
+		numberOfBitsUsed+=numberOfBitsToWrite;
+		return;
+	}
+
+	unsigned char dataByte;
+	const unsigned char* inputPtr=inByteArray;
+
+	while ( numberOfBitsToWrite > 0 )
+	{
+		dataByte = *( inputPtr++ );
+
+		if ( numberOfBitsToWrite < 8 && rightAlignedBits )
+			dataByte <<= 8 - numberOfBitsToWrite;
+
+		if ( numberOfBitsUsedMod8 == 0 )
+			* ( data + ( numberOfBitsUsed >> 3 ) ) = dataByte;
+		else
+		{
+			*( data + ( numberOfBitsUsed >> 3 ) ) |= dataByte >> ( numberOfBitsUsedMod8 );
+
+			if ( 8 - ( numberOfBitsUsedMod8 ) < 8 && 8 - ( numberOfBitsUsedMod8 ) < numberOfBitsToWrite )
+				*( data + ( numberOfBitsUsed >> 3 ) + 1 ) = (unsigned char) ( dataByte << ( 8 - ( numberOfBitsUsedMod8 ) ) );
+		}
+
+		if ( numberOfBitsToWrite >= 8 )
+		{
+			numberOfBitsUsed += 8;
+			numberOfBitsToWrite -= 8;
+		}
+		else
+		{
+			numberOfBitsUsed += numberOfBitsToWrite;
+			numberOfBitsToWrite=0;
+		}
+	}
+}
+bool ReferenceBitStream::ReadBits( unsigned char *inOutByteArray, BitSize_t numberOfBitsToRead, const bool alignBitsToRight )
+{
+	if (numberOfBitsToRead<=0)
+		return false;
+
+	if ( readOffset + numberOfBitsToRead > numberOfBitsUsed )
+		return false;
+
+	const BitSize_t readOffsetMod8 = readOffset & 7;
+
+	// If currently aligned and numberOfBits is a multiple of 8, just memcpy for speed
+	if (readOffsetMod8==0 && (numberOfBitsToRead&7)==0)
+	{
+		memcpy( inOutByteArray, data + ( readOffset >> 3 ), numberOfBitsToRead>>3);
+		readOffset+=numberOfBitsToRead;
+		return true;
+	}
+
+	BitSize_t offset = 0;
+
+	memset( inOutByteArray, 0, (size_t) BITS_TO_BYTES( numberOfBitsToRead ) );
+
+	while ( numberOfBitsToRead > 0 )
+	{
+		*( inOutByteArray + offset ) |= *( data + ( readOffset >> 3 ) ) << ( readOffsetMod8 );
+
+		if ( readOffsetMod8 > 0 && numberOfBitsToRead > 8 - ( readOffsetMod8 ) )
+			*( inOutByteArray + offset ) |= *( data + ( readOffset >> 3 ) + 1 ) >> ( 8 - ( readOffsetMod8 ) );
+
+		if (numberOfBitsToRead>=8)
+		{
+			numberOfBitsToRead -= 8;
+			readOffset += 8;
+			offset++;
+		}
+		else
+		{
+			int neg = (int) numberOfBitsToRead - 8;
+
+			if ( neg < 0 )
+			{
+				if ( alignBitsToRight )
+					* ( inOutByteArray + offset ) >>= -neg;
+
+				readOffset += 8 + neg;
+			}
+			else
+				readOffset += 8;
+
+			offset++;
+
+			numberOfBitsToRead=0;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#ifndef __REFERENCE_BIT_STREAM_H
+#define __REFERENCE_BIT_STREAM_H
+
+#include "RakNetTypes.h"
+
+/// The byte at a time BitStream::WriteBits() and ReadBits() from before the word at a time versions, on a fixed buffer.
+/// In its own file so the compiler cannot inline it into the benchmark, just as it cannot inline BitStream from the library.
+class ReferenceBitStream
+{
+public:
+	ReferenceBitStream(unsigned int bufferSize);
+	~ReferenceBitStream();
+
+	void Reset(void);
+	void WriteBits( const unsigned char* inByteArray, RakNet::BitSize_t numberOfBitsToWrite, const bool rightAlignedBits = true );
+	bool ReadBits( unsigned char *inOutByteArray, RakNet::BitSize_t numberOfBitsToRead, const bool alignBitsToRight = true );
+	void SetReadOffset( const RakNet::BitSize_t newReadOffset ) {readOffset=newReadOffset;}
+	RakNet::BitSize_t GetNumberOfBitsUsed( void ) const {return numberOfBitsUsed;}
+	unsigned char* GetData( void ) const {return data;}
+
+private:
+	void AddBitsAndReallocate( const RakNet::BitSize_t numberOfBitsToWrite );
+
+	unsigned char *data;
+	RakNet::BitSize_t numberOfBitsUsed;
+	RakNet::BitSize_t numberOfBitsAllocated;
+	RakNet::BitSize_t readOffset;
+};
+
+#endif
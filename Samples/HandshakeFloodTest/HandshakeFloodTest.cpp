@@ -0,0 +1,187 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+// Measures how many connections a server can accept while it is flooded with ID_OPEN_CONNECTION_REQUEST_2 from many addresses.
+// Run once with handshake cookies and once without to compare.
+
+#include "RakPeerInterface.h"
+#include "RakNetSocket2.h"
+#include "MessageIdentifiers.h"
+#include "BitStream.h"
+#include "GetTime.h"
+#include "RakSleep.h"
+#include "Rand.h"
+#include "Gets.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace RakNet;
+
+static const unsigned short SERVER_PORT=60100;
+static const unsigned short MAX_SERVER_CONNECTIONS=32;
+static const int CLIENT_COUNT=8;
+// Copy of OFFLINE_MESSAGE_DATA_ID in RakPeer.cpp, so the flood passes the offline message check
+static const unsigned char OFFLINE_MESSAGE_DATA_ID[16]={0x00,0xFF,0xFF,0x00,0xFE,0xFE,0xFE,0xFE,0xFD,0xFD,0xFD,0xFD,0x12,0x34,0x56,0x78};
+
+int main(void)
+{
+	char str[64];
+
+	printf("Floods a server with connection requests from many addresses, while other\nclients connect and disconnect. Prints completed handshakes per second.\n");
+	printf("Difficulty: Intermediate\n\n");
+
+	printf("Use handshake cookies? (y/n, default y)\n");
+	Gets(str, sizeof(str));
+	bool useCookies = str[0]!='n' && str[0]!='N';
+
+	printf("How many flooding addresses? (default 256)\n");
+	Gets(str, sizeof(str));
+	int floodSocketCount = str[0] ? atoi(str) : 256;
+
+	printf("How many flood datagrams per millisecond? (default 50)\n");
+	Gets(str, sizeof(str));
+	int floodRate = str[0] ? atoi(str) : 50;
+
+	printf("How many seconds to run? (default 10)\n");
+	Gets(str, sizeof(str));
+	RakNet::TimeMS duration = (str[0] ? atoi(str) : 10) * 1000;
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	SocketDescriptor serverSd(SERVER_PORT, "127.0.0.1");
+	if (server->Startup(MAX_SERVER_CONNECTIONS, &serverSd, 1)!=RAKNET_STARTED)
+	{
+		printf("Server failed to start.\n");
+		return 1;
+	}
+	server->SetMaximumIncomingConnections(MAX_SERVER_CONNECTIONS);
+	server->SetHandshakeCookies(useCookies);
+	SystemAddress serverAddress("127.0.0.1", SERVER_PORT);
+
+	// Each flood socket has its own port, so to the server it is a different system
+	RakNetSocket2 **floodSockets = new RakNetSocket2*[floodSocketCount];
+	int i;
+	for (i=0; i < floodSocketCount; i++)
+	{
+		RNS2_BerkleyBindParameters bbp;
+		memset(&bbp, 0, sizeof(bbp));
+		bbp.port=0;
+		bbp.hostAddress=(char*) "127.0.0.1";
+		bbp.addressFamily=AF_INET;
+		bbp.type=SOCK_DGRAM;
+		bbp.nonBlockingSocket=true;
+		bbp.doNotFragment=false;
+		bbp.pollingThreadPriority=0;
+		floodSockets[i]=RakNetSocket2Allocator::AllocRNS2();
+		if (((RNS2_Berkley*) floodSockets[i])->Bind(&bbp, _FILE_AND_LINE_)!=BR_SUCCESS)
+		{
+			printf("Failed to bind flood socket %i.\n", i);
+			return 1;
+		}
+	}
+
+	RakPeerInterface *clients[CLIENT_COUNT];
+	bool connecting[CLIENT_COUNT];
+	for (i=0; i < CLIENT_COUNT; i++)
+	{
+		clients[i]=RakPeerInterface::GetInstance();
+		SocketDescriptor sd(0, "127.0.0.1");
+		clients[i]->Startup(1, &sd, 1);
+		connecting[i]=false;
+	}
+
+	unsigned int handshakes=0, failures=0, floodSent=0;
+	unsigned int intervalHandshakes=0, intervalFailures=0, intervalFloodSent=0;
+	RakNet::TimeMS startTime=RakNet::GetTimeMS();
+	RakNet::TimeMS lastFloodTime=startTime;
+	RakNet::TimeMS nextPrintTime=startTime+1000;
+	RakNet::TimeMS now;
+	int floodIndex=0;
+	while ((now=RakNet::GetTimeMS())-startTime < duration)
+	{
+		// Flood. Without a valid cookie, every request looks like a new connection from a new system
+		int toSend=(int) (now-lastFloodTime)*floodRate;
+		lastFloodTime=now;
+		while (toSend-- > 0)
+		{
+			BitStream bs;
+			bs.Write((MessageID)ID_OPEN_CONNECTION_REQUEST_2);
+			bs.WriteAlignedBytes(OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+			if (useCookies)
+				bs.Write((uint32_t) randomMT());
+			bs.Write(serverAddress);
+			bs.Write((uint16_t) 1400);
+			RakNetGUID guid;
+			guid.g=((uint64_t) randomMT() << 32) | randomMT();
+			bs.Write(guid);
+
+			RNS2_SendParameters bsp;
+			bsp.data=(char*) bs.GetData();
+			bsp.length=bs.GetNumberOfBytesUsed();
+			bsp.systemAddress=serverAddress;
+			floodSockets[floodIndex]->Send(&bsp, _FILE_AND_LINE_);
+			floodIndex=(floodIndex+1)%floodSocketCount;
+			intervalFloodSent++;
+		}
+
+		for (i=0; i < CLIENT_COUNT; i++)
+		{
+			if (connecting[i]==false)
+				connecting[i]=clients[i]->Connect("127.0.0.1", SERVER_PORT, 0, 0)==CONNECTION_ATTEMPT_STARTED;
+
+			Packet *p;
+			for (p=clients[i]->Receive(); p; clients[i]->DeallocatePacket(p), p=clients[i]->Receive())
+			{
+				switch (p->data[0])
+				{
+				case ID_CONNECTION_REQUEST_ACCEPTED:
+					intervalHandshakes++;
+					clients[i]->CloseConnection(p->systemAddress, true);
+					connecting[i]=false;
+					break;
+				case ID_CONNECTION_ATTEMPT_FAILED:
+				case ID_NO_FREE_INCOMING_CONNECTIONS:
+				case ID_ALREADY_CONNECTED:
+				case ID_IP_RECENTLY_CONNECTED:
+					intervalFailures++;
+					connecting[i]=false;
+					break;
+				}
+			}
+		}
+
+		Packet *p;
+		for (p=server->Receive(); p; server->DeallocatePacket(p), p=server->Receive())
+			;
+
+		if (now>=nextPrintTime)
+		{
+			printf("%u handshakes/sec, %u failed, %u flood datagrams/sec, %u server connections\n",
+				intervalHandshakes, intervalFailures, intervalFloodSent, (unsigned int) server->NumberOfConnections());
+			handshakes+=intervalHandshakes;
+			failures+=intervalFailures;
+			floodSent+=intervalFloodSent;
+			intervalHandshakes=intervalFailures=intervalFloodSent=0;
+			nextPrintTime+=1000;
+		}
+		RakSleep(1);
+	}
+
+	printf("\nCookies %s: %.1f handshakes/sec, %u failed, %.0f flood datagrams/sec\n",
+		useCookies ? "on" : "off", handshakes*1000.0/duration, failures, floodSent*1000.0/duration);
+
+	for (i=0; i < CLIENT_COUNT; i++)
+		RakPeerInterface::DestroyInstance(clients[i]);
+	for (i=0; i < floodSocketCount; i++)
+		RakNetSocket2Allocator::DeallocRNS2(floodSockets[i]);
+	delete [] floodSockets;
+	RakPeerInterface::DestroyInstance(server);
+	return 0;
+}
@@ -41,6 +41,7 @@ int main(void)
 	int verbosityLevel;
 	unsigned int showStatsInterval;
 	bool connectionCompleted, incomingConnectionCompleted;
+	bool useIOUring;
 	RakNet::RakNetStatistics *rss;
 
 	printf("Loopback performance test.\n");
@@ -91,11 +92,20 @@ int main(void)
 	else
 		showStatsInterval=atoi((char*)byteBlock)*1000;
 
+#if RAKNET_SUPPORT_IO_URING==1
+	printf("Use io_uring sockets? (y/n)\n");
+	Gets((char*)byteBlock, sizeof(byteBlock));
+	useIOUring=byteBlock[0]=='y' || byteBlock[0]=='Y';
+#else
+	useIOUring=false;
+#endif
+
 	if (systemType==0)
 	{
 		printf("Initializing Raknet...\n");
 		// Destination.  Accept one connection and wait for further instructions.
 		RakNet::SocketDescriptor socketDescriptor(DESTINATION_SYSTEM_PORT,0);
+		socketDescriptor.useIOUring=useIOUring;
 		if (localSystem->Startup(1, &socketDescriptor, 1)!=RakNet::RAKNET_STARTED)
 		{
 			printf("Failed to initialize RakNet!.\nQuitting\n");
@@ -131,6 +141,7 @@ int main(void)
 		printf("Initializing Raknet...\n");
 		// Relay.  Accept one connection, initiate outgoing connection, wait for further instructions.
 		RakNet::SocketDescriptor socketDescriptor(RELAY_SYSTEM_PORT,0);
+		socketDescriptor.useIOUring=useIOUring;
 		if (localSystem->Startup(2, &socketDescriptor, 1)!=RakNet::RAKNET_STARTED)
 		{
 			printf("Failed to initialize RakNet!.\nQuitting\n");
@@ -204,6 +215,7 @@ int main(void)
 		printf("Initializing RakNet...\n");
 		// Sender.  Initiate outgoing connection to relay.
 		RakNet::SocketDescriptor socketDescriptor(SOURCE_SYSTEM_PORT,0);
+		socketDescriptor.useIOUring=useIOUring;
 		if (localSystem->Startup(1, &socketDescriptor, 1)!=RakNet::RAKNET_STARTED)
 		{
 			printf("Failed to initialize RakNet!.\nQuitting\n");
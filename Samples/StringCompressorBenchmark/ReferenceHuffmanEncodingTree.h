@@ -0,0 +1,50 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#ifndef __REFERENCE_HUFFMAN_ENCODING_TREE_H
+#define __REFERENCE_HUFFMAN_ENCODING_TREE_H
+
+#include "DS_HuffmanEncodingTreeNode.h"
+#include "DS_LinkedList.h"
+#include "RakNetTypes.h"
+
+namespace RakNet
+{
+	class BitStream;
+}
+
+/// The HuffmanEncodingTree from before canonical codes, which writes a code at a time and decodes by walking the tree a bit at a time.
+/// In its own file so the compiler cannot inline it into the benchmark, just as it cannot inline HuffmanEncodingTree from the library.
+class ReferenceHuffmanEncodingTree
+{
+public:
+	ReferenceHuffmanEncodingTree();
+	~ReferenceHuffmanEncodingTree();
+
+	void EncodeArray( unsigned char *input, size_t sizeInBytes, RakNet::BitStream * output );
+	unsigned DecodeArray( RakNet::BitStream * input, RakNet::BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output );
+	void GenerateFromFrequencyTable( unsigned int frequencyTable[ 256 ] );
+	void FreeMemory( void );
+
+private:
+	HuffmanEncodingTreeNode *root;
+
+	struct CharacterEncoding
+	{
+		unsigned char* encoding;
+		unsigned short bitLength;
+	};
+
+	CharacterEncoding encodingTable[ 256 ];
+
+	void InsertNodeIntoSortedList( HuffmanEncodingTreeNode * node, DataStructures::LinkedList<HuffmanEncodingTreeNode *> *huffmanEncodingTreeNodeList ) const;
+};
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+// Measures how fast StringCompressor encodes and decodes chat lines, and how small they get.
+// ReferenceHuffmanEncodingTree has the tree walk from before canonical codes, used the way EncodeString() and DecodeString() used it, to compare speed.
+// Also trains a dictionary on sample chat with AddTrainingSample() and compares its compression with the default English tree.
+
+#include "StringCompressor.h"
+#include "BitStream.h"
+#include "ReferenceHuffmanEncodingTree.h"
+#include "GetTime.h"
+#include "Rand.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace RakNet;
+
+static const int LINE_COUNT=4096;
+static const int MAX_LINE_LENGTH=128;
+static const uint8_t TRAINED_LANGUAGE=1;
+
+// Same table StringCompressor uses for language 0
+extern unsigned int englishCharacterFrequencies[ 256 ];
+
+// Makes lines that look like game chat: names, short words, numbers, abbreviations and punctuation
+static void MakeChatLine(char *line)
+{
+	static const char *names[] = {"Rogue42", "xXSniperXx", "Healbot", "TankMain", "Zed", "LootGoblin"};
+	static const char *words[] = {"the", "you", "to", "go", "left", "right", "gg", "lol", "need", "heal", "pls", "on", "me",
+		"push", "mid", "b", "site", "wait", "for", "it", "nice", "shot", "ok", "brb", "who", "has", "the", "key", "?", "!!", "wp", "ez"};
+	int length = sprintf(line, "%s: ", names[randomMT() % (sizeof(names)/sizeof(names[0]))]);
+	int wordCount = 2 + randomMT() % 10;
+	for (int i=0; i < wordCount && length < MAX_LINE_LENGTH-16; i++)
+	{
+		if (randomMT() % 8 == 0)
+			length += sprintf(line+length, "%u ", randomMT() % 1000);
+		else
+			length += sprintf(line+length, "%s ", words[randomMT() % (sizeof(words)/sizeof(words[0]))]);
+	}
+	line[length-1]=0;
+}
+
+// How EncodeString() used the tree: encode to a temporary stream, then copy it after the length
+static void ReferenceEncodeString(ReferenceHuffmanEncodingTree &tree, const char *input, BitStream *output)
+{
+	BitStream encodedBitStream;
+	tree.EncodeArray((unsigned char*) input, strlen(input), &encodedBitStream);
+	uint32_t stringBitLength = (uint32_t) encodedBitStream.GetNumberOfBitsUsed();
+	output->WriteCompressed(stringBitLength);
+	output->WriteBits(encodedBitStream.GetData(), stringBitLength);
+}
+
+static bool ReferenceDecodeString(ReferenceHuffmanEncodingTree &tree, char *output, int maxCharsToWrite, BitStream *input)
+{
+	uint32_t stringBitLength;
+	if (input->ReadCompressed(stringBitLength)==false || input->GetNumberOfUnreadBits() < stringBitLength)
+		return false;
+	unsigned bytesInStream = tree.DecodeArray(input, stringBitLength, maxCharsToWrite, (unsigned char*) output);
+	output[bytesInStream < (unsigned) maxCharsToWrite ? bytesInStream : maxCharsToWrite-1]=0;
+	return true;
+}
+
+// Encodes then decodes every line, checking they come back the same. Returns megabytes of text per second each way, from the fastest of several passes, and bits per character
+static bool Measure(char lines[][MAX_LINE_LENGTH], int lineCount, ReferenceHuffmanEncodingTree *referenceTree, uint8_t languageId, double &encodeMBPerSecond, double &decodeMBPerSecond, double &bitsPerCharacter)
+{
+	StringCompressor *stringCompressor = StringCompressor::Instance();
+	char output[MAX_LINE_LENGTH];
+	size_t characterCount=0;
+	int i;
+	for (i=0; i < lineCount; i++)
+		characterCount+=strlen(lines[i]);
+
+	BitStream bitStream;
+	RakNet::TimeUS bestEncode=(RakNet::TimeUS)-1, bestDecode=(RakNet::TimeUS)-1;
+	for (int pass=0; pass < 5; pass++)
+	{
+		bitStream.Reset();
+		RakNet::TimeUS startTime=RakNet::GetTimeUS();
+		for (i=0; i < lineCount; i++)
+		{
+			if (referenceTree)
+				ReferenceEncodeString(*referenceTree, lines[i], &bitStream);
+			else
+				stringCompressor->EncodeString(lines[i], MAX_LINE_LENGTH, &bitStream, languageId);
+		}
+		RakNet::TimeUS midTime=RakNet::GetTimeUS();
+		for (i=0; i < lineCount; i++)
+		{
+			bool success;
+			if (referenceTree)
+				success=ReferenceDecodeString(*referenceTree, output, MAX_LINE_LENGTH, &bitStream);
+			else
+				success=stringCompressor->DecodeString(output, MAX_LINE_LENGTH, &bitStream, languageId);
+			if (success==false || strcmp(output, lines[i])!=0)
+				return false;
+		}
+		RakNet::TimeUS endTime=RakNet::GetTimeUS();
+		if (midTime-startTime < bestEncode)
+			bestEncode=midTime-startTime;
+		if (endTime-midTime < bestDecode)
+			bestDecode=endTime-midTime;
+	}
+
+	encodeMBPerSecond = characterCount / (double) (bestEncode ? bestEncode : 1);
+	decodeMBPerSecond = characterCount / (double) (bestDecode ? bestDecode : 1);
+	bitsPerCharacter = bitStream.GetNumberOfBitsUsed() / (double) characterCount;
+	return true;
+}
+
+int main(void)
+{
+	printf("Compares the throughput of StringCompressor encoding and decoding chat lines\nwith the tree walk it replaced, and the compression of a trained dictionary\nwith the default English tree.\n");
+	printf("Difficulty: Beginner\n\n");
+
+	StringCompressor::AddReference();
+	seedMT(1234);
+
+	static char lines[LINE_COUNT][MAX_LINE_LENGTH];
+	int i;
+	for (i=0; i < LINE_COUNT; i++)
+		MakeChatLine(lines[i]);
+
+	// Train on different lines from the ones measured
+	char sample[MAX_LINE_LENGTH];
+	for (i=0; i < LINE_COUNT; i++)
+	{
+		MakeChatLine(sample);
+		StringCompressor::Instance()->AddTrainingSample((const unsigned char*) sample, (unsigned) strlen(sample), TRAINED_LANGUAGE);
+	}
+	StringCompressor::Instance()->FinishTraining(TRAINED_LANGUAGE);
+	BitStream dictionary;
+	StringCompressor::Instance()->WriteLanguage(TRAINED_LANGUAGE, &dictionary);
+
+	ReferenceHuffmanEncodingTree referenceTree;
+	referenceTree.GenerateFromFrequencyTable(englishCharacterFrequencies);
+
+	double treeWalkEncode, treeWalkDecode, treeWalkBits;
+	double canonicalEncode, canonicalDecode, canonicalBits;
+	double trainedEncode, trainedDecode, trainedBits;
+	if (Measure(lines, LINE_COUNT, &referenceTree, 0, treeWalkEncode, treeWalkDecode, treeWalkBits)==false ||
+		Measure(lines, LINE_COUNT, 0, 0, canonicalEncode, canonicalDecode, canonicalBits)==false ||
+		Measure(lines, LINE_COUNT, 0, TRAINED_LANGUAGE, trainedEncode, trainedDecode, trainedBits)==false)
+	{
+		printf("FAILED: decoded strings differ from the input\n");
+		StringCompressor::RemoveReference();
+		return 1;
+	}
+
+	printf("%-24s %16s %16s %16s\n", "Benchmark", "Encode MB/s", "Decode MB/s", "Bits per char");
+	printf("%-24s %16.1f %16.1f %16.3f\n", "BM_Chat/TreeWalk", treeWalkEncode, treeWalkDecode, treeWalkBits);
+	printf("%-24s %16.1f %16.1f %16.3f\n", "BM_Chat/Canonical", canonicalEncode, canonicalDecode, canonicalBits);
+	printf("%-24s %16.1f %16.1f %16.3f\n", "BM_Chat/Trained", trainedEncode, trainedDecode, trainedBits);
+	printf("Trained dictionary: %i bytes\n", dictionary.GetNumberOfBytesUsed());
+
+	StringCompressor::RemoveReference();
+	return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BanListTest.h"
+
+/*
+Description:
+Bans single addresses, CIDR ranges and * ranges, and checks which addresses are banned.
+Then checks that malformed ranges are rejected, that ranges can be removed with a different string for the same range, and that timed bans expire.
+
+Success conditions:
+Addresses in a banned range are banned, and addresses outside every range are not.
+Ranges with a bad address, a prefix length that is not a number, or a prefix length longer than the address are not added.
+Removing a range unbans only that range.
+A timed ban stops matching once it expires, RemoveExpired removes it, and banning the range again without a time keeps it.
+
+Failure conditions:
+Any success conditions failed
+
+BanList Functions Explicitly Tested:
+Add
+Remove
+Clear
+IsBanned
+RemoveExpired
+Size
+*/
+
+int BanListTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	int errorCode=0;
+	BanList banList;
+
+	banList.Add("10.0.0.0/8", 0);
+	banList.Add("128.0.0.*", 0);
+	banList.Add("192.168.1.20", 0);
+	if (banList.IsBanned("10.1.2.3")==false || banList.IsBanned("10.255.255.255")==false ||
+		banList.IsBanned("128.0.0.5")==false || banList.IsBanned("192.168.1.20")==false ||
+		banList.IsBanned("11.0.0.1") || banList.IsBanned("128.0.1.5") || banList.IsBanned("192.168.1.21") ||
+		banList.Size()!=3)
+		errorCode=1;
+
+	if (errorCode==0)
+	{
+		static const char *malformed[]={"20.0.0.0/33", "20.0.0.0/8x", "20.0.0.0/", "20.0.0.0/-1", "20.0.0.0/4294967304",
+			"20.0.0", "256.0.0.1", "20.*.0.1", "20.0.0.*/8", "20.0.0.1.2", "::1/129", "::1/99999999999999999999"};
+		for (unsigned int i=0; i < sizeof(malformed)/sizeof(malformed[0]); i++)
+		{
+			if (banList.Add(malformed[i], 0))
+				errorCode=2;
+		}
+		if (banList.Size()!=3 || banList.IsBanned("20.0.0.1"))
+			errorCode=2;
+	}
+
+	if (errorCode==0)
+	{
+		// 10.* is the same range as 10.0.0.0/8
+		banList.Remove("10.*");
+		banList.Remove("192.168.1.21");
+		if (banList.IsBanned("10.1.2.3") || banList.IsBanned("128.0.0.5")==false || banList.IsBanned("192.168.1.20")==false ||
+			banList.Size()!=2)
+			errorCode=3;
+	}
+
+	if (errorCode==0)
+	{
+		banList.Clear();
+		banList.Add("30.0.0.1", 50);
+		banList.Add("30.0.0.2", 50);
+		banList.Add("30.0.0.2", 0);
+		if (banList.IsBanned("30.0.0.1")==false)
+			errorCode=4;
+		RakSleep(100);
+		if (banList.IsBanned("30.0.0.1") || banList.IsBanned("30.0.0.2")==false)
+			errorCode=4;
+		banList.RemoveExpired(GetTimeMS());
+		if (banList.Size()!=1 || banList.IsBanned("30.0.0.2")==false)
+			errorCode=4;
+	}
+
+	if (errorCode!=0 && isVerbose)
+		DebugTools::ShowError(ErrorCodeToString(errorCode)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+	return errorCode;
+}
+
+RakString BanListTest::GetTestName()
+{
+
+	return "BanListTest";
+
+}
+
+RakString BanListTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "An address was banned when it should not be, or not banned when it should be";
+		break;
+	case 2:
+		return "A malformed range was added";
+		break;
+	case 3:
+		return "Removing a range did not unban exactly that range";
+		break;
+	case 4:
+		return "A timed ban did not expire, or was not removed once expired";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BanListTest::BanListTest(void)
+{
+}
+
+BanListTest::~BanListTest(void)
+{
+}
+
+void BanListTest::DestroyPeers()
+{
+}
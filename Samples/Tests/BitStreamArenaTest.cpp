@@ -0,0 +1,196 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamArenaTest.h"
+
+/*
+Description:
+Writes BitStreams that grow into a BitStreamArena over several frames, including streams that grow at the same time and streams that run the arena out of room.
+
+Success conditions:
+Data written to a stream backed by an arena reads back the same, whether it ended up in the arena or on the heap.
+Streams allocate from the arena, not the heap, while there is room.
+A stream that runs out of room moves to the heap, and the overflow is counted.
+The high water mark is the most the arena had allocated at once.
+
+Failure conditions:
+Any success conditions failed
+
+BitStream Functions Explicitly Tested:
+BitStream(BitStreamArena*)
+SetArena
+
+BitStreamArena Functions Explicitly Tested:
+Reset
+Allocate
+Reallocate
+Release
+GetBytesUsed
+GetHighWaterMark
+GetOverflowCount
+ResetStatistics
+*/
+
+static const unsigned int ARENA_SLAB_SIZE=16384;
+
+static void WriteNumbers(BitStream &bitStream, unsigned int first, unsigned int count)
+{
+	for (unsigned int i=0; i < count; i++)
+		bitStream.Write(first+i);
+}
+
+static bool ReadNumbers(BitStream &bitStream, unsigned int first, unsigned int count)
+{
+	bitStream.ResetReadPointer();
+	for (unsigned int i=0; i < count; i++)
+	{
+		unsigned int value;
+		if (bitStream.Read(value)==false || value!=first+i)
+			return false;
+	}
+	return true;
+}
+
+int BitStreamArenaTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	unsigned char slab[ARENA_SLAB_SIZE];
+	BitStreamArena arena(slab, sizeof(slab));
+
+	// One stream growing on its own stays at the end of the arena, so grows in place, and gives its block back when destroyed
+	{
+		BitStream bitStream(&arena);
+		WriteNumbers(bitStream, 0, 1000);
+		if (arena.Contains(bitStream.GetData())==false || arena.GetOverflowCount()!=0 || ReadNumbers(bitStream, 0, 1000)==false)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A stream did not grow into the arena\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 1;
+		}
+	}
+	if (arena.GetBytesUsed()!=0 || arena.GetHighWaterMark()==0 || arena.GetHighWaterMark() > 2*1000*sizeof(unsigned int)+8)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The arena did not track the bytes allocated\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	// Streams growing at the same time, as with the channels in ReplicaManager3, over several frames
+	arena.ResetStatistics();
+	for (int frame=0; frame < 10; frame++)
+	{
+		arena.Reset();
+		BitStream channels[4];
+		int i;
+		for (i=0; i < 4; i++)
+			channels[i].SetArena(&arena);
+		for (int round=0; round < 10; round++)
+		{
+			for (i=0; i < 4; i++)
+				WriteNumbers(channels[i], i*1000+round*20, 20);
+		}
+		for (i=0; i < 4; i++)
+		{
+			if (arena.Contains(channels[i].GetData())==false || ReadNumbers(channels[i], i*1000, 200)==false)
+			{
+				if (isVerbose)
+					DebugTools::ShowError("Streams growing at the same time did not read back\n",!noPauses && isVerbose,__LINE__,__FILE__);
+				return 3;
+			}
+		}
+	}
+	if (arena.GetOverflowCount()!=0 || arena.GetHighWaterMark() > ARENA_SLAB_SIZE)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The arena did not track the bytes allocated\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	// Run out of room, once growing in place and once when not the last block
+	arena.Reset();
+	arena.ResetStatistics();
+	{
+		BitStream first(&arena), second(&arena);
+		WriteNumbers(first, 0, 100);
+		WriteNumbers(second, 5000, 100);
+		WriteNumbers(first, 100, 2000);
+		WriteNumbers(second, 5100, 4000);
+		if (arena.GetOverflowCount()==0 || arena.Contains(second.GetData()) || ReadNumbers(first, 0, 2100)==false || ReadNumbers(second, 5000, 4100)==false)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A stream that ran out of room in the arena did not move to the heap\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 4;
+		}
+
+		// Once on the heap, stays there
+		BitStream third(&arena);
+		WriteNumbers(third, 0, 10000);
+		if (arena.Contains(third.GetData()) || ReadNumbers(third, 0, 10000)==false)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A stream that ran out of room in the arena did not move to the heap\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 4;
+		}
+	}
+	if (arena.GetHighWaterMark() > ARENA_SLAB_SIZE)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The arena did not track the bytes allocated\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	return 0;
+}
+
+RakString BitStreamArenaTest::GetTestName()
+{
+
+	return "BitStreamArenaTest";
+
+}
+
+RakString BitStreamArenaTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "A stream did not grow into the arena";
+		break;
+	case 2:
+		return "The arena did not track the bytes allocated";
+		break;
+	case 3:
+		return "Streams growing at the same time did not read back";
+		break;
+	case 4:
+		return "A stream that ran out of room in the arena did not move to the heap";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamArenaTest::BitStreamArenaTest(void)
+{
+}
+
+BitStreamArenaTest::~BitStreamArenaTest(void)
+{
+}
+
+void BitStreamArenaTest::DestroyPeers()
+{
+}
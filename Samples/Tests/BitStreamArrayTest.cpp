@@ -0,0 +1,223 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamArrayTest.h"
+#include <string.h>
+
+/*
+Description:
+Writes random arrays of integers, floats, doubles, bools and a small struct at random bit offsets, with WriteArray and with Write on each element, and reads them back both ways.
+Array lengths are random, so both the block swapping and the element at a time paths run.
+
+Success conditions:
+WriteArray writes the same bits as Write on each element.
+ReadArray reads back what was written, whether by WriteArray or by Write on each element.
+Reading more elements than were written fails without moving the read offset, even when the count is large enough to wrap the number of bits.
+
+Failure conditions:
+Any success conditions failed
+
+BitStream Functions Explicitly Tested:
+WriteArray
+ReadArray
+*/
+
+// Not a multiple of 2, 4 or 8 bytes
+struct ArrayTestStruct
+{
+	unsigned char bytes[6];
+};
+
+static bool operator==(const ArrayTestStruct &a, const ArrayTestStruct &b)
+{
+	return memcmp(a.bytes, b.bytes, sizeof(a.bytes))==0;
+}
+
+// Writes count elements both ways at the same offset, then reads back both ways. Returns 0, or the error code
+template <class templateType>
+static int TestArray(const templateType *values, templateType *output, unsigned int count)
+{
+	BitStream byArray, byElement;
+	int leadingBits = randomMT() % 8;
+	for (int i=0; i < leadingBits; i++)
+	{
+		byArray.Write1();
+		byElement.Write1();
+	}
+	unsigned int i;
+	byArray.WriteArray(values, count);
+	for (i=0; i < count; i++)
+		byElement.Write(values[i]);
+	byArray.Write(true);
+	byElement.Write(true);
+	if (byArray.GetNumberOfBitsUsed()!=byElement.GetNumberOfBitsUsed() || memcmp(byArray.GetData(), byElement.GetData(), byArray.GetNumberOfBytesUsed())!=0)
+		return 1;
+
+	bool trailing=false;
+	byArray.IgnoreBits(leadingBits);
+	if (byArray.ReadArray(output, count)==false || byArray.Read(trailing)==false || trailing==false)
+		return 2;
+	for (i=0; i < count; i++)
+	{
+		if (!(output[i]==values[i]))
+			return 2;
+	}
+
+	// Elements written one at a time read back as an array
+	byElement.IgnoreBits(leadingBits);
+	if (byElement.ReadArray(output, count)==false)
+		return 2;
+	for (i=0; i < count; i++)
+	{
+		if (!(output[i]==values[i]))
+			return 2;
+	}
+
+	// Two more, as the trailing bit is a whole bool
+	byArray.SetReadOffset(leadingBits);
+	if (byArray.ReadArray(output, count+2) || byArray.GetReadOffset()!=(BitSize_t) leadingBits)
+		return 3;
+	return 0;
+}
+
+template <class templateType>
+static int TestRandomArray(unsigned int count)
+{
+	templateType *values = new templateType[count+2];
+	templateType *output = new templateType[count+2];
+	fillBufferMT(values, (count+2)*sizeof(templateType));
+	int errorCode=TestArray(values, output, count);
+	delete [] values;
+	delete [] output;
+	return errorCode;
+}
+
+static int TestFloatArray(unsigned int count)
+{
+	float *values = new float[count+2];
+	float *output = new float[count+2];
+	for (unsigned int i=0; i < count+2; i++)
+		values[i]=frandomMT() * 2000.0f - 1000.0f;
+	int errorCode=TestArray(values, output, count);
+	delete [] values;
+	delete [] output;
+	return errorCode;
+}
+
+static int TestDoubleArray(unsigned int count)
+{
+	double *values = new double[count+2];
+	double *output = new double[count+2];
+	for (unsigned int i=0; i < count+2; i++)
+		values[i]=(double) frandomMT() * 1e12 - 5e11;
+	int errorCode=TestArray(values, output, count);
+	delete [] values;
+	delete [] output;
+	return errorCode;
+}
+
+static int TestBoolArray(unsigned int count)
+{
+	bool *values = new bool[count+2];
+	bool *output = new bool[count+2];
+	for (unsigned int i=0; i < count+2; i++)
+		values[i]=(randomMT() & 1)!=0;
+	int errorCode=TestArray(values, output, count);
+	delete [] values;
+	delete [] output;
+	return errorCode;
+}
+
+int BitStreamArrayTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	for (int round=0; round < 500; round++)
+	{
+		unsigned int count = randomMT() % 4 == 0 ? randomMT() % 8 : randomMT() % 1000;
+		int errorCode;
+		switch (round % 10)
+		{
+		case 0: errorCode=TestRandomArray<unsigned char>(count); break;
+		case 1: errorCode=TestRandomArray<short>(count); break;
+		case 2: errorCode=TestRandomArray<unsigned short>(count); break;
+		case 3: errorCode=TestRandomArray<int>(count); break;
+		case 4: errorCode=TestRandomArray<unsigned int>(count); break;
+		case 5: errorCode=TestRandomArray<uint64_t>(count); break;
+		case 6: errorCode=TestRandomArray<ArrayTestStruct>(count); break;
+		case 7: errorCode=TestFloatArray(count); break;
+		case 8: errorCode=TestDoubleArray(count); break;
+		default: errorCode=TestBoolArray(count); break;
+		}
+		if (errorCode!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError(ErrorCodeToString(errorCode)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return errorCode;
+		}
+	}
+
+	// Counts from the network so large that the number of bits wraps in BitSize_t
+	{
+		BitStream bitStream;
+		bitStream.Write((unsigned int) 12345);
+		unsigned int output[1];
+		if (bitStream.ReadArray(output, 0x08000000) || bitStream.ReadArray(output, 0x08000001) || bitStream.GetReadOffset()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError(ErrorCodeToString(3)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 3;
+		}
+	}
+
+	return 0;
+}
+
+RakString BitStreamArrayTest::GetTestName()
+{
+
+	return "BitStreamArrayTest";
+
+}
+
+RakString BitStreamArrayTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "WriteArray wrote different bits from Write on each element";
+		break;
+	case 2:
+		return "An array read back differently";
+		break;
+	case 3:
+		return "Reading more than was written did not fail, or moved the read offset";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamArrayTest::BitStreamArrayTest(void)
+{
+}
+
+BitStreamArrayTest::~BitStreamArrayTest(void)
+{
+}
+
+void BitStreamArrayTest::DestroyPeers()
+{
+}
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamChainTest.h"
+
+/*
+Description:
+Sends messages made of a header BitStream, a cached payload, and a trailer, as a BitStreamChain, without copying them into one BitStream first.
+The header changes every message, and the payload is large enough to be split on some messages, and small enough not to be on others.
+
+Success conditions:
+Each message arrives as the segments joined at byte boundaries, in order.
+The header BitStream can be rewritten as soon as Send() returns.
+CopyTo() gives the same bytes as what was sent.
+A chain does not take more than BITSTREAM_CHAIN_MAX_SEGMENTS segments.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+
+RakPeerInterface Functions Explicitly Tested:
+SendChain
+
+BitStreamChain Functions Explicitly Tested:
+AppendReference
+Reset
+GetNumberOfBytesUsed
+CopyTo
+*/
+
+static const int CHAIN_MESSAGE_COUNT=50;
+static const int CHAIN_PAYLOAD_SIZE=4000;
+
+int BitStreamChainTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	static char payload[CHAIN_PAYLOAD_SIZE];
+	int i;
+	for (i=0; i < CHAIN_PAYLOAD_SIZE; i++)
+		payload[i]=(char) (i*7);
+	const char trailer[3]={'e','n','d'};
+
+	// Limit on segments, and CopyTo
+	{
+		BitStreamChain chain;
+		for (i=0; i < BITSTREAM_CHAIN_MAX_SEGMENTS; i++)
+			chain.AppendReference(payload+i, 1);
+		if (chain.AppendReference(payload, 1) || chain.GetNumberOfBytesUsed()!=BITSTREAM_CHAIN_MAX_SEGMENTS)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A chain took more than BITSTREAM_CHAIN_MAX_SEGMENTS segments\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 1;
+		}
+
+		BitStream header;
+		header.Write(true);
+		chain.Reset();
+		chain.AppendReference(&header);
+		chain.AppendReference(payload, 100);
+		BitStream copy;
+		chain.CopyTo(&copy);
+		if (copy.GetNumberOfBytesUsed()!=101 || copy.GetData()[0]!=0x80 || memcmp(copy.GetData()+1, payload, 100)!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("CopyTo did not give the segments joined at byte boundaries\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 2;
+		}
+	}
+
+	RakPeerInterface *sender=RakPeerInterface::GetInstance();
+	destroyList.Push(sender,_FILE_AND_LINE_);
+	RakPeerInterface *receiver=RakPeerInterface::GetInstance();
+	destroyList.Push(receiver,_FILE_AND_LINE_);
+	SocketDescriptor senderSd(0, "127.0.0.1"), receiverSd(0, "127.0.0.1");
+	sender->Startup(1, &senderSd, 1);
+	receiver->Startup(1, &receiverSd, 1);
+	receiver->SetMaximumIncomingConnections(1);
+	sender->Connect("127.0.0.1", receiver->GetMyBoundAddress().GetPort(), 0, 0);
+
+	int received=0;
+	bool badMessage=false, sent=false;
+	TimeMS entryTime=GetTimeMS();
+	while (received < CHAIN_MESSAGE_COUNT && GetTimeMS()-entryTime<10000)
+	{
+		Packet *packet;
+		for (packet=sender->Receive(); packet; sender->DeallocatePacket(packet), packet=sender->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED && sent==false)
+			{
+				sent=true;
+				BitStream header;
+				for (int message=0; message < CHAIN_MESSAGE_COUNT; message++)
+				{
+					// A header that ends part way through a byte, rewritten for every message
+					header.Reset();
+					header.Write((MessageID) ID_USER_PACKET_ENUM);
+					header.Write(message);
+					header.Write(true);
+
+					BitStreamChain chain;
+					chain.AppendReference(&header);
+					// Some small enough to go in one datagram, some split
+					chain.AppendReference(payload, (message & 1) ? CHAIN_PAYLOAD_SIZE : 100);
+					chain.AppendReference(trailer, sizeof(trailer));
+					sender->SendChain(&chain, HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->guid, false);
+				}
+			}
+		}
+
+		for (packet=receiver->Receive(); packet; receiver->DeallocatePacket(packet), packet=receiver->Receive())
+		{
+			if (packet->data[0]!=ID_USER_PACKET_ENUM)
+				continue;
+
+			BitStream bitStream(packet->data, packet->length, false);
+			bitStream.IgnoreBytes(sizeof(MessageID));
+			int message;
+			bool flag;
+			bitStream.Read(message);
+			bitStream.Read(flag);
+			bitStream.AlignReadToByteBoundary();
+			unsigned int payloadLength = (message & 1) ? CHAIN_PAYLOAD_SIZE : 100;
+			const unsigned char *rest = packet->data + BITS_TO_BYTES(bitStream.GetReadOffset());
+			if (message!=received || flag==false ||
+				packet->length!=BITS_TO_BYTES(bitStream.GetReadOffset())+payloadLength+sizeof(trailer) ||
+				memcmp(rest, payload, payloadLength)!=0 || memcmp(rest+payloadLength, trailer, sizeof(trailer))!=0)
+				badMessage=true;
+			received++;
+		}
+		RakSleep(10);
+	}
+
+	if (received!=CHAIN_MESSAGE_COUNT)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Not all messages arrived\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	if (badMessage)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("A message did not arrive as its segments joined in order\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	return 0;
+}
+
+RakString BitStreamChainTest::GetTestName()
+{
+
+	return "BitStreamChainTest";
+
+}
+
+RakString BitStreamChainTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "A chain took more than BITSTREAM_CHAIN_MAX_SEGMENTS segments";
+		break;
+	case 2:
+		return "CopyTo did not give the segments joined at byte boundaries";
+		break;
+	case 3:
+		return "Not all messages arrived";
+		break;
+	case 4:
+		return "A message did not arrive as its segments joined in order";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamChainTest::BitStreamChainTest(void)
+{
+}
+
+BitStreamChainTest::~BitStreamChainTest(void)
+{
+}
+
+void BitStreamChainTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
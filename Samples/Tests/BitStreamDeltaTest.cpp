@@ -0,0 +1,229 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamDeltaTest.h"
+#include <string.h>
+
+/*
+Description:
+Takes random snapshots and changes some of their bits, grows or shrinks them, and sends the delta from the original to the changed one at a random bit offset.
+Then reads cut off, random, and corrupt deltas.
+
+Success conditions:
+The stream read back has exactly the bits of the changed snapshot.
+A delta of an unchanged snapshot takes only a few bytes, whatever its size.
+The delta of a few changed bytes is much smaller than the snapshot.
+Reading a cut off, random, or corrupt delta fails without moving the read offset, or succeeds without reading past the end.
+
+Failure conditions:
+Any success conditions failed
+
+BitStream Functions Explicitly Tested:
+WriteBitStreamDelta
+ReadBitStreamDelta
+*/
+
+static void WriteRandomBits(BitStream &bitStream, BitSize_t bits)
+{
+	unsigned char randomData[512];
+	while (bits > 0)
+	{
+		BitSize_t chunk = bits < BYTES_TO_BITS(sizeof(randomData)) ? bits : BYTES_TO_BITS(sizeof(randomData));
+		fillBufferMT(randomData, sizeof(randomData));
+		bitStream.WriteBits(randomData, chunk, false);
+		bits-=chunk;
+	}
+}
+
+static bool SameBits(const BitStream &a, const BitStream &b)
+{
+	if (a.GetNumberOfBitsUsed()!=b.GetNumberOfBitsUsed())
+		return false;
+	BitSize_t bits=a.GetNumberOfBitsUsed();
+	if (memcmp(a.GetData(), b.GetData(), (size_t) (bits >> 3))!=0)
+		return false;
+	if ((bits & 7)==0)
+		return true;
+	unsigned char mask = (unsigned char) (0xFF << (8 - (bits & 7)));
+	return (a.GetData()[bits >> 3] & mask)==(b.GetData()[bits >> 3] & mask);
+}
+
+int BitStreamDeltaTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	int round;
+
+	// Round trip
+	for (round=0; round < 2000; round++)
+	{
+		BitStream baseline, current;
+		BitSize_t baselineBits = randomMT() % 4 == 0 ? randomMT() % 64 : randomMT() % 20000;
+		WriteRandomBits(baseline, baselineBits);
+		// Leave junk past the end of the baseline, which must not get into the result
+		baseline.SetWriteOffset(baselineBits - (baselineBits > 0 && randomMT() % 2 ? 1 : 0));
+		current.Write(baseline);
+
+		int changes = randomMT() % 8;
+		for (int i=0; i < changes && current.GetNumberOfBitsUsed() > 0; i++)
+		{
+			BitSize_t bit = randomMT() % current.GetNumberOfBitsUsed();
+			current.GetData()[bit >> 3] ^= (unsigned char) (0x80 >> (bit & 7));
+		}
+		switch (randomMT() % 4)
+		{
+		case 0:
+			WriteRandomBits(current, randomMT() % 300);
+			break;
+		case 1:
+			current.SetWriteOffset(current.GetNumberOfBitsUsed() > 0 ? randomMT() % current.GetNumberOfBitsUsed() : 0);
+			break;
+		}
+
+		BitStream delta;
+		int leadingBits = randomMT() % 8;
+		for (int i=0; i < leadingBits; i++)
+			delta.Write1();
+		delta.WriteBitStreamDelta(&current, &baseline);
+		delta.Write(true);
+
+		BitStream result;
+		// Something in the result already, which must be replaced
+		result.Write(round);
+		bool trailing=false;
+		delta.IgnoreBits(leadingBits);
+		if (delta.ReadBitStreamDelta(&baseline, &result)==false || delta.Read(trailing)==false || trailing==false ||
+			delta.GetNumberOfUnreadBits()!=0 || SameBits(result, current)==false || result.GetReadOffset()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A snapshot read back differently\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 1;
+		}
+	}
+
+	// Sizes
+	{
+		BitStream baseline, current, unchangedDelta, changedDelta;
+		WriteRandomBits(baseline, 80000);
+		current.Write(baseline);
+		unchangedDelta.WriteBitStreamDelta(&current, &baseline);
+		for (int i=0; i < 4; i++)
+			current.GetData()[randomMT() % current.GetNumberOfBytesUsed()] ^= 0x10;
+		changedDelta.WriteBitStreamDelta(&current, &baseline);
+		if (unchangedDelta.GetNumberOfBytesUsed() > 8 || changedDelta.GetNumberOfBytesUsed() > 40)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A delta was larger than expected\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 2;
+		}
+	}
+
+	// Cut off
+	for (round=0; round < 200; round++)
+	{
+		BitStream baseline, current, delta, result;
+		WriteRandomBits(baseline, randomMT() % 2000);
+		WriteRandomBits(current, 1 + randomMT() % 2000);
+		delta.WriteBitStreamDelta(&current, &baseline);
+		delta.SetWriteOffset(randomMT() % delta.GetNumberOfBitsUsed());
+		if (delta.ReadBitStreamDelta(&baseline, &result) || delta.GetReadOffset()!=0 || result.GetNumberOfBitsUsed()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A cut off delta was read\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 3;
+		}
+	}
+
+	// Random data, which must never read past the end
+	for (round=0; round < 20000; round++)
+	{
+		unsigned char randomData[32];
+		fillBufferMT(randomData, sizeof(randomData));
+		BitStream delta(randomData, 1 + randomMT() % sizeof(randomData), false);
+		BitStream baseline, result;
+		WriteRandomBits(baseline, randomMT() % 400);
+		if (delta.ReadBitStreamDelta(&baseline, &result)==false && delta.GetReadOffset()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A failed read moved the read offset\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 4;
+		}
+		if (delta.GetReadOffset() > delta.GetNumberOfBitsUsed())
+		{
+			if (isVerbose)
+				DebugTools::ShowError("Read past the end of the delta\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 4;
+		}
+	}
+
+	// Lengths near the top of BitSize_t, where rounding up to bytes would wrap
+	{
+		const BitSize_t corruptLengths[] = {(BitSize_t) 0xFFFFFFFF, (BitSize_t) 0xFFFFFFF9, (BitSize_t) 0xFFFFFFF8};
+		for (unsigned int i=0; i < sizeof(corruptLengths)/sizeof(corruptLengths[0]); i++)
+		{
+			BitStream delta, baseline, result;
+			delta.WriteVarInt(corruptLengths[i]);
+			WriteRandomBits(baseline, 100);
+			if (delta.ReadBitStreamDelta(&baseline, &result) || delta.GetReadOffset()!=0 || result.GetNumberOfBitsUsed()!=0)
+			{
+				if (isVerbose)
+					DebugTools::ShowError("A delta longer than the baseline and the data sent was read\n",!noPauses && isVerbose,__LINE__,__FILE__);
+				return 4;
+			}
+		}
+	}
+
+	return 0;
+}
+
+RakString BitStreamDeltaTest::GetTestName()
+{
+
+	return "BitStreamDeltaTest";
+
+}
+
+RakString BitStreamDeltaTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "A snapshot read back differently";
+		break;
+	case 2:
+		return "A delta was larger than expected";
+		break;
+	case 3:
+		return "A cut off delta was read";
+		break;
+	case 4:
+		return "Reading a random or corrupt delta went wrong";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamDeltaTest::BitStreamDeltaTest(void)
+{
+}
+
+BitStreamDeltaTest::~BitStreamDeltaTest(void)
+{
+}
+
+void BitStreamDeltaTest::DestroyPeers()
+{
+}
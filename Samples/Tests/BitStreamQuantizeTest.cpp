@@ -0,0 +1,288 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamQuantizeTest.h"
+#include <math.h>
+#include <string.h>
+
+/*
+Description:
+Writes random arrays of floats, vectors and quaternions with the batched quantizing calls at random bit offsets, and reads them back.
+Array lengths are random, so the SIMD and scalar paths both run, and some values are out of range.
+
+Success conditions:
+WriteFloat16Array and WriteNormVectorArray write the same bits as WriteFloat16 and WriteNormVector one at a time.
+Values read back within a quantization step of what was written, clamped to the range, or half a step for WriteQuantizedVectorArray, which rounds.
+Quaternions read back within a degree of the rotation written, with 10 or more bits per component.
+A quaternion written alone gives the same bits as when written with others.
+The stream ends where it was written to, and reading more than was written fails without moving the read offset.
+
+Failure conditions:
+Any success conditions failed
+
+BitStream Functions Explicitly Tested:
+WriteFloat16Array
+ReadFloat16Array
+WriteNormVectorArray
+ReadNormVectorArray
+WriteQuantizedVectorArray
+ReadQuantizedVectorArray
+WriteSmallestThreeQuatArray
+ReadSmallestThreeQuatArray
+*/
+
+static float RandomFloat(float floatMin, float floatMax)
+{
+	return floatMin + (floatMax-floatMin) * frandomMT();
+}
+
+static float Clamp(float f, float floatMin, float floatMax)
+{
+	return f < floatMin ? floatMin : (f > floatMax ? floatMax : f);
+}
+
+static void WriteLeadingBits(BitStream &bitStream, int leadingBits)
+{
+	for (int i=0; i < leadingBits; i++)
+		bitStream.Write1();
+}
+
+// Rotation between two quaternions in degrees, where q and -q are the same rotation
+static float AngleBetween(const float *a, const float *b)
+{
+	float dot = fabsf(a[0]*b[0]+a[1]*b[1]+a[2]*b[2]+a[3]*b[3]);
+	if (dot > 1.0f)
+		dot=1.0f;
+	return 2.0f * acosf(dot) * 57.2957795f;
+}
+
+int BitStreamQuantizeTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	const unsigned int maxCount=700;
+	float *input = new float[maxCount*4];
+	float *output = new float[maxCount*4];
+	int errorCode=0;
+
+	for (int round=0; round < 200 && errorCode==0; round++)
+	{
+		unsigned int count = randomMT() % maxCount;
+		int leadingBits = randomMT() % 8;
+		unsigned int i;
+		bool trailing;
+
+		// Normalized vectors, as float16, against one at a time
+		for (i=0; i < count*3; i++)
+			input[i]=RandomFloat(-1.2f, 1.2f);
+		BitStream batched, perValue;
+		WriteLeadingBits(batched, leadingBits);
+		WriteLeadingBits(perValue, leadingBits);
+		batched.WriteNormVectorArray(input, count);
+		batched.Write(true);
+		for (i=0; i < count; i++)
+			perValue.WriteNormVector(input[i*3], input[i*3+1], input[i*3+2]);
+		perValue.Write(true);
+		if (batched.GetNumberOfBitsUsed()!=perValue.GetNumberOfBitsUsed() || memcmp(batched.GetData(), perValue.GetData(), batched.GetNumberOfBytesUsed())!=0)
+		{
+			errorCode=1;
+			break;
+		}
+		trailing=false;
+		batched.IgnoreBits(leadingBits);
+		if (batched.ReadNormVectorArray(output, count)==false || batched.Read(trailing)==false || trailing==false || batched.GetNumberOfUnreadBits()!=0)
+		{
+			errorCode=2;
+			break;
+		}
+		// WriteFloat16() truncates, so this is up to a whole step
+		for (i=0; i < count*3; i++)
+		{
+			if (fabsf(output[i]-Clamp(input[i], -1.0f, 1.0f)) > 2.0f/65535.0f + .00001f)
+			{
+				errorCode=3;
+				break;
+			}
+		}
+
+		// Floats in a range, as float16, against one at a time
+		float floatMin = RandomFloat(-1000.0f, 0.0f);
+		float floatMax = floatMin + RandomFloat(1.0f, 2000.0f);
+		for (i=0; i < count; i++)
+			input[i]=RandomFloat(floatMin-10.0f, floatMax+10.0f);
+		BitStream batchedFloats, perValueFloats;
+		batchedFloats.WriteFloat16Array(input, count, floatMin, floatMax);
+		for (i=0; i < count; i++)
+			perValueFloats.WriteFloat16(input[i], floatMin, floatMax);
+		if (batchedFloats.GetNumberOfBitsUsed()!=perValueFloats.GetNumberOfBitsUsed() || memcmp(batchedFloats.GetData(), perValueFloats.GetData(), batchedFloats.GetNumberOfBytesUsed())!=0)
+		{
+			errorCode=1;
+			break;
+		}
+		if (batchedFloats.ReadFloat16Array(output, count, floatMin, floatMax)==false || batchedFloats.GetNumberOfUnreadBits()!=0)
+		{
+			errorCode=2;
+			break;
+		}
+
+		// Vectors at any number of bits
+		int bitsPerComponent = 1 + randomMT() % 24;
+		for (i=0; i < count*3; i++)
+			input[i]=RandomFloat(floatMin-10.0f, floatMax+10.0f);
+		BitStream vectors;
+		WriteLeadingBits(vectors, leadingBits);
+		vectors.WriteQuantizedVectorArray(input, count, floatMin, floatMax, bitsPerComponent);
+		vectors.Write(true);
+		trailing=false;
+		vectors.IgnoreBits(leadingBits);
+		if (vectors.GetNumberOfBitsUsed()!=(BitSize_t) (leadingBits + count*3*bitsPerComponent + 1) ||
+			vectors.ReadQuantizedVectorArray(output, count, floatMin, floatMax, bitsPerComponent)==false || vectors.Read(trailing)==false || trailing==false)
+		{
+			errorCode=2;
+			break;
+		}
+		float halfStep = (floatMax-floatMin) / (float) ((1 << bitsPerComponent) - 1) * .5f;
+		for (i=0; i < count*3; i++)
+		{
+			if (fabsf(output[i]-Clamp(input[i], floatMin, floatMax)) > halfStep + (floatMax-floatMin) * .00001f)
+			{
+				errorCode=3;
+				break;
+			}
+		}
+
+		// Reading more than was written
+		vectors.SetReadOffset(leadingBits);
+		if (vectors.ReadQuantizedVectorArray(output, count+1, floatMin, floatMax, bitsPerComponent) || vectors.GetReadOffset()!=(BitSize_t) leadingBits)
+		{
+			errorCode=4;
+			break;
+		}
+
+		// Quaternions, including ties for the largest component
+		bitsPerComponent = 2 + randomMT() % 23;
+		for (i=0; i < count; i++)
+		{
+			float *q=input+i*4, length=0.0f;
+			int j;
+			for (j=0; j < 4; j++)
+			{
+				q[j]=RandomFloat(-1.0f, 1.0f);
+				length+=q[j]*q[j];
+			}
+			length=sqrtf(length);
+			for (j=0; j < 4; j++)
+				q[j]/=length;
+			if (i % 17 == 0)
+			{
+				q[0]=.5f;
+				q[1]=-.5f;
+				q[2]=.5f;
+				q[3]=-.5f;
+			}
+		}
+		BitStream quaternions;
+		WriteLeadingBits(quaternions, leadingBits);
+		quaternions.WriteSmallestThreeQuatArray(input, count, bitsPerComponent);
+		quaternions.Write(true);
+		trailing=false;
+		quaternions.IgnoreBits(leadingBits);
+		if (quaternions.GetNumberOfBitsUsed()!=(BitSize_t) (leadingBits + count*(2+3*bitsPerComponent) + 1) ||
+			quaternions.ReadSmallestThreeQuatArray(output, count, bitsPerComponent)==false || quaternions.Read(trailing)==false || trailing==false)
+		{
+			errorCode=2;
+			break;
+		}
+		if (bitsPerComponent >= 10)
+		{
+			for (i=0; i < count; i++)
+			{
+				if (AngleBetween(input+i*4, output+i*4) > 1.0f)
+				{
+					errorCode=3;
+					break;
+				}
+			}
+		}
+		if (count >= 8)
+		{
+			// The fifth quaternion takes the SIMD path in a batch of eight, and the scalar path alone
+			BitStream alone, together;
+			alone.WriteSmallestThreeQuatArray(input+4*4, 1, bitsPerComponent);
+			together.WriteSmallestThreeQuatArray(input, 8, bitsPerComponent);
+			unsigned char aloneBits[12], togetherBits[12];
+			memset(aloneBits, 0, sizeof(aloneBits));
+			memset(togetherBits, 0, sizeof(togetherBits));
+			together.SetReadOffset(4*(2+3*bitsPerComponent));
+			alone.ReadBits(aloneBits, 2+3*bitsPerComponent);
+			together.ReadBits(togetherBits, 2+3*bitsPerComponent);
+			if (memcmp(aloneBits, togetherBits, sizeof(aloneBits))!=0)
+			{
+				errorCode=5;
+				break;
+			}
+		}
+	}
+
+	delete [] input;
+	delete [] output;
+
+	if (errorCode!=0 && isVerbose)
+		DebugTools::ShowError(ErrorCodeToString(errorCode)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+	return errorCode;
+}
+
+RakString BitStreamQuantizeTest::GetTestName()
+{
+
+	return "BitStreamQuantizeTest";
+
+}
+
+RakString BitStreamQuantizeTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Batched float16 writes differ from writing one at a time";
+		break;
+	case 2:
+		return "A batch did not read back, or took the wrong number of bits";
+		break;
+	case 3:
+		return "A value read back further from what was written than the quantization allows";
+		break;
+	case 4:
+		return "Reading more than was written did not fail, or moved the read offset";
+		break;
+	case 5:
+		return "A quaternion written alone differs from the same quaternion written with others";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamQuantizeTest::BitStreamQuantizeTest(void)
+{
+}
+
+BitStreamQuantizeTest::~BitStreamQuantizeTest(void)
+{
+}
+
+void BitStreamQuantizeTest::DestroyPeers()
+{
+}
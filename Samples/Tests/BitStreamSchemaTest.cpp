@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamSchemaTest.h"
+
+/*
+Description:
+Writes random objects with a BitStreamSchema of ranges, an integer, a bool and a float at random bit offsets, and reads them back.
+Then writes members outside their ranges, and reads fields whose bits hold more than their range.
+
+Success conditions:
+Objects read back as written, with floats within a step.
+Members outside their range are written as the nearest end of it.
+Bits that decode past either end of a range read as that end.
+Reading with too few bits left fails without changing the object or the read offset.
+
+Failure conditions:
+Any success conditions failed
+
+BitStreamSchema Functions Explicitly Tested:
+Serialize
+Deserialize
+*/
+
+struct SchemaTestObject
+{
+	int health;
+	short offset;
+	int wide;
+	unsigned char team;
+	bool isCrouching;
+	float x;
+};
+
+// 101 values in 7 bits each, so 27 encodings are past the end of each range
+typedef BitStreamSchema<
+	SchemaRange<SchemaTestObject, int, &SchemaTestObject::health, 0, 100>,
+	SchemaRange<SchemaTestObject, short, &SchemaTestObject::offset, -50, 50>,
+	SchemaRange<SchemaTestObject, int, &SchemaTestObject::wide, -2147483647-1, 2147483647>,
+	SchemaInteger<SchemaTestObject, unsigned char, &SchemaTestObject::team>,
+	SchemaBool<SchemaTestObject, &SchemaTestObject::isCrouching>,
+	SchemaFloat<SchemaTestObject, &SchemaTestObject::x, -1000, 1000, 20> > SchemaTestSchema;
+
+typedef BitStreamSchema<SchemaRange<SchemaTestObject, int, &SchemaTestObject::health, 0, 100> > SchemaTestHealthSchema;
+typedef BitStreamSchema<SchemaRange<SchemaTestObject, short, &SchemaTestObject::offset, -50, 50> > SchemaTestOffsetSchema;
+
+static bool SchemaTestEqual(const SchemaTestObject &a, const SchemaTestObject &b)
+{
+	// A 2000/(2^20-1) step. Rounding only loses half of one, but the arithmetic is in float
+	const float tolerance = .002f;
+	return a.health==b.health && a.offset==b.offset && a.wide==b.wide && a.team==b.team && a.isCrouching==b.isCrouching &&
+		a.x-b.x < tolerance && b.x-a.x < tolerance;
+}
+
+// Writes object after a random number of bits, and returns what is read back
+static bool SchemaTestRoundTrip(const SchemaTestObject &object, SchemaTestObject &output)
+{
+	BitStream bitStream;
+	int leadingBits = randomMT() % 8;
+	for (int i=0; i < leadingBits; i++)
+		bitStream.Write1();
+	SchemaTestSchema::Serialize(&bitStream, object);
+	bitStream.IgnoreBits(leadingBits);
+	return SchemaTestSchema::Deserialize(&bitStream, output) && bitStream.GetNumberOfUnreadBits()==0;
+}
+
+// Reads a 7 bit encoding with schema
+template <class Schema>
+static SchemaTestObject SchemaTestDecode(unsigned char encoded)
+{
+	BitStream bitStream;
+	bitStream.WriteBits(&encoded, 7, true);
+	SchemaTestObject object;
+	memset(&object, 0, sizeof(object));
+	Schema::Deserialize(&bitStream, object);
+	return object;
+}
+
+int BitStreamSchemaTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	int errorCode=0;
+	SchemaTestObject object, output;
+
+	for (int i=0; i < 1000 && errorCode==0; i++)
+	{
+		object.health=(int) (randomMT() % 101);
+		object.offset=(short) ((int) (randomMT() % 101) - 50);
+		object.wide=(int) randomMT();
+		object.team=(unsigned char) randomMT();
+		object.isCrouching=(randomMT() & 1)!=0;
+		object.x=frandomMT() * 2000.0f - 1000.0f;
+		if (SchemaTestRoundTrip(object, output)==false || SchemaTestEqual(object, output)==false)
+			errorCode=1;
+	}
+
+	// Written outside the range
+	if (errorCode==0)
+	{
+		object.health=150;
+		object.offset=-70;
+		object.x=5000.0f;
+		if (SchemaTestRoundTrip(object, output)==false || output.health!=100 || output.offset!=-50 || output.x!=1000.0f)
+			errorCode=2;
+		object.health=-10;
+		object.offset=70;
+		object.x=-5000.0f;
+		if (SchemaTestRoundTrip(object, output)==false || output.health!=0 || output.offset!=50 || output.x!=-1000.0f)
+			errorCode=2;
+	}
+
+	// Read past the end of the range
+	for (unsigned int encoded=0; encoded < 128 && errorCode==0; encoded++)
+	{
+		int expectedHealth = encoded > 100 ? 100 : (int) encoded;
+		int expectedOffset = encoded > 100 ? 50 : (int) encoded - 50;
+		if (SchemaTestDecode<SchemaTestHealthSchema>((unsigned char) encoded).health!=expectedHealth ||
+			SchemaTestDecode<SchemaTestOffsetSchema>((unsigned char) encoded).offset!=expectedOffset)
+			errorCode=3;
+	}
+
+	// Too few bits
+	if (errorCode==0)
+	{
+		BitStream bitStream;
+		object.health=1;
+		SchemaTestSchema::Serialize(&bitStream, object);
+		BitStream shortStream(bitStream.GetData(), BITS_TO_BYTES(SchemaTestSchema::BITS)-1, false);
+		output=object;
+		output.health=2;
+		if (SchemaTestSchema::Deserialize(&shortStream, output) || output.health!=2 || shortStream.GetReadOffset()!=0)
+			errorCode=4;
+	}
+
+	if (errorCode!=0 && isVerbose)
+		DebugTools::ShowError(ErrorCodeToString(errorCode)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+	return errorCode;
+}
+
+RakString BitStreamSchemaTest::GetTestName()
+{
+
+	return "BitStreamSchemaTest";
+
+}
+
+RakString BitStreamSchemaTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "An object read back differently";
+		break;
+	case 2:
+		return "A member outside its range was not written as the nearest end of it";
+		break;
+	case 3:
+		return "A field read past the end of its range was not clamped";
+		break;
+	case 4:
+		return "Reading with too few bits did not fail, or changed the object or read offset";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamSchemaTest::BitStreamSchemaTest(void)
+{
+}
+
+BitStreamSchemaTest::~BitStreamSchemaTest(void)
+{
+}
+
+void BitStreamSchemaTest::DestroyPeers()
+{
+}
@@ -0,0 +1,271 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamVarIntTest.h"
+
+/*
+Description:
+Writes random integers of every width as variable length integers, signed and unsigned, at random bit offsets, and reads them back.
+Then reads random and cut off streams, which must fail or succeed without reading past the end.
+
+Success conditions:
+Every value reads back the same, and the stream ends where it was written to.
+Values take the expected number of bytes.
+Reading a value too large for the type, a cut off value, or a value encoded with more bytes than needed fails without moving the read offset.
+
+Failure conditions:
+Any success conditions failed
+
+BitStream Functions Explicitly Tested:
+WriteVarInt
+WriteVarIntSigned
+ReadVarInt
+ReadVarIntSigned
+SerializeVarInt
+SerializeVarIntSigned
+*/
+
+// Random value with a random number of significant bits, so every length of encoding comes up
+static uint64_t RandomValue(void)
+{
+	uint64_t value = ((uint64_t) randomMT() << 32) | randomMT();
+	int bits = randomMT() % 65;
+	if (bits < 64)
+		value &= ((uint64_t) 1 << bits) - 1;
+	if (randomMT() & 1)
+		value = (uint64_t) -(int64_t) value;
+	return value;
+}
+
+template <class templateType>
+static void WriteRandom(BitStream &bitStream, uint64_t *values, unsigned char *types, int index, unsigned char type)
+{
+	templateType value = (templateType) RandomValue();
+	values[index] = (uint64_t) value;
+	types[index] = type;
+	if (type & 1)
+		bitStream.WriteVarIntSigned(value);
+	else
+		bitStream.WriteVarInt(value);
+}
+
+template <class templateType>
+static bool ReadAndCompare(BitStream &bitStream, uint64_t expected, bool isSigned, bool useSerialize)
+{
+	templateType value;
+	bool success;
+	if (useSerialize)
+		success = isSigned ? bitStream.SerializeVarIntSigned(false, value) : bitStream.SerializeVarInt(false, value);
+	else
+		success = isSigned ? bitStream.ReadVarIntSigned(value) : bitStream.ReadVarInt(value);
+	return success && (uint64_t) value == expected;
+}
+
+static unsigned int WrittenBytes(int64_t value, bool isSigned)
+{
+	BitStream bitStream;
+	if (isSigned)
+		bitStream.WriteVarIntSigned(value);
+	else
+		bitStream.WriteVarInt(value);
+	return bitStream.GetNumberOfBytesUsed();
+}
+
+int BitStreamVarIntTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	const int valueCount=200;
+	uint64_t values[valueCount];
+	unsigned char types[valueCount];
+	int round, i;
+
+	// Round trip
+	for (round=0; round < 2000; round++)
+	{
+		BitStream bitStream;
+		// Start at a random offset, so both the aligned and unaligned paths are used
+		int leadingBits = randomMT() % 8;
+		for (i=0; i < leadingBits; i++)
+			bitStream.Write1();
+
+		int count = 1 + randomMT() % valueCount;
+		for (i=0; i < count; i++)
+		{
+			// Low bit is signed, the rest is the width
+			unsigned char type = (unsigned char) (randomMT() % 8);
+			switch (type >> 1)
+			{
+			case 0: WriteRandom<char>(bitStream, values, types, i, type); break;
+			case 1: WriteRandom<short>(bitStream, values, types, i, type); break;
+			case 2: WriteRandom<int>(bitStream, values, types, i, type); break;
+			default: WriteRandom<int64_t>(bitStream, values, types, i, type); break;
+			}
+			// Sometimes unalign what follows
+			if (randomMT() % 4 == 0)
+			{
+				bitStream.Write0();
+				types[i] |= 0x80;
+			}
+		}
+
+		bitStream.IgnoreBits(leadingBits);
+		for (i=0; i < count; i++)
+		{
+			bool isSigned = (types[i] & 1)!=0;
+			bool useSerialize = (i & 1)!=0;
+			bool success;
+			switch ((types[i] & 0x7F) >> 1)
+			{
+			case 0: success = ReadAndCompare<char>(bitStream, values[i], isSigned, useSerialize); break;
+			case 1: success = ReadAndCompare<short>(bitStream, values[i], isSigned, useSerialize); break;
+			case 2: success = ReadAndCompare<int>(bitStream, values[i], isSigned, useSerialize); break;
+			default: success = ReadAndCompare<int64_t>(bitStream, values[i], isSigned, useSerialize); break;
+			}
+			if (success==false)
+			{
+				if (isVerbose)
+					DebugTools::ShowError("A value read back differently\n",!noPauses && isVerbose,__LINE__,__FILE__);
+				return 1;
+			}
+			if (types[i] & 0x80)
+				bitStream.IgnoreBits(1);
+		}
+		if (bitStream.GetNumberOfUnreadBits()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("The stream did not end where it was written to\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 1;
+		}
+	}
+
+	// Sizes
+	if (WrittenBytes(0,false)!=1 || WrittenBytes(127,false)!=1 || WrittenBytes(128,false)!=2 || WrittenBytes(16383,false)!=2 || WrittenBytes(16384,false)!=3 ||
+		WrittenBytes(-1,false)!=10 || WrittenBytes(-64,true)!=1 || WrittenBytes(63,true)!=1 || WrittenBytes(64,true)!=2 || WrittenBytes(-65,true)!=2 ||
+		WrittenBytes((int64_t) 0x7FFFFFFFFFFFFFFFLL,true)!=10)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Values were not written with the expected number of bytes\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	// Too large for the type, cut off, and longer than needed
+	{
+		BitStream bitStream;
+		bitStream.WriteVarInt((unsigned int) 300);
+		unsigned char smallValue;
+		unsigned int value;
+		if (bitStream.ReadVarInt(smallValue) || bitStream.GetReadOffset()!=0 || bitStream.ReadVarInt(value)==false || value!=300)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A value too large for the type was read\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 3;
+		}
+
+		BitStream cutOff;
+		cutOff.WriteVarInt((unsigned int) 0x7FFFFFFF);
+		cutOff.SetWriteOffset(cutOff.GetNumberOfBitsUsed()-9);
+		if (cutOff.ReadVarInt(value) || cutOff.GetReadOffset()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A cut off value was read\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 3;
+		}
+
+		// Longer than needed: 0 as two bytes, and 1 as three
+		const unsigned char overlong[] = {0x80, 0x00, 0x81, 0x80, 0x00};
+		BitStream overlongZero((unsigned char*) overlong, 2, false);
+		BitStream overlongOne((unsigned char*) overlong+2, 3, false);
+		if (overlongZero.ReadVarInt(value) || overlongZero.GetReadOffset()!=0 || overlongOne.ReadVarInt(value) || overlongOne.GetReadOffset()!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A value encoded with more bytes than needed was read\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 3;
+		}
+	}
+
+	// Random data, which must never read past the end
+	for (round=0; round < 20000; round++)
+	{
+		unsigned char randomData[12];
+		fillBufferMT(randomData, sizeof(randomData));
+		BitStream bitStream(randomData, 1 + randomMT() % sizeof(randomData), false);
+		bitStream.IgnoreBits(randomMT() % 8);
+		int64_t value;
+		while (bitStream.GetNumberOfUnreadBits() > 0)
+		{
+			BitSize_t readOffset = bitStream.GetReadOffset();
+			bool success = (round & 1) ? bitStream.ReadVarIntSigned(value) : bitStream.ReadVarInt(value);
+			if (success==false)
+			{
+				if (bitStream.GetReadOffset()!=readOffset)
+				{
+					if (isVerbose)
+						DebugTools::ShowError("A failed read moved the read offset\n",!noPauses && isVerbose,__LINE__,__FILE__);
+					return 4;
+				}
+				break;
+			}
+			if (bitStream.GetReadOffset() > bitStream.GetNumberOfBitsUsed())
+			{
+				if (isVerbose)
+					DebugTools::ShowError("Read past the end of the stream\n",!noPauses && isVerbose,__LINE__,__FILE__);
+				return 4;
+			}
+		}
+	}
+
+	return 0;
+}
+
+RakString BitStreamVarIntTest::GetTestName()
+{
+
+	return "BitStreamVarIntTest";
+
+}
+
+RakString BitStreamVarIntTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "A value read back differently";
+		break;
+	case 2:
+		return "Values were not written with the expected number of bytes";
+		break;
+	case 3:
+		return "A value too large for the type, cut off, or longer than needed was read";
+		break;
+	case 4:
+		return "Reading random data went wrong";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamVarIntTest::BitStreamVarIntTest(void)
+{
+}
+
+BitStreamVarIntTest::~BitStreamVarIntTest(void)
+{
+}
+
+void BitStreamVarIntTest::DestroyPeers()
+{
+}
@@ -0,0 +1,215 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamViewTest.h"
+#include "BitStreamView.h"
+#include <string.h>
+
+/*
+Description:
+Writes messages of random integers, bits, strings, byte ranges and sub streams at random bit offsets, then reads them back with BitStreamView.
+Strings, byte ranges and sub streams are read with ReadStringView, ReadBytesView and ReadView, which point into the message.
+Then reads past the end of truncated messages.
+
+Success conditions:
+Everything reads back as written.
+Pointers and sub streams from the view point into the message, rather than at copies.
+A sub stream reads from its start, and ResetReadPointer returns there.
+ReadView frees a stream's heap memory before pointing it at the message.
+Reads past the end fail without moving the read offset.
+
+Failure conditions:
+Any success conditions failed
+
+BitStreamView Functions Explicitly Tested:
+Read
+ReadStringView
+ReadBytesView
+ReadView
+*/
+
+static bool InMessage(const void *pointer, const BitStream &message)
+{
+	const unsigned char *bytes = (const unsigned char *) pointer;
+	return bytes >= message.GetData() && bytes <= message.GetData() + message.GetNumberOfBytesUsed();
+}
+
+static int TestMessage(void)
+{
+	BitStream message;
+	int leadingBits = randomMT() % 8;
+	int i;
+	for (i=0; i < leadingBits; i++)
+		message.Write1();
+
+	unsigned int number = randomMT();
+	char string[300];
+	unsigned short stringLength = (unsigned short) (randomMT() % 300);
+	for (i=0; i < stringLength; i++)
+		string[i] = (char) ('a' + randomMT() % 26);
+	string[stringLength] = 0;
+	unsigned char bytes[100];
+	unsigned int byteCount = randomMT() % sizeof(bytes);
+	fillBufferMT(bytes, sizeof(bytes));
+	unsigned char subStreamBytes[600];
+	BitSize_t subStreamBits = randomMT() % BYTES_TO_BITS(sizeof(subStreamBytes));
+	fillBufferMT(subStreamBytes, sizeof(subStreamBytes));
+
+	message.Write(number);
+	RakString::Serialize(string, &message);
+	message.Write1();
+	message.WriteAlignedBytes(bytes, byteCount);
+	message.Write0();
+	message.AlignWriteToByteBoundary();
+	message.WriteBits(subStreamBytes, subStreamBits, false);
+	message.Write(number);
+
+	BitStreamView view(message.GetData(), message.GetNumberOfBytesUsed());
+	view.IgnoreBits(leadingBits);
+	unsigned int numberOutput;
+	const char *stringOutput;
+	unsigned short stringOutputLength;
+	const unsigned char *bytesOutput;
+	bool bit;
+	if (view.Read(numberOutput)==false || numberOutput!=number)
+		return 1;
+	if (view.ReadStringView(&stringOutput, &stringOutputLength)==false || stringOutputLength!=stringLength || memcmp(stringOutput, string, stringLength)!=0)
+		return 1;
+	if (view.Read(bit)==false || bit==false)
+		return 1;
+	if (view.ReadBytesView(&bytesOutput, byteCount)==false || memcmp(bytesOutput, bytes, byteCount)!=0)
+		return 1;
+	if (view.Read(bit)==false || bit==true)
+		return 1;
+	if (InMessage(stringOutput, message)==false || InMessage(bytesOutput, message)==false)
+		return 2;
+
+	// Read the sub stream into a stream that has outgrown its stack buffer, to check ReadView frees it
+	BitStream subStream;
+	subStream.WriteAlignedBytes(subStreamBytes, sizeof(subStreamBytes));
+	if (view.ReadView(&subStream, subStreamBits)==false)
+		return 1;
+	if (InMessage(subStream.GetData(), message)==false)
+		return 2;
+	unsigned char subStreamOutput[600];
+	for (int pass=0; pass < 2; pass++)
+	{
+		if (subStream.GetNumberOfBitsUsed()!=subStreamBits || subStream.GetReadOffset()!=0)
+			return 3;
+		if (subStream.ReadBits(subStreamOutput, subStreamBits, false)==false || subStream.GetNumberOfUnreadBits()!=0)
+			return 3;
+		if (memcmp(subStreamOutput, subStreamBytes, subStreamBits>>3)!=0 ||
+			((subStreamBits & 7) && ((subStreamOutput[subStreamBits>>3] ^ subStreamBytes[subStreamBits>>3]) & (0xFF << (8-(subStreamBits&7))))))
+			return 3;
+		subStream.ResetReadPointer();
+	}
+	if (view.Read(numberOutput)==false || numberOutput!=number)
+		return 1;
+	return 0;
+}
+
+static int TestTruncated(void)
+{
+	BitStream message;
+	message.Write1();
+	RakString::Serialize("A string cut short", &message);
+	unsigned char bytes[8]={0};
+	message.WriteAlignedBytes(bytes, sizeof(bytes));
+
+	const char *string;
+	unsigned short stringLength;
+	const unsigned char *bytesOutput;
+	BitStream subStream;
+	for (unsigned int length=0; length < message.GetNumberOfBytesUsed(); length++)
+	{
+		BitStreamView view(message.GetData(), length);
+		view.IgnoreBits(1);
+		BitSize_t readOffset = view.GetReadOffset();
+		if (view.ReadStringView(&string, &stringLength))
+		{
+			// Only once the whole string is there
+			if (length < 1 + 2 + 18)
+				return 4;
+			if (view.ReadBytesView(&bytesOutput, sizeof(bytes)) && length < message.GetNumberOfBytesUsed())
+				return 4;
+		}
+		else if (view.GetReadOffset()!=readOffset)
+			return 4;
+		readOffset = view.GetReadOffset();
+		if (view.ReadBytesView(&bytesOutput, length) || view.ReadView(&subStream, BYTES_TO_BITS(length)+1) || view.GetReadOffset()!=readOffset)
+			return 4;
+	}
+	return 0;
+}
+
+int BitStreamViewTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	for (int round=0; round < 1000; round++)
+	{
+		int errorCode=TestMessage();
+		if (errorCode==0 && round==0)
+			errorCode=TestTruncated();
+		if (errorCode!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError(ErrorCodeToString(errorCode)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return errorCode;
+		}
+	}
+
+	return 0;
+}
+
+RakString BitStreamViewTest::GetTestName()
+{
+
+	return "BitStreamViewTest";
+
+}
+
+RakString BitStreamViewTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "A value read back differently through the view";
+		break;
+	case 2:
+		return "A string, byte range or sub stream did not point into the message";
+		break;
+	case 3:
+		return "A sub stream read back differently, or did not start at its first bit";
+		break;
+	case 4:
+		return "Reading past the end did not fail, or moved the read offset";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+BitStreamViewTest::BitStreamViewTest(void)
+{
+}
+
+BitStreamViewTest::~BitStreamViewTest(void)
+{
+}
+
+void BitStreamViewTest::DestroyPeers()
+{
+}
@@ -0,0 +1,243 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "CoalescingKeyTest.h"
+
+/*
+Description:
+Tests that an unreliable message sent with a coalescing key replaces the unsent message with the same key.
+The client's outgoing bandwidth is limited, and it sends a burst of updates for two keys, followed by messages without a key.
+
+Success conditions:
+The last update for each key arrives, and updates for a key arrive in the order they were sent.
+Far fewer updates arrive than were sent.
+Every message without a key arrives.
+USER_MESSAGE_BYTES_DISCARDED counts the replaced updates.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+SetPerConnectionOutgoingBandwidthLimit
+GetStatistics
+
+RakPeerInterface Functions Explicitly Tested:
+Send
+*/
+
+static const unsigned short COALESCING_SERVER_PORT=60021;
+static const int COALESCING_KEY_COUNT=2;
+static const int COALESCING_UPDATE_COUNT=200;
+static const int COALESCING_PLAIN_COUNT=5;
+static const int COALESCING_MESSAGE_SIZE=300;
+
+int CoalescingKeyTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(COALESCING_SERVER_PORT, "127.0.0.1");
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+	client->Connect("127.0.0.1", COALESCING_SERVER_PORT, 0, 0);
+
+	bool connected=false;
+	SystemAddress serverAddress;
+	TimeMS entryTime=GetTimeMS();
+	while (connected==false && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+			{
+				connected=true;
+				serverAddress=packet->systemAddress;
+			}
+		}
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+	}
+
+	if (connected==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	// Sending every update would take about six seconds
+	client->SetPerConnectionOutgoingBandwidthLimit(COALESCING_KEY_COUNT*COALESCING_UPDATE_COUNT*COALESCING_MESSAGE_SIZE/6);
+
+	if (isVerbose)
+		printf("Sending %i updates for each of %i keys\n", COALESCING_UPDATE_COUNT, COALESCING_KEY_COUNT);
+
+	int i, key;
+	for (i=0; i < COALESCING_UPDATE_COUNT; i++)
+	{
+		for (key=0; key < COALESCING_KEY_COUNT; key++)
+		{
+			BitStream bitStream;
+			bitStream.Write((MessageID) ID_USER_PACKET_ENUM);
+			bitStream.Write(key);
+			bitStream.Write(i);
+			bitStream.PadWithZeroToByteLength(COALESCING_MESSAGE_SIZE);
+			client->Send(&bitStream, HIGH_PRIORITY, UNRELIABLE, 0, serverAddress, false, 0, 0, (uint32_t) key+1);
+		}
+	}
+	for (i=0; i < COALESCING_PLAIN_COUNT; i++)
+	{
+		BitStream bitStream;
+		bitStream.Write((MessageID) (ID_USER_PACKET_ENUM+1));
+		bitStream.PadWithZeroToByteLength(COALESCING_MESSAGE_SIZE);
+		client->Send(&bitStream, HIGH_PRIORITY, UNRELIABLE, 0, serverAddress, false);
+	}
+
+	int lastUpdate[COALESCING_KEY_COUNT];
+	for (key=0; key < COALESCING_KEY_COUNT; key++)
+		lastUpdate[key]=-1;
+	int updatesReceived=0, plainReceived=0;
+	bool outOfOrder=false;
+	entryTime=GetTimeMS();
+	while ((lastUpdate[0]!=COALESCING_UPDATE_COUNT-1 || lastUpdate[1]!=COALESCING_UPDATE_COUNT-1 || plainReceived<COALESCING_PLAIN_COUNT) && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+			{
+				BitStream bitStream(packet->data, packet->length, false);
+				bitStream.IgnoreBytes(sizeof(MessageID));
+				bitStream.Read(key);
+				bitStream.Read(i);
+				if (key<0 || key>=COALESCING_KEY_COUNT || i<=lastUpdate[key])
+					outOfOrder=true;
+				else
+					lastUpdate[key]=i;
+				updatesReceived++;
+			}
+			else if (packet->data[0]==ID_USER_PACKET_ENUM+1)
+				plainReceived++;
+		}
+		client->DeallocatePacket(client->Receive());
+		RakSleep(30);
+	}
+
+	if (isVerbose)
+		printf("%i updates and %i messages without a key arrived\n", updatesReceived, plainReceived);
+
+	if (lastUpdate[0]!=COALESCING_UPDATE_COUNT-1 || lastUpdate[1]!=COALESCING_UPDATE_COUNT-1)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The last update for a key did not arrive\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	if (outOfOrder)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Updates for a key arrived out of order\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	if (updatesReceived > COALESCING_UPDATE_COUNT/10)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Unsent updates were not replaced\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	if (plainReceived!=COALESCING_PLAIN_COUNT)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages without a key were lost\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 5;
+	}
+
+	RakNetStatistics rakNetStatistics;
+	if (client->GetStatistics(serverAddress, &rakNetStatistics)==0 ||
+		rakNetStatistics.runningTotal[USER_MESSAGE_BYTES_DISCARDED] < (uint64_t) (COALESCING_KEY_COUNT*COALESCING_UPDATE_COUNT-updatesReceived)*COALESCING_MESSAGE_SIZE)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("USER_MESSAGE_BYTES_DISCARDED does not count the replaced updates\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 6;
+	}
+
+	return 0;
+}
+
+RakString CoalescingKeyTest::GetTestName()
+{
+
+	return "CoalescingKeyTest";
+
+}
+
+RakString CoalescingKeyTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Could not connect";
+		break;
+	case 2:
+		return "The last update for a key did not arrive";
+		break;
+	case 3:
+		return "Updates for a key arrived out of order";
+		break;
+	case 4:
+		return "Unsent updates were not replaced";
+		break;
+	case 5:
+		return "Messages without a key were lost";
+		break;
+	case 6:
+		return "USER_MESSAGE_BYTES_DISCARDED does not count the replaced updates";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+CoalescingKeyTest::CoalescingKeyTest(void)
+{
+}
+
+CoalescingKeyTest::~CoalescingKeyTest(void)
+{
+}
+
+void CoalescingKeyTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
@@ -0,0 +1,397 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "ConnectionMigrationTest.h"
+
+/*
+Description:
+Tests that a connection survives its client's NAT rebinding when the server allows connection migration.
+The client connects through a stand-in NAT. Partway through, the NAT starts forwarding the client's datagrams from a new port, and drops replies sent to the old one.
+This is done once with a server that owns its socket, and once with a server that is the second instance in a RakPeerGroup, where datagrams from unknown addresses go to the first instance.
+
+Success conditions:
+In both cases, the server gets ID_CONNECTION_MIGRATION, with the old address in the payload and the new address as the sender.
+Every reliable ordered message the client sent arrives in order, and neither side loses the connection.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Send
+Receive
+DeallocatePacket
+NumberOfConnections
+
+RakPeerGroup Functions used, tested indirectly by its use:
+Startup
+SetUnknownSenderHandler
+
+RakPeerInterface Functions Explicitly Tested:
+AllowConnectionMigration
+*/
+
+static const unsigned short MIGRATION_SERVER_PORT=60022;
+static const unsigned short MIGRATION_NAT_PORT=60023;
+static const int MIGRATION_MESSAGE_COUNT=150;
+static const RakNet::TimeMS MIGRATION_MESSAGE_INTERVAL_MS=20;
+static const RakNet::TimeMS MIGRATION_REBIND_TIME_MS=1000;
+
+// Forwards datagrams between the client and the server, as a NAT would. The side facing the server uses one of two ports, so the test can change the client's public address
+class ConnectionMigrationNat : public RNS2EventHandler
+{
+public:
+	ConnectionMigrationNat() {clientSide=0; serverSide[0]=serverSide[1]=0; currentServerSide=0;}
+	~ConnectionMigrationNat()
+	{
+		if (clientSide)
+			RakNetSocket2Allocator::DeallocRNS2(clientSide);
+		for (int i=0; i < 2; i++)
+		{
+			if (serverSide[i])
+				RakNetSocket2Allocator::DeallocRNS2(serverSide[i]);
+		}
+	}
+	bool Startup(unsigned short clientSidePort, unsigned short serverPort)
+	{
+		serverAddress.FromStringExplicitPort("127.0.0.1", serverPort);
+		clientSide=Bind(clientSidePort);
+		serverSide[0]=Bind(0);
+		serverSide[1]=Bind(0);
+		return clientSide && serverSide[0] && serverSide[1];
+	}
+	// Later datagrams to the server come from the other port. Datagrams the server sends to the old port are dropped
+	void Rebind(void) {currentServerSide=1;}
+	SystemAddress GetServerSideAddress(int index) const
+	{
+		SystemAddress address=serverSide[index]->GetBoundAddress();
+		address.FromStringExplicitPort("127.0.0.1", address.GetPort());
+		return address;
+	}
+	void Update(void)
+	{
+		((RNS2_Berkley*) clientSide)->PollRecvFrom();
+		((RNS2_Berkley*) serverSide[0])->PollRecvFrom();
+		((RNS2_Berkley*) serverSide[1])->PollRecvFrom();
+	}
+
+	virtual void OnRNS2Recv(RNS2RecvStruct *recvStruct)
+	{
+		RNS2_SendParameters bsp;
+		bsp.data=recvStruct->data;
+		bsp.length=recvStruct->bytesRead;
+		if (recvStruct->socket==clientSide)
+		{
+			clientAddress=recvStruct->systemAddress;
+			bsp.systemAddress=serverAddress;
+			serverSide[currentServerSide]->Send(&bsp, _FILE_AND_LINE_);
+		}
+		else if (recvStruct->socket==serverSide[currentServerSide] && clientAddress!=UNASSIGNED_SYSTEM_ADDRESS)
+		{
+			bsp.systemAddress=clientAddress;
+			clientSide->Send(&bsp, _FILE_AND_LINE_);
+		}
+	}
+	virtual void DeallocRNS2RecvStruct(RNS2RecvStruct *s, const char *file, unsigned int line) {(void) s; (void) file; (void) line;}
+	virtual RNS2RecvStruct *AllocRNS2RecvStruct(const char *file, unsigned int line) {(void) file; (void) line; return &recvStruct;}
+
+protected:
+	RakNetSocket2 *Bind(unsigned short port)
+	{
+		RakNetSocket2 *s=RakNetSocket2Allocator::AllocRNS2();
+		RNS2_BerkleyBindParameters bbp;
+		memset(&bbp, 0, sizeof(bbp));
+		bbp.port=port;
+		bbp.hostAddress=(char*) "127.0.0.1";
+		bbp.addressFamily=AF_INET;
+		bbp.type=SOCK_DGRAM;
+		bbp.nonBlockingSocket=true;
+		bbp.eventHandler=this;
+		if (((RNS2_Berkley*) s)->Bind(&bbp, _FILE_AND_LINE_)!=BR_SUCCESS)
+		{
+			RakNetSocket2Allocator::DeallocRNS2(s);
+			return 0;
+		}
+		return s;
+	}
+
+	RakNetSocket2 *clientSide;
+	RakNetSocket2 *serverSide[2];
+	int currentServerSide;
+	SystemAddress clientAddress, serverAddress;
+	RNS2RecvStruct recvStruct;
+};
+
+static RakPeerInterface *groupServer, *groupDecoy;
+static SystemAddress groupServerRoute;
+
+// The NAT's first port goes to the server, and every other unknown address to the decoy
+static RakPeerInterface *RouteToServerOrDecoy(RNS2RecvStruct *recvStruct, void *userData)
+{
+	(void) userData;
+	return recvStruct->systemAddress==groupServerRoute ? groupServer : groupDecoy;
+}
+
+int ConnectionMigrationTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	nat=new ConnectionMigrationNat;
+	if (nat->Startup(MIGRATION_NAT_PORT, MIGRATION_SERVER_PORT)==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not bind the NAT sockets\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(MIGRATION_SERVER_PORT, "127.0.0.1");
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+	server->AllowConnectionMigration(true);
+
+	int errorCode=TestMigration(server, isVerbose, noPauses);
+	if (errorCode!=0)
+		return errorCode;
+
+	DestroyPeers();
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	if (isVerbose)
+		printf("Again, with the server in a RakPeerGroup\n");
+
+	nat=new ConnectionMigrationNat;
+	if (nat->Startup(MIGRATION_NAT_PORT, MIGRATION_SERVER_PORT)==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not bind the NAT sockets\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	group=new RakPeerGroup;
+	if (group->Startup(&serverSd, 1, 1)!=RAKNET_STARTED)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("RakPeerGroup::Startup failed\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 7;
+	}
+	groupDecoy=RakPeerInterface::GetInstance();
+	destroyList.Push(groupDecoy,_FILE_AND_LINE_);
+	groupDecoy->Startup(1, group);
+	groupDecoy->SetMaximumIncomingConnections(1);
+	groupServer=RakPeerInterface::GetInstance();
+	destroyList.Push(groupServer,_FILE_AND_LINE_);
+	groupServer->Startup(1, group);
+	groupServer->SetMaximumIncomingConnections(1);
+	groupServer->AllowConnectionMigration(true);
+	// After the rebind, only the GUID in ID_CONNECTION_MIGRATION leads back to the server
+	groupServerRoute=nat->GetServerSideAddress(0);
+	group->SetUnknownSenderHandler(RouteToServerOrDecoy, 0);
+
+	return TestMigration(groupServer, isVerbose, noPauses);
+}
+
+int ConnectionMigrationTest::TestMigration(RakPeerInterface *server, bool isVerbose, bool noPauses)
+{
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+	client->Connect("127.0.0.1", MIGRATION_NAT_PORT, 0, 0);
+
+	bool connected=false;
+	SystemAddress serverAddress;
+	TimeMS entryTime=GetTimeMS();
+	while (connected==false && GetTimeMS()-entryTime<5000)
+	{
+		nat->Update();
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+			{
+				connected=true;
+				serverAddress=packet->systemAddress;
+			}
+		}
+		server->DeallocatePacket(server->Receive());
+		RakSleep(5);
+	}
+
+	if (connected==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect through the NAT\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	if (isVerbose)
+		printf("Sending messages while the NAT rebinds\n");
+
+	int messagesSent=0, messagesReceived=0, migrations=0;
+	bool outOfOrder=false, connectionLost=false, wrongAddresses=false;
+	entryTime=GetTimeMS();
+	while ((messagesReceived<MIGRATION_MESSAGE_COUNT || migrations==0) && connectionLost==false && GetTimeMS()-entryTime<8000)
+	{
+		if (GetTimeMS()-entryTime>MIGRATION_REBIND_TIME_MS)
+			nat->Rebind();
+		if (messagesSent<MIGRATION_MESSAGE_COUNT && GetTimeMS()-entryTime>(TimeMS) messagesSent*MIGRATION_MESSAGE_INTERVAL_MS)
+		{
+			BitStream bitStream;
+			bitStream.Write((MessageID) ID_USER_PACKET_ENUM);
+			bitStream.Write(messagesSent);
+			client->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, serverAddress, false);
+			messagesSent++;
+		}
+
+		nat->Update();
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+			{
+				BitStream bitStream(packet->data, packet->length, false);
+				bitStream.IgnoreBytes(sizeof(MessageID));
+				int index;
+				bitStream.Read(index);
+				if (index!=messagesReceived)
+					outOfOrder=true;
+				messagesReceived++;
+			}
+			else if (packet->data[0]==ID_CONNECTION_MIGRATION)
+			{
+				BitStream bitStream(packet->data, packet->length, false);
+				bitStream.IgnoreBytes(sizeof(MessageID));
+				SystemAddress oldAddress;
+				bitStream.Read(oldAddress);
+				if (isVerbose)
+					printf("Migrated from %s to %s\n", oldAddress.ToString(true), packet->systemAddress.ToString(true));
+				if (oldAddress!=nat->GetServerSideAddress(0) || packet->systemAddress!=nat->GetServerSideAddress(1))
+					wrongAddresses=true;
+				migrations++;
+			}
+			else if (packet->data[0]==ID_CONNECTION_LOST || packet->data[0]==ID_DISCONNECTION_NOTIFICATION)
+				connectionLost=true;
+		}
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_LOST || packet->data[0]==ID_DISCONNECTION_NOTIFICATION)
+				connectionLost=true;
+		}
+		RakSleep(5);
+	}
+
+	if (migrations==0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Never got ID_CONNECTION_MIGRATION\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	if (migrations!=1 || wrongAddresses)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("ID_CONNECTION_MIGRATION had the wrong addresses, or arrived more than once\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	if (connectionLost || server->NumberOfConnections()!=1)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The connection was lost\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 5;
+	}
+
+	if (messagesReceived!=MIGRATION_MESSAGE_COUNT || outOfOrder)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages were lost or out of order\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 6;
+	}
+
+	return 0;
+}
+
+RakString ConnectionMigrationTest::GetTestName()
+{
+
+	return "ConnectionMigrationTest";
+
+}
+
+RakString ConnectionMigrationTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Could not bind the NAT sockets";
+		break;
+	case 2:
+		return "Could not connect through the NAT";
+		break;
+	case 3:
+		return "Never got ID_CONNECTION_MIGRATION";
+		break;
+	case 4:
+		return "ID_CONNECTION_MIGRATION had the wrong addresses, or arrived more than once";
+		break;
+	case 5:
+		return "The connection was lost";
+		break;
+	case 6:
+		return "Messages were lost or out of order";
+		break;
+	case 7:
+		return "RakPeerGroup::Startup failed";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+ConnectionMigrationTest::ConnectionMigrationTest(void)
+{
+	nat=0;
+	group=0;
+}
+
+ConnectionMigrationTest::~ConnectionMigrationTest(void)
+{
+}
+
+void ConnectionMigrationTest::DestroyPeers()
+{
+
+	// Shuts down the instances still in the group
+	if (group)
+		group->Shutdown();
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+	delete group;
+	group=0;
+
+	delete nat;
+	nat=0;
+
+}
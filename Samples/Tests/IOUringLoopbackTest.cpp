@@ -0,0 +1,228 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "IOUringLoopbackTest.h"
+
+#if !defined(_WIN32) && !defined(__native_client__) && !defined(WINDOWS_STORE_RT) && RAKNET_SUPPORT_IO_URING==1
+
+/*
+Description:
+Tests the io_uring socket backend over loopback. A server and a client, both with SocketDescriptor::useIOUring, connect and send each other reliable ordered messages.
+There are more messages than send slots, and some are long enough to be split, so slots are reused and datagrams of all sizes go through the rings.
+
+Success conditions:
+Both sockets use io_uring.
+Every message arrives once, in order, with its contents intact, in both directions.
+Shutdown ends the receive threads promptly.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+Send
+GetSockets
+Shutdown
+
+RakPeerInterface Functions Explicitly Tested:
+Startup with SocketDescriptor::useIOUring
+*/
+
+static const unsigned short IOURING_SERVER_PORT=60028;
+static const int IOURING_MESSAGE_COUNT=600;
+
+static int MessageLength(int index)
+{
+	return 1+sizeof(int)+(index*37)%3000;
+}
+
+static void SendMessages(RakPeerInterface *peer, const SystemAddress &systemAddress)
+{
+	for (int i=0; i < IOURING_MESSAGE_COUNT; i++)
+	{
+		BitStream bitStream;
+		bitStream.Write((MessageID) ID_USER_PACKET_ENUM);
+		bitStream.Write(i);
+		for (int j=1+sizeof(int); j < MessageLength(i); j++)
+			bitStream.Write((unsigned char) (i+j));
+		peer->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, systemAddress, false);
+	}
+}
+
+// Returns false if packet is not the message expected next
+static bool CheckMessage(Packet *packet, int &nextIndex)
+{
+	if (packet->data[0]!=ID_USER_PACKET_ENUM)
+		return true;
+	BitStream bitStream(packet->data, packet->length, false);
+	bitStream.IgnoreBytes(sizeof(MessageID));
+	int index;
+	bitStream.Read(index);
+	if (index!=nextIndex || (int) packet->length!=MessageLength(index))
+		return false;
+	for (int j=1+sizeof(int); j < MessageLength(index); j++)
+	{
+		if (packet->data[j]!=(unsigned char) (index+j))
+			return false;
+	}
+	nextIndex++;
+	return true;
+}
+
+static bool UsesIOUring(RakPeerInterface *peer)
+{
+	DataStructures::List<RakNetSocket2*> sockets;
+	peer->GetSockets(sockets);
+	return sockets.Size()==1 && ((RNS2_Linux_IOUring*) sockets[0])->IsUsingIOUring();
+}
+
+int IOUringLoopbackTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(IOURING_SERVER_PORT, "127.0.0.1");
+	serverSd.useIOUring=true;
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	clientSd.useIOUring=true;
+	client->Startup(1, &clientSd, 1);
+
+	if (UsesIOUring(server)==false || UsesIOUring(client)==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("io_uring could not be set up. The kernel may be too old or not allow it\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	client->Connect("127.0.0.1", IOURING_SERVER_PORT, 0, 0);
+
+	SystemAddress serverAddress, clientAddress;
+	TimeMS entryTime=GetTimeMS();
+	while ((serverAddress==UNASSIGNED_SYSTEM_ADDRESS || clientAddress==UNASSIGNED_SYSTEM_ADDRESS) && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+				serverAddress=packet->systemAddress;
+		}
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_NEW_INCOMING_CONNECTION)
+				clientAddress=packet->systemAddress;
+		}
+		RakSleep(30);
+	}
+	if (serverAddress==UNASSIGNED_SYSTEM_ADDRESS || clientAddress==UNASSIGNED_SYSTEM_ADDRESS)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	SendMessages(client, serverAddress);
+	SendMessages(server, clientAddress);
+
+	int nextServerIndex=0, nextClientIndex=0;
+	bool inOrder=true;
+	entryTime=GetTimeMS();
+	while (inOrder && (nextServerIndex<IOURING_MESSAGE_COUNT || nextClientIndex<IOURING_MESSAGE_COUNT) && GetTimeMS()-entryTime<10000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+			inOrder=CheckMessage(packet, nextServerIndex) && inOrder;
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+			inOrder=CheckMessage(packet, nextClientIndex) && inOrder;
+		RakSleep(10);
+	}
+	if (inOrder==false || nextServerIndex!=IOURING_MESSAGE_COUNT || nextClientIndex!=IOURING_MESSAGE_COUNT)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages were lost, out of order, or corrupted\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	// The receive threads wait in the kernel, so this checks they are woken
+	entryTime=GetTimeMS();
+	client->Shutdown(0);
+	server->Shutdown(0);
+	if (GetTimeMS()-entryTime>1000)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Shutdown did not end the receive threads promptly\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	return 0;
+}
+
+RakString IOUringLoopbackTest::GetTestName()
+{
+
+	return "IOUringLoopbackTest";
+
+}
+
+RakString IOUringLoopbackTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "io_uring could not be set up";
+		break;
+	case 2:
+		return "Could not connect";
+		break;
+	case 3:
+		return "Messages were lost, out of order, or corrupted";
+		break;
+	case 4:
+		return "Shutdown did not end the receive threads promptly";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+IOUringLoopbackTest::IOUringLoopbackTest(void)
+{
+}
+
+IOUringLoopbackTest::~IOUringLoopbackTest(void)
+{
+}
+
+void IOUringLoopbackTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
+
+#endif // RAKNET_SUPPORT_IO_URING
@@ -28,4 +28,24 @@
 #include "SystemAddressAndGuidTest.h"
 #include "PacketAndLowLevelTestsTest.h"
 #include "MiscellaneousTestsTest.h"
+#include "PacketFilterTest.h"
+#include "RakPeerGroupTest.h"
+#include "BitStreamVarIntTest.h"
+#include "BitStreamArenaTest.h"
+#include "BitStreamChainTest.h"
+#include "BitStreamQuantizeTest.h"
+#include "BitStreamDeltaTest.h"
+#include "BitStreamArrayTest.h"
+#include "StringCompressorTest.h"
+#include "BitStreamViewTest.h"
+#include "SendDeadlineTest.h"
+#include "CoalescingKeyTest.h"
+#include "ConnectionMigrationTest.h"
+#include "RakPeerKeyTest.h"
+#include "OrderingChannelLimitTest.h"
+#include "OfflineRateLimiterTest.h"
+#include "PathMTUDiscoveryTest.h"
+#include "BitStreamSchemaTest.h"
+#include "BanListTest.h"
+#include "IOUringLoopbackTest.h"
 
@@ -0,0 +1,213 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "OfflineRateLimiterTest.h"
+
+/*
+Description:
+Tests the per address and per prefix limits on offline messages, first on OfflineRateLimiter directly with chosen times, then on unconnected pings to a RakPeer.
+
+Success conditions:
+An address gets its burst, then is dropped until its bucket refills, while other addresses are not affected.
+A prefix gets its burst across all its addresses.
+A message dropped by the prefix limit does not take a token from its address.
+A RakPeer with a limit answers only as many pings as the burst, and counts the rest as dropped.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+Receive
+DeallocatePacket
+Ping
+
+RakPeerInterface Functions Explicitly Tested:
+SetOfflineRateLimit
+GetOfflineRateLimitStatistics
+*/
+
+static const unsigned short RATE_LIMIT_SERVER_PORT=60026;
+static const int RATE_LIMIT_PING_COUNT=10;
+
+// How many of count messages from systemAddress at time are allowed
+static int AllowCount(OfflineRateLimiter &limiter, const SystemAddress &systemAddress, RakNet::TimeMS time, int count)
+{
+	int allowed=0;
+	for (int i=0; i < count; i++)
+	{
+		if (limiter.Allow(systemAddress, time))
+			allowed++;
+	}
+	return allowed;
+}
+
+int OfflineRateLimiterTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	const SystemAddress firstAddress("10.1.2.3", 1000), secondAddress("10.1.2.4", 1000), otherPrefixAddress("10.9.9.9", 1000);
+	RakNet::TimeMS time=1000;
+
+	// Address limit only
+	{
+		OfflineRateLimiter limiter;
+		limiter.Seed(12345);
+		OfflineRateLimitSettings settings;
+		settings.addressMessagesPerSecond=1.0f;
+		settings.addressBurst=5;
+		limiter.SetSettings(settings);
+		if (AllowCount(limiter, firstAddress, time, 10)!=5 || AllowCount(limiter, secondAddress, time, 10)!=5 ||
+			AllowCount(limiter, firstAddress, time+1000, 10)!=1)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("The address limit did not allow its burst and rate\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 1;
+		}
+	}
+
+	// Prefix limit, shared by the addresses in it
+	{
+		OfflineRateLimiter limiter;
+		limiter.Seed(12345);
+		OfflineRateLimitSettings settings;
+		settings.prefixMessagesPerSecond=1.0f;
+		settings.prefixBurst=6;
+		limiter.SetSettings(settings);
+		if (AllowCount(limiter, firstAddress, time, 4)!=4 || AllowCount(limiter, secondAddress, time, 4)!=2 ||
+			AllowCount(limiter, otherPrefixAddress, time, 10)!=6)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("The prefix limit did not allow its burst across its addresses\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 2;
+		}
+	}
+
+	// Both limits. The address refills much more slowly than the prefix
+	{
+		OfflineRateLimiter limiter;
+		limiter.Seed(12345);
+		OfflineRateLimitSettings settings;
+		settings.addressMessagesPerSecond=0.001f;
+		settings.addressBurst=2;
+		settings.prefixMessagesPerSecond=1.0f;
+		settings.prefixBurst=3;
+		limiter.SetSettings(settings);
+		// The second address has one token left when the prefix runs out, and must keep it through the messages the prefix drops
+		AllowCount(limiter, firstAddress, time, 2);
+		AllowCount(limiter, secondAddress, time, 1);
+		AllowCount(limiter, secondAddress, time, 5);
+		OfflineRateLimitStatistics statistics;
+		limiter.GetStatistics(&statistics);
+		if (AllowCount(limiter, secondAddress, time+1000, 1)!=1 ||
+			statistics.messagesAllowed!=3 || statistics.messagesDroppedByPrefix!=5 || statistics.messagesDroppedByAddress!=0)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A message dropped by the prefix limit took a token from its address\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 3;
+		}
+	}
+
+	// Through RakPeer
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(RATE_LIMIT_SERVER_PORT, "127.0.0.1");
+	server->Startup(1, &serverSd, 1);
+	OfflineRateLimitSettings settings;
+	settings.addressMessagesPerSecond=0.001f;
+	settings.addressBurst=3;
+	server->SetOfflineRateLimit(settings);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+	for (int i=0; i < RATE_LIMIT_PING_COUNT; i++)
+		client->Ping("127.0.0.1", RATE_LIMIT_SERVER_PORT, false);
+
+	int pongCount=0;
+	RakNet::TimeMS entryTime=GetTimeMS();
+	while (GetTimeMS()-entryTime<1000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_UNCONNECTED_PONG)
+				pongCount++;
+		}
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+	}
+
+	OfflineRateLimitStatistics statistics;
+	server->GetOfflineRateLimitStatistics(&statistics);
+	if (pongCount!=(int) settings.addressBurst || statistics.messagesAllowed!=settings.addressBurst ||
+		statistics.messagesDroppedByAddress!=RATE_LIMIT_PING_COUNT-settings.addressBurst)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("RakPeer did not limit unconnected pings\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	return 0;
+}
+
+RakString OfflineRateLimiterTest::GetTestName()
+{
+
+	return "OfflineRateLimiterTest";
+
+}
+
+RakString OfflineRateLimiterTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "The address limit did not allow its burst and rate";
+		break;
+	case 2:
+		return "The prefix limit did not allow its burst across its addresses";
+		break;
+	case 3:
+		return "A message dropped by the prefix limit took a token from its address";
+		break;
+	case 4:
+		return "RakPeer did not limit unconnected pings";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+OfflineRateLimiterTest::OfflineRateLimiterTest(void)
+{
+}
+
+OfflineRateLimiterTest::~OfflineRateLimiterTest(void)
+{
+}
+
+void OfflineRateLimiterTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
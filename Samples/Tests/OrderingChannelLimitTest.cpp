@@ -0,0 +1,205 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "OrderingChannelLimitTest.h"
+
+/*
+Description:
+Tests the limit on how many ordering channels a remote system can make a connection keep state for.
+The server sends on MAX_ORDERING_CHANNELS_PER_CONNECTION channels, then the client sends on as many different channels, then on one more.
+
+Success conditions:
+Channels the server sent on first do not count toward the limit, so every message the client sends within the limit arrives.
+The message on the channel past the limit does not arrive, and the server drops the connection with ID_CONNECTION_LOST.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+
+RakPeerInterface Functions Explicitly Tested:
+Send
+*/
+
+static const unsigned short CHANNEL_LIMIT_SERVER_PORT=60025;
+
+static void SendOnChannel(RakPeerInterface *peer, OrderingChannelType orderingChannel, const SystemAddress &target)
+{
+	BitStream bitStream;
+	bitStream.Write((MessageID) ID_USER_PACKET_ENUM);
+	bitStream.Write(orderingChannel);
+	peer->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, orderingChannel, target, false);
+}
+
+int OrderingChannelLimitTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(CHANNEL_LIMIT_SERVER_PORT, "127.0.0.1");
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+	client->Connect("127.0.0.1", CHANNEL_LIMIT_SERVER_PORT, 0, 0);
+
+	bool connected=false;
+	SystemAddress serverAddress, clientAddress;
+	TimeMS entryTime=GetTimeMS();
+	while (connected==false && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+				serverAddress=packet->systemAddress;
+		}
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_NEW_INCOMING_CONNECTION)
+				clientAddress=packet->systemAddress;
+		}
+		connected=serverAddress!=UNASSIGNED_SYSTEM_ADDRESS && clientAddress!=UNASSIGNED_SYSTEM_ADDRESS;
+		RakSleep(30);
+	}
+
+	if (connected==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	OrderingChannelType orderingChannel;
+	for (orderingChannel=0; orderingChannel < MAX_ORDERING_CHANNELS_PER_CONNECTION; orderingChannel++)
+		SendOnChannel(server, orderingChannel, clientAddress);
+	for (orderingChannel=MAX_ORDERING_CHANNELS_PER_CONNECTION; orderingChannel < MAX_ORDERING_CHANNELS_PER_CONNECTION*2; orderingChannel++)
+		SendOnChannel(client, orderingChannel, serverAddress);
+
+	int serverReceived=0, clientReceived=0;
+	bool connectionLost=false;
+	entryTime=GetTimeMS();
+	while ((serverReceived<MAX_ORDERING_CHANNELS_PER_CONNECTION || clientReceived<MAX_ORDERING_CHANNELS_PER_CONNECTION) && GetTimeMS()-entryTime<10000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+				serverReceived++;
+			else if (packet->data[0]==ID_CONNECTION_LOST)
+				connectionLost=true;
+		}
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+				clientReceived++;
+		}
+		RakSleep(5);
+	}
+
+	if (serverReceived!=MAX_ORDERING_CHANNELS_PER_CONNECTION || clientReceived!=MAX_ORDERING_CHANNELS_PER_CONNECTION || connectionLost)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages on channels within the limit did not arrive\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	SendOnChannel(client, MAX_ORDERING_CHANNELS_PER_CONNECTION*2, serverAddress);
+	entryTime=GetTimeMS();
+	while (connectionLost==false && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+				serverReceived++;
+			else if (packet->data[0]==ID_CONNECTION_LOST)
+				connectionLost=true;
+		}
+		client->DeallocatePacket(client->Receive());
+		RakSleep(5);
+	}
+
+	if (serverReceived!=MAX_ORDERING_CHANNELS_PER_CONNECTION)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("A message on a channel past the limit arrived\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	if (connectionLost==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The connection was not dropped when the remote system went past the limit\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	return 0;
+}
+
+RakString OrderingChannelLimitTest::GetTestName()
+{
+
+	return "OrderingChannelLimitTest";
+
+}
+
+RakString OrderingChannelLimitTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Could not connect";
+		break;
+	case 2:
+		return "Messages on channels within the limit did not arrive";
+		break;
+	case 3:
+		return "A message on a channel past the limit arrived";
+		break;
+	case 4:
+		return "The connection was not dropped when the remote system went past the limit";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+OrderingChannelLimitTest::OrderingChannelLimitTest(void)
+{
+}
+
+OrderingChannelLimitTest::~OrderingChannelLimitTest(void)
+{
+}
+
+void OrderingChannelLimitTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
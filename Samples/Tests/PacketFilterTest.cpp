@@ -0,0 +1,323 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "PacketFilterTest.h"
+
+/*
+Description:
+Tests that a server whose socket has the kernel packet filter attached still gets all RakNet traffic, and that the filter drops other datagrams.
+
+Success conditions:
+A client connects and all its reliable ordered messages arrive.
+Unconnected pings are answered and ID_ADVERTISE_SYSTEM arrives.
+On Linux, datagrams that cannot be RakNet datagrams never reach the server, while a valid ping from the same socket does.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Send
+Receive
+DeallocatePacket
+Ping
+AdvertiseSystem
+SetIncomingDatagramEventHandler
+
+SocketDescriptor members Explicitly Tested:
+attachPacketFilter
+*/
+
+static const unsigned short FILTER_SERVER_PORT=60001;
+static const int FILTER_MESSAGE_COUNT=100;
+// Copy of OFFLINE_MESSAGE_DATA_ID in RakPeer.cpp
+static const unsigned char FILTER_OFFLINE_MESSAGE_DATA_ID[16]={0x00,0xFF,0xFF,0x00,0xFE,0xFE,0xFE,0xFE,0xFD,0xFD,0xFD,0xFD,0x12,0x34,0x56,0x78};
+
+// Datagrams the server received from rawSocket. Written by the server's receive thread
+static volatile unsigned int rawDatagramsReceived;
+static volatile unsigned short rawSocketPort;
+
+static bool CountRawDatagrams(RNS2RecvStruct *recvStruct)
+{
+	if (recvStruct->systemAddress.GetPort()==rawSocketPort)
+		rawDatagramsReceived++;
+	return true;
+}
+
+static void SendRaw(RakNetSocket2 *s, const char *data, int length)
+{
+	RNS2_SendParameters bsp;
+	bsp.data=(char*) data;
+	bsp.length=length;
+	bsp.systemAddress.FromStringExplicitPort("127.0.0.1", FILTER_SERVER_PORT);
+	s->Send(&bsp, _FILE_AND_LINE_);
+}
+
+int PacketFilterTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+	rawSocket=0;
+	rawDatagramsReceived=0;
+	rawSocketPort=0;
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(FILTER_SERVER_PORT, "127.0.0.1");
+	serverSd.attachPacketFilter=true;
+	server->SetIncomingDatagramEventHandler(CountRawDatagrams);
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+	server->SetOfflinePingResponse("Offline Ping Data", (int)strlen("Offline Ping Data")+1);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+
+	if (isVerbose)
+		printf("Connecting to a server with the packet filter attached\n");
+
+	client->Connect("127.0.0.1", FILTER_SERVER_PORT, 0, 0);
+	bool connected=false;
+	SystemAddress serverAddress;
+	TimeMS entryTime=GetTimeMS();
+	while (connected==false && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+			{
+				connected=true;
+				serverAddress=packet->systemAddress;
+			}
+		}
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+	}
+
+	if (connected==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect through the packet filter\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	int i;
+	for (i=0; i < FILTER_MESSAGE_COUNT; i++)
+	{
+		BitStream bitStream;
+		bitStream.Write((MessageID) ID_USER_PACKET_ENUM);
+		bitStream.Write(i);
+		// Some messages are split
+		for (int j=0; j < (i%4)*1000; j++)
+			bitStream.Write((unsigned char) j);
+		client->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, serverAddress, false);
+	}
+	client->AdvertiseSystem("127.0.0.1", FILTER_SERVER_PORT, "hello world", (int)strlen("hello world")+1);
+
+	int messagesReceived=0;
+	bool outOfOrder=false, receivedAdvertise=false;
+	entryTime=GetTimeMS();
+	while ((messagesReceived<FILTER_MESSAGE_COUNT || receivedAdvertise==false) && GetTimeMS()-entryTime<10000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+			{
+				BitStream bitStream(packet->data, packet->length, false);
+				bitStream.IgnoreBytes(sizeof(MessageID));
+				int index;
+				bitStream.Read(index);
+				if (index!=messagesReceived)
+					outOfOrder=true;
+				messagesReceived++;
+			}
+			else if (packet->data[0]==ID_ADVERTISE_SYSTEM)
+				receivedAdvertise=true;
+		}
+		client->DeallocatePacket(client->Receive());
+		RakSleep(30);
+	}
+
+	if (messagesReceived!=FILTER_MESSAGE_COUNT || outOfOrder)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages were lost or out of order\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	if (receivedAdvertise==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Never got ID_ADVERTISE_SYSTEM\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	client->Ping("127.0.0.1", FILTER_SERVER_PORT, false);
+	bool receivedPong=false;
+	entryTime=GetTimeMS();
+	while (receivedPong==false && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_UNCONNECTED_PONG)
+				receivedPong=true;
+		}
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+	}
+
+	if (receivedPong==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Never got ID_UNCONNECTED_PONG\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+#if defined(__linux__)
+	rawSocket=RakNetSocket2Allocator::AllocRNS2();
+	RNS2_BerkleyBindParameters bbp;
+	memset(&bbp, 0, sizeof(bbp));
+	bbp.hostAddress=(char*) "127.0.0.1";
+	bbp.addressFamily=AF_INET;
+	bbp.type=SOCK_DGRAM;
+	bbp.nonBlockingSocket=true;
+	if (((RNS2_Berkley*) rawSocket)->Bind(&bbp, _FILE_AND_LINE_)!=BR_SUCCESS)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not bind the raw socket\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 5;
+	}
+	rawSocketPort=rawSocket->GetBoundAddress().GetPort();
+
+	if (isVerbose)
+		printf("Sending datagrams that are not RakNet datagrams\n");
+
+	char data[64];
+	SendRaw(rawSocket, "hello world", (int)strlen("hello world"));
+	data[0]=ID_UNCONNECTED_PING;
+	SendRaw(rawSocket, data, 1);
+	SendRaw(rawSocket, data, 2);
+	// Too short for a ping
+	memcpy(data+1, FILTER_OFFLINE_MESSAGE_DATA_ID, sizeof(FILTER_OFFLINE_MESSAGE_DATA_ID));
+	SendRaw(rawSocket, data, 1+sizeof(FILTER_OFFLINE_MESSAGE_DATA_ID));
+	// Right length, without OFFLINE_MESSAGE_DATA_ID
+	BitStream wrongId;
+	wrongId.Write((MessageID) ID_UNCONNECTED_PING);
+	wrongId.Write(RakNet::GetTime());
+	wrongId.PadWithZeroToByteLength(wrongId.GetNumberOfBytesUsed()+sizeof(FILTER_OFFLINE_MESSAGE_DATA_ID));
+	SendRaw(rawSocket, (const char*) wrongId.GetData(), wrongId.GetNumberOfBytesUsed());
+	// Connection request with the wrong identifier
+	memset(data, 0x11, sizeof(data));
+	data[0]=ID_OPEN_CONNECTION_REQUEST_1;
+	SendRaw(rawSocket, data, sizeof(data));
+
+	RakSleep(500);
+	if (rawDatagramsReceived!=0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Datagrams that are not RakNet datagrams passed the filter\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 6;
+	}
+
+	// A well formed ping from the same socket must still pass
+	BitStream ping;
+	ping.Write((MessageID) ID_UNCONNECTED_PING);
+	ping.Write(RakNet::GetTime());
+	ping.WriteAlignedBytes(FILTER_OFFLINE_MESSAGE_DATA_ID, sizeof(FILTER_OFFLINE_MESSAGE_DATA_ID));
+	ping.Write(RakNetGUID(1234));
+	SendRaw(rawSocket, (const char*) ping.GetData(), ping.GetNumberOfBytesUsed());
+
+	entryTime=GetTimeMS();
+	while (rawDatagramsReceived==0 && GetTimeMS()-entryTime<2000)
+		RakSleep(30);
+
+	if (rawDatagramsReceived!=1)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("A valid ping was dropped by the filter\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 7;
+	}
+#endif
+
+	return 0;
+}
+
+RakString PacketFilterTest::GetTestName()
+{
+
+	return "PacketFilterTest";
+
+}
+
+RakString PacketFilterTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Could not connect through the packet filter";
+		break;
+	case 2:
+		return "Messages were lost or out of order";
+		break;
+	case 3:
+		return "Never got ID_ADVERTISE_SYSTEM";
+		break;
+	case 4:
+		return "Never got ID_UNCONNECTED_PONG";
+		break;
+	case 5:
+		return "Could not bind the raw socket";
+		break;
+	case 6:
+		return "Datagrams that are not RakNet datagrams passed the filter";
+		break;
+	case 7:
+		return "A valid ping was dropped by the filter";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+PacketFilterTest::PacketFilterTest(void)
+{
+	rawSocket=0;
+}
+
+PacketFilterTest::~PacketFilterTest(void)
+{
+}
+
+void PacketFilterTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+	if (rawSocket)
+	{
+		RakNetSocket2Allocator::DeallocRNS2(rawSocket);
+		rawSocket=0;
+	}
+
+}
@@ -0,0 +1,258 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "PathMTUDiscoveryTest.h"
+
+/*
+Description:
+Tests in-session path MTU discovery over loopback, with the server dropping incoming datagrams above a size to stand in for the path.
+The client connects while datagrams above 1000 bytes are dropped, so the handshake settles on the smallest MTU.
+Then the limit is lifted and the client enables path MTU discovery.
+Then all datagrams are dropped while the client has a reliable message to resend and a split message held in its queue by the bandwidth limit.
+Last, only datagrams above 1000 bytes are dropped.
+
+Success conditions:
+Without SetPathMTUDiscovery the MTU stays at the handshake size.
+With it, a probe raises the MTU to MAXIMUM_MTU_SIZE.
+When datagrams stop arriving, the MTU falls back, and the queued split message is split again so it arrives where only smaller datagrams get through.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+Send
+SetPerConnectionOutgoingBandwidthLimit
+SetIncomingDatagramEventHandler
+
+RakPeerInterface Functions Explicitly Tested:
+SetPathMTUDiscovery
+GetStatistics
+*/
+
+static const unsigned short PATH_MTU_SERVER_PORT=60027;
+static const int PATH_MTU_SPLIT_MESSAGE_LENGTH=20000;
+static const int PATH_MTU_SMALL_DATAGRAM=1000;
+
+// Datagrams above this many bytes do not reach the server
+static volatile int maxIncomingDatagram;
+
+static bool DropLargeDatagrams(RNS2RecvStruct *recvStruct)
+{
+	return recvStruct->bytesRead <= maxIncomingDatagram;
+}
+
+int PathMTUDiscoveryTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	maxIncomingDatagram=PATH_MTU_SMALL_DATAGRAM;
+	server->SetIncomingDatagramEventHandler(DropLargeDatagrams);
+	SocketDescriptor serverSd(PATH_MTU_SERVER_PORT, "127.0.0.1");
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+	// Two attempts per MTU size, so the handshake gets to the smallest size quickly
+	client->Connect("127.0.0.1", PATH_MTU_SERVER_PORT, 0, 0, 0, 0, 6, 200);
+
+	bool connected=false;
+	SystemAddress serverAddress, clientAddress;
+	TimeMS entryTime=GetTimeMS();
+	while (connected==false && GetTimeMS()-entryTime<10000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+				serverAddress=packet->systemAddress;
+		}
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_NEW_INCOMING_CONNECTION)
+				clientAddress=packet->systemAddress;
+		}
+		connected=serverAddress!=UNASSIGNED_SYSTEM_ADDRESS && clientAddress!=UNASSIGNED_SYSTEM_ADDRESS;
+		RakSleep(30);
+	}
+
+	RakNetStatistics rns;
+	if (connected==false || client->GetStatistics(serverAddress, &rns)==0 || rns.MTUSize>PATH_MTU_SMALL_DATAGRAM)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect at the smallest MTU\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+	int handshakeMTUSize=rns.MTUSize;
+
+	// Off by default, so nothing may be probed even though larger datagrams now get through
+	maxIncomingDatagram=MAXIMUM_MTU_SIZE;
+	entryTime=GetTimeMS();
+	while (GetTimeMS()-entryTime<2500)
+	{
+		client->DeallocatePacket(client->Receive());
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+	}
+	client->GetStatistics(serverAddress, &rns);
+	if (rns.MTUSize!=handshakeMTUSize || rns.discoveredMTUSize!=0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The MTU changed with path MTU discovery off\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	client->SetPathMTUDiscovery(true);
+	entryTime=GetTimeMS();
+	while ((rns.MTUSize!=MAXIMUM_MTU_SIZE || rns.discoveredMTUSize!=MAXIMUM_MTU_SIZE) && GetTimeMS()-entryTime<5000)
+	{
+		client->DeallocatePacket(client->Receive());
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+		client->GetStatistics(serverAddress, &rns);
+	}
+	if (rns.MTUSize!=MAXIMUM_MTU_SIZE || rns.discoveredMTUSize!=MAXIMUM_MTU_SIZE)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Path MTU discovery did not raise the MTU\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	// Nothing gets through. The reliable message is resent until the current size is confirmed lost.
+	// The split message, at low priority, waits behind immediate priority messages that use up the bandwidth limit, so none of its parts is sent
+	maxIncomingDatagram=0;
+	client->SetPerConnectionOutgoingBandwidthLimit(8);
+	// Too long to share a datagram with a part of the split message
+	BitStream reliableMessage;
+	reliableMessage.Write((MessageID) ID_USER_PACKET_ENUM);
+	reliableMessage.PadWithZeroToByteLength(100);
+	client->Send(&reliableMessage, IMMEDIATE_PRIORITY, RELIABLE, 0, serverAddress, false);
+	BitStream splitMessage;
+	splitMessage.Write((MessageID) (ID_USER_PACKET_ENUM+1));
+	for (int i=0; i < PATH_MTU_SPLIT_MESSAGE_LENGTH; i++)
+		splitMessage.Write((unsigned char) i);
+	client->Send(&splitMessage, LOW_PRIORITY, RELIABLE_ORDERED, 0, serverAddress, false);
+
+	BitStream fillerMessage;
+	fillerMessage.Write((MessageID) (ID_USER_PACKET_ENUM+2));
+	entryTime=GetTimeMS();
+	while (rns.MTUSize>=MAXIMUM_MTU_SIZE && GetTimeMS()-entryTime<10000)
+	{
+		client->Send(&fillerMessage, IMMEDIATE_PRIORITY, UNRELIABLE, 0, serverAddress, false);
+		client->DeallocatePacket(client->Receive());
+		server->DeallocatePacket(server->Receive());
+		RakSleep(50);
+		client->GetStatistics(serverAddress, &rns);
+	}
+	if (rns.MTUSize>=MAXIMUM_MTU_SIZE)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The MTU did not fall back when datagrams stopped arriving\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	// Only small datagrams get through, so the split message arrives only if its parts were split again
+	maxIncomingDatagram=PATH_MTU_SMALL_DATAGRAM;
+	client->SetPerConnectionOutgoingBandwidthLimit(0);
+	bool gotReliableMessage=false, gotSplitMessage=false;
+	entryTime=GetTimeMS();
+	while ((gotReliableMessage==false || gotSplitMessage==false) && GetTimeMS()-entryTime<10000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+				gotReliableMessage=true;
+			else if (packet->data[0]==ID_USER_PACKET_ENUM+1 && packet->length==PATH_MTU_SPLIT_MESSAGE_LENGTH+1)
+			{
+				gotSplitMessage=true;
+				for (int i=0; i < PATH_MTU_SPLIT_MESSAGE_LENGTH; i++)
+				{
+					if (packet->data[i+1]!=(unsigned char) i)
+						gotSplitMessage=false;
+				}
+			}
+		}
+		client->DeallocatePacket(client->Receive());
+		RakSleep(30);
+	}
+	if (gotReliableMessage==false || gotSplitMessage==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("A split message queued before the MTU fell back did not arrive\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 5;
+	}
+
+	return 0;
+}
+
+RakString PathMTUDiscoveryTest::GetTestName()
+{
+
+	return "PathMTUDiscoveryTest";
+
+}
+
+RakString PathMTUDiscoveryTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Could not connect at the smallest MTU";
+		break;
+	case 2:
+		return "The MTU changed with path MTU discovery off";
+		break;
+	case 3:
+		return "Path MTU discovery did not raise the MTU";
+		break;
+	case 4:
+		return "The MTU did not fall back when datagrams stopped arriving";
+		break;
+	case 5:
+		return "A split message queued before the MTU fell back did not arrive";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+PathMTUDiscoveryTest::PathMTUDiscoveryTest(void)
+{
+}
+
+PathMTUDiscoveryTest::~PathMTUDiscoveryTest(void)
+{
+}
+
+void PathMTUDiscoveryTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
@@ -0,0 +1,276 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "RakPeerGroupTest.h"
+
+/*
+Description:
+Tests many instances of RakPeer started on one RakPeerGroup, sharing its socket and update threads.
+
+Success conditions:
+Clients connecting to the group's port reach the instance chosen by the unknown sender handler.
+Reliable ordered messages to and from each instance arrive, and replies come from the right instance.
+An instance in the group can connect out to a system that is not in the group.
+Instances detach from the group when they shut down.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Send
+Receive
+DeallocatePacket
+GetSockets
+ReleaseSockets
+Shutdown
+
+RakPeerGroup Functions Explicitly Tested:
+Startup
+SetUnknownSenderHandler
+GetPeerCount
+Shutdown
+*/
+
+static const int GROUP_INSTANCE_COUNT=8;
+static const int GROUP_CLIENT_COUNT=16;
+static const int GROUP_MESSAGE_COUNT=20;
+
+static RakPeerInterface *groupInstances[GROUP_INSTANCE_COUNT];
+
+// Spread new systems over the instances by port, so the test knows where each client should end up
+static RakPeerInterface *RouteByPort(RNS2RecvStruct *recvStruct, void *userData)
+{
+	(void) userData;
+	return groupInstances[recvStruct->systemAddress.GetPort() % GROUP_INSTANCE_COUNT];
+}
+
+static unsigned short GetBoundPort(RakPeerInterface *peer)
+{
+	DataStructures::List<RakNetSocket2* > sockets;
+	peer->GetSockets(sockets);
+	unsigned short port=sockets[0]->GetBoundAddress().GetPort();
+	peer->ReleaseSockets(sockets);
+	return port;
+}
+
+int RakPeerGroupTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+	group=new RakPeerGroup;
+
+	SocketDescriptor groupSd(0, "127.0.0.1");
+	if (group->Startup(&groupSd, 1, 2)!=RAKNET_STARTED)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("RakPeerGroup::Startup failed\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	int i;
+	for (i=0; i < GROUP_INSTANCE_COUNT; i++)
+	{
+		groupInstances[i]=RakPeerInterface::GetInstance();
+		destroyList.Push(groupInstances[i],_FILE_AND_LINE_);
+		groupInstances[i]->SetMaximumIncomingConnections(GROUP_CLIENT_COUNT);
+		if (groupInstances[i]->Startup(GROUP_CLIENT_COUNT+1, group)!=RAKNET_STARTED)
+		{
+			if (isVerbose)
+				DebugTools::ShowError("Could not start an instance on the group\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 2;
+		}
+	}
+	group->SetUnknownSenderHandler(RouteByPort, 0);
+	unsigned short groupPort=GetBoundPort(groupInstances[0]);
+
+	if (isVerbose)
+		printf("Connecting %i clients to %i instances on port %i\n", GROUP_CLIENT_COUNT, GROUP_INSTANCE_COUNT, groupPort);
+
+	RakPeerInterface *clients[GROUP_CLIENT_COUNT];
+	int expectedInstance[GROUP_CLIENT_COUNT], repliesReceived[GROUP_CLIENT_COUNT];
+	bool connected[GROUP_CLIENT_COUNT];
+	for (i=0; i < GROUP_CLIENT_COUNT; i++)
+	{
+		clients[i]=RakPeerInterface::GetInstance();
+		destroyList.Push(clients[i],_FILE_AND_LINE_);
+		SocketDescriptor clientSd(0, "127.0.0.1");
+		clients[i]->Startup(1, &clientSd, 1);
+		expectedInstance[i]=GetBoundPort(clients[i]) % GROUP_INSTANCE_COUNT;
+		repliesReceived[i]=0;
+		connected[i]=false;
+		clients[i]->Connect("127.0.0.1", groupPort, 0, 0);
+	}
+
+	// A system outside the group, for an instance to connect out to
+	RakPeerInterface *outside=RakPeerInterface::GetInstance();
+	destroyList.Push(outside,_FILE_AND_LINE_);
+	SocketDescriptor outsideSd(0, "127.0.0.1");
+	outside->Startup(1, &outsideSd, 1);
+	outside->SetMaximumIncomingConnections(1);
+	groupInstances[1]->Connect("127.0.0.1", GetBoundPort(outside), 0, 0);
+
+	bool wrongInstance=false, outOfOrder=false, connectedOut=false;
+	int connectedCount=0, repliesCount=0;
+	TimeMS entryTime=GetTimeMS();
+	while ((connectedCount<GROUP_CLIENT_COUNT || repliesCount<GROUP_CLIENT_COUNT*GROUP_MESSAGE_COUNT || connectedOut==false) && GetTimeMS()-entryTime<10000)
+	{
+		for (i=0; i < GROUP_CLIENT_COUNT; i++)
+		{
+			for (Packet *packet=clients[i]->Receive(); packet; clients[i]->DeallocatePacket(packet), packet=clients[i]->Receive())
+			{
+				if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED && connected[i]==false)
+				{
+					connected[i]=true;
+					connectedCount++;
+					for (int j=0; j < GROUP_MESSAGE_COUNT; j++)
+					{
+						BitStream bitStream;
+						bitStream.Write((MessageID) ID_USER_PACKET_ENUM);
+						bitStream.Write(j);
+						clients[i]->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->guid, false);
+					}
+				}
+				else if (packet->data[0]==ID_USER_PACKET_ENUM)
+				{
+					BitStream bitStream(packet->data, packet->length, false);
+					bitStream.IgnoreBytes(sizeof(MessageID));
+					int index, instance;
+					bitStream.Read(index);
+					bitStream.Read(instance);
+					if (index!=repliesReceived[i])
+						outOfOrder=true;
+					if (instance!=expectedInstance[i])
+						wrongInstance=true;
+					repliesReceived[i]++;
+					repliesCount++;
+				}
+			}
+		}
+
+		// Each instance echoes with its own index
+		for (int instance=0; instance < GROUP_INSTANCE_COUNT; instance++)
+		{
+			for (Packet *packet=groupInstances[instance]->Receive(); packet; groupInstances[instance]->DeallocatePacket(packet), packet=groupInstances[instance]->Receive())
+			{
+				if (packet->data[0]==ID_USER_PACKET_ENUM)
+				{
+					BitStream bitStream;
+					bitStream.Write((const char*) packet->data, packet->length);
+					bitStream.Write(instance);
+					groupInstances[instance]->Send(&bitStream, HIGH_PRIORITY, RELIABLE_ORDERED, 0, packet->guid, false);
+				}
+				else if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED && instance==1)
+					connectedOut=true;
+			}
+		}
+		outside->DeallocatePacket(outside->Receive());
+		RakSleep(10);
+	}
+
+	if (connectedCount!=GROUP_CLIENT_COUNT)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Not all clients could connect to the group\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	if (wrongInstance || outOfOrder || repliesCount!=GROUP_CLIENT_COUNT*GROUP_MESSAGE_COUNT)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages were lost, out of order, or handled by the wrong instance\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	if (connectedOut==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("An instance in the group could not connect out\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 5;
+	}
+
+	groupInstances[0]->Shutdown(100);
+	if (group->GetPeerCount()!=GROUP_INSTANCE_COUNT-1)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("An instance that shut down is still in the group\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 6;
+	}
+
+	return 0;
+}
+
+RakString RakPeerGroupTest::GetTestName()
+{
+
+	return "RakPeerGroupTest";
+
+}
+
+RakString RakPeerGroupTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "RakPeerGroup::Startup failed";
+		break;
+	case 2:
+		return "Could not start an instance on the group";
+		break;
+	case 3:
+		return "Not all clients could connect to the group";
+		break;
+	case 4:
+		return "Messages were lost, out of order, or handled by the wrong instance";
+		break;
+	case 5:
+		return "An instance in the group could not connect out";
+		break;
+	case 6:
+		return "An instance that shut down is still in the group";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+RakPeerGroupTest::RakPeerGroupTest(void)
+{
+	group=0;
+}
+
+RakPeerGroupTest::~RakPeerGroupTest(void)
+{
+}
+
+void RakPeerGroupTest::DestroyPeers()
+{
+
+	// Shuts down the instances still in the group
+	if (group)
+		group->Shutdown();
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+	delete group;
+	group=0;
+
+}
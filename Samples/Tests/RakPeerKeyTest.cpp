@@ -0,0 +1,211 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "RakPeerKeyTest.h"
+#include <string.h>
+
+/*
+Description:
+Tests that the secret keys RakPeer uses to authenticate remote systems are random, rather than fixed or derived from public values.
+Two peers are started, and one is restarted. Then two clients connect to a server that allows connection migration.
+
+Success conditions:
+The handshake cookie key is not all zeros.
+Two peers get different handshake cookie keys.
+A peer gets a new handshake cookie key each Startup.
+Each connection gets a connection migration key that is not all zeros, and two connections get different keys.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Shutdown
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+
+RakPeerInterface Functions Explicitly Tested:
+Startup
+AllowConnectionMigration
+*/
+
+static const unsigned short KEY_TEST_SERVER_PORT=60024;
+
+static bool IsAllZero(const unsigned char *key, unsigned int length)
+{
+	for (unsigned int i=0; i < length; i++)
+	{
+		if (key[i]!=0)
+			return false;
+	}
+	return true;
+}
+
+int RakPeerKeyTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	RakPeerKeySpy *peers[2];
+	for (int i=0; i < 2; i++)
+	{
+		peers[i]=RakNet::OP_NEW<RakPeerKeySpy>(_FILE_AND_LINE_);
+		destroyList.Push(peers[i],_FILE_AND_LINE_);
+		SocketDescriptor sd(0, "127.0.0.1");
+		peers[i]->Startup(1, &sd, 1);
+	}
+
+	for (int i=0; i < 2; i++)
+	{
+		if (IsAllZero(peers[i]->GetHandshakeCookieKey(), HANDSHAKE_COOKIE_KEY_LENGTH))
+		{
+			if (isVerbose)
+				DebugTools::ShowError("The handshake cookie key is all zeros\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 1;
+		}
+	}
+
+	if (memcmp(peers[0]->GetHandshakeCookieKey(), peers[1]->GetHandshakeCookieKey(), HANDSHAKE_COOKIE_KEY_LENGTH)==0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Two peers have the same handshake cookie key\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	unsigned char firstKey[HANDSHAKE_COOKIE_KEY_LENGTH];
+	memcpy(firstKey, peers[0]->GetHandshakeCookieKey(), HANDSHAKE_COOKIE_KEY_LENGTH);
+	peers[0]->Shutdown(0);
+	SocketDescriptor sd(0, "127.0.0.1");
+	peers[0]->Startup(1, &sd, 1);
+	if (memcmp(firstKey, peers[0]->GetHandshakeCookieKey(), HANDSHAKE_COOKIE_KEY_LENGTH)==0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("The handshake cookie key did not change on Startup\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	// Connection migration keys, issued by the server with ID_CONNECTION_REQUEST_ACCEPTED
+	RakPeerKeySpy *server=RakNet::OP_NEW<RakPeerKeySpy>(_FILE_AND_LINE_);
+	destroyList.Push(server,_FILE_AND_LINE_);
+	SocketDescriptor serverSd(KEY_TEST_SERVER_PORT, "127.0.0.1");
+	server->Startup(2, &serverSd, 1);
+	server->SetMaximumIncomingConnections(2);
+	server->AllowConnectionMigration(true);
+
+	RakNetGUID clientGuids[2];
+	for (int i=0; i < 2; i++)
+	{
+		RakPeerInterface *client=RakPeerInterface::GetInstance();
+		destroyList.Push(client,_FILE_AND_LINE_);
+		SocketDescriptor clientSd(0, "127.0.0.1");
+		client->Startup(1, &clientSd, 1);
+		client->Connect("127.0.0.1", KEY_TEST_SERVER_PORT, 0, 0);
+		clientGuids[i]=client->GetMyGUID();
+	}
+
+	int connectionCount=0;
+	TimeMS entryTime=GetTimeMS();
+	while (connectionCount < 2 && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_NEW_INCOMING_CONNECTION)
+				connectionCount++;
+		}
+		RakSleep(5);
+	}
+
+	if (connectionCount < 2)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	const unsigned char *migrationKeys[2];
+	for (int i=0; i < 2; i++)
+	{
+		migrationKeys[i]=server->GetConnectionMigrationKey(clientGuids[i]);
+		if (migrationKeys[i]==0 || IsAllZero(migrationKeys[i], CONNECTION_MIGRATION_KEY_LENGTH))
+		{
+			if (isVerbose)
+				DebugTools::ShowError("A connection has no connection migration key, or it is all zeros\n",!noPauses && isVerbose,__LINE__,__FILE__);
+			return 5;
+		}
+	}
+
+	if (memcmp(migrationKeys[0], migrationKeys[1], CONNECTION_MIGRATION_KEY_LENGTH)==0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Two connections have the same connection migration key\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 6;
+	}
+
+	return 0;
+}
+
+RakString RakPeerKeyTest::GetTestName()
+{
+
+	return "RakPeerKeyTest";
+
+}
+
+RakString RakPeerKeyTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "The handshake cookie key is all zeros";
+		break;
+	case 2:
+		return "Two peers have the same handshake cookie key";
+		break;
+	case 3:
+		return "The handshake cookie key did not change on Startup";
+		break;
+	case 4:
+		return "Could not connect";
+		break;
+	case 5:
+		return "A connection has no connection migration key, or it is all zeros";
+		break;
+	case 6:
+		return "Two connections have the same connection migration key";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+RakPeerKeyTest::RakPeerKeyTest(void)
+{
+}
+
+RakPeerKeyTest::~RakPeerKeyTest(void)
+{
+}
+
+void RakPeerKeyTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#pragma once
+
+
+#include "TestInterface.h"
+
+#include "RakString.h"
+
+#include "RakPeerInterface.h"
+#include "MessageIdentifiers.h"
+#include "RakPeer.h"
+#include "RakSleep.h"
+#include "GetTime.h"
+#include "DebugTools.h"
+
+using namespace RakNet;
+
+// Reads the keys a RakPeer keeps to itself
+class RakPeerKeySpy : public RakPeer
+{
+public:
+	const unsigned char *GetHandshakeCookieKey(void) const {return handshakeCookieKey;}
+	// The key issued to a connected system, or 0 if it has none
+	const unsigned char *GetConnectionMigrationKey(RakNetGUID guid) const
+	{
+		RemoteSystemStruct *remoteSystem=GetRemoteSystemFromGUID(guid, true);
+		return remoteSystem && remoteSystem->hasConnectionMigrationKey ? remoteSystem->connectionMigrationKey : 0;
+	}
+};
+
+class RakPeerKeyTest : public TestInterface
+{
+public:
+	RakPeerKeyTest(void);
+	~RakPeerKeyTest(void);
+	int RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses);//should return 0 if no error, or the error number
+	RakString GetTestName();
+	RakString ErrorCodeToString(int errorCode);
+	void DestroyPeers();
+private:
+	DataStructures::List <RakPeerInterface *> destroyList;
+};
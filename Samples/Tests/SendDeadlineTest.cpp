@@ -0,0 +1,205 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "SendDeadlineTest.h"
+
+/*
+Description:
+Tests that unreliable messages still in the send buffer when their deadline passes are discarded rather than sent.
+The client's outgoing bandwidth is limited, so most of a burst cannot be sent before the deadline.
+
+Success conditions:
+Some messages arrive and the rest are reported with ID_SND_RECEIPT_LOSS.
+Every message either arrives or is reported lost.
+USER_MESSAGE_BYTES_DISCARDED counts the discarded messages.
+
+Failure conditions:
+Any success conditions failed
+
+RakPeerInterface Functions used, tested indirectly by its use:
+Startup
+SetMaximumIncomingConnections
+Connect
+Receive
+DeallocatePacket
+SetPerConnectionOutgoingBandwidthLimit
+GetStatistics
+
+RakPeerInterface Functions Explicitly Tested:
+Send
+*/
+
+static const unsigned short DEADLINE_SERVER_PORT=60020;
+static const int DEADLINE_MESSAGE_COUNT=400;
+static const int DEADLINE_MESSAGE_SIZE=500;
+static const RakNet::TimeMS DEADLINE_MS=200;
+
+int SendDeadlineTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	destroyList.Clear(false,_FILE_AND_LINE_);
+
+	RakPeerInterface *server=RakPeerInterface::GetInstance();
+	destroyList.Push(server,_FILE_AND_LINE_);
+	RakPeerInterface *client=RakPeerInterface::GetInstance();
+	destroyList.Push(client,_FILE_AND_LINE_);
+
+	SocketDescriptor serverSd(DEADLINE_SERVER_PORT, "127.0.0.1");
+	server->Startup(1, &serverSd, 1);
+	server->SetMaximumIncomingConnections(1);
+
+	SocketDescriptor clientSd(0, "127.0.0.1");
+	client->Startup(1, &clientSd, 1);
+	client->Connect("127.0.0.1", DEADLINE_SERVER_PORT, 0, 0);
+
+	bool connected=false;
+	SystemAddress serverAddress;
+	TimeMS entryTime=GetTimeMS();
+	while (connected==false && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_CONNECTION_REQUEST_ACCEPTED)
+			{
+				connected=true;
+				serverAddress=packet->systemAddress;
+			}
+		}
+		server->DeallocatePacket(server->Receive());
+		RakSleep(30);
+	}
+
+	if (connected==false)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Could not connect\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 1;
+	}
+
+	// About ten messages a second, so only the first few can go out before the deadline
+	client->SetPerConnectionOutgoingBandwidthLimit(DEADLINE_MESSAGE_COUNT*DEADLINE_MESSAGE_SIZE/40);
+
+	if (isVerbose)
+		printf("Sending %i messages with a deadline of %i milliseconds\n", DEADLINE_MESSAGE_COUNT, DEADLINE_MS);
+
+	char data[DEADLINE_MESSAGE_SIZE];
+	memset(data, 0, sizeof(data));
+	data[0]=ID_USER_PACKET_ENUM;
+	int i;
+	for (i=0; i < DEADLINE_MESSAGE_COUNT; i++)
+		client->Send(data, sizeof(data), HIGH_PRIORITY, UNRELIABLE_WITH_ACK_RECEIPT, 0, serverAddress, false, 0, DEADLINE_MS);
+
+	int messagesReceived=0, receiptsLost=0;
+	entryTime=GetTimeMS();
+	while (messagesReceived+receiptsLost<DEADLINE_MESSAGE_COUNT && GetTimeMS()-entryTime<5000)
+	{
+		for (Packet *packet=server->Receive(); packet; server->DeallocatePacket(packet), packet=server->Receive())
+		{
+			if (packet->data[0]==ID_USER_PACKET_ENUM)
+				messagesReceived++;
+		}
+		for (Packet *packet=client->Receive(); packet; client->DeallocatePacket(packet), packet=client->Receive())
+		{
+			if (packet->data[0]==ID_SND_RECEIPT_LOSS)
+				receiptsLost++;
+		}
+		RakSleep(30);
+	}
+
+	if (isVerbose)
+		printf("%i messages arrived, %i were reported lost\n", messagesReceived, receiptsLost);
+
+	if (receiptsLost==0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("No message was discarded at its deadline\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 2;
+	}
+
+	if (messagesReceived==0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages sent before their deadline did not arrive\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 3;
+	}
+
+	if (messagesReceived+receiptsLost!=DEADLINE_MESSAGE_COUNT)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("Messages were neither delivered nor reported lost\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 4;
+	}
+
+	RakNetStatistics rakNetStatistics;
+	if (client->GetStatistics(serverAddress, &rakNetStatistics)==0 ||
+		rakNetStatistics.runningTotal[USER_MESSAGE_BYTES_DISCARDED] < (uint64_t) receiptsLost*DEADLINE_MESSAGE_SIZE)
+	{
+		if (isVerbose)
+			DebugTools::ShowError("USER_MESSAGE_BYTES_DISCARDED does not count the discarded messages\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return 5;
+	}
+
+	return 0;
+}
+
+RakString SendDeadlineTest::GetTestName()
+{
+
+	return "SendDeadlineTest";
+
+}
+
+RakString SendDeadlineTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "Could not connect";
+		break;
+	case 2:
+		return "No message was discarded at its deadline";
+		break;
+	case 3:
+		return "Messages sent before their deadline did not arrive";
+		break;
+	case 4:
+		return "Messages were neither delivered nor reported lost";
+		break;
+	case 5:
+		return "USER_MESSAGE_BYTES_DISCARDED does not count the discarded messages";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+SendDeadlineTest::SendDeadlineTest(void)
+{
+}
+
+SendDeadlineTest::~SendDeadlineTest(void)
+{
+}
+
+void SendDeadlineTest::DestroyPeers()
+{
+
+	int theSize=destroyList.Size();
+
+	for (int i=0; i < theSize; i++)
+		RakPeerInterface::DestroyInstance(destroyList[i]);
+
+}
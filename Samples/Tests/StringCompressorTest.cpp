@@ -0,0 +1,273 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant 
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "StringCompressorTest.h"
+#include "StringCompressor.h"
+#include "DS_HuffmanEncodingTree.h"
+#include "DataCompressor.h"
+#include <string.h>
+
+/*
+Description:
+Encodes random strings and English text at random bit offsets with StringCompressor and decodes them, in full and truncated.
+Trains a language on sample text, sends it with WriteLanguage and ReadLanguage, and decodes with the copy what was encoded with the original.
+Builds a HuffmanEncodingTree from frequencies that would give codes longer than HUFFMAN_MAX_CODE_LENGTH, and compresses with DataCompressor.
+
+Success conditions:
+Strings decode to what was encoded, and truncated strings to the start of it, with the read offset after the string either way.
+A trained language compresses its sample text smaller than the English tree, and FinishTraining fails for a language with no samples.
+A language read with ReadLanguage decodes the same as the original, and ReadLanguage fails for lengths that are not a valid tree.
+No code is longer than HUFFMAN_MAX_CODE_LENGTH, and the tree decodes what it encodes.
+DataCompressor decompresses what it compressed.
+
+Failure conditions:
+Any success conditions failed
+
+StringCompressor Functions Explicitly Tested:
+EncodeString
+DecodeString
+AddTrainingSample
+FinishTraining
+WriteLanguage
+ReadLanguage
+
+HuffmanEncodingTree Functions Explicitly Tested:
+GenerateFromFrequencyTable
+GetCodeLengths
+EncodeArray
+DecodeArray
+*/
+
+static const char *englishText = "The quick brown fox jumps over the lazy dog. Meet me at the north gate at 10:30, and bring the key!";
+
+static const uint8_t TRAINED_LANGUAGE=5;
+static const uint8_t RECEIVED_LANGUAGE=6;
+
+// Fills with random characters, other than the terminator
+static void RandomString(char *output, int length)
+{
+	for (int i=0; i < length; i++)
+		output[i]=(char) (1 + randomMT() % 255);
+	output[length]=0;
+}
+
+// Encodes input after some bits and a value after it, then decodes to a buffer of maxCharsToWrite. Returns false if the output or the value after it differ
+static bool RoundTrip(const char *input, int maxCharsToWrite, uint8_t encodeLanguage, uint8_t decodeLanguage)
+{
+	StringCompressor *stringCompressor = StringCompressor::Instance();
+	BitStream bitStream;
+	int leadingBits = randomMT() % 8;
+	for (int i=0; i < leadingBits; i++)
+		bitStream.Write1();
+	stringCompressor->EncodeString(input, 0, &bitStream, encodeLanguage);
+	unsigned int after = randomMT();
+	bitStream.Write(after);
+
+	char output[512];
+	unsigned int afterOutput=0;
+	bitStream.IgnoreBits(leadingBits);
+	if (stringCompressor->DecodeString(output, maxCharsToWrite, &bitStream, decodeLanguage)==false)
+		return false;
+	if (bitStream.Read(afterOutput)==false || afterOutput!=after)
+		return false;
+	int expectedLength = (int) strlen(input) < maxCharsToWrite ? (int) strlen(input) : maxCharsToWrite-1;
+	return (int) strlen(output)==expectedLength && memcmp(output, input, expectedLength)==0;
+}
+
+static int TestStrings(void)
+{
+	char input[300];
+	for (int round=0; round < 500; round++)
+	{
+		if (round % 2)
+			RandomString(input, randomMT() % 300);
+		else
+		{
+			int offset = randomMT() % (int) strlen(englishText);
+			strcpy(input, englishText+offset);
+		}
+		if (RoundTrip(input, sizeof(input), 0, 0)==false)
+			return 1;
+		if (RoundTrip(input, 1 + randomMT() % sizeof(input), 0, 0)==false)
+			return 2;
+	}
+	return 0;
+}
+
+static int TestTraining(void)
+{
+	StringCompressor *stringCompressor = StringCompressor::Instance();
+	if (stringCompressor->FinishTraining(TRAINED_LANGUAGE))
+		return 3;
+
+	// Text unlike English, so the trained language should be smaller
+	const char *sample = "0101 1100 0011 1010 1111 0000 1001 0110 ";
+	for (int i=0; i < 100; i++)
+		stringCompressor->AddTrainingSample((const unsigned char*) sample, (unsigned) strlen(sample), TRAINED_LANGUAGE);
+	if (stringCompressor->FinishTraining(TRAINED_LANGUAGE)==false)
+		return 3;
+
+	BitStream english, trained;
+	stringCompressor->EncodeString(sample, 0, &english, 0);
+	stringCompressor->EncodeString(sample, 0, &trained, TRAINED_LANGUAGE);
+	if (trained.GetNumberOfBitsUsed() >= english.GetNumberOfBitsUsed())
+		return 3;
+	if (RoundTrip(sample, 512, TRAINED_LANGUAGE, TRAINED_LANGUAGE)==false)
+		return 3;
+
+	// Send the language, and decode with the copy
+	BitStream language;
+	if (stringCompressor->WriteLanguage(TRAINED_LANGUAGE, &language)==false)
+		return 4;
+	if (stringCompressor->ReadLanguage(&language, RECEIVED_LANGUAGE)==false)
+		return 4;
+	char input[300];
+	for (int round=0; round < 100; round++)
+	{
+		RandomString(input, randomMT() % 300);
+		if (RoundTrip(input, sizeof(input), TRAINED_LANGUAGE, RECEIVED_LANGUAGE)==false)
+			return 4;
+	}
+
+	// Every code 1 bit long is not a valid tree
+	BitStream invalidLanguage;
+	for (int i=0; i < 256; i++)
+		invalidLanguage.WriteBits((const unsigned char*) "\001", 5, true);
+	if (stringCompressor->ReadLanguage(&invalidLanguage, RECEIVED_LANGUAGE+1))
+		return 4;
+	BitStream shortLanguage;
+	shortLanguage.Write((unsigned int) 0);
+	if (stringCompressor->ReadLanguage(&shortLanguage, RECEIVED_LANGUAGE+1))
+		return 4;
+	return 0;
+}
+
+static int TestLongCodes(void)
+{
+	// Fibonacci frequencies give the most unbalanced tree, with codes far longer than the limit
+	unsigned int frequencyTable[256];
+	unsigned int a=1, b=1;
+	int i;
+	for (i=0; i < 256; i++)
+	{
+		frequencyTable[i] = i < 40 ? a : 1;
+		unsigned int c=a+b;
+		a=b;
+		b=c;
+	}
+	HuffmanEncodingTree tree;
+	tree.GenerateFromFrequencyTable(frequencyTable);
+	unsigned char codeLengths[256];
+	tree.GetCodeLengths(codeLengths);
+	for (i=0; i < 256; i++)
+	{
+		if (codeLengths[i] < 1 || codeLengths[i] > HUFFMAN_MAX_CODE_LENGTH)
+			return 5;
+	}
+
+	unsigned char input[1000], output[1000];
+	for (i=0; i < (int) sizeof(input); i++)
+		input[i] = (unsigned char) (randomMT() % 2 ? randomMT() % 40 : randomMT());
+	BitStream bitStream;
+	tree.EncodeArray(input, sizeof(input), &bitStream);
+	if (tree.DecodeArray(&bitStream, bitStream.GetNumberOfBitsUsed(), sizeof(output), output)!=sizeof(input) || memcmp(input, output, sizeof(input))!=0)
+		return 5;
+	return 0;
+}
+
+static int TestDataCompressor(void)
+{
+	unsigned char input[5000];
+	for (int i=0; i < (int) sizeof(input); i++)
+		input[i] = (unsigned char) englishText[randomMT() % strlen(englishText)];
+	BitStream bitStream;
+	DataCompressor::Compress(input, sizeof(input), &bitStream);
+	unsigned char *output;
+	unsigned int outputLength = DataCompressor::DecompressAndAllocate(&bitStream, &output);
+	bool success = outputLength==sizeof(input) && memcmp(input, output, sizeof(input))==0;
+	if (outputLength)
+		rakFree_Ex(output, _FILE_AND_LINE_);
+	return success ? 0 : 6;
+}
+
+int StringCompressorTest::RunTest(DataStructures::List<RakString> params,bool isVerbose,bool noPauses)
+{
+	StringCompressor::AddReference();
+	int errorCode=TestStrings();
+	if (errorCode==0)
+		errorCode=TestTraining();
+	if (errorCode==0)
+		errorCode=TestLongCodes();
+	if (errorCode==0)
+		errorCode=TestDataCompressor();
+	StringCompressor::RemoveReference();
+
+	if (errorCode!=0)
+	{
+		if (isVerbose)
+			DebugTools::ShowError(ErrorCodeToString(errorCode)+"\n",!noPauses && isVerbose,__LINE__,__FILE__);
+		return errorCode;
+	}
+
+	return 0;
+}
+
+RakString StringCompressorTest::GetTestName()
+{
+
+	return "StringCompressorTest";
+
+}
+
+RakString StringCompressorTest::ErrorCodeToString(int errorCode)
+{
+
+	switch (errorCode)
+	{
+
+	case 0:
+		return "No error";
+		break;
+	case 1:
+		return "A string decoded differently";
+		break;
+	case 2:
+		return "A truncated string decoded differently, or left the read offset inside the string";
+		break;
+	case 3:
+		return "Training failed, or the trained language did not compress its samples better than English";
+		break;
+	case 4:
+		return "A language read with ReadLanguage decoded differently, or an invalid one was accepted";
+		break;
+	case 5:
+		return "A code was longer than HUFFMAN_MAX_CODE_LENGTH, or the tree did not decode what it encoded";
+		break;
+	case 6:
+		return "DataCompressor decompressed differently";
+		break;
+
+	default:
+		return "Undefined Error";
+	}
+
+}
+
+StringCompressorTest::StringCompressorTest(void)
+{
+}
+
+StringCompressorTest::~StringCompressorTest(void)
+{
+}
+
+void StringCompressorTest::DestroyPeers()
+{
+}
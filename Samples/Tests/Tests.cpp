@@ -55,6 +55,28 @@ int main(int argc, char *argv[])
 	testList.Push(new SystemAddressAndGuidTest(),_FILE_AND_LINE_);	
 	testList.Push(new PacketAndLowLevelTestsTest(),_FILE_AND_LINE_);
 	testList.Push(new MiscellaneousTestsTest(),_FILE_AND_LINE_);
+	testList.Push(new PacketFilterTest(),_FILE_AND_LINE_);
+	testList.Push(new RakPeerGroupTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamVarIntTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamArenaTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamChainTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamQuantizeTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamDeltaTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamArrayTest(),_FILE_AND_LINE_);
+	testList.Push(new StringCompressorTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamViewTest(),_FILE_AND_LINE_);
+	testList.Push(new SendDeadlineTest(),_FILE_AND_LINE_);
+	testList.Push(new CoalescingKeyTest(),_FILE_AND_LINE_);
+	testList.Push(new ConnectionMigrationTest(),_FILE_AND_LINE_);
+	testList.Push(new RakPeerKeyTest(),_FILE_AND_LINE_);
+	testList.Push(new OrderingChannelLimitTest(),_FILE_AND_LINE_);
+	testList.Push(new OfflineRateLimiterTest(),_FILE_AND_LINE_);
+	testList.Push(new PathMTUDiscoveryTest(),_FILE_AND_LINE_);
+	testList.Push(new BitStreamSchemaTest(),_FILE_AND_LINE_);
+	testList.Push(new BanListTest(),_FILE_AND_LINE_);
+#if !defined(_WIN32) && !defined(__native_client__) && !defined(WINDOWS_STORE_RT) && RAKNET_SUPPORT_IO_URING==1
+	testList.Push(new IOUringLoopbackTest(),_FILE_AND_LINE_);
+#endif
 
 	testListSize=testList.Size();
 
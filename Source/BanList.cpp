@@ -0,0 +1,371 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BanList.h"
+#include "GetTime.h"
+#include "RakSleep.h"
+#include "RakAssert.h"
+#include <string.h>
+#include <stdlib.h>
+
+using namespace RakNet;
+
+// Node 0 is the IPv4 root, node 1 the IPv6 root
+static const unsigned int BAN_LIST_IPV4_ROOT=0;
+static const unsigned int BAN_LIST_IPV6_ROOT=1;
+
+static inline int GetKeyBit(const unsigned char *address, unsigned int bit)
+{
+	return (address[bit>>3] >> (7-(bit&7))) & 1;
+}
+static inline bool IsExpired(RakNet::TimeMS timeout, RakNet::TimeMS time)
+{
+	return timeout>0 && timeout<time;
+}
+
+void BanList::Trie::Init( void )
+{
+	Node root;
+	root.child[0]=root.child[1]=0;
+	root.banned=false;
+	root.timeout=0;
+	nodes.Clear(false, _FILE_AND_LINE_);
+	freeNodes.Clear(false, _FILE_AND_LINE_);
+	nodes.Insert(root, _FILE_AND_LINE_);
+	nodes.Insert(root, _FILE_AND_LINE_);
+	rangeCount=0;
+}
+void BanList::Trie::Insert( const Key &key, RakNet::TimeMS timeout )
+{
+	unsigned int nodeIndex = key.isIPv6 ? BAN_LIST_IPV6_ROOT : BAN_LIST_IPV4_ROOT;
+	for (unsigned int bit=0; bit < key.prefixLength; bit++)
+	{
+		int direction=GetKeyBit(key.address, bit);
+		if (nodes[nodeIndex].child[direction]==0)
+		{
+			Node node;
+			node.child[0]=node.child[1]=0;
+			node.banned=false;
+			node.timeout=0;
+			unsigned int newIndex;
+			if (freeNodes.Size())
+			{
+				newIndex=freeNodes.Pop();
+				nodes[newIndex]=node;
+			}
+			else
+			{
+				newIndex=nodes.Size();
+				nodes.Insert(node, _FILE_AND_LINE_);
+			}
+			nodes[nodeIndex].child[direction]=newIndex;
+		}
+		nodeIndex=nodes[nodeIndex].child[direction];
+	}
+	if (nodes[nodeIndex].banned==false)
+		rangeCount++;
+	nodes[nodeIndex].banned=true;
+	nodes[nodeIndex].timeout=timeout;
+}
+bool BanList::Trie::Remove( const Key &key )
+{
+	unsigned int path[129];
+	unsigned int nodeIndex = key.isIPv6 ? BAN_LIST_IPV6_ROOT : BAN_LIST_IPV4_ROOT;
+	unsigned int bit;
+	path[0]=nodeIndex;
+	for (bit=0; bit < key.prefixLength; bit++)
+	{
+		nodeIndex=nodes[nodeIndex].child[GetKeyBit(key.address, bit)];
+		if (nodeIndex==0)
+			return false;
+		path[bit+1]=nodeIndex;
+	}
+	if (nodes[nodeIndex].banned==false)
+		return false;
+	nodes[nodeIndex].banned=false;
+	rangeCount--;
+
+	// Free nodes that no longer lead to a ban
+	while (bit > 0)
+	{
+		Node &node = nodes[path[bit]];
+		if (node.banned || node.child[0] || node.child[1])
+			break;
+		nodes[path[bit-1]].child[GetKeyBit(key.address, bit-1)]=0;
+		freeNodes.Push(path[bit], _FILE_AND_LINE_);
+		bit--;
+	}
+	return true;
+}
+bool BanList::Trie::Find( const Key &key, RakNet::TimeMS time ) const
+{
+	unsigned int nodeIndex = key.isIPv6 ? BAN_LIST_IPV6_ROOT : BAN_LIST_IPV4_ROOT;
+	for (unsigned int bit=0; ; bit++)
+	{
+		const Node &node = nodes[nodeIndex];
+		if (node.banned && IsExpired(node.timeout, time)==false)
+			return true;
+		if (bit==key.prefixLength)
+			return false;
+		nodeIndex=node.child[GetKeyBit(key.address, bit)];
+		if (nodeIndex==0)
+			return false;
+	}
+}
+bool BanList::Trie::GetTimeout( const Key &key, RakNet::TimeMS *timeout ) const
+{
+	unsigned int nodeIndex = key.isIPv6 ? BAN_LIST_IPV6_ROOT : BAN_LIST_IPV4_ROOT;
+	for (unsigned int bit=0; bit < key.prefixLength; bit++)
+	{
+		nodeIndex=nodes[nodeIndex].child[GetKeyBit(key.address, bit)];
+		if (nodeIndex==0)
+			return false;
+	}
+	if (nodes[nodeIndex].banned==false)
+		return false;
+	*timeout=nodes[nodeIndex].timeout;
+	return true;
+}
+void BanList::Trie::Clear( void )
+{
+	Init();
+}
+
+BanList::BanList()
+{
+	tries[0].Init();
+	tries[1].Init();
+}
+BanList::~BanList()
+{
+}
+bool BanList::ParseRange( const char *IP, Key *key, bool allowPrefix )
+{
+	char str[64];
+	if (IP==0 || IP[0]==0 || strlen(IP) >= sizeof(str))
+		return false;
+	strcpy(str, IP);
+	memset(key->address, 0, sizeof(key->address));
+
+	int prefixLength=-1;
+	char *slash = strchr(str, '/');
+	if (slash)
+	{
+		if (allowPrefix==false || slash[1]<'0' || slash[1]>'9')
+			return false;
+		// The whole suffix must be the number, and it is checked against the address length below
+		char *end;
+		long value=strtol(slash+1, &end, 10);
+		if (*end!=0 || value>128)
+			return false;
+		prefixLength=(int) value;
+		*slash=0;
+	}
+
+	if (strchr(str, ':'))
+	{
+#if RAKNET_SUPPORT_IPV6==1
+		SystemAddress systemAddress;
+		if (systemAddress.FromString(str, '|', 6)==false || systemAddress.GetIPVersion()!=6)
+			return false;
+		memcpy(key->address, &systemAddress.address.addr6.sin6_addr, 16);
+		key->isIPv6=true;
+		if (prefixLength<0)
+			prefixLength=128;
+		if (prefixLength>128)
+			return false;
+		key->prefixLength=(unsigned char) prefixLength;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	// Dotted IPv4, where trailing octets may be *
+	key->isIPv6=false;
+	int octetCount=0, wildcardCount=0;
+	char *octet=str;
+	for (;;)
+	{
+		char *dot=strchr(octet, '.');
+		if (dot)
+			*dot=0;
+		if (octetCount==4)
+			return false;
+		if (octet[0]=='*' && octet[1]==0)
+			wildcardCount++;
+		else
+		{
+			if (wildcardCount>0 || octet[0]<'0' || octet[0]>'9' || strlen(octet)>3)
+				return false;
+			for (char *c=octet; *c; c++)
+			{
+				if (*c<'0' || *c>'9')
+					return false;
+			}
+			int value=atoi(octet);
+			if (value>255)
+				return false;
+			key->address[octetCount]=(unsigned char) value;
+		}
+		octetCount++;
+		if (dot==0)
+			break;
+		octet=dot+1;
+	}
+	if (wildcardCount>0)
+	{
+		// 128.0.0.* is 128.0.0.0/24, and 128.* is 128.0.0.0/8
+		if (prefixLength>=0 || allowPrefix==false)
+			return false;
+		prefixLength=(octetCount-wildcardCount)*8;
+	}
+	else if (octetCount!=4)
+		return false;
+	if (prefixLength<0)
+		prefixLength=32;
+	if (prefixLength>32)
+		return false;
+	key->prefixLength=(unsigned char) prefixLength;
+	return true;
+}
+void BanList::SystemAddressToKey( const SystemAddress &systemAddress, Key *key )
+{
+	memset(key->address, 0, sizeof(key->address));
+#if RAKNET_SUPPORT_IPV6==1
+	if (systemAddress.GetIPVersion()==6)
+	{
+		const unsigned char *a = (const unsigned char*) &systemAddress.address.addr6.sin6_addr;
+		static const unsigned char v4MappedPrefix[12]={0,0,0,0,0,0,0,0,0,0,0xFF,0xFF};
+		if (memcmp(a, v4MappedPrefix, sizeof(v4MappedPrefix))==0)
+		{
+			// Matches IPv4 bans
+			memcpy(key->address, a+12, 4);
+			key->prefixLength=32;
+			key->isIPv6=false;
+		}
+		else
+		{
+			memcpy(key->address, a, 16);
+			key->prefixLength=128;
+			key->isIPv6=true;
+		}
+		return;
+	}
+#endif
+	memcpy(key->address, &systemAddress.address.addr4.sin_addr, 4);
+	key->prefixLength=32;
+	key->isIPv6=false;
+}
+void BanList::Write( WriteOperation operation, const Key &key, RakNet::TimeMS timeout )
+{
+	// Change the copy that lookups are not using, then point lookups at it
+	unsigned int oldActive = activeTrie.GetValue() & 1;
+	for (int pass=0; pass < 2; pass++)
+	{
+		Trie &trie = tries[1-oldActive];
+		if (operation==WO_INSERT)
+			trie.Insert(key, timeout);
+		else if (operation==WO_REMOVE)
+			trie.Remove(key);
+		else
+			trie.Clear();
+
+		if (pass==0)
+		{
+			activeTrie.Increment();
+			// Wait for lookups that started before the switch
+			while (readers[oldActive].GetValue()>0)
+				RakSleep(0);
+			oldActive=1-oldActive;
+		}
+	}
+}
+bool BanList::Add( const char *IP, RakNet::TimeMS milliseconds )
+{
+	Key key;
+	if (ParseRange(IP, &key, true)==false)
+		return false;
+
+	RakNet::TimeMS timeout = milliseconds==0 ? 0 : RakNet::GetTimeMS()+milliseconds;
+	if (timeout==0 && milliseconds!=0)
+		timeout=1;
+	writeMutex.Lock();
+	Write(WO_INSERT, key, timeout);
+	if (timeout!=0)
+		expiryHeap.Push(timeout, key, _FILE_AND_LINE_);
+	writeMutex.Unlock();
+	return true;
+}
+void BanList::Remove( const char *IP )
+{
+	Key key;
+	if (ParseRange(IP, &key, true)==false)
+		return;
+	writeMutex.Lock();
+	Write(WO_REMOVE, key, 0);
+	writeMutex.Unlock();
+}
+void BanList::Clear( void )
+{
+	Key key;
+	memset(&key, 0, sizeof(key));
+	writeMutex.Lock();
+	Write(WO_CLEAR, key, 0);
+	expiryHeap.Clear(false, _FILE_AND_LINE_);
+	writeMutex.Unlock();
+}
+void BanList::RemoveExpired( RakNet::TimeMS time )
+{
+	writeMutex.Lock();
+	while (expiryHeap.Size() && expiryHeap.PeekWeight()<time)
+	{
+		RakNet::TimeMS heapTimeout = expiryHeap.PeekWeight();
+		Key key = expiryHeap.Pop(0);
+		// Skip if the range was removed or banned again since
+		RakNet::TimeMS currentTimeout;
+		if (tries[activeTrie.GetValue() & 1].GetTimeout(key, &currentTimeout) && currentTimeout==heapTimeout)
+			Write(WO_REMOVE, key, 0);
+	}
+	writeMutex.Unlock();
+}
+bool BanList::Find( const Key &key )
+{
+	unsigned int index;
+	for (;;)
+	{
+		index = activeTrie.GetValue() & 1;
+		readers[index].Increment();
+		// Only safe to read if the writer did not switch before it could see our increment
+		if ((activeTrie.GetValue() & 1)==index)
+			break;
+		readers[index].Decrement();
+	}
+	bool banned = tries[index].rangeCount>0 && tries[index].Find(key, RakNet::GetTimeMS());
+	readers[index].Decrement();
+	return banned;
+}
+bool BanList::IsBanned( const char *IP )
+{
+	Key key;
+	if (ParseRange(IP, &key, false)==false)
+		return false;
+	return Find(key);
+}
+bool BanList::IsBanned( const SystemAddress &systemAddress )
+{
+	Key key;
+	SystemAddressToKey(systemAddress, &key);
+	return Find(key);
+}
+unsigned int BanList::Size( void ) const
+{
+	return tries[activeTrie.GetValue() & 1].rangeCount;
+}
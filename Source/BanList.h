@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file BanList.h
+/// \brief Banned address ranges, used by RakPeer
+///
+
+#ifndef __BAN_LIST_H
+#define __BAN_LIST_H
+
+#include "Export.h"
+#include "RakNetTypes.h"
+#include "SimpleMutex.h"
+#include "LocklessTypes.h"
+#include "DS_List.h"
+#include "DS_Heap.h"
+
+namespace RakNet
+{
+
+/// \brief Set of banned IPv4 and IPv6 address prefixes with optional expiry
+/// \details Lookups walk a binary trie keyed by the address bits, so their cost depends on the address length and not on the number of bans.
+/// Two copies of the trie are kept. Lookups read one without locking, while a change is made to the other, the copies are swapped, and the change is repeated once no lookup is using the old copy.
+/// Changes are serialized with a mutex.
+class RAK_DLL_EXPORT BanList
+{
+public:
+	BanList();
+	~BanList();
+
+	/// Ban a range of addresses
+	/// \param[in] IP An IPv4 or IPv6 address. An IPv4 address can end in * octets, such as 128.0.0.*, and either can have a CIDR prefix length, such as 10.0.0.0/8
+	/// The prefix length can be at most 32 for IPv4 and 128 for IPv6.
+	/// \param[in] milliseconds How long the ban lasts. 0 for forever. If the range is already banned, the time is replaced
+	/// \return False if \a IP could not be parsed
+	bool Add( const char *IP, RakNet::TimeMS milliseconds );
+
+	/// Remove a range added with Add(). \a IP must describe the same range, but need not be the same string.
+	void Remove( const char *IP );
+
+	/// Remove all bans
+	void Clear( void );
+
+	/// \return True if \a IP is in any range that has not expired
+	bool IsBanned( const char *IP );
+
+	/// \return True if the address of \a systemAddress, ignoring the port, is in any range that has not expired
+	bool IsBanned( const SystemAddress &systemAddress );
+
+	/// Remove ranges that have expired. Returns immediately if none have.
+	void RemoveExpired( RakNet::TimeMS time );
+
+	/// \return Number of banned ranges, including those that have expired but were not yet removed
+	unsigned int Size( void ) const;
+
+protected:
+	struct Key
+	{
+		unsigned char address[16];
+		unsigned char prefixLength;
+		bool isIPv6;
+	};
+
+	struct Node
+	{
+		// 0 for none. Node 0 is never a child
+		unsigned int child[2];
+		bool banned;
+		// 0 for forever
+		RakNet::TimeMS timeout;
+	};
+
+	// Single threaded binary trie. IPv4 and IPv6 have separate roots.
+	struct Trie
+	{
+		void Init( void );
+		void Insert( const Key &key, RakNet::TimeMS timeout );
+		bool Remove( const Key &key );
+		bool Find( const Key &key, RakNet::TimeMS time ) const;
+		bool GetTimeout( const Key &key, RakNet::TimeMS *timeout ) const;
+		void Clear( void );
+
+		DataStructures::List<Node> nodes;
+		DataStructures::List<unsigned int> freeNodes;
+		unsigned int rangeCount;
+	};
+
+	enum WriteOperation
+	{
+		WO_INSERT,
+		WO_REMOVE,
+		WO_CLEAR
+	};
+
+	static bool ParseRange( const char *IP, Key *key, bool allowPrefix );
+	static void SystemAddressToKey( const SystemAddress &systemAddress, Key *key );
+	bool Find( const Key &key );
+	// Requires writeMutex
+	void Write( WriteOperation operation, const Key &key, RakNet::TimeMS timeout );
+
+	Trie tries[2];
+	// Low bit is the index of the trie that lookups should use
+	LocklessUint32_t activeTrie;
+	LocklessUint32_t readers[2];
+	SimpleMutex writeMutex;
+
+	// Timed bans, soonest first. Entries are stale if the range was removed or banned again. Requires writeMutex.
+	DataStructures::Heap<RakNet::TimeMS, Key, false> expiryHeap;
+};
+
+} // namespace RakNet
+
+#endif
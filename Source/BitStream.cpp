@@ -18,6 +18,7 @@
 #else
 
 #include "BitStream.h"
+#include "BitStreamArena.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -47,6 +48,15 @@
 #include <float.h>
 #endif
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BITSTREAM_SHIFT_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#include <emmintrin.h>
+#define BITSTREAM_SHIFT_SSE2
+#endif
+
 // MSWin uses _copysign, others use copysign...
 #ifndef _WIN32
 #define _copysign copysign
@@ -74,6 +84,17 @@ BitStream::BitStream()
 #endif
 	//memset(data, 0, 32);
 	copyData = true;
+	arena = 0;
+}
+
+BitStream::BitStream( BitStreamArena *_arena )
+{
+	numberOfBitsUsed = 0;
+	numberOfBitsAllocated = BITSTREAM_STACK_ALLOCATION_SIZE * 8;
+	readOffset = 0;
+	data = ( unsigned char* ) stackData;
+	copyData = true;
+	arena = _arena;
 }
 
 BitStream::BitStream( const unsigned int initialBytesToAllocate )
@@ -95,6 +116,7 @@ BitStream::BitStream( const unsigned int initialBytesToAllocate )
 #endif
 	// memset(data, 0, initialBytesToAllocate);
 	copyData = true;
+	arena = 0;
 }
 
 BitStream::BitStream( unsigned char* _data, const unsigned int lengthInBytes, bool _copyData )
@@ -103,6 +125,7 @@ BitStream::BitStream( unsigned char* _data, const unsigned int lengthInBytes, bo
 	readOffset = 0;
 	copyData = _copyData;
 	numberOfBitsAllocated = lengthInBytes << 3;
+	arena = 0;
 
 	if ( copyData )
 	{
@@ -138,10 +161,23 @@ void BitStream::SetNumberOfBitsAllocated( const BitSize_t lengthInBits )
 	numberOfBitsAllocated = lengthInBits;
 }
 
+void BitStream::SetArena( BitStreamArena *_arena )
+{
+	// Once on the heap or in another arena, the buffer stays there
+	RakAssert( data == ( unsigned char* ) stackData || arena == _arena );
+	if ( data == ( unsigned char* ) stackData )
+		arena = _arena;
+}
+
 BitStream::~BitStream()
 {
 	if ( copyData && numberOfBitsAllocated > (BITSTREAM_STACK_ALLOCATION_SIZE << 3))
-		rakFree_Ex( data , _FILE_AND_LINE_ );  // Use realloc and free so we are more efficient than delete and new for resizing
+	{
+		if ( arena )
+			arena->Release( data, BITS_TO_BYTES( numberOfBitsAllocated ) );
+		else
+			rakFree_Ex( data , _FILE_AND_LINE_ );  // Use realloc and free so we are more efficient than delete and new for resizing
+	}
 }
 
 void BitStream::Reset( void )
@@ -268,6 +304,179 @@ bool BitStream::Read( BitStream &bitStream )
 	return true;
 }
 
+// Unchanged bytes between two changed ones that are sent anyway, rather than starting a new run, which costs at least two bytes
+#define BITSTREAM_DELTA_MIN_GAP 3
+
+// The bytes of a stream for WriteBitStreamDelta(), with the unused bits of the last byte cleared, and zeroes past the end
+struct BitStreamDeltaSource
+{
+	BitStreamDeltaSource(const BitStream *bitStream)
+	{
+		data=bitStream->GetData();
+		bytes=(unsigned int) BITS_TO_BYTES(bitStream->GetNumberOfBitsUsed());
+		fullBytes=(unsigned int) (bitStream->GetNumberOfBitsUsed() >> 3);
+		lastByte=0;
+		if (fullBytes!=bytes)
+			lastByte=(unsigned char) (data[fullBytes] & (0xFF << (8 - (bitStream->GetNumberOfBitsUsed() & 7))));
+	}
+	inline unsigned char ByteAt(unsigned int index) const
+	{
+		if (index < fullBytes)
+			return data[index];
+		return index < bytes ? lastByte : 0;
+	}
+
+	const unsigned char *data;
+	unsigned int bytes, fullBytes;
+	unsigned char lastByte;
+};
+
+// First byte at or after index that differs from the baseline, or current.bytes. Bytes past the end of the baseline always differ, so they are sent
+static unsigned int FindDeltaDifference(const BitStreamDeltaSource &current, const BitStreamDeltaSource &baseline, unsigned int index)
+{
+	const unsigned int wordEnd = current.fullBytes < baseline.fullBytes ? current.fullBytes : baseline.fullBytes;
+	while (index+8 <= wordEnd)
+	{
+		uint64_t currentWord, baselineWord;
+		memcpy(&currentWord, current.data+index, sizeof(currentWord));
+		memcpy(&baselineWord, baseline.data+index, sizeof(baselineWord));
+		if (currentWord!=baselineWord)
+			break;
+		index+=8;
+	}
+	while (index < current.bytes && index < baseline.bytes && current.ByteAt(index)==baseline.ByteAt(index))
+		index++;
+	return index;
+}
+
+// First byte at or after index that starts at least BITSTREAM_DELTA_MIN_GAP unchanged bytes, or the unchanged bytes at the end, or current.bytes
+static unsigned int FindDeltaMatch(const BitStreamDeltaSource &current, const BitStreamDeltaSource &baseline, unsigned int index)
+{
+	for (;;)
+	{
+		while (index < current.bytes && (index >= baseline.bytes || current.ByteAt(index)!=baseline.ByteAt(index)))
+			index++;
+		if (index==current.bytes)
+			return index;
+		unsigned int difference = FindDeltaDifference(current, baseline, index);
+		if (difference-index >= BITSTREAM_DELTA_MIN_GAP || difference==current.bytes)
+			return index;
+		index=difference;
+	}
+}
+
+void BitStream::WriteBitStreamDelta( const BitStream *current, const BitStream *baseline )
+{
+	RakAssert(current!=this && baseline!=this);
+	const BitStreamDeltaSource currentSource(current), baselineSource(baseline);
+	WriteVarInt(current->GetNumberOfBitsUsed());
+
+	unsigned char xorBytes[256];
+	unsigned int index=0;
+	while (index < currentSource.bytes)
+	{
+		unsigned int changedStart = FindDeltaDifference(currentSource, baselineSource, index);
+		unsigned int changedEnd = FindDeltaMatch(currentSource, baselineSource, changedStart);
+		WriteVarInt(changedStart-index);
+		WriteVarInt(changedEnd-changedStart);
+		for (index=changedStart; index < changedEnd;)
+		{
+			unsigned int chunk = changedEnd-index < sizeof(xorBytes) ? changedEnd-index : (unsigned int) sizeof(xorBytes);
+			unsigned int i=0;
+			// A word at a time where both streams have whole bytes
+			for (; i+8 <= chunk && index+i+8 <= currentSource.fullBytes && index+i+8 <= baselineSource.fullBytes; i+=8)
+			{
+				uint64_t currentWord, baselineWord;
+				memcpy(&currentWord, currentSource.data+index+i, sizeof(currentWord));
+				memcpy(&baselineWord, baselineSource.data+index+i, sizeof(baselineWord));
+				currentWord^=baselineWord;
+				memcpy(xorBytes+i, &currentWord, sizeof(currentWord));
+			}
+			for (; i < chunk; i++)
+				xorBytes[i]=(unsigned char) (currentSource.ByteAt(index+i) ^ baselineSource.ByteAt(index+i));
+			WriteBits(xorBytes, BYTES_TO_BITS(chunk), false);
+			index+=chunk;
+		}
+	}
+}
+
+bool BitStream::ReadBitStreamDelta( const BitStream *baseline, BitStream *current )
+{
+	RakAssert(current!=this && current!=baseline);
+	const BitSize_t startReadOffset=readOffset;
+	BitSize_t currentBits;
+	if (ReadVarInt(currentBits)==false)
+		return false;
+
+	// Bytes past the end of the baseline are always sent, so a longer stream than this is corrupt.
+	// Count the bytes in 64 bits, as rounding up a corrupt length near the top of BitSize_t would wrap to 0
+	const uint64_t currentBytes64=((uint64_t) currentBits + 7) >> 3;
+	const unsigned int baselineBytes=(unsigned int) BITS_TO_BYTES(baseline->GetNumberOfBitsUsed());
+	if (currentBytes64 > (uint64_t) baselineBytes + BITS_TO_BYTES(GetNumberOfUnreadBits()))
+	{
+		readOffset=startReadOffset;
+		return false;
+	}
+	const unsigned int currentBytes=(unsigned int) currentBytes64;
+
+	current->Reset();
+	current->AddBitsAndReallocate(BYTES_TO_BITS(currentBytes));
+	if (currentBytes >= baselineBytes)
+	{
+		memcpy(current->data, baseline->GetData(), baselineBytes);
+		memset(current->data+baselineBytes, 0, currentBytes-baselineBytes);
+		// The delta was taken against the baseline with the unused bits of its last byte cleared
+		if (baseline->GetNumberOfBitsUsed() & 7)
+			current->data[baselineBytes-1]&=(unsigned char) (0xFF << (8 - (baseline->GetNumberOfBitsUsed() & 7)));
+	}
+	else
+		memcpy(current->data, baseline->GetData(), currentBytes);
+
+	unsigned char xorBytes[256];
+	unsigned int index=0;
+	while (index < currentBytes)
+	{
+		unsigned int unchanged, changed;
+		if (ReadVarInt(unchanged)==false || ReadVarInt(changed)==false ||
+			unchanged > currentBytes-index || changed > currentBytes-index-unchanged || (unchanged==0 && changed==0))
+		{
+			readOffset=startReadOffset;
+			current->Reset();
+			return false;
+		}
+		index+=unchanged;
+		while (changed > 0)
+		{
+			unsigned int chunk = changed < sizeof(xorBytes) ? changed : (unsigned int) sizeof(xorBytes);
+			if (ReadBits(xorBytes, BYTES_TO_BITS(chunk), false)==false)
+			{
+				readOffset=startReadOffset;
+				current->Reset();
+				return false;
+			}
+			unsigned int i=0;
+			for (; i+8 <= chunk; i+=8)
+			{
+				uint64_t currentWord, xorWord;
+				memcpy(&currentWord, current->data+index+i, sizeof(currentWord));
+				memcpy(&xorWord, xorBytes+i, sizeof(xorWord));
+				currentWord^=xorWord;
+				memcpy(current->data+index+i, &currentWord, sizeof(currentWord));
+			}
+			for (; i < chunk; i++)
+				current->data[index+i]^=xorBytes[i];
+			index+=chunk;
+			changed-=chunk;
+		}
+	}
+
+	current->numberOfBitsUsed=currentBits;
+	// The baseline may have had bits set past the end of the result, in what is now its last byte
+	if (currentBits & 7)
+		current->data[currentBytes-1]&=(unsigned char) (0xFF << (8 - (currentBits & 7)));
+	return true;
+}
+
 // Read an array or casted stream
 bool BitStream::Read( char* outByteArray, const unsigned int numberOfBytes )
 {
@@ -420,8 +629,173 @@ bool BitStream::ReadAlignedBytesSafeAlloc( char ** outByteArray, unsigned int &i
 	return ReadAlignedBytes((unsigned char*) *outByteArray, inputLength);
 }
 
+// Bytes are stored with the first bit in the high bit, so 8 bytes read as a big endian word are 64 bits of the stream in order
+static inline uint64_t LoadBigEndian64( const unsigned char *in )
+{
+	return ((uint64_t) in[0]<<56) | ((uint64_t) in[1]<<48) | ((uint64_t) in[2]<<40) | ((uint64_t) in[3]<<32) |
+		((uint64_t) in[4]<<24) | ((uint64_t) in[5]<<16) | ((uint64_t) in[6]<<8) | (uint64_t) in[7];
+}
+static inline void StoreBigEndian64( unsigned char *out, const uint64_t value )
+{
+	out[0]=(unsigned char) (value>>56); out[1]=(unsigned char) (value>>48); out[2]=(unsigned char) (value>>40); out[3]=(unsigned char) (value>>32);
+	out[4]=(unsigned char) (value>>24); out[5]=(unsigned char) (value>>16); out[6]=(unsigned char) (value>>8); out[7]=(unsigned char) value;
+}
+
+#if defined(BITSTREAM_SHIFT_SSE2)
+// ShiftBytesLeft() 32 or 16 bytes at a time. Returns how many bytes were done, leaving fewer than 16.
+// There is no 8 bit shift, so 16 bit lanes are shifted and what crossed into the neighboring byte is masked off
+static BitSize_t ShiftBytesLeftSIMD( unsigned char *out, const unsigned char *in, BitSize_t count, const int shift )
+{
+	BitSize_t i=0;
+#if defined(BITSTREAM_SHIFT_AVX2)
+	{
+		const __m128i shiftLeft = _mm_cvtsi32_si128(shift);
+		const __m128i shiftRight = _mm_cvtsi32_si128(8-shift);
+		const __m256i maskLeft = _mm256_set1_epi8((char) (0xFF<<shift));
+		const __m256i maskRight = _mm256_set1_epi8((char) (0xFF>>(8-shift)));
+		for (; i+32 <= count; i+=32)
+		{
+			__m256i a = _mm256_loadu_si256((const __m256i*) (in+i));
+			__m256i b = _mm256_loadu_si256((const __m256i*) (in+i+1));
+			a = _mm256_and_si256(_mm256_sll_epi16(a, shiftLeft), maskLeft);
+			b = _mm256_and_si256(_mm256_srl_epi16(b, shiftRight), maskRight);
+			_mm256_storeu_si256((__m256i*) (out+i), _mm256_or_si256(a, b));
+		}
+	}
+#endif
+	{
+		const __m128i shiftLeft = _mm_cvtsi32_si128(shift);
+		const __m128i shiftRight = _mm_cvtsi32_si128(8-shift);
+		const __m128i maskLeft = _mm_set1_epi8((char) (0xFF<<shift));
+		const __m128i maskRight = _mm_set1_epi8((char) (0xFF>>(8-shift)));
+		for (; i+16 <= count; i+=16)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*) (in+i));
+			__m128i b = _mm_loadu_si128((const __m128i*) (in+i+1));
+			a = _mm_and_si128(_mm_sll_epi16(a, shiftLeft), maskLeft);
+			b = _mm_and_si128(_mm_srl_epi16(b, shiftRight), maskRight);
+			_mm_storeu_si128((__m128i*) (out+i), _mm_or_si128(a, b));
+		}
+	}
+	return i;
+}
+#endif
+
+// out[i] = in[i] << shift | in[i+1] >> (8-shift), for i < count. Reads count+1 bytes of in. shift is 1 to 7.
+// Both reading and writing at an unaligned offset come down to this, so whole bytes move 32, 16 or 8 at a time and only the ends are done bit by bit
+static inline void ShiftBytesLeft( unsigned char *out, const unsigned char *in, BitSize_t count, const int shift )
+{
+	BitSize_t i=0;
+#if defined(BITSTREAM_SHIFT_SSE2)
+	if (count>=16)
+		i=ShiftBytesLeftSIMD(out, in, count, shift);
+#endif
+	for (; i+8 <= count; i+=8)
+		StoreBigEndian64(out+i, (LoadBigEndian64(in+i) << shift) | (in[i+8] >> (8-shift)));
+	for (; i < count; i++)
+		out[i] = (unsigned char) ((in[i] << shift) | (in[i+1] >> (8-shift)));
+}
+
+// WriteBits() of more than a word. Writes wholeBytes of in and then the partialBits on the left of lastByte, starting at bit outputBitOffset of out
+static void WriteLongField( unsigned char *out, const BitSize_t outputBitOffset, const unsigned char *in, const BitSize_t wholeBytes, const int partialBits, const unsigned char lastByte )
+{
+	if ( outputBitOffset == 0 )
+	{
+		memcpy( out, in, (size_t) wholeBytes );
+		if ( partialBits )
+			out[ wholeBytes ] = lastByte;
+		return;
+	}
+
+	// Keep the bits already written to the first byte. Each input byte is split over two output bytes
+	const int shift = (int) outputBitOffset;
+	out[ 0 ] = (unsigned char) ( ( out[ 0 ] & ( 0xFF << ( 8 - shift ) ) ) | ( in[ 0 ] >> shift ) );
+	ShiftBytesLeft( out + 1, in, wholeBytes - 1, 8 - shift );
+	out[ wholeBytes ] = (unsigned char) ( ( in[ wholeBytes - 1 ] << ( 8 - shift ) ) | ( lastByte >> shift ) );
+	if ( shift + partialBits > 8 )
+		out[ wholeBytes + 1 ] = (unsigned char) ( lastByte << ( 8 - shift ) );
+}
+
+// WriteBits() of more than 16 bits. Writes numberOfBitsToWrite bits of in, starting at bit outputBitOffset of out
+static void WriteField( unsigned char *out, const BitSize_t outputBitOffset, const unsigned char* in, const BitSize_t numberOfBitsToWrite, const bool rightAlignedBits )
+{
+	// If currently aligned and numberOfBits is a multiple of 8, just memcpy for speed
+	if (outputBitOffset==0 && (numberOfBitsToWrite&7)==0)
+	{
+		memcpy( out, in, numberOfBitsToWrite>>3);
+		return;
+	}
+
+	const BitSize_t wholeBytes = numberOfBitsToWrite >> 3;
+	const int partialBits = (int) (numberOfBitsToWrite & 7);
+
+	// The last byte of the input, with its bits on the left as in our internal representation, and what follows them cleared
+	unsigned char lastByte = 0;
+	if ( partialBits )
+	{
+		lastByte = in[ wholeBytes ];
+		if ( rightAlignedBits )   // rightAlignedBits means in the case of a partial byte, the bits are aligned from the right (bit 0) rather than the left (as in the normal internal representation)
+			lastByte <<= 8 - partialBits;
+		lastByte &= 0xFF << ( 8 - partialBits );
+	}
+
+	if ( numberOfBitsToWrite <= 56 )
+	{
+		// Most fields fit in a 64 bit word along with the bits already in the first byte, so put them together there and store them a byte at a time
+		uint64_t bits = (uint64_t) ( out[ 0 ] & ( 0xFF00 >> outputBitOffset ) ) << 56;
+		uint64_t field = 0;
+		BitSize_t i;
+		for ( i=0; i < wholeBytes; i++ )
+			field = ( field << 8 ) | in[ i ];
+		field = ( ( field << 8 ) | lastByte ) << ( 56 - 8 * wholeBytes );
+		bits |= field >> outputBitOffset;
+		const BitSize_t outputBytes = BITS_TO_BYTES( outputBitOffset + numberOfBitsToWrite );
+		for ( i=0; i < outputBytes; i++ )
+			out[ i ] = (unsigned char) ( bits >> ( 56 - 8 * i ) );
+	}
+	else
+		WriteLongField( out, outputBitOffset, in, wholeBytes, partialBits, lastByte );
+}
+
+// Writes a field of 16 bits or less at bit outputBitOffset of out. Setting up a word costs more than moving one or two bytes
+static inline void WriteShortField( unsigned char *out, const BitSize_t outputBitOffset, const unsigned char* in, BitSize_t numberOfBitsToWrite, const bool rightAlignedBits )
+{
+	for (;;)
+	{
+		unsigned char dataByte = *( in++ );
+		if ( numberOfBitsToWrite < 8 )
+		{
+			if ( rightAlignedBits )   // rightAlignedBits means in the case of a partial byte, the bits are aligned from the right (bit 0) rather than the left (as in the normal internal representation)
+				dataByte <<= 8 - numberOfBitsToWrite;
+			dataByte &= 0xFF << ( 8 - numberOfBitsToWrite );
+		}
+		out[ 0 ] = (unsigned char) ( ( out[ 0 ] & ( 0xFF00 >> outputBitOffset ) ) | ( dataByte >> outputBitOffset ) );
+		if ( outputBitOffset + numberOfBitsToWrite > 8 )
+			out[ 1 ] = (unsigned char) ( dataByte << ( 8 - outputBitOffset ) );
+		if ( numberOfBitsToWrite <= 8 )
+			return;
+		numberOfBitsToWrite -= 8;
+		out++;
+	}
+}
+
 // Write numberToWrite bits from the input source
 void BitStream::WriteBits( const unsigned char* inByteArray, BitSize_t numberOfBitsToWrite, const bool rightAlignedBits )
+{
+	// Small fields are the most common, so keep their path free of calls
+	if ( numberOfBitsToWrite > 16 || numberOfBitsUsed + numberOfBitsToWrite > numberOfBitsAllocated )
+	{
+		WriteBitsSlow( inByteArray, numberOfBitsToWrite, rightAlignedBits );
+		return;
+	}
+
+	const BitSize_t numberOfBitsUsedMod8 = numberOfBitsUsed & 7;
+	unsigned char *out = data + ( numberOfBitsUsed >> 3 );
+	numberOfBitsUsed += numberOfBitsToWrite;
+	WriteShortField( out, numberOfBitsUsedMod8, inByteArray, numberOfBitsToWrite, rightAlignedBits );
+}
+
+void BitStream::WriteBitsSlow( const unsigned char* inByteArray, BitSize_t numberOfBitsToWrite, const bool rightAlignedBits )
 {
 //	if (numberOfBitsToWrite<=0)
 //		return;
@@ -429,53 +803,51 @@ void BitStream::WriteBits( const unsigned char* inByteArray, BitSize_t numberOfB
 	AddBitsAndReallocate( numberOfBitsToWrite );
 
 	const BitSize_t numberOfBitsUsedMod8 = numberOfBitsUsed & 7;
+	unsigned char *out = data + ( numberOfBitsUsed >> 3 );
+	numberOfBitsUsed += numberOfBitsToWrite;
+
+	if ( numberOfBitsToWrite <= 16 )
+	{
+		WriteShortField( out, numberOfBitsUsedMod8, inByteArray, numberOfBitsToWrite, rightAlignedBits );
+		return;
+	}
 
 	// If currently aligned and numberOfBits is a multiple of 8, just memcpy for speed
 	if (numberOfBitsUsedMod8==0 && (numberOfBitsToWrite&7)==0)
 	{
-		memcpy( data + ( numberOfBitsUsed >> 3 ), inByteArray, numberOfBitsToWrite>>3);
-		numberOfBitsUsed+=numberOfBitsToWrite;
+		memcpy( out, inByteArray, numberOfBitsToWrite>>3);
 		return;
 	}
 
-	unsigned char dataByte;
-	const unsigned char* inputPtr=inByteArray;
+	const BitSize_t wholeBytes = numberOfBitsToWrite >> 3;
+	const int partialBits = (int) (numberOfBitsToWrite & 7);
 
-	// Faster to put the while at the top surprisingly enough
-	while ( numberOfBitsToWrite > 0 )
-		//do
+	// The last byte of the input, with its bits on the left as in our internal representation, and what follows them cleared
+	unsigned char lastByte = 0;
+	if ( partialBits )
 	{
-		dataByte = *( inputPtr++ );
-
-		if ( numberOfBitsToWrite < 8 && rightAlignedBits )   // rightAlignedBits means in the case of a partial byte, the bits are aligned from the right (bit 0) rather than the left (as in the normal internal representation)
-			dataByte <<= 8 - numberOfBitsToWrite;  // shift left to get the bits on the left, as in our internal representation
-
-		// Writing to a new byte each time
-		if ( numberOfBitsUsedMod8 == 0 )
-			* ( data + ( numberOfBitsUsed >> 3 ) ) = dataByte;
-		else
-		{
-			// Copy over the new data.
-			*( data + ( numberOfBitsUsed >> 3 ) ) |= dataByte >> ( numberOfBitsUsedMod8 ); // First half
-
-			if ( 8 - ( numberOfBitsUsedMod8 ) < 8 && 8 - ( numberOfBitsUsedMod8 ) < numberOfBitsToWrite )   // If we didn't write it all out in the first half (8 - (numberOfBitsUsed%8) is the number we wrote in the first half)
-			{
-				*( data + ( numberOfBitsUsed >> 3 ) + 1 ) = (unsigned char) ( dataByte << ( 8 - ( numberOfBitsUsedMod8 ) ) ); // Second half (overlaps byte boundary)
-			}
-		}
+		lastByte = inByteArray[ wholeBytes ];
+		if ( rightAlignedBits )
+			lastByte <<= 8 - partialBits;
+		lastByte &= 0xFF << ( 8 - partialBits );
+	}
 
-		if ( numberOfBitsToWrite >= 8 )
-		{
-			numberOfBitsUsed += 8;
-			numberOfBitsToWrite -= 8;
-		}
-		else
-		{
-			numberOfBitsUsed += numberOfBitsToWrite;
-			numberOfBitsToWrite=0;
-		}
+	if ( numberOfBitsToWrite <= 56 )
+	{
+		// Most fields fit in a 64 bit word along with the bits already in the first byte, so put them together there and store them a byte at a time
+		uint64_t bits = (uint64_t) ( out[ 0 ] & ( 0xFF00 >> numberOfBitsUsedMod8 ) ) << 56;
+		uint64_t field = 0;
+		BitSize_t i;
+		for ( i=0; i < wholeBytes; i++ )
+			field = ( field << 8 ) | inByteArray[ i ];
+		field = ( ( field << 8 ) | lastByte ) << ( 56 - 8 * wholeBytes );
+		bits |= field >> numberOfBitsUsedMod8;
+		const BitSize_t outputBytes = BITS_TO_BYTES( numberOfBitsUsedMod8 + numberOfBitsToWrite );
+		for ( i=0; i < outputBytes; i++ )
+			out[ i ] = (unsigned char) ( bits >> ( 56 - 8 * i ) );
 	}
-	// } while(numberOfBitsToWrite>0);
+	else
+		WriteLongField( out, numberOfBitsUsedMod8, inByteArray, wholeBytes, partialBits, lastByte );
 }
 
 // Set the stream to some initial data.  For internal use
@@ -572,44 +944,35 @@ bool BitStream::ReadBits( unsigned char *inOutByteArray, BitSize_t numberOfBitsT
 
 
 
-	BitSize_t offset = 0;
-
-	memset( inOutByteArray, 0, (size_t) BITS_TO_BYTES( numberOfBitsToRead ) );
+	const BitSize_t wholeBytes = numberOfBitsToRead >> 3;
+	const int partialBits = (int) (numberOfBitsToRead & 7);
+	const unsigned char *in = data + ( readOffset >> 3 );
+	unsigned char lastByte;
 
-	while ( numberOfBitsToRead > 0 )
+	if ( readOffsetMod8 == 0 )
 	{
-		*( inOutByteArray + offset ) |= *( data + ( readOffset >> 3 ) ) << ( readOffsetMod8 ); // First half
-
-		if ( readOffsetMod8 > 0 && numberOfBitsToRead > 8 - ( readOffsetMod8 ) )   // If we have a second half, we didn't read enough bytes in the first half
-			*( inOutByteArray + offset ) |= *( data + ( readOffset >> 3 ) + 1 ) >> ( 8 - ( readOffsetMod8 ) ); // Second half (overlaps byte boundary)
-
-		if (numberOfBitsToRead>=8)
-		{
-			numberOfBitsToRead -= 8;
-			readOffset += 8;
-			offset++;
-		}
-		else
-		{
-			int neg = (int) numberOfBitsToRead - 8;
-
-			if ( neg < 0 )   // Reading a partial byte for the last byte, shift right so the data is aligned on the right
-			{
-
-				if ( alignBitsToRight )
-					* ( inOutByteArray + offset ) >>= -neg;
-
-				readOffset += 8 + neg;
-			}
-			else
-				readOffset += 8;
-
-			offset++;
+		memcpy( inOutByteArray, in, (size_t) wholeBytes );
+		lastByte = in[ wholeBytes ];
+	}
+	else
+	{
+		// Each output byte is the end of one stream byte and the start of the next
+		const int shift = (int) readOffsetMod8;
+		ShiftBytesLeft( inOutByteArray, in, wholeBytes, shift );
+		lastByte = (unsigned char) ( in[ wholeBytes ] << shift );
+		if ( shift + partialBits > 8 )
+			lastByte |= in[ wholeBytes + 1 ] >> ( 8 - shift );
+	}
 
-			numberOfBitsToRead=0;
-		}		
+	if ( partialBits )
+	{
+		lastByte &= 0xFF << ( 8 - partialBits );
+		if ( alignBitsToRight )   // Reading a partial byte for the last byte, shift right so the data is aligned on the right
+			lastByte >>= 8 - partialBits;
+		inOutByteArray[ wholeBytes ] = lastByte;
 	}
 
+	readOffset += numberOfBitsToRead;
 	return true;
 }
 
@@ -689,6 +1052,160 @@ bool BitStream::ReadCompressed( unsigned char* inOutByteArray,
 	return true;
 }
 
+void BitStream::WriteVarIntInternal( uint64_t value )
+{
+	if ( ( numberOfBitsUsed & 7 ) == 0 )
+	{
+		// Aligned, so encode straight into the stream. Make room for the longest encoding, but only count what is used
+		if ( numberOfBitsUsed + 10 * 8 > numberOfBitsAllocated )
+			AddBitsAndReallocate( 10 * 8 );
+		unsigned char *out = data + ( numberOfBitsUsed >> 3 );
+		unsigned char *start = out;
+		while ( value >= 0x80 )
+		{
+			*out++ = (unsigned char) ( value | 0x80 );
+			value >>= 7;
+		}
+		*out++ = (unsigned char) value;
+		numberOfBitsUsed += (BitSize_t) BYTES_TO_BITS( out - start );
+		return;
+	}
+
+	unsigned char encoded[ 10 ];
+	int length = 0;
+	while ( value >= 0x80 )
+	{
+		encoded[ length++ ] = (unsigned char) ( value | 0x80 );
+		value >>= 7;
+	}
+	encoded[ length++ ] = (unsigned char) value;
+	WriteBits( encoded, BYTES_TO_BITS( length ), true );
+}
+
+bool BitStream::ReadVarIntInternal( uint64_t &value, const int valueBits )
+{
+	const unsigned char *in = data + ( readOffset >> 3 );
+	const int shift = (int) ( readOffset & 7 );
+	const BitSize_t bytesLeft = ( numberOfBitsUsed - readOffset ) >> 3;
+	const int maxBytes = ( valueBits + 6 ) / 7;
+	uint64_t result = 0;
+	int i;
+	for ( i=0; i < maxBytes; i++ )
+	{
+		if ( (BitSize_t) i >= bytesLeft )
+			return false;
+
+		// When not aligned each byte spans two in the stream. Both are in the stream, since there is a whole byte left after this offset
+		unsigned char byte = shift==0 ? in[ i ] : (unsigned char) ( ( in[ i ] << shift ) | ( in[ i + 1 ] >> ( 8 - shift ) ) );
+		result |= (uint64_t) ( byte & 0x7F ) << ( 7 * i );
+		if ( ( byte & 0x80 ) == 0 )
+		{
+			// Reject values too large for the type, including those with bits past the 64th in the tenth byte,
+			// and longer encodings than needed, where the last byte adds no bits. Each value has one encoding
+			if ( ( valueBits < 64 && ( result >> valueBits ) != 0 ) || ( i == 9 && byte > 1 ) || ( i > 0 && byte == 0 ) )
+				return false;
+			value = result;
+			readOffset += (BitSize_t) BYTES_TO_BITS( i + 1 );
+			return true;
+		}
+	}
+
+	// Longer than any value of this width can be
+	return false;
+}
+
+// Reverses the bytes of each of count elements of elementSize bytes. in and out can be the same
+static void SwapElementBytes(const unsigned char *in, unsigned char *out, unsigned int count, unsigned int elementSize)
+{
+	unsigned int i=0;
+	const unsigned int bytes=count*elementSize;
+	if (elementSize==2 || elementSize==4 || elementSize==8)
+	{
+#if defined(BITSTREAM_SHIFT_AVX2)
+		{
+			// Byte indices within each 128 bit lane
+			__m256i shuffle;
+			if (elementSize==2)
+				shuffle=_mm256_setr_epi8(1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14, 1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14);
+			else if (elementSize==4)
+				shuffle=_mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12, 3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+			else
+				shuffle=_mm256_setr_epi8(7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8, 7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8);
+			for (; i+32 <= bytes; i+=32)
+				_mm256_storeu_si256((__m256i*) (out+i), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*) (in+i)), shuffle));
+		}
+#endif
+#if defined(BITSTREAM_SHIFT_SSE2)
+		// SSE2 has no byte shuffle, so swap 16 bit words into place, then the bytes within each word
+		for (; i+16 <= bytes; i+=16)
+		{
+			__m128i v=_mm_loadu_si128((const __m128i*) (in+i));
+			if (elementSize==4)
+				v=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1)), _MM_SHUFFLE(2,3,0,1));
+			else if (elementSize==8)
+				v=_mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(0,1,2,3)), _MM_SHUFFLE(0,1,2,3));
+			v=_mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+			_mm_storeu_si128((__m128i*) (out+i), v);
+		}
+#endif
+	}
+	for (; i < bytes; i+=elementSize)
+	{
+		if (in==out)
+			BitStream::ReverseBytesInPlace(out+i, elementSize);
+		else
+			BitStream::ReverseBytes((unsigned char*) in+i, out+i, elementSize);
+	}
+}
+
+void BitStream::WriteArrayInternal( const unsigned char *inByteArray, const unsigned int count, const unsigned int elementSize )
+{
+	if (count==0)
+		return;
+	// In 64 bits, since a count large enough to wrap the bit count in BitSize_t would write only part of the array
+	const uint64_t numberOfBits = (uint64_t) count*elementSize*8;
+	RakAssert(numberOfBits <= (uint64_t) (BitSize_t) -1 - numberOfBitsUsed);
+	if (numberOfBits > (uint64_t) (BitSize_t) -1 - numberOfBitsUsed)
+		return;
+	if (elementSize==1 || DoEndianSwap()==false)
+	{
+		WriteBits(inByteArray, (BitSize_t) numberOfBits, true);
+		return;
+	}
+
+	// Swapped a block at a time into a buffer, since the input is const
+	unsigned char swapped[1024];
+	if (elementSize > sizeof(swapped))
+	{
+		for (unsigned int i=0; i < count; i++)
+		{
+			for (unsigned int j=elementSize; j > 0; j--)
+				WriteBits(inByteArray+(size_t)i*elementSize+j-1, 8, true);
+		}
+		return;
+	}
+	const unsigned int elementsPerBlock = (unsigned int) sizeof(swapped) / elementSize;
+	for (unsigned int i=0; i < count; i+=elementsPerBlock)
+	{
+		unsigned int blockCount = count-i < elementsPerBlock ? count-i : elementsPerBlock;
+		SwapElementBytes(inByteArray+(size_t)i*elementSize, swapped, blockCount, elementSize);
+		WriteBits(swapped, BYTES_TO_BITS(blockCount*elementSize), true);
+	}
+}
+
+bool BitStream::ReadArrayInternal( unsigned char *outByteArray, const unsigned int count, const unsigned int elementSize )
+{
+	// In 64 bits, since a large count from the network would wrap the bit count in BitSize_t and pass the check
+	if ((uint64_t) GetNumberOfUnreadBits() < (uint64_t) count*elementSize*8)
+		return false;
+	if (count==0)
+		return true;
+	ReadBits(outByteArray, BYTES_TO_BITS(count*elementSize), true);
+	if (elementSize > 1 && DoEndianSwap())
+		SwapElementBytes(outByteArray, outByteArray, count, elementSize);
+	return true;
+}
+
 // Reallocates (if necessary) in preparation of writing numberOfBitsToWrite
 void BitStream::AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite )
 {
@@ -716,13 +1233,35 @@ void BitStream::AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite )
 		{
 			if (amountToAllocate > BITSTREAM_STACK_ALLOCATION_SIZE)
 			{
-				data = ( unsigned char* ) rakMalloc_Ex( (size_t) amountToAllocate, _FILE_AND_LINE_ );
+				data = 0;
+				if ( arena )
+					data = arena->Allocate( (unsigned int) amountToAllocate );
+				if ( data == 0 )
+				{
+					// No arena, or it is full
+					arena = 0;
+					data = ( unsigned char* ) rakMalloc_Ex( (size_t) amountToAllocate, _FILE_AND_LINE_ );
+				}
 				RakAssert(data);
 
 				// need to copy the stack data over to our new memory area too
 				memcpy ((void *)data, (void *)stackData, (size_t) BITS_TO_BYTES( numberOfBitsAllocated )); 
 			}
 		}
+		else if ( arena )
+		{
+			unsigned char *newData = arena->Reallocate( data, (unsigned int) BITS_TO_BYTES( numberOfBitsAllocated ), (unsigned int) amountToAllocate );
+			if ( newData == 0 )
+			{
+				// The arena is full, so move to the heap
+				newData = ( unsigned char* ) rakMalloc_Ex( (size_t) amountToAllocate, _FILE_AND_LINE_ );
+				RakAssert(newData);
+				memcpy( newData, data, (size_t) BITS_TO_BYTES( numberOfBitsAllocated ) );
+				arena->Release( data, (unsigned int) BITS_TO_BYTES( numberOfBitsAllocated ) );
+				arena = 0;
+			}
+			data = newData;
+		}
 		else
 		{
 			data = ( unsigned char* ) rakRealloc_Ex( data, (size_t) amountToAllocate, _FILE_AND_LINE_ );
@@ -1175,6 +1714,443 @@ void BitStream::WriteFloat16( float inOutFloat, float floatMin, float floatMax )
 	Write((unsigned short)percentile);
 }
 
+// Values are quantized and packed this many at a time, on the stack
+#define BITSTREAM_QUANTIZE_BATCH 256
+
+// out[i] = maxValue*(in[i]-floatMin)/(floatMax-floatMin)+rounding, clamped to 0 to maxValue and truncated.
+// With rounding 0 and maxValue 65535, this is exactly what WriteFloat16() computes, so both give the same bits
+static void QuantizeFloats( const float *in, unsigned int count, float floatMin, float floatMax, float maxValue, float rounding, uint32_t *out )
+{
+	const float range = floatMax-floatMin;
+	unsigned int i=0;
+#if defined(BITSTREAM_SHIFT_AVX2)
+	{
+		const __m256 vMin=_mm256_set1_ps(floatMin), vRange=_mm256_set1_ps(range), vMax=_mm256_set1_ps(maxValue), vRounding=_mm256_set1_ps(rounding), zero=_mm256_setzero_ps();
+		for (; i+8 <= count; i+=8)
+		{
+			__m256 v=_mm256_div_ps(_mm256_mul_ps(vMax, _mm256_sub_ps(_mm256_loadu_ps(in+i), vMin)), vRange);
+			v=_mm256_min_ps(_mm256_max_ps(_mm256_add_ps(v, vRounding), zero), vMax);
+			_mm256_storeu_si256((__m256i*) (out+i), _mm256_cvttps_epi32(v));
+		}
+	}
+#endif
+#if defined(BITSTREAM_SHIFT_SSE2)
+	{
+		const __m128 vMin=_mm_set1_ps(floatMin), vRange=_mm_set1_ps(range), vMax=_mm_set1_ps(maxValue), vRounding=_mm_set1_ps(rounding), zero=_mm_setzero_ps();
+		for (; i+4 <= count; i+=4)
+		{
+			__m128 v=_mm_div_ps(_mm_mul_ps(vMax, _mm_sub_ps(_mm_loadu_ps(in+i), vMin)), vRange);
+			// max before min, so NaN becomes 0
+			v=_mm_min_ps(_mm_max_ps(_mm_add_ps(v, vRounding), zero), vMax);
+			_mm_storeu_si128((__m128i*) (out+i), _mm_cvttps_epi32(v));
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float v=maxValue * (in[i]-floatMin) / range + rounding;
+		if (!(v>0.0f))
+			v=0.0f;
+		if (v>maxValue)
+			v=maxValue;
+		out[i]=(uint32_t) v;
+	}
+}
+
+// out[i] = floatMin + (in[i]/maxValue)*(floatMax-floatMin), clamped to floatMin to floatMax. With maxValue 65535, this is what ReadFloat16() computes
+static void DequantizeFloats( const uint32_t *in, unsigned int count, float floatMin, float floatMax, float maxValue, float *out )
+{
+	const float range = floatMax-floatMin;
+	unsigned int i=0;
+#if defined(BITSTREAM_SHIFT_AVX2)
+	{
+		const __m256 vMin=_mm256_set1_ps(floatMin), vMaxFloat=_mm256_set1_ps(floatMax), vRange=_mm256_set1_ps(range), vMax=_mm256_set1_ps(maxValue);
+		for (; i+8 <= count; i+=8)
+		{
+			__m256 v=_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (in+i)));
+			v=_mm256_add_ps(vMin, _mm256_mul_ps(_mm256_div_ps(v, vMax), vRange));
+			_mm256_storeu_ps(out+i, _mm256_min_ps(_mm256_max_ps(v, vMin), vMaxFloat));
+		}
+	}
+#endif
+#if defined(BITSTREAM_SHIFT_SSE2)
+	{
+		const __m128 vMin=_mm_set1_ps(floatMin), vMaxFloat=_mm_set1_ps(floatMax), vRange=_mm_set1_ps(range), vMax=_mm_set1_ps(maxValue);
+		for (; i+4 <= count; i+=4)
+		{
+			__m128 v=_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*) (in+i)));
+			v=_mm_add_ps(vMin, _mm_mul_ps(_mm_div_ps(v, vMax), vRange));
+			_mm_storeu_ps(out+i, _mm_min_ps(_mm_max_ps(v, vMin), vMaxFloat));
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float v=floatMin + ((float) in[i] / maxValue) * range;
+		if (v<floatMin)
+			v=floatMin;
+		else if (v>floatMax)
+			v=floatMax;
+		out[i]=v;
+	}
+}
+
+// Collects values of up to 24 bits, first bit first, and writes them with WriteBits() a buffer at a time
+struct BitStreamPacker
+{
+	BitStreamPacker(BitStream *_bitStream) {bitStream=_bitStream; byteCount=0; accumulator=0; accumulatorBits=0;}
+	inline void Put(uint32_t value, int bits)
+	{
+		accumulator=(accumulator << bits) | value;
+		accumulatorBits+=bits;
+		while (accumulatorBits>=8)
+		{
+			accumulatorBits-=8;
+			buffer[byteCount++]=(unsigned char) (accumulator >> accumulatorBits);
+		}
+		if (byteCount > sizeof(buffer)-4)
+		{
+			bitStream->WriteBits(buffer, BYTES_TO_BITS(byteCount), false);
+			byteCount=0;
+		}
+	}
+	void Flush(void)
+	{
+		if (byteCount)
+			bitStream->WriteBits(buffer, BYTES_TO_BITS(byteCount), false);
+		if (accumulatorBits)
+		{
+			unsigned char lastByte=(unsigned char) (accumulator << (8-accumulatorBits));
+			bitStream->WriteBits(&lastByte, accumulatorBits, false);
+		}
+		byteCount=0;
+		accumulatorBits=0;
+	}
+
+	BitStream *bitStream;
+	unsigned char buffer[1024];
+	unsigned int byteCount;
+	uint64_t accumulator;
+	int accumulatorBits;
+};
+
+// Reads what BitStreamPacker wrote, with ReadBits() a buffer at a time. The caller checks there are totalBits to read first
+struct BitStreamUnpacker
+{
+	BitStreamUnpacker(BitStream *_bitStream, BitSize_t totalBits) {bitStream=_bitStream; bitsLeft=totalBits; byteIndex=0; byteCount=0; accumulator=0; accumulatorBits=0;}
+	inline uint32_t Get(int bits)
+	{
+		while (accumulatorBits<bits)
+		{
+			if (byteIndex==byteCount)
+				Refill();
+			accumulator=(accumulator << 8) | buffer[byteIndex++];
+			accumulatorBits+=8;
+		}
+		accumulatorBits-=bits;
+		return (uint32_t) (accumulator >> accumulatorBits) & (((uint32_t) 1 << bits) - 1);
+	}
+	void Refill(void)
+	{
+		BitSize_t bits = bitsLeft < BYTES_TO_BITS(sizeof(buffer)) ? bitsLeft : BYTES_TO_BITS(sizeof(buffer));
+		// Left aligned, so a partial last byte is in its high bits, as it is in the stream
+		bitStream->ReadBits(buffer, bits, false);
+		bitsLeft-=bits;
+		byteCount=(unsigned int) BITS_TO_BYTES(bits);
+		byteIndex=0;
+	}
+
+	BitStream *bitStream;
+	BitSize_t bitsLeft;
+	unsigned char buffer[1024];
+	unsigned int byteIndex, byteCount;
+	uint64_t accumulator;
+	int accumulatorBits;
+};
+
+void BitStream::WriteFloat16Array( const float *values, unsigned int count, float floatMin, float floatMax )
+{
+	RakAssert(floatMax>floatMin);
+#ifdef __BITSTREAM_NATIVE_END
+	// Write() of an unsigned short is not big endian in this case, so there is nothing to gain over WriteFloat16()
+	if (IsBigEndian()==false)
+	{
+		for (unsigned int i=0; i < count; i++)
+			WriteFloat16(values[i], floatMin, floatMax);
+		return;
+	}
+#endif
+
+	uint32_t quantized[BITSTREAM_QUANTIZE_BATCH];
+	BitStreamPacker packer(this);
+	for (unsigned int batchStart=0; batchStart < count; batchStart+=BITSTREAM_QUANTIZE_BATCH)
+	{
+		unsigned int batchCount = count-batchStart < BITSTREAM_QUANTIZE_BATCH ? count-batchStart : BITSTREAM_QUANTIZE_BATCH;
+		QuantizeFloats(values+batchStart, batchCount, floatMin, floatMax, 65535.0f, 0.0f, quantized);
+		for (unsigned int i=0; i < batchCount; i++)
+			packer.Put(quantized[i], 16);
+	}
+	packer.Flush();
+}
+bool BitStream::ReadFloat16Array( float *values, unsigned int count, float floatMin, float floatMax )
+{
+	RakAssert(floatMax>floatMin);
+	if (GetNumberOfUnreadBits() < (BitSize_t) count * 16)
+		return false;
+#ifdef __BITSTREAM_NATIVE_END
+	if (IsBigEndian()==false)
+	{
+		for (unsigned int i=0; i < count; i++)
+			ReadFloat16(values[i], floatMin, floatMax);
+		return true;
+	}
+#endif
+
+	uint32_t quantized[BITSTREAM_QUANTIZE_BATCH];
+	BitStreamUnpacker unpacker(this, (BitSize_t) count * 16);
+	for (unsigned int batchStart=0; batchStart < count; batchStart+=BITSTREAM_QUANTIZE_BATCH)
+	{
+		unsigned int batchCount = count-batchStart < BITSTREAM_QUANTIZE_BATCH ? count-batchStart : BITSTREAM_QUANTIZE_BATCH;
+		for (unsigned int i=0; i < batchCount; i++)
+			quantized[i]=unpacker.Get(16);
+		DequantizeFloats(quantized, batchCount, floatMin, floatMax, 65535.0f, values+batchStart);
+	}
+	return true;
+}
+void BitStream::WriteNormVectorArray( const float *vectors, unsigned int count )
+{
+	WriteFloat16Array(vectors, count*3, -1.0f, 1.0f);
+}
+bool BitStream::ReadNormVectorArray( float *vectors, unsigned int count )
+{
+	return ReadFloat16Array(vectors, count*3, -1.0f, 1.0f);
+}
+void BitStream::WriteQuantizedVectorArray( const float *vectors, unsigned int count, float floatMin, float floatMax, int bitsPerComponent )
+{
+	RakAssert(floatMax>floatMin);
+	RakAssert(bitsPerComponent>=1 && bitsPerComponent<=24);
+	const float maxValue = (float) (((uint32_t) 1 << bitsPerComponent) - 1);
+	uint32_t quantized[BITSTREAM_QUANTIZE_BATCH];
+	BitStreamPacker packer(this);
+	const unsigned int componentCount = count*3;
+	for (unsigned int batchStart=0; batchStart < componentCount; batchStart+=BITSTREAM_QUANTIZE_BATCH)
+	{
+		unsigned int batchCount = componentCount-batchStart < BITSTREAM_QUANTIZE_BATCH ? componentCount-batchStart : BITSTREAM_QUANTIZE_BATCH;
+		QuantizeFloats(vectors+batchStart, batchCount, floatMin, floatMax, maxValue, 0.5f, quantized);
+		for (unsigned int i=0; i < batchCount; i++)
+			packer.Put(quantized[i], bitsPerComponent);
+	}
+	packer.Flush();
+}
+bool BitStream::ReadQuantizedVectorArray( float *vectors, unsigned int count, float floatMin, float floatMax, int bitsPerComponent )
+{
+	RakAssert(floatMax>floatMin);
+	RakAssert(bitsPerComponent>=1 && bitsPerComponent<=24);
+	const unsigned int componentCount = count*3;
+	if (GetNumberOfUnreadBits() < (BitSize_t) componentCount * bitsPerComponent)
+		return false;
+
+	const float maxValue = (float) (((uint32_t) 1 << bitsPerComponent) - 1);
+	uint32_t quantized[BITSTREAM_QUANTIZE_BATCH];
+	BitStreamUnpacker unpacker(this, (BitSize_t) componentCount * bitsPerComponent);
+	for (unsigned int batchStart=0; batchStart < componentCount; batchStart+=BITSTREAM_QUANTIZE_BATCH)
+	{
+		unsigned int batchCount = componentCount-batchStart < BITSTREAM_QUANTIZE_BATCH ? componentCount-batchStart : BITSTREAM_QUANTIZE_BATCH;
+		for (unsigned int i=0; i < batchCount; i++)
+			quantized[i]=unpacker.Get(bitsPerComponent);
+		DequantizeFloats(quantized, batchCount, floatMin, floatMax, maxValue, vectors+batchStart);
+	}
+	return true;
+}
+
+// Smallest three: the other three components of a unit quaternion are at most 1/sqrt(2) in magnitude
+#define SMALLEST_THREE_RANGE 0.707106781f
+
+// For each quaternion, which component is largest in magnitude, and the other three in order, negated if the largest is negative.
+// The three are quantized to 0 to maxValue across -SMALLEST_THREE_RANGE to SMALLEST_THREE_RANGE, rounding to the nearest step
+static void EncodeSmallestThree( const float *quaternions, unsigned int count, float maxValue, uint32_t *largestIndex, uint32_t *smallestThree )
+{
+	const float scale = maxValue / (2.0f * SMALLEST_THREE_RANGE);
+	unsigned int i=0;
+#if defined(BITSTREAM_SHIFT_SSE2)
+	{
+		const __m128 signBit=_mm_set1_ps(-0.0f), zero=_mm_setzero_ps(), vRange=_mm_set1_ps(SMALLEST_THREE_RANGE);
+		const __m128 vScale=_mm_set1_ps(scale), vMax=_mm_set1_ps(maxValue), half=_mm_set1_ps(0.5f);
+		for (; i+4 <= count; i+=4)
+		{
+			// Four quaternions to one register per component
+			__m128 w=_mm_loadu_ps(quaternions+i*4), x=_mm_loadu_ps(quaternions+i*4+4), y=_mm_loadu_ps(quaternions+i*4+8), z=_mm_loadu_ps(quaternions+i*4+12);
+			_MM_TRANSPOSE4_PS(w, x, y, z);
+
+			__m128 absW=_mm_andnot_ps(signBit, w), absX=_mm_andnot_ps(signBit, x), absY=_mm_andnot_ps(signBit, y), absZ=_mm_andnot_ps(signBit, z);
+			__m128 largest=_mm_max_ps(_mm_max_ps(absW, absX), _mm_max_ps(absY, absZ));
+			// On a tie, the first component is largest, as in the scalar loop
+			__m128 isW=_mm_cmpeq_ps(absW, largest);
+			__m128 isX=_mm_andnot_ps(isW, _mm_cmpeq_ps(absX, largest));
+			__m128 isWOrX=_mm_or_ps(isW, isX);
+			__m128 isY=_mm_andnot_ps(isWOrX, _mm_cmpeq_ps(absY, largest));
+			__m128 isZ=_mm_andnot_ps(_mm_or_ps(isWOrX, isY), _mm_castsi128_ps(_mm_set1_epi32(-1)));
+
+			__m128i index=_mm_or_si128(_mm_and_si128(_mm_castps_si128(isX), _mm_set1_epi32(1)),
+				_mm_or_si128(_mm_and_si128(_mm_castps_si128(isY), _mm_set1_epi32(2)), _mm_and_si128(_mm_castps_si128(isZ), _mm_set1_epi32(3))));
+			_mm_storeu_si128((__m128i*) (largestIndex+i), index);
+
+			// Sign of the largest component, to flip the others with
+			__m128 largestSigned=_mm_or_ps(_mm_or_ps(_mm_and_ps(isW, w), _mm_and_ps(isX, x)), _mm_or_ps(_mm_and_ps(isY, y), _mm_and_ps(isZ, z)));
+			__m128 flip=_mm_and_ps(_mm_cmplt_ps(largestSigned, zero), signBit);
+
+			// The three that are left, in order
+			__m128 a=_mm_or_ps(_mm_and_ps(isW, x), _mm_andnot_ps(isW, w));
+			__m128 b=_mm_or_ps(_mm_and_ps(isWOrX, y), _mm_andnot_ps(isWOrX, x));
+			__m128 c=_mm_or_ps(_mm_and_ps(isZ, y), _mm_andnot_ps(isZ, z));
+
+			__m128 q[3]={a, b, c};
+			for (int j=0; j < 3; j++)
+			{
+				__m128 v=_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_xor_ps(q[j], flip), vRange), vScale), half);
+				v=_mm_min_ps(_mm_max_ps(v, zero), vMax);
+				__m128i quantized=_mm_cvttps_epi32(v);
+				// Back to quaternion order
+				uint32_t lanes[4];
+				_mm_storeu_si128((__m128i*) lanes, quantized);
+				smallestThree[i*3+j]=lanes[0];
+				smallestThree[i*3+3+j]=lanes[1];
+				smallestThree[i*3+6+j]=lanes[2];
+				smallestThree[i*3+9+j]=lanes[3];
+			}
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		const float *q=quaternions+i*4;
+		int largest=0;
+		for (int j=1; j < 4; j++)
+		{
+			if (fabsf(q[j]) > fabsf(q[largest]))
+				largest=j;
+		}
+		largestIndex[i]=(uint32_t) largest;
+		const float flip = q[largest] < 0.0f ? -1.0f : 1.0f;
+		int k=0;
+		for (int j=0; j < 4; j++)
+		{
+			if (j==largest)
+				continue;
+			float v=(q[j]*flip + SMALLEST_THREE_RANGE) * scale + 0.5f;
+			if (!(v>0.0f))
+				v=0.0f;
+			if (v>maxValue)
+				v=maxValue;
+			smallestThree[i*3+k++]=(uint32_t) v;
+		}
+	}
+}
+
+// The reverse of EncodeSmallestThree, computing the largest component from the other three
+static void DecodeSmallestThree( const uint32_t *largestIndex, const uint32_t *smallestThree, unsigned int count, float maxValue, float *quaternions )
+{
+	const float step = (2.0f * SMALLEST_THREE_RANGE) / maxValue;
+	unsigned int i=0;
+#if defined(BITSTREAM_SHIFT_SSE2)
+	{
+		const __m128 vStep=_mm_set1_ps(step), vRange=_mm_set1_ps(SMALLEST_THREE_RANGE), one=_mm_set1_ps(1.0f), zero=_mm_setzero_ps();
+		for (; i+4 <= count; i+=4)
+		{
+			__m128 q[3];
+			for (int j=0; j < 3; j++)
+			{
+				__m128i quantized=_mm_setr_epi32((int) smallestThree[i*3+j], (int) smallestThree[i*3+3+j], (int) smallestThree[i*3+6+j], (int) smallestThree[i*3+9+j]);
+				q[j]=_mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(quantized), vStep), vRange);
+			}
+			__m128 sum=_mm_add_ps(_mm_add_ps(_mm_mul_ps(q[0], q[0]), _mm_mul_ps(q[1], q[1])), _mm_mul_ps(q[2], q[2]));
+			__m128 largest=_mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, sum), zero));
+
+			__m128i index=_mm_loadu_si128((const __m128i*) (largestIndex+i));
+			__m128 isW=_mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_setzero_si128()));
+			__m128 isX=_mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(1)));
+			__m128 isY=_mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(2)));
+			__m128 isZ=_mm_castsi128_ps(_mm_cmpeq_epi32(index, _mm_set1_epi32(3)));
+			__m128 isWOrX=_mm_or_ps(isW, isX);
+
+			// w is a unless it is largest, x is largest, a, or b, and so on
+			__m128 w=_mm_or_ps(_mm_and_ps(isW, largest), _mm_andnot_ps(isW, q[0]));
+			__m128 x=_mm_or_ps(_mm_and_ps(isX, largest), _mm_or_ps(_mm_and_ps(isW, q[0]), _mm_andnot_ps(isWOrX, q[1])));
+			__m128 y=_mm_or_ps(_mm_and_ps(isY, largest), _mm_or_ps(_mm_and_ps(isWOrX, q[1]), _mm_and_ps(isZ, q[2])));
+			__m128 z=_mm_or_ps(_mm_and_ps(isZ, largest), _mm_andnot_ps(isZ, q[2]));
+
+			_MM_TRANSPOSE4_PS(w, x, y, z);
+			_mm_storeu_ps(quaternions+i*4, w);
+			_mm_storeu_ps(quaternions+i*4+4, x);
+			_mm_storeu_ps(quaternions+i*4+8, y);
+			_mm_storeu_ps(quaternions+i*4+12, z);
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float *q=quaternions+i*4;
+		const uint32_t largest=largestIndex[i];
+		float sum=0.0f;
+		int k=0;
+		for (uint32_t j=0; j < 4; j++)
+		{
+			if (j==largest)
+				continue;
+			q[j]=(float) smallestThree[i*3+k++] * step - SMALLEST_THREE_RANGE;
+			sum+=q[j]*q[j];
+		}
+		q[largest]=sqrtf(1.0f-sum > 0.0f ? 1.0f-sum : 0.0f);
+	}
+}
+
+void BitStream::WriteSmallestThreeQuatArray( const float *quaternions, unsigned int count, int bitsPerComponent )
+{
+	RakAssert(bitsPerComponent>=2 && bitsPerComponent<=24);
+	const float maxValue = (float) (((uint32_t) 1 << bitsPerComponent) - 1);
+	uint32_t largestIndex[BITSTREAM_QUANTIZE_BATCH];
+	uint32_t smallestThree[BITSTREAM_QUANTIZE_BATCH*3];
+	BitStreamPacker packer(this);
+	for (unsigned int batchStart=0; batchStart < count; batchStart+=BITSTREAM_QUANTIZE_BATCH)
+	{
+		unsigned int batchCount = count-batchStart < BITSTREAM_QUANTIZE_BATCH ? count-batchStart : BITSTREAM_QUANTIZE_BATCH;
+		EncodeSmallestThree(quaternions+batchStart*4, batchCount, maxValue, largestIndex, smallestThree);
+		for (unsigned int i=0; i < batchCount; i++)
+		{
+			packer.Put(largestIndex[i], 2);
+			packer.Put(smallestThree[i*3], bitsPerComponent);
+			packer.Put(smallestThree[i*3+1], bitsPerComponent);
+			packer.Put(smallestThree[i*3+2], bitsPerComponent);
+		}
+	}
+	packer.Flush();
+}
+bool BitStream::ReadSmallestThreeQuatArray( float *quaternions, unsigned int count, int bitsPerComponent )
+{
+	RakAssert(bitsPerComponent>=2 && bitsPerComponent<=24);
+	const BitSize_t totalBits = (BitSize_t) count * (2 + 3 * bitsPerComponent);
+	if (GetNumberOfUnreadBits() < totalBits)
+		return false;
+
+	const float maxValue = (float) (((uint32_t) 1 << bitsPerComponent) - 1);
+	uint32_t largestIndex[BITSTREAM_QUANTIZE_BATCH];
+	uint32_t smallestThree[BITSTREAM_QUANTIZE_BATCH*3];
+	BitStreamUnpacker unpacker(this, totalBits);
+	for (unsigned int batchStart=0; batchStart < count; batchStart+=BITSTREAM_QUANTIZE_BATCH)
+	{
+		unsigned int batchCount = count-batchStart < BITSTREAM_QUANTIZE_BATCH ? count-batchStart : BITSTREAM_QUANTIZE_BATCH;
+		for (unsigned int i=0; i < batchCount; i++)
+		{
+			largestIndex[i]=unpacker.Get(2);
+			smallestThree[i*3]=unpacker.Get(bitsPerComponent);
+			smallestThree[i*3+1]=unpacker.Get(bitsPerComponent);
+			smallestThree[i*3+2]=unpacker.Get(bitsPerComponent);
+		}
+		DecodeSmallestThree(largestIndex, smallestThree, batchCount, maxValue, quaternions+batchStart*4);
+	}
+	return true;
+}
+
 #ifdef _MSC_VER
 #pragma warning( pop )
 #endif
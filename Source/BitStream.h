@@ -40,8 +40,17 @@
 #define _copysign copysign
 #endif
 
+// Host byte order, where the compiler says what it is. Otherwise IsNetworkOrder() finds out at run time
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__==__ORDER_BIG_ENDIAN__
+#define BITSTREAM_HOST_BIG_ENDIAN 1
+#elif (defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_M_ARM64)
+#define BITSTREAM_HOST_BIG_ENDIAN 0
+#endif
+
 namespace RakNet
 {
+	class BitStreamArena;
+
 	/// This class allows you to write and read native types as a string of bits.  BitStream is used extensively throughout RakNet and is designed to be used by users as well.
 	/// \sa BitStreamSample.txt
 	class RAK_DLL_EXPORT BitStream
@@ -60,6 +69,12 @@ namespace RakNet
 		/// \param[in] initialBytesToAllocate the number of bytes to pre-allocate.
 		BitStream( const unsigned int initialBytesToAllocate );
 
+		/// \brief Create the bitstream, growing into \a _arena rather than the heap once it no longer fits in BITSTREAM_STACK_ALLOCATION_SIZE.
+		/// \details Use this for streams written and sent every frame, so writing them does not call rakMalloc() or rakRealloc(). If \a _arena runs out of room, the stream moves to the heap.
+		/// The stream must be destroyed before BitStreamArena::Reset() is called.
+		/// \param[in] _arena The arena to allocate from. May be 0, to use the heap.
+		BitStream( BitStreamArena *_arena );
+
 		/// \brief Initialize the BitStream, immediately setting the data it contains to a predefined pointer.
 		/// \details Set \a _copyData to true if you want to make an internal copy of the data you are passing. Set it to false to just save a pointer to the data.
 		/// You shouldn't call Write functions with \a _copyData as false, as this will write to unallocated memory
@@ -132,6 +147,22 @@ namespace RakNet
 		template <class templateType>
 			bool SerializeCompressedDelta(bool writeToBitstream, templateType &inOutTemplateVar);
 
+		/// \brief Bidirectional serialize/deserialize an unsigned integer as a variable length integer.
+		/// \details See WriteVarInt()
+		/// \param[in] writeToBitstream true to write from your data to this bitstream.  False to read from this bitstream and write to your data
+		/// \param[in] inOutTemplateVar The value to write
+		/// \return true if \a writeToBitstream is true.  true if \a writeToBitstream is false and the read was successful.  false if \a writeToBitstream is false and the read was not successful.
+		template <class templateType>
+			bool SerializeVarInt(bool writeToBitstream, templateType &inOutTemplateVar);
+
+		/// \brief Bidirectional serialize/deserialize a signed integer as a zigzag encoded variable length integer.
+		/// \details See WriteVarIntSigned()
+		/// \param[in] writeToBitstream true to write from your data to this bitstream.  False to read from this bitstream and write to your data
+		/// \param[in] inOutTemplateVar The value to write
+		/// \return true if \a writeToBitstream is true.  true if \a writeToBitstream is false and the read was successful.  false if \a writeToBitstream is false and the read was not successful.
+		template <class templateType>
+			bool SerializeVarIntSigned(bool writeToBitstream, templateType &inOutTemplateVar);
+
 		/// \brief Bidirectional serialize/deserialize an array or casted stream or raw data.  This does NOT do endian swapping.
 		/// \param[in] writeToBitstream true to write from your data to this bitstream.  False to read from this bitstream and write to your data
 		/// \param[in] inOutByteArray a byte buffer
@@ -272,6 +303,31 @@ namespace RakNet
 		template <class templateType>
 			void WriteCompressedDelta(const templateType &currentValue);
 
+		/// \brief Write an integer of any width as a variable length integer (LEB128): 7 bits per byte, low bits first, with the high bit of each byte set if another follows.
+		/// \details Values under 128 take one byte, under 16384 two, and so on, up to 10 bytes for 64 bits. Byte order does not matter.
+		/// Negative values take the most bytes for their type, so use WriteVarIntSigned() for values that can be negative.
+		/// When the write offset is byte aligned, the bytes go straight into the stream.
+		/// \param[in] inTemplateVar The value to write
+		template <class templateType>
+			void WriteVarInt(const templateType &inTemplateVar);
+
+		/// \brief Write a signed integer of any width as a zigzag encoded variable length integer.
+		/// \details Zigzag encoding maps 0, -1, 1, -2, 2... to 0, 1, 2, 3, 4... so small values of either sign, such as deltas, take few bytes.
+		/// Values from -64 to 63 take one byte. Otherwise the same as WriteVarInt().
+		/// \param[in] inTemplateVar The value to write
+		template <class templateType>
+			void WriteVarIntSigned(const templateType &inTemplateVar);
+
+		/// \brief Write an array of integers, floats, or other plain old data, with the same bits as calling Write() on each element.
+		/// \details Elements are byte swapped a block at a time with SSE2 where the host is little endian and __BITSTREAM_NATIVE_END is not defined,
+		/// and written straight from \a inTemplateArray otherwise. A bool array is written a bit per element, as Write() does.
+		/// Do not use for types with their own Write(), such as SystemAddress or RakString, as this writes the bytes of each element.
+		/// An array too large for the stream to count its bits asserts, and is not written.
+		/// \param[in] inTemplateArray The elements to write
+		/// \param[in] count How many elements to write
+		template <class templateType>
+			void WriteArray(const templateType *inTemplateArray, const unsigned int count);
+
 		/// \brief Read any integral type from a bitstream.  
 		/// \details Define __BITSTREAM_NATIVE_END if you need endian swapping.
 		/// \param[in] outTemplateVar The value to read
@@ -311,6 +367,30 @@ namespace RakNet
 		template <class templateType>
 			bool ReadCompressedDelta(templateType &outTemplateVar);
 
+		/// \brief Read an integer written with WriteVarInt()
+		/// \details Fails without reading anything if the stream ends first, the value does not fit in \a outTemplateVar,
+		/// or the encoding is longer than WriteVarInt() would write, such as 0x80 0x00 for 0.
+		/// \param[in] outTemplateVar The value to read
+		/// \return true on success, false on failure.
+		template <class templateType>
+			bool ReadVarInt(templateType &outTemplateVar);
+
+		/// \brief Read an integer written with WriteVarIntSigned()
+		/// \details Fails without reading anything if the stream ends first, the value does not fit in \a outTemplateVar,
+		/// or the encoding is longer than WriteVarIntSigned() would write, such as 0x80 0x00 for 0.
+		/// \param[in] outTemplateVar The value to read
+		/// \return true on success, false on failure.
+		template <class templateType>
+			bool ReadVarIntSigned(templateType &outTemplateVar);
+
+		/// \brief Read an array written with WriteArray(), or with Write() on each element.
+		/// \details Fails without reading anything if the stream ends first.
+		/// \param[out] outTemplateArray Gets \a count elements
+		/// \param[in] count How many elements to read
+		/// \return true on success, false on failure.
+		template <class templateType>
+			bool ReadArray(templateType *outTemplateArray, const unsigned int count);
+
 		/// \brief Read one bitstream to another.
 		/// \param[in] numberOfBits bits to read
 		/// \param bitStream the bitstream to read into from
@@ -320,6 +400,13 @@ namespace RakNet
 		bool Read( BitStream &bitStream, BitSize_t numberOfBits );
 		bool Read( BitStream &bitStream );
 
+		/// \brief Read a delta written with WriteBitStreamDelta(), and apply it to \a baseline to get the stream it was written from.
+		/// \details \a current is reset and gets the same bits as the stream passed to WriteBitStreamDelta(). Its read offset is 0.
+		/// \param[in] baseline The same bits as the baseline passed to WriteBitStreamDelta(), such as the last snapshot the remote system acknowledged
+		/// \param[out] current Gets the result. Cannot be \a baseline or this stream.
+		/// \return true on success. false if the delta is cut off or corrupt, in which case the read offset is unchanged and \a current is empty.
+		bool ReadBitStreamDelta( const BitStream *baseline, BitStream *current );
+
 		/// \brief Write an array or casted stream or raw data.  This does NOT do endian swapping.
 		/// \param[in] inputByteArray a byte buffer
 		/// \param[in] numberOfBytes the size of \a input in bytes
@@ -332,6 +419,14 @@ namespace RakNet
 		void Write( BitStream *bitStream );
 		void Write( BitStream &bitStream, BitSize_t numberOfBits );
 		void Write( BitStream &bitStream );\
+
+		/// \brief Write the difference between two streams, such as a snapshot of an object and the last snapshot the remote system acknowledged.
+		/// \details Bytes that differ are XORed with the baseline and sent in runs, and the unchanged bytes between runs are sent only as a count.
+		/// Unchanged stretches are found 8 bytes at a time. An unchanged stream takes a few bytes whatever its size.
+		/// Lossless, so ReadBitStreamDelta() gets back exactly the bits of \a current. Only the bits used in each stream are compared, not the read offsets.
+		/// \param[in] current The stream to send
+		/// \param[in] baseline The stream the receiver already has. Can be shorter or longer than \a current, or empty.
+		void WriteBitStreamDelta( const BitStream *current, const BitStream *baseline );
 		
 		/// \brief Write a float into 2 bytes, spanning the range between \a floatMin and \a floatMax
 		/// \param[in] x The float to write
@@ -394,6 +489,37 @@ namespace RakNet
 			templateType m10, templateType m11, templateType m12,
 			templateType m20, templateType m21, templateType m22 );
 
+		/// \brief Write \a count floats, each as WriteFloat16() would, in one call.
+		/// \details Quantizes several values at a time with SSE2 or AVX2 where available, and gives the same bits as calling WriteFloat16() for each value.
+		/// \param[in] values The floats to write
+		/// \param[in] count How many floats to write
+		/// \param[in] floatMin Predetermined minimum value of the floats
+		/// \param[in] floatMax Predetermined maximum value of the floats
+		void WriteFloat16Array( const float *values, unsigned int count, float floatMin, float floatMax );
+
+		/// \brief Write \a count normalized 3D vectors, stored as x,y,z one after another, each as WriteNormVector() would, in one call.
+		/// \param[in] vectors 3 * \a count floats
+		/// \param[in] count How many vectors to write
+		void WriteNormVectorArray( const float *vectors, unsigned int count );
+
+		/// \brief Write \a count vectors, such as positions, stored as x,y,z one after another, each component in \a bitsPerComponent bits spanning \a floatMin to \a floatMax.
+		/// \details Rounds to the nearest step, so accurate to (floatMax-floatMin) / (2^bitsPerComponent-1) / 2. Components outside the range are clamped to it.
+		/// \param[in] vectors 3 * \a count floats
+		/// \param[in] count How many vectors to write
+		/// \param[in] floatMin Predetermined minimum value of every component
+		/// \param[in] floatMax Predetermined maximum value of every component
+		/// \param[in] bitsPerComponent 1 to 24
+		void WriteQuantizedVectorArray( const float *vectors, unsigned int count, float floatMin, float floatMax, int bitsPerComponent );
+
+		/// \brief Write \a count normalized quaternions, stored as w,x,y,z one after another, using smallest three encoding.
+		/// \details Each takes 2 bits for which component is largest, and \a bitsPerComponent bits for each of the other three, which are between -1/sqrt(2) and 1/sqrt(2).
+		/// The largest is computed from the others on read. A quaternion is written as its negative when that makes the largest component positive, which is the same rotation.
+		/// With 15 bits per component this is 47 bits, against 52 for WriteNormQuat(), and is within about 0.1 degrees of the rotation written.
+		/// \param[in] quaternions 4 * \a count floats
+		/// \param[in] count How many quaternions to write
+		/// \param[in] bitsPerComponent 2 to 24
+		void WriteSmallestThreeQuatArray( const float *quaternions, unsigned int count, int bitsPerComponent );
+
 		/// \brief Read an array or casted stream of byte.
 		/// \details The array is raw data. There is no automatic endian conversion with this function
 		/// \param[in] output The result byte array. It should be larger than @em numberOfBytes.
@@ -466,6 +592,36 @@ namespace RakNet
 			templateType &m10, templateType &m11, templateType &m12,
 			templateType &m20, templateType &m21, templateType &m22 );
 
+		/// \brief Read \a count floats written with WriteFloat16Array(), or with WriteFloat16() one at a time.
+		/// \param[out] values Where to put the floats
+		/// \param[in] count How many floats to read
+		/// \param[in] floatMin Predetermined minimum value of the floats
+		/// \param[in] floatMax Predetermined maximum value of the floats
+		/// \return true on success, false if there are not enough bits left, in which case nothing is read.
+		bool ReadFloat16Array( float *values, unsigned int count, float floatMin, float floatMax );
+
+		/// \brief Read \a count normalized 3D vectors written with WriteNormVectorArray(), or with WriteNormVector() one at a time.
+		/// \param[out] vectors Where to put 3 * \a count floats
+		/// \param[in] count How many vectors to read
+		/// \return true on success, false if there are not enough bits left, in which case nothing is read.
+		bool ReadNormVectorArray( float *vectors, unsigned int count );
+
+		/// \brief Read \a count vectors written with WriteQuantizedVectorArray().
+		/// \param[out] vectors Where to put 3 * \a count floats
+		/// \param[in] count How many vectors to read
+		/// \param[in] floatMin Same as passed to WriteQuantizedVectorArray()
+		/// \param[in] floatMax Same as passed to WriteQuantizedVectorArray()
+		/// \param[in] bitsPerComponent Same as passed to WriteQuantizedVectorArray()
+		/// \return true on success, false if there are not enough bits left, in which case nothing is read.
+		bool ReadQuantizedVectorArray( float *vectors, unsigned int count, float floatMin, float floatMax, int bitsPerComponent );
+
+		/// \brief Read \a count quaternions written with WriteSmallestThreeQuatArray().
+		/// \param[out] quaternions Where to put 4 * \a count floats, as w,x,y,z
+		/// \param[in] count How many quaternions to read
+		/// \param[in] bitsPerComponent Same as passed to WriteSmallestThreeQuatArray()
+		/// \return true on success, false if there are not enough bits left, in which case nothing is read.
+		bool ReadSmallestThreeQuatArray( float *quaternions, unsigned int count, int bitsPerComponent );
+
 		/// \brief Sets the read pointer back to the beginning of your data.
 		void ResetReadPointer( void );
 
@@ -621,6 +777,11 @@ namespace RakNet
 		/// reallocation.
 		void SetNumberOfBitsAllocated( const BitSize_t lengthInBits );
 
+		/// \brief Same as passing \a _arena to the constructor, for streams in arrays or members, which can only be default constructed.
+		/// \details Only takes effect while the stream still fits in BITSTREAM_STACK_ALLOCATION_SIZE.
+		/// \param[in] _arena The arena to allocate from. May be 0, to use the heap.
+		void SetArena( BitStreamArena *_arena );
+
 		/// \brief Reallocates (if necessary) in preparation of writing numberOfBitsToWrite
 		void AddBitsAndReallocate( const BitSize_t numberOfBitsToWrite );
 
@@ -646,6 +807,15 @@ namespace RakNet
 		static int NumberOfLeadingZeroes( int32_t x );
 		static int NumberOfLeadingZeroes( int64_t x );
 
+		/// \internal Writes the variable length integer for WriteVarInt() and WriteVarIntSigned()
+		void WriteVarIntInternal(uint64_t value);
+		/// \internal Reads a variable length integer of up to \a valueBits bits for ReadVarInt() and ReadVarIntSigned()
+		bool ReadVarIntInternal(uint64_t &value, const int valueBits);
+		/// \internal Writes \a count elements of \a elementSize bytes each for WriteArray(), byte swapping each if DoEndianSwap()
+		void WriteArrayInternal(const unsigned char *inByteArray, const unsigned int count, const unsigned int elementSize);
+		/// \internal Reads \a count elements of \a elementSize bytes each for ReadArray(), byte swapping each if DoEndianSwap()
+		bool ReadArrayInternal(unsigned char *outByteArray, const unsigned int count, const unsigned int elementSize);
+
 		/// \internal Unrolled inner loop, for when performance is critical
 		void WriteAlignedVar8(const char *inByteArray);
 		/// \internal Unrolled inner loop, for when performance is critical
@@ -892,7 +1062,12 @@ namespace RakNet
 		{
 			return IsNetworkOrder();
 		}
+#ifdef BITSTREAM_HOST_BIG_ENDIAN
+		// Known at compile time, so the checks in Write() and Read() compile away
+		inline static bool IsNetworkOrder(void) {return BITSTREAM_HOST_BIG_ENDIAN!=0;}
+#else
 		inline static bool IsNetworkOrder(void) {bool r = IsNetworkOrderInternal(); return r;}
+#endif
 		// Not inline, won't compile on PC due to winsock include errors
 		static bool IsNetworkOrderInternal(void);
 		static void ReverseBytes(unsigned char *inByteArray, unsigned char *inOutByteArray, const unsigned int length);
@@ -900,6 +1075,9 @@ namespace RakNet
 
 	private:
 
+		/// Points BitStreams at part of its buffer, and returns pointers into it
+		friend class BitStreamView;
+
 		BitStream( const BitStream &invalid) {
 			(void) invalid;
 			RakAssert(0);
@@ -918,6 +1096,9 @@ namespace RakNet
 		/// \brief Assume the input source points to a compressed native type. Decompress and read it.
 		bool ReadCompressed( unsigned char* inOutByteArray,	const unsigned int size, const bool unsignedData );
 
+		/// \brief WriteBits() for fields longer than 16 bits, or that need the buffer to grow first
+		void WriteBitsSlow( const unsigned char* inByteArray, BitSize_t numberOfBitsToWrite, const bool rightAlignedBits );
+
 
 		BitSize_t numberOfBitsUsed;
 
@@ -930,6 +1111,9 @@ namespace RakNet
 		/// true if the internal buffer is copy of the data passed to the constructor
 		bool copyData;
 
+		/// While not 0, data beyond stackData is allocated from this arena rather than the heap
+		BitStreamArena *arena;
+
 		/// BitStreams that use less than BITSTREAM_STACK_ALLOCATION_SIZE use the stack, rather than the heap to store data.  It switches over if BITSTREAM_STACK_ALLOCATION_SIZE is exceeded
 		unsigned char stackData[BITSTREAM_STACK_ALLOCATION_SIZE];
 	};
@@ -994,6 +1178,26 @@ namespace RakNet
 			return true;
 		}
 
+		template <class templateType>
+		inline bool BitStream::SerializeVarInt(bool writeToBitstream, templateType &inOutTemplateVar)
+		{
+			if (writeToBitstream)
+				WriteVarInt(inOutTemplateVar);
+			else
+				return ReadVarInt(inOutTemplateVar);
+			return true;
+		}
+
+		template <class templateType>
+		inline bool BitStream::SerializeVarIntSigned(bool writeToBitstream, templateType &inOutTemplateVar)
+		{
+			if (writeToBitstream)
+				WriteVarIntSigned(inOutTemplateVar);
+			else
+				return ReadVarIntSigned(inOutTemplateVar);
+			return true;
+		}
+
 		inline bool BitStream::Serialize(bool writeToBitstream, char* inOutByteArray, const unsigned int numberOfBytes )
 		{
 			if (writeToBitstream)
@@ -1437,6 +1641,23 @@ namespace RakNet
 		Write(currentValue);
 	}
 
+	template <class templateType>
+		inline void BitStream::WriteVarInt(const templateType &inTemplateVar)
+	{
+		// Only the bits of the type, so a negative value is not sign extended to 64 bits
+		uint64_t value = (uint64_t) inTemplateVar;
+		if (sizeof(templateType) < sizeof(uint64_t))
+			value &= ((uint64_t) 1 << (BYTES_TO_BITS(sizeof(templateType)) & 63)) - 1;
+		WriteVarIntInternal(value);
+	}
+
+	template <class templateType>
+		inline void BitStream::WriteVarIntSigned(const templateType &inTemplateVar)
+	{
+		int64_t value = (int64_t) inTemplateVar;
+		WriteVarIntInternal(((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+	}
+
 	/// \brief Read any integral type from a bitstream.  Define __BITSTREAM_NATIVE_END if you need endian swapping.
 	/// \param[in] outTemplateVar The value to read
 	template <class templateType>
@@ -1742,6 +1963,55 @@ namespace RakNet
 		return Read(outTemplateVar);
 	}
 
+	template <class templateType>
+		inline bool BitStream::ReadVarInt(templateType &outTemplateVar)
+	{
+		uint64_t value;
+		if (ReadVarIntInternal(value, BYTES_TO_BITS(sizeof(templateType)))==false)
+			return false;
+		outTemplateVar = (templateType) value;
+		return true;
+	}
+
+	template <class templateType>
+		inline bool BitStream::ReadVarIntSigned(templateType &outTemplateVar)
+	{
+		uint64_t value;
+		if (ReadVarIntInternal(value, BYTES_TO_BITS(sizeof(templateType)))==false)
+			return false;
+		outTemplateVar = (templateType) ((int64_t) (value >> 1) ^ -(int64_t) (value & 1));
+		return true;
+	}
+
+	template <class templateType>
+		inline void BitStream::WriteArray(const templateType *inTemplateArray, const unsigned int count)
+	{
+		WriteArrayInternal((const unsigned char*) inTemplateArray, count, sizeof(templateType));
+	}
+
+	template <>
+		inline void BitStream::WriteArray(const bool *inTemplateArray, const unsigned int count)
+	{
+		for (unsigned int i=0; i < count; i++)
+			Write(inTemplateArray[i]);
+	}
+
+	template <class templateType>
+		inline bool BitStream::ReadArray(templateType *outTemplateArray, const unsigned int count)
+	{
+		return ReadArrayInternal((unsigned char*) outTemplateArray, count, sizeof(templateType));
+	}
+
+	template <>
+		inline bool BitStream::ReadArray(bool *outTemplateArray, const unsigned int count)
+	{
+		if (GetNumberOfUnreadBits() < count)
+			return false;
+		for (unsigned int i=0; i < count; i++)
+			Read(outTemplateArray[i]);
+		return true;
+	}
+
 	template <class destinationType, class sourceType >
 	void BitStream::WriteCasted( const sourceType &value )
 	{
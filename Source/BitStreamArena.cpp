@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamArena.h"
+#include "RakAssert.h"
+#include <string.h>
+
+using namespace RakNet;
+
+// Blocks start on 8 byte boundaries, for the word at a time reads and writes in BitStream
+static inline unsigned int RoundUpBlockSize( unsigned int numberOfBytes )
+{
+	return ( numberOfBytes + 7 ) & ~7u;
+}
+
+BitStreamArena::BitStreamArena( unsigned char *_slab, unsigned int _slabSize )
+{
+	slab=_slab;
+	slabSize=_slabSize;
+	ownsSlab=false;
+	bytesUsed=0;
+	highWaterMark=0;
+	overflowCount=0;
+}
+BitStreamArena::BitStreamArena( unsigned int _slabSize )
+{
+	slab=(unsigned char*) rakMalloc_Ex( _slabSize, _FILE_AND_LINE_ );
+	slabSize=slab ? _slabSize : 0;
+	ownsSlab=true;
+	bytesUsed=0;
+	highWaterMark=0;
+	overflowCount=0;
+}
+BitStreamArena::~BitStreamArena()
+{
+	if (ownsSlab)
+		rakFree_Ex( slab, _FILE_AND_LINE_ );
+}
+void BitStreamArena::Reset( void )
+{
+	bytesUsed=0;
+}
+unsigned char* BitStreamArena::Allocate( unsigned int numberOfBytes )
+{
+	numberOfBytes=RoundUpBlockSize(numberOfBytes);
+	if (numberOfBytes > slabSize - bytesUsed)
+	{
+		overflowCount++;
+		return 0;
+	}
+
+	unsigned char *block = slab + bytesUsed;
+	bytesUsed+=numberOfBytes;
+	if (bytesUsed > highWaterMark)
+		highWaterMark=bytesUsed;
+	return block;
+}
+unsigned char* BitStreamArena::Reallocate( unsigned char *block, unsigned int oldNumberOfBytes, unsigned int newNumberOfBytes )
+{
+	RakAssert(Contains(block));
+
+	if (IsLastBlock(block, oldNumberOfBytes))
+	{
+		unsigned int blockOffset = (unsigned int) (block - slab);
+		newNumberOfBytes=RoundUpBlockSize(newNumberOfBytes);
+		if (newNumberOfBytes > slabSize - blockOffset)
+		{
+			overflowCount++;
+			return 0;
+		}
+		bytesUsed=blockOffset+newNumberOfBytes;
+		if (bytesUsed > highWaterMark)
+			highWaterMark=bytesUsed;
+		return block;
+	}
+
+	unsigned char *newBlock = Allocate(newNumberOfBytes);
+	if (newBlock)
+		memcpy(newBlock, block, oldNumberOfBytes);
+	return newBlock;
+}
+void BitStreamArena::Release( unsigned char *block, unsigned int numberOfBytes )
+{
+	RakAssert(Contains(block));
+
+	if (IsLastBlock(block, numberOfBytes))
+		bytesUsed=(unsigned int) (block - slab);
+}
+bool BitStreamArena::IsLastBlock( const unsigned char *block, unsigned int numberOfBytes ) const
+{
+	return block + RoundUpBlockSize(numberOfBytes) == slab + bytesUsed;
+}
+bool BitStreamArena::Contains( const unsigned char *block ) const
+{
+	return block >= slab && block < slab + slabSize;
+}
+void BitStreamArena::ResetStatistics( void )
+{
+	highWaterMark=bytesUsed;
+	overflowCount=0;
+}
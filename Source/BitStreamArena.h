@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file BitStreamArena.h
+/// \brief Bump allocator that BitStream can grow into instead of the heap
+///
+
+#ifndef __BITSTREAM_ARENA_H
+#define __BITSTREAM_ARENA_H
+
+#include "Export.h"
+#include "RakMemoryOverride.h"
+
+namespace RakNet
+{
+
+/// \brief Bump allocator for the buffers of short lived BitStreams
+/// \details A BitStream constructed with an arena grows into it, rather than calling rakMalloc() and rakRealloc(), once it no longer fits in BITSTREAM_STACK_ALLOCATION_SIZE.
+/// Allocating moves a pointer forward through one slab, and the whole slab is given back at once by Reset(), typically once per frame.
+/// If the slab runs out, the BitStream that needed more moves to the heap as usual, and GetOverflowCount() goes up. Use GetHighWaterMark() to size the slab so this does not happen.
+/// \note Every BitStream using the arena must be destroyed before Reset() is called.
+/// \note Not threadsafe. Use one arena per thread.
+class RAK_DLL_EXPORT BitStreamArena
+{
+public:
+	/// \brief Allocate from a slab the caller owns, which is not freed by the arena
+	/// \param[in] _slab Memory to allocate from. Should stay valid for the life of the arena.
+	/// \param[in] _slabSize Size of \a _slab in bytes
+	BitStreamArena( unsigned char *_slab, unsigned int _slabSize );
+
+	/// \brief Allocate a slab of \a _slabSize bytes from the heap, once
+	/// \param[in] _slabSize Size of the slab in bytes
+	BitStreamArena( unsigned int _slabSize );
+
+	~BitStreamArena();
+
+	/// \brief Give back everything allocated since the last call, such as at the start of a frame
+	/// \details Keeps the statistics. See ResetStatistics()
+	void Reset( void );
+
+	/// \brief Allocate \a numberOfBytes from the slab
+	/// \return The block, or 0 if there is not enough room left
+	unsigned char* Allocate( unsigned int numberOfBytes );
+
+	/// \brief Grow a block returned by Allocate() or Reallocate()
+	/// \details The block at the end of what is allocated grows in place. Others are copied to a new block.
+	/// \return The block, or 0 if there is not enough room left, in which case \a block is unchanged
+	unsigned char* Reallocate( unsigned char *block, unsigned int oldNumberOfBytes, unsigned int newNumberOfBytes );
+
+	/// \brief Give back a block before Reset()
+	/// \details Only the block at the end of what is allocated can be given back, so blocks given back in the reverse order they were allocated are all reused, and others stay used until Reset().
+	void Release( unsigned char *block, unsigned int numberOfBytes );
+
+	/// \return True if \a block is in the slab
+	bool Contains( const unsigned char *block ) const;
+
+	/// \return Size of the slab in bytes
+	unsigned int GetCapacity( void ) const {return slabSize;}
+
+	/// \return Bytes allocated since the last call to Reset()
+	unsigned int GetBytesUsed( void ) const {return bytesUsed;}
+
+	/// \return The most bytes allocated at once since the arena was created, or since ResetStatistics()
+	unsigned int GetHighWaterMark( void ) const {return highWaterMark;}
+
+	/// \return How many times Allocate() or Reallocate() did not have enough room, since the arena was created, or since ResetStatistics()
+	unsigned int GetOverflowCount( void ) const {return overflowCount;}
+
+	/// \brief Set GetHighWaterMark() to GetBytesUsed(), and GetOverflowCount() to 0
+	void ResetStatistics( void );
+
+protected:
+	// True if \a block ends where the next allocation would start, so it can grow in place or be given back
+	bool IsLastBlock( const unsigned char *block, unsigned int numberOfBytes ) const;
+
+	unsigned char *slab;
+	unsigned int slabSize;
+	unsigned int bytesUsed;
+	unsigned int highWaterMark;
+	unsigned int overflowCount;
+	bool ownsSlab;
+};
+
+} // namespace RakNet
+
+#endif
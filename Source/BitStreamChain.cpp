@@ -0,0 +1,48 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamChain.h"
+#include "BitStream.h"
+
+using namespace RakNet;
+
+BitStreamChain::BitStreamChain()
+{
+	Reset();
+}
+bool BitStreamChain::AppendReference( const char *data, unsigned int lengthInBytes )
+{
+	if (segmentCount==BITSTREAM_CHAIN_MAX_SEGMENTS)
+		return false;
+	if (lengthInBytes==0)
+		return true;
+
+	segmentData[segmentCount]=data;
+	segmentLengths[segmentCount]=(int) lengthInBytes;
+	segmentCount++;
+	numberOfBytesUsed+=lengthInBytes;
+	return true;
+}
+bool BitStreamChain::AppendReference( const BitStream *bitStream )
+{
+	// BitStream zeroes the rest of a byte when it starts writing to it, so the padding is zeros
+	return AppendReference((const char*) bitStream->GetData(), bitStream->GetNumberOfBytesUsed());
+}
+void BitStreamChain::Reset( void )
+{
+	segmentCount=0;
+	numberOfBytesUsed=0;
+}
+void BitStreamChain::CopyTo( BitStream *bitStream ) const
+{
+	bitStream->AlignWriteToByteBoundary();
+	for (int i=0; i < segmentCount; i++)
+		bitStream->WriteAlignedBytes((const unsigned char*) segmentData[i], segmentLengths[i]);
+}
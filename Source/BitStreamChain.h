@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file BitStreamChain.h
+/// \brief A message made of references to existing buffers, sent without first copying them into one BitStream
+///
+
+#ifndef __BITSTREAM_CHAIN_H
+#define __BITSTREAM_CHAIN_H
+
+#include "Export.h"
+#include "RakMemoryOverride.h"
+
+namespace RakNet
+{
+class BitStream;
+
+/// Most segments one BitStreamChain can hold
+#define BITSTREAM_CHAIN_MAX_SEGMENTS 16
+
+/// \brief A message made of byte aligned segments, each a reference to memory owned by someone else
+/// \details Use this to send a header followed by a payload that is cached elsewhere, such as the last serialization of an object, without copying the payload into the header's BitStream first.
+/// Pass it to RakPeerInterface::SendChain(), which gathers the segments straight into its send buffer, so they are only copied that once.
+/// Segments are joined at byte boundaries. A BitStream that does not end on a byte boundary is sent padded to a whole byte, as if AlignWriteToByteBoundary() had been called.
+/// \note The chain only holds pointers. What it references must stay valid and unchanged until the chain is sent or copied.
+class RAK_DLL_EXPORT BitStreamChain
+{
+public:
+	BitStreamChain();
+
+	/// \brief Add \a lengthInBytes bytes at \a data to the end of the chain, without copying them
+	/// \return False if the chain already has BITSTREAM_CHAIN_MAX_SEGMENTS segments
+	bool AppendReference( const char *data, unsigned int lengthInBytes );
+
+	/// \brief Add what has been written to \a bitStream to the end of the chain, without copying it
+	/// \details Writing more to \a bitStream may move its data, so do not write to it again until the chain is sent.
+	/// \return False if the chain already has BITSTREAM_CHAIN_MAX_SEGMENTS segments
+	bool AppendReference( const BitStream *bitStream );
+
+	/// \brief Remove all segments
+	void Reset( void );
+
+	/// \return Number of segments added since construction or Reset()
+	int GetSegmentCount( void ) const {return segmentCount;}
+
+	/// \return Array of GetSegmentCount() pointers to the segments, in order
+	const char **GetSegmentData( void ) const {return (const char **) segmentData;}
+
+	/// \return Array of GetSegmentCount() segment lengths in bytes, in order
+	const int *GetSegmentLengths( void ) const {return segmentLengths;}
+
+	/// \return Total length of the segments in bytes
+	unsigned int GetNumberOfBytesUsed( void ) const {return numberOfBytesUsed;}
+
+	/// \brief Copy the segments, in order, to the end of \a bitStream
+	/// \details For passing the chain to code that only takes a BitStream.
+	void CopyTo( BitStream *bitStream ) const;
+
+protected:
+	const char *segmentData[BITSTREAM_CHAIN_MAX_SEGMENTS];
+	int segmentLengths[BITSTREAM_CHAIN_MAX_SEGMENTS];
+	int segmentCount;
+	unsigned int numberOfBytesUsed;
+};
+
+} // namespace RakNet
+
+#endif
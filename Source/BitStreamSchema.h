@@ -0,0 +1,291 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file BitStreamSchema.h
+/// \brief Serializes a class from a list of its members and how many bits each takes, worked out when compiling
+///
+
+#ifndef __BIT_STREAM_SCHEMA_H
+#define __BIT_STREAM_SCHEMA_H
+
+#include "BitStream.h"
+#include "NativeTypes.h"
+#include <string.h>
+
+namespace RakNet
+{
+
+/// \internal Number of bits needed to write every value from 0 to \a n
+template <uint32_t n>
+struct SchemaBitsToRepresent
+{
+	enum { BITS = 1 + SchemaBitsToRepresent<(n>>1)>::BITS };
+};
+template <>
+struct SchemaBitsToRepresent<0>
+{
+	enum { BITS = 0 };
+};
+
+/// \internal Fails to compile when \a condition is false
+template <bool condition> struct SchemaCompileTimeCheck;
+template <> struct SchemaCompileTimeCheck<true> {};
+
+/// \brief An integer member that is always between \a minimum and \a maximum, written with only the bits needed for that range
+/// \details Values outside the range are clamped to it, both when written and when read, so a corrupt or hostile stream cannot set one.
+/// \param[in] ClassType The class the member is in
+/// \param[in] MemberType An integer type of 32 bits or less
+/// \param[in] member Pointer to the member, such as &Player::health
+template <class ClassType, class MemberType, MemberType ClassType::*member, int32_t minimum, int32_t maximum>
+struct SchemaRange
+{
+	typedef ClassType Class;
+	// Unsigned, so a range wider than an int32_t does not overflow
+	enum { BITS = SchemaBitsToRepresent<(uint32_t) maximum - (uint32_t) minimum>::BITS };
+	SchemaCompileTimeCheck<(maximum>=minimum)> maximumLessThanMinimum;
+
+	static inline uint32_t Encode( const ClassType &object )
+	{
+		int32_t value = (int32_t) (object.*member);
+		if (value<minimum)
+			value=minimum;
+		else if (value>maximum)
+			value=maximum;
+		return (uint32_t) value - (uint32_t) minimum;
+	}
+	static inline void Decode( ClassType &object, uint32_t encoded )
+	{
+		// The bits can hold more than the range unless it is a power of 2
+		if (encoded > (uint32_t) maximum - (uint32_t) minimum)
+			encoded = (uint32_t) maximum - (uint32_t) minimum;
+		object.*member = (MemberType) (int32_t) (encoded + (uint32_t) minimum);
+	}
+};
+
+/// \brief All the bits of an integer member of 32 bits or less
+template <class ClassType, class MemberType, MemberType ClassType::*member>
+struct SchemaInteger
+{
+	typedef ClassType Class;
+	enum { BITS = sizeof(MemberType)*8 };
+	SchemaCompileTimeCheck<(sizeof(MemberType)<=4)> memberLargerThan32Bits;
+
+	static inline uint32_t Encode( const ClassType &object )
+	{
+		return (uint32_t) (object.*member) & (uint32_t) (0xFFFFFFFF >> (32-BITS));
+	}
+	static inline void Decode( ClassType &object, uint32_t encoded )
+	{
+		object.*member = (MemberType) encoded;
+	}
+};
+
+/// \brief A bool member, written as one bit
+template <class ClassType, bool ClassType::*member>
+struct SchemaBool
+{
+	typedef ClassType Class;
+	enum { BITS = 1 };
+
+	static inline uint32_t Encode( const ClassType &object )
+	{
+		return (object.*member) ? 1 : 0;
+	}
+	static inline void Decode( ClassType &object, uint32_t encoded )
+	{
+		object.*member = encoded!=0;
+	}
+};
+
+/// \brief A float member between \a minimum and \a maximum, written with \a bits bits of precision
+/// \details Like BitStream::WriteFloat16(), but with any number of bits from 1 to 24. Values outside the range are clamped to it.
+/// A float only has 24 bits of precision, so more bits would not be more exact, and the number of steps would no longer be exact either.
+template <class ClassType, float ClassType::*member, int32_t minimum, int32_t maximum, int bits>
+struct SchemaFloat
+{
+	typedef ClassType Class;
+	enum { BITS = bits };
+	SchemaCompileTimeCheck<(maximum>minimum && bits>=1 && bits<=24)> invalidRangeOrBits;
+
+	// In double, so a range wider than an int32_t does not overflow
+	static inline float Range( void )
+	{
+		return (float) ((double) maximum - (double) minimum);
+	}
+	static inline uint32_t Encode( const ClassType &object )
+	{
+		const float steps = (float) (0xFFFFFFFF >> (32-bits));
+		float percentile = steps * ((object.*member) - (float) minimum) / Range();
+		// Clamp before rounding, since steps+.5f rounds up past the last step. Also catches NaN
+		if ((percentile>0.0f)==false)
+			return 0;
+		if (percentile>=steps)
+			return 0xFFFFFFFF >> (32-bits);
+		return (uint32_t) (percentile+.5f);
+	}
+	static inline void Decode( ClassType &object, uint32_t encoded )
+	{
+		const float steps = (float) (0xFFFFFFFF >> (32-bits));
+		object.*member = (float) minimum + ((float) encoded / steps) * Range();
+	}
+};
+
+/// \internal Fills unused places in BitStreamSchema
+struct SchemaEnd
+{
+	enum { BITS = 0 };
+	template <class ClassType>
+	static inline uint32_t Encode( const ClassType & ) {return 0;}
+	template <class ClassType>
+	static inline void Decode( ClassType &, uint32_t ) {}
+};
+
+/// \brief Writes and reads a class as a fixed list of fields, given as SchemaRange, SchemaInteger, SchemaBool or SchemaFloat
+/// \details The size of each field, where it goes, and the total size are all known when compiling.
+/// Serialize() packs every field into a buffer on the stack with straight line code and writes the buffer with one call to BitStream::WriteBits().
+/// Deserialize() checks the size once, reads the buffer with one call to BitStream::ReadBits(), and unpacks the fields.
+/// This replaces a call to BitStream per member, each checking the allocation or remaining bits, for classes that are sent often.
+/// The format is not the same as writing the members one at a time, so always read with the same schema that wrote.
+///
+/// \code
+/// struct Player { float x, y; int health; unsigned char team; bool isCrouching; };
+/// typedef BitStreamSchema<
+///		SchemaFloat<Player, &Player::x, -4096, 4096, 20>,
+///		SchemaFloat<Player, &Player::y, -4096, 4096, 20>,
+///		SchemaRange<Player, int, &Player::health, 0, 100>,
+///		SchemaInteger<Player, unsigned char, &Player::team>,
+///		SchemaBool<Player, &Player::isCrouching> > PlayerSchema;
+/// PlayerSchema::Serialize(&bitStream, player); // PlayerSchema::BITS is 20+20+7+8+1
+/// \endcode
+template <class F1, class F2=SchemaEnd, class F3=SchemaEnd, class F4=SchemaEnd, class F5=SchemaEnd, class F6=SchemaEnd, class F7=SchemaEnd, class F8=SchemaEnd,
+	class F9=SchemaEnd, class F10=SchemaEnd, class F11=SchemaEnd, class F12=SchemaEnd, class F13=SchemaEnd, class F14=SchemaEnd, class F15=SchemaEnd, class F16=SchemaEnd>
+struct BitStreamSchema
+{
+	typedef typename F1::Class Class;
+
+	/// Where each field starts, in bits
+	enum
+	{
+		OFFSET1 = 0,
+		OFFSET2 = OFFSET1 + F1::BITS,
+		OFFSET3 = OFFSET2 + F2::BITS,
+		OFFSET4 = OFFSET3 + F3::BITS,
+		OFFSET5 = OFFSET4 + F4::BITS,
+		OFFSET6 = OFFSET5 + F5::BITS,
+		OFFSET7 = OFFSET6 + F6::BITS,
+		OFFSET8 = OFFSET7 + F7::BITS,
+		OFFSET9 = OFFSET8 + F8::BITS,
+		OFFSET10 = OFFSET9 + F9::BITS,
+		OFFSET11 = OFFSET10 + F10::BITS,
+		OFFSET12 = OFFSET11 + F11::BITS,
+		OFFSET13 = OFFSET12 + F12::BITS,
+		OFFSET14 = OFFSET13 + F13::BITS,
+		OFFSET15 = OFFSET14 + F14::BITS,
+		OFFSET16 = OFFSET15 + F15::BITS,
+		/// Bits written by Serialize()
+		BITS = OFFSET16 + F16::BITS,
+		/// Size of the buffer the fields are packed in. Each field is read and written as a 64 bit word, so allow for the last one to go past the end.
+		BUFFER_BYTES = (BITS+7)/8 + 8
+	};
+
+	/// Writes \a object to \a bitStream
+	static void Serialize( BitStream *bitStream, const Class &object )
+	{
+		unsigned char buffer[BUFFER_BYTES];
+		memset(buffer, 0, BUFFER_BYTES);
+		Pack<OFFSET1, F1::BITS>(buffer, F1::Encode(object));
+		Pack<OFFSET2, F2::BITS>(buffer, F2::Encode(object));
+		Pack<OFFSET3, F3::BITS>(buffer, F3::Encode(object));
+		Pack<OFFSET4, F4::BITS>(buffer, F4::Encode(object));
+		Pack<OFFSET5, F5::BITS>(buffer, F5::Encode(object));
+		Pack<OFFSET6, F6::BITS>(buffer, F6::Encode(object));
+		Pack<OFFSET7, F7::BITS>(buffer, F7::Encode(object));
+		Pack<OFFSET8, F8::BITS>(buffer, F8::Encode(object));
+		Pack<OFFSET9, F9::BITS>(buffer, F9::Encode(object));
+		Pack<OFFSET10, F10::BITS>(buffer, F10::Encode(object));
+		Pack<OFFSET11, F11::BITS>(buffer, F11::Encode(object));
+		Pack<OFFSET12, F12::BITS>(buffer, F12::Encode(object));
+		Pack<OFFSET13, F13::BITS>(buffer, F13::Encode(object));
+		Pack<OFFSET14, F14::BITS>(buffer, F14::Encode(object));
+		Pack<OFFSET15, F15::BITS>(buffer, F15::Encode(object));
+		Pack<OFFSET16, F16::BITS>(buffer, F16::Encode(object));
+		bitStream->WriteBits(buffer, BITS, false);
+	}
+
+	/// Reads \a object from \a bitStream
+	/// \return false if there were not enough bits left, in which case \a object and the read offset are unchanged
+	static bool Deserialize( BitStream *bitStream, Class &object )
+	{
+		unsigned char buffer[BUFFER_BYTES];
+		if (bitStream->ReadBits(buffer, BITS, false)==false)
+			return false;
+		F1::Decode(object, Unpack<OFFSET1, F1::BITS>(buffer));
+		F2::Decode(object, Unpack<OFFSET2, F2::BITS>(buffer));
+		F3::Decode(object, Unpack<OFFSET3, F3::BITS>(buffer));
+		F4::Decode(object, Unpack<OFFSET4, F4::BITS>(buffer));
+		F5::Decode(object, Unpack<OFFSET5, F5::BITS>(buffer));
+		F6::Decode(object, Unpack<OFFSET6, F6::BITS>(buffer));
+		F7::Decode(object, Unpack<OFFSET7, F7::BITS>(buffer));
+		F8::Decode(object, Unpack<OFFSET8, F8::BITS>(buffer));
+		F9::Decode(object, Unpack<OFFSET9, F9::BITS>(buffer));
+		F10::Decode(object, Unpack<OFFSET10, F10::BITS>(buffer));
+		F11::Decode(object, Unpack<OFFSET11, F11::BITS>(buffer));
+		F12::Decode(object, Unpack<OFFSET12, F12::BITS>(buffer));
+		F13::Decode(object, Unpack<OFFSET13, F13::BITS>(buffer));
+		F14::Decode(object, Unpack<OFFSET14, F14::BITS>(buffer));
+		F15::Decode(object, Unpack<OFFSET15, F15::BITS>(buffer));
+		F16::Decode(object, Unpack<OFFSET16, F16::BITS>(buffer));
+		return true;
+	}
+
+	/// Serialize() when \a writeToBitstream is true, otherwise Deserialize()
+	static bool SerializeOrDeserialize( bool writeToBitstream, BitStream *bitStream, Class &object )
+	{
+		if (writeToBitstream)
+		{
+			Serialize(bitStream, object);
+			return true;
+		}
+		return Deserialize(bitStream, object);
+	}
+
+protected:
+	// The stream puts the first bit in the high bit of each byte, so a field is ORed into the 64 bit big endian word at the byte it starts in
+	template <int offset, int bits>
+	static inline void Pack( unsigned char *buffer, uint32_t encoded )
+	{
+		if (bits==0)
+			return;
+		unsigned char *word = buffer + offset/8;
+		uint64_t value = LoadBigEndian(word) | ((uint64_t) encoded << (64 - (offset&7) - (bits ? bits : 1)));
+		StoreBigEndian(word, value);
+	}
+	template <int offset, int bits>
+	static inline uint32_t Unpack( const unsigned char *buffer )
+	{
+		if (bits==0)
+			return 0;
+		return (uint32_t) ((LoadBigEndian(buffer + offset/8) << (offset&7)) >> (64 - (bits ? bits : 1)));
+	}
+	static inline uint64_t LoadBigEndian( const unsigned char *in )
+	{
+		return ((uint64_t) in[0]<<56) | ((uint64_t) in[1]<<48) | ((uint64_t) in[2]<<40) | ((uint64_t) in[3]<<32) |
+			((uint64_t) in[4]<<24) | ((uint64_t) in[5]<<16) | ((uint64_t) in[6]<<8) | (uint64_t) in[7];
+	}
+	static inline void StoreBigEndian( unsigned char *out, const uint64_t value )
+	{
+		out[0]=(unsigned char) (value>>56); out[1]=(unsigned char) (value>>48); out[2]=(unsigned char) (value>>40); out[3]=(unsigned char) (value>>32);
+		out[4]=(unsigned char) (value>>24); out[5]=(unsigned char) (value>>16); out[6]=(unsigned char) (value>>8); out[7]=(unsigned char) value;
+	}
+};
+
+} // namespace RakNet
+
+#endif
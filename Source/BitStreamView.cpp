@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "BitStreamView.h"
+#include "BitStreamArena.h"
+#include "RakNetTypes.h"
+
+using namespace RakNet;
+
+BitStreamView::BitStreamView() : bitStream( 0, 0, false )
+{
+}
+
+BitStreamView::BitStreamView( const unsigned char *data, const unsigned int lengthInBytes ) : bitStream( (unsigned char*) data, lengthInBytes, false )
+{
+}
+
+BitStreamView::BitStreamView( const Packet *packet ) : bitStream( packet->data, packet->length, false )
+{
+}
+
+bool BitStreamView::ReadBytesView( const unsigned char **bytes, const unsigned int lengthInBytes )
+{
+	BitSize_t byteOffset = BITS_TO_BYTES( bitStream.readOffset );
+	if ( BYTES_TO_BITS( byteOffset ) > bitStream.numberOfBitsUsed ||
+		lengthInBytes > ( ( bitStream.numberOfBitsUsed - BYTES_TO_BITS( byteOffset ) ) >> 3 ) )
+		return false;
+
+	*bytes = bitStream.data + byteOffset;
+	bitStream.readOffset = BYTES_TO_BITS( byteOffset + lengthInBytes );
+	return true;
+}
+
+bool BitStreamView::ReadStringView( const char **string, unsigned short *length )
+{
+	BitSize_t startOffset = bitStream.readOffset;
+	unsigned short stringLength;
+	if ( bitStream.Read( stringLength ) == false )
+		return false;
+
+	const unsigned char *bytes;
+	if ( ReadBytesView( &bytes, stringLength ) == false )
+	{
+		bitStream.readOffset = startOffset;
+		return false;
+	}
+
+	*string = (const char*) bytes;
+	*length = stringLength;
+	return true;
+}
+
+bool BitStreamView::ReadView( BitStream *output, BitSize_t numberOfBits )
+{
+	BitSize_t byteOffset = BITS_TO_BYTES( bitStream.readOffset );
+	if ( BYTES_TO_BITS( byteOffset ) > bitStream.numberOfBitsUsed ||
+		numberOfBits > bitStream.numberOfBitsUsed - BYTES_TO_BITS( byteOffset ) )
+		return false;
+
+	// Free what output owns, as its destructor would, since it will not own anything after this
+	if ( output->copyData && output->numberOfBitsAllocated > ( BITSTREAM_STACK_ALLOCATION_SIZE << 3 ) )
+	{
+		if ( output->arena )
+			output->arena->Release( output->data, BITS_TO_BYTES( output->numberOfBitsAllocated ) );
+		else
+			rakFree_Ex( output->data, _FILE_AND_LINE_ );
+	}
+
+	output->data = bitStream.data + byteOffset;
+	output->copyData = false;
+	output->arena = 0;
+	output->numberOfBitsUsed = numberOfBits;
+	output->numberOfBitsAllocated = numberOfBits;
+	output->readOffset = 0;
+
+	bitStream.readOffset = BYTES_TO_BITS( byteOffset ) + numberOfBits;
+	return true;
+}
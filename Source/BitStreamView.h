@@ -0,0 +1,107 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file BitStreamView.h
+/// \brief Reads a packet or other buffer in place, returning strings and byte ranges as pointers into it rather than copies
+///
+
+#ifndef __BITSTREAM_VIEW_H
+#define __BITSTREAM_VIEW_H
+
+#include "Export.h"
+#include "BitStream.h"
+
+namespace RakNet
+{
+struct Packet;
+
+/// \brief Read only BitStream over memory owned by someone else, such as Packet::data
+/// \details Construct one from a Packet in a plugin's OnReceive() instead of BitStream(packet->data, packet->length, false).
+/// Reads are the same as BitStream's. In addition, ReadBytesView() and ReadStringView() return pointers into the buffer instead of copying to a buffer or RakString, and ReadView() gives a BitStream of part of the buffer without copying it.
+/// Nothing is allocated or copied, so a view is cheap to construct on the stack.
+/// \note Pointers from the view, and BitStreams pointed at the buffer by ReadView(), are only valid while the buffer is, which for a Packet is until it is deallocated.
+class RAK_DLL_EXPORT BitStreamView
+{
+public:
+	/// \brief An empty view, for ReadView() to point at part of another
+	BitStreamView();
+
+	/// \brief View \a lengthInBytes bytes at \a data
+	BitStreamView( const unsigned char *data, const unsigned int lengthInBytes );
+
+	/// \brief View the data of \a packet
+	BitStreamView( const Packet *packet );
+
+	/// \brief Read any type BitStream::Read() can
+	template <class templateType>
+		bool Read( templateType &outTemplateVar ) {return bitStream.Read(outTemplateVar);}
+
+	/// \brief Read any type BitStream::ReadCompressed() can
+	template <class templateType>
+		bool ReadCompressed( templateType &outTemplateVar ) {return bitStream.ReadCompressed(outTemplateVar);}
+
+	/// \brief Read one type and assign it to another, as BitStream::ReadCasted()
+	template <class destinationType, class sourceType>
+		bool ReadCasted( sourceType &value ) {return bitStream.ReadCasted<destinationType>(value);}
+
+	/// \brief Read an array, as BitStream::ReadArray()
+	template <class templateType>
+		bool ReadArray( templateType *outTemplateArray, const unsigned int count ) {return bitStream.ReadArray(outTemplateArray, count);}
+
+	/// \brief Copy the next \a numberOfBits into \a output, as BitStream::Read(BitStream&, BitSize_t)
+	bool Read( BitStream &output, BitSize_t numberOfBits ) {return bitStream.Read(output, numberOfBits);}
+
+	bool ReadBits( unsigned char *inOutByteArray, BitSize_t numberOfBitsToRead, const bool alignBitsToRight = true ) {return bitStream.ReadBits(inOutByteArray, numberOfBitsToRead, alignBitsToRight);}
+	bool ReadAlignedBytes( unsigned char *inOutByteArray, const unsigned int numberOfBytesToRead ) {return bitStream.ReadAlignedBytes(inOutByteArray, numberOfBytesToRead);}
+	void IgnoreBits( const BitSize_t numberOfBits ) {bitStream.IgnoreBits(numberOfBits);}
+	void IgnoreBytes( const unsigned int numberOfBytes ) {bitStream.IgnoreBytes(numberOfBytes);}
+	void AlignReadToByteBoundary( void ) {bitStream.AlignReadToByteBoundary();}
+	void ResetReadPointer( void ) {bitStream.ResetReadPointer();}
+	BitSize_t GetReadOffset( void ) const {return bitStream.GetReadOffset();}
+	void SetReadOffset( const BitSize_t newReadOffset ) {bitStream.SetReadOffset(newReadOffset);}
+	BitSize_t GetNumberOfUnreadBits( void ) const {return bitStream.GetNumberOfUnreadBits();}
+	BitSize_t GetNumberOfBitsUsed( void ) const {return bitStream.GetNumberOfBitsUsed();}
+	BitSize_t GetNumberOfBytesUsed( void ) const {return bitStream.GetNumberOfBytesUsed();}
+	const unsigned char* GetData( void ) const {return bitStream.GetData();}
+
+	/// \brief Read \a lengthInBytes bytes from the next byte boundary, as ReadAlignedBytes() does, returning where they are rather than copying them
+	/// \param[out] bytes Set to the first byte, in the viewed buffer
+	/// \param[in] lengthInBytes How many bytes to read
+	/// \return false, without moving the read offset, if there are not that many bytes left
+	bool ReadBytesView( const unsigned char **bytes, const unsigned int lengthInBytes );
+
+	/// \brief Read a string written by RakString::Serialize() or BitStream::Write(const RakString&), returning where it is rather than copying it
+	/// \param[out] string Set to the first character, in the viewed buffer. It is not null terminated.
+	/// \param[out] length Set to the number of characters
+	/// \return false, without moving the read offset, if the string is cut short
+	bool ReadStringView( const char **string, unsigned short *length );
+
+	/// \brief Point \a output at the next \a numberOfBits from the next byte boundary, rather than copying them as BitStream::Read(BitStream*, BitSize_t) does
+	/// \details \a output reads from its start, and ResetReadPointer() returns there. Any memory \a output had allocated is freed.
+	/// Use it to pass part of a packet to code that takes a BitStream, only to read. Writing to \a output is not supported, as with any BitStream constructed with _copyData false.
+	/// \param[out] output The stream to point at the bits
+	/// \param[in] numberOfBits How many bits it gets
+	/// \return false, without changing \a output or moving the read offset, if there are not that many bits left
+	bool ReadView( BitStream *output, BitSize_t numberOfBits );
+
+	/// \brief As ReadView(BitStream*, BitSize_t), for another view
+	bool ReadView( BitStreamView *output, BitSize_t numberOfBits ) {return ReadView(&output->bitStream, numberOfBits);}
+
+	/// \brief The BitStream that does the reading, for code that takes a BitStream to read from, such as Replica3::Deserialize() or an RPC4 slot
+	/// \details It reads from and moves the view's read offset. Do not write to it.
+	BitStream* GetBitStream( void ) {return &bitStream;}
+
+protected:
+	BitStream bitStream;
+};
+
+} // namespace RakNet
+
+#endif
@@ -12,6 +12,7 @@
 #include "DS_Queue.h"
 #include "BitStream.h"
 #include "RakAssert.h" 
+#include <string.h>
 
 #ifdef _MSC_VER
 #pragma warning( push )
@@ -21,7 +22,7 @@ using namespace RakNet;
 
 HuffmanEncodingTree::HuffmanEncodingTree()
 {
-	root = 0;
+	FreeMemory();
 }
 
 HuffmanEncodingTree::~HuffmanEncodingTree()
@@ -31,19 +32,24 @@ HuffmanEncodingTree::~HuffmanEncodingTree()
 
 void HuffmanEncodingTree::FreeMemory( void )
 {
-	if ( root == 0 )
-		return ;
-
-	// Use an in-order traversal to delete the tree
-	DataStructures::Queue<HuffmanEncodingTreeNode *> nodeQueue;
+	// The tables are members, so there is nothing to free. Just mark the tree empty
+	for ( int i = 0; i < 256; i++ )
+	{
+		encodingTable[ i ].code = 0;
+		encodingTable[ i ].bitLength = 0;
+	}
 
-	HuffmanEncodingTreeNode *node;
+	maxCodeLength = 0;
+}
 
+// Frees the nodes used to find the code lengths
+static void DeleteNodes( HuffmanEncodingTreeNode *root )
+{
+	DataStructures::Queue<HuffmanEncodingTreeNode *> nodeQueue;
 	nodeQueue.Push( root, _FILE_AND_LINE_  );
-
 	while ( nodeQueue.Size() > 0 )
 	{
-		node = nodeQueue.Pop();
+		HuffmanEncodingTreeNode *node = nodeQueue.Pop();
 
 		if ( node->left )
 			nodeQueue.Push( node->left, _FILE_AND_LINE_  );
@@ -53,23 +59,15 @@ void HuffmanEncodingTree::FreeMemory( void )
 
 		RakNet::OP_DELETE(node, _FILE_AND_LINE_);
 	}
-
-	// Delete the encoding table
-	for ( int i = 0; i < 256; i++ )
-		rakFree_Ex(encodingTable[ i ].encoding, _FILE_AND_LINE_ );
-
-	root = 0;
 }
 
-
-////#include <stdio.h>
-
 // Given a frequency table of 256 elements, all with a frequency of 1 or more, generate the tree
 void HuffmanEncodingTree::GenerateFromFrequencyTable( unsigned int frequencyTable[ 256 ] )
 {
 	int counter;
 	HuffmanEncodingTreeNode * node;
-	HuffmanEncodingTreeNode *leafList[ 256 ]; // Keep a copy of the pointers to all the leaves so we can generate the encryption table bottom-up, which is easier
+	HuffmanEncodingTreeNode *root;
+	HuffmanEncodingTreeNode *leafList[ 256 ]; // Keep a copy of the pointers to all the leaves so we can find the length of each code bottom-up, which is easier
 	// 1.  Make 256 trees each with a weight equal to the frequency of the corresponding character
 	DataStructures::LinkedList<HuffmanEncodingTreeNode *> huffmanEncodingTreeNodeList;
 
@@ -86,7 +84,7 @@ void HuffmanEncodingTree::GenerateFromFrequencyTable( unsigned int frequencyTabl
 		if ( node->weight == 0 )
 			node->weight = 1; // 0 weights are illegal
 
-		leafList[ counter ] = node; // Used later to generate the encryption table
+		leafList[ counter ] = node; // Used later to find the code lengths
 
 		InsertNodeIntoSortedList( node, &huffmanEncodingTreeNodeList ); // Insert and maintain sort order.
 	}
@@ -107,8 +105,8 @@ void HuffmanEncodingTree::GenerateFromFrequencyTable( unsigned int frequencyTabl
 		node->left = lesser;
 		node->right = greater;
 		node->weight = lesser->weight + greater->weight;
-		lesser->parent = node;  // This is done to make generating the encryption table easier
-		greater->parent = node;  // This is done to make generating the encryption table easier
+		lesser->parent = node;  // This is done to make finding the code lengths easier
+		greater->parent = node;  // This is done to make finding the code lengths easier
 
 		if ( huffmanEncodingTreeNodeList.Size() == 0 )
 		{
@@ -122,141 +120,318 @@ void HuffmanEncodingTree::GenerateFromFrequencyTable( unsigned int frequencyTabl
 		InsertNodeIntoSortedList( node, &huffmanEncodingTreeNodeList );
 	}
 
-	bool tempPath[ 256 ]; // Maximum path length is 256
-	unsigned short tempPathLength;
-	HuffmanEncodingTreeNode *currentNode;
-	RakNet::BitStream bitStream;
-
-	// Generate the encryption table. From before, we have an array of pointers to all the leaves which contain pointers to their parents.
-	// This can be done more efficiently but this isn't bad and it's way easier to program and debug
-
+	// 4. The length of each code is the depth of its leaf. Only the lengths are kept, as the codes themselves are assigned in canonical order
+	int lengthCount[ 256 ];
+	memset( lengthCount, 0, sizeof( lengthCount ) );
+	int longest = 0;
 	for ( counter = 0; counter < 256; counter++ )
 	{
-		// Already done at the end of the loop and before it!
-		tempPathLength = 0;
+		int depth = 0;
+		for ( HuffmanEncodingTreeNode *currentNode = leafList[ counter ]; currentNode != root; currentNode = currentNode->parent )
+			depth++;
+		encodingTable[ counter ].bitLength = (unsigned char) depth;
+		lengthCount[ depth ]++;
+		if ( depth > longest )
+			longest = depth;
+	}
 
-		// Set the current node at the leaf
-		currentNode = leafList[ counter ];
+	DeleteNodes( root );
 
-		do
+	// 5. If any code is too long, make them all HUFFMAN_MAX_CODE_LENGTH, then lengthen shorter codes until the code is complete again.
+	// Then give the longest codes to the least frequent values
+	if ( longest > HUFFMAN_MAX_CODE_LENGTH )
+	{
+		int length;
+		for ( length = HUFFMAN_MAX_CODE_LENGTH + 1; length <= longest; length++ )
 		{
-			if ( currentNode->parent->left == currentNode )   // We're storing the paths in reverse order.since we are going from the leaf to the root
-				tempPath[ tempPathLength++ ] = false;
-			else
-				tempPath[ tempPathLength++ ] = true;
+			lengthCount[ HUFFMAN_MAX_CODE_LENGTH ] += lengthCount[ length ];
+			lengthCount[ length ] = 0;
+		}
 
-			currentNode = currentNode->parent;
+		// Kraft sum, in units of the longest code
+		uint32_t total = 0;
+		for ( length = 1; length <= HUFFMAN_MAX_CODE_LENGTH; length++ )
+			total += (uint32_t) lengthCount[ length ] << ( HUFFMAN_MAX_CODE_LENGTH - length );
+		while ( total > ( (uint32_t) 1 << HUFFMAN_MAX_CODE_LENGTH ) )
+		{
+			// Take one code of the longest length, and split a shorter code into two codes one bit longer
+			lengthCount[ HUFFMAN_MAX_CODE_LENGTH ]--;
+			for ( length = HUFFMAN_MAX_CODE_LENGTH - 1; length > 0; length-- )
+			{
+				if ( lengthCount[ length ] )
+				{
+					lengthCount[ length ]--;
+					lengthCount[ length + 1 ] += 2;
+					break;
+				}
+			}
+			total--;
 		}
 
-		while ( currentNode != root );
+		// Least frequent first, then by value so both ends agree
+		unsigned char byFrequency[ 256 ];
+		for ( counter = 0; counter < 256; counter++ )
+			byFrequency[ counter ] = (unsigned char) counter;
+		for ( counter = 1; counter < 256; counter++ )
+		{
+			unsigned char value = byFrequency[ counter ];
+			unsigned int weight = frequencyTable[ value ] ? frequencyTable[ value ] : 1;
+			int position = counter;
+			while ( position > 0 )
+			{
+				unsigned char previous = byFrequency[ position - 1 ];
+				unsigned int previousWeight = frequencyTable[ previous ] ? frequencyTable[ previous ] : 1;
+				if ( previousWeight <= weight )
+					break;
+				byFrequency[ position ] = previous;
+				position--;
+			}
+			byFrequency[ position ] = value;
+		}
 
-		// Write to the bitstream in the reverse order that we stored the path, which gives us the correct order from the root to the leaf
-		while ( tempPathLength-- > 0 )
+		counter = 0;
+		for ( length = HUFFMAN_MAX_CODE_LENGTH; length > 0; length-- )
 		{
-			if ( tempPath[ tempPathLength ] )   // Write 1's and 0's because writing a bool will write the BitStream TYPE_CHECKING validation bits if that is defined along with the actual data bit, which is not what we want
-				bitStream.Write1();
-			else
-				bitStream.Write0();
+			for ( int i = 0; i < lengthCount[ length ]; i++ )
+				encodingTable[ byFrequency[ counter++ ] ].bitLength = (unsigned char) length;
 		}
+	}
 
-		// Read data from the bitstream, which is written to the encoding table in bits and bitlength. Note this function allocates the encodingTable[counter].encoding pointer
-		encodingTable[ counter ].bitLength = ( unsigned char ) bitStream.CopyData( &encodingTable[ counter ].encoding );
+	GenerateCodes();
+}
 
-		// Reset the bitstream for the next iteration
-		bitStream.Reset();
+bool HuffmanEncodingTree::GenerateFromCodeLengths( const unsigned char codeLengths[ 256 ] )
+{
+	FreeMemory();
+
+	// Every value needs a code, and together they must use every bit pattern, so the padding is a prefix of a longer code
+	uint32_t total = 0;
+	int counter;
+	for ( counter = 0; counter < 256; counter++ )
+	{
+		if ( codeLengths[ counter ] < 1 || codeLengths[ counter ] > HUFFMAN_MAX_CODE_LENGTH )
+			return false;
+		total += (uint32_t) 1 << ( HUFFMAN_MAX_CODE_LENGTH - codeLengths[ counter ] );
 	}
+	if ( total != ( (uint32_t) 1 << HUFFMAN_MAX_CODE_LENGTH ) )
+		return false;
+
+	for ( counter = 0; counter < 256; counter++ )
+		encodingTable[ counter ].bitLength = codeLengths[ counter ];
+	GenerateCodes();
+	return true;
 }
 
-// Pass an array of bytes to array and a preallocated BitStream to receive the output
-void HuffmanEncodingTree::EncodeArray( unsigned char *input, size_t sizeInBytes, RakNet::BitStream * output )
-{		
-	unsigned counter;
+void HuffmanEncodingTree::GetCodeLengths( unsigned char codeLengths[ 256 ] ) const
+{
+	for ( int counter = 0; counter < 256; counter++ )
+		codeLengths[ counter ] = encodingTable[ counter ].bitLength;
+}
 
-	// For each input byte, Write out the corresponding series of 1's and 0's that give the encoded representation
-	for ( counter = 0; counter < sizeInBytes; counter++ )
+void HuffmanEncodingTree::GenerateCodes( void )
+{
+	int length, counter;
+	memset( codeCount, 0, sizeof( codeCount ) );
+	maxCodeLength = 0;
+	for ( counter = 0; counter < 256; counter++ )
 	{
-		output->WriteBits( encodingTable[ input[ counter ] ].encoding, encodingTable[ input[ counter ] ].bitLength, false ); // Data is left aligned
+		codeCount[ encodingTable[ counter ].bitLength ]++;
+		if ( encodingTable[ counter ].bitLength > maxCodeLength )
+			maxCodeLength = encodingTable[ counter ].bitLength;
 	}
 
-	// Byte align the output so the unassigned remaining bits don't equate to some actual value
-	if ( output->GetNumberOfBitsUsed() % 8 != 0 )
+	// Canonical codes: each length starts one past the last code of the length before, shifted one bit. Within a length, in order of value
+	uint32_t code = 0;
+	unsigned short valueIndex = 0;
+	firstCode[ 0 ] = 0;
+	firstValueIndex[ 0 ] = 0;
+	for ( length = 1; length <= HUFFMAN_MAX_CODE_LENGTH; length++ )
 	{
-		// Find an input that is longer than the remaining bits.  Write out part of it to pad the output to be byte aligned.
-		unsigned char remainingBits = (unsigned char) ( 8 - ( output->GetNumberOfBitsUsed() % 8 ) );
-
+		firstCode[ length ] = code;
+		firstValueIndex[ length ] = valueIndex;
 		for ( counter = 0; counter < 256; counter++ )
-			if ( encodingTable[ counter ].bitLength > remainingBits )
+		{
+			if ( encodingTable[ counter ].bitLength == length )
 			{
-				output->WriteBits( encodingTable[ counter ].encoding, remainingBits, false ); // Data is left aligned
-				break;
+				encodingTable[ counter ].code = code++;
+				sortedValues[ valueIndex++ ] = (unsigned char) counter;
 			}
+		}
+		code <<= 1;
+	}
 
-#ifdef _DEBUG
-			RakAssert( counter != 256 );  // Given 256 elements, we should always be able to find an input that would be >= 7 bits
-
-#endif
-
+	// For every pattern of HUFFMAN_LOOKUP_BITS bits, decode as many whole codes from the start as fit, up to HUFFMAN_LOOKUP_SYMBOLS
+	for ( uint32_t pattern = 0; pattern < ( 1 << HUFFMAN_LOOKUP_BITS ); pattern++ )
+	{
+		LookupEntry &entry = lookupTable[ pattern ];
+		entry.valueCount = 0;
+		entry.bitLength = 0;
+		while ( entry.valueCount < HUFFMAN_LOOKUP_SYMBOLS )
+		{
+			int bitsLeft = HUFFMAN_LOOKUP_BITS - entry.bitLength;
+			for ( length = 1; length <= bitsLeft; length++ )
+			{
+				uint32_t prefix = ( pattern >> ( bitsLeft - length ) ) & ( ( 1 << length ) - 1 );
+				if ( prefix - firstCode[ length ] < codeCount[ length ] )
+				{
+					entry.values[ entry.valueCount++ ] = sortedValues[ firstValueIndex[ length ] + prefix - firstCode[ length ] ];
+					entry.bitLength = (unsigned char) ( entry.bitLength + length );
+					break;
+				}
+			}
+			if ( length > bitsLeft )
+				break;
+		}
 	}
 }
 
-unsigned HuffmanEncodingTree::DecodeArray( RakNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output )
-{
-	HuffmanEncodingTreeNode * currentNode;
-
-	unsigned outputWriteIndex;
-	outputWriteIndex = 0;
-	currentNode = root;
-
-	// For each bit, go left if it is a 0 and right if it is a 1.  When we reach a leaf, that gives us the desired value and we restart from the root
-
-	for ( unsigned counter = 0; counter < sizeInBits; counter++ )
+// Pass an array of bytes to array and a preallocated BitStream to receive the output
+void HuffmanEncodingTree::EncodeArray( unsigned char *input, size_t sizeInBytes, RakNet::BitStream * output )
+{		
+	if ( maxCodeLength == 0 )
+		return;
+
+	// Codes are collected in an accumulator, and written a buffer at a time rather than a call per character
+	unsigned char buffer[ 256 ];
+	unsigned int byteCount = 0;
+	uint64_t accumulator = 0;
+	int accumulatorBits = 0;
+	for ( size_t counter = 0; counter < sizeInBytes; counter++ )
 	{
-		if ( input->ReadBit() == false )   // left!
-			currentNode = currentNode->left;
-		else
-			currentNode = currentNode->right;
-
-		if ( currentNode->left == 0 && currentNode->right == 0 )   // Leaf
+		const CharacterEncoding &encoding = encodingTable[ input[ counter ] ];
+		accumulator = ( accumulator << encoding.bitLength ) | encoding.code;
+		accumulatorBits += encoding.bitLength;
+		while ( accumulatorBits >= 8 )
+		{
+			accumulatorBits -= 8;
+			buffer[ byteCount++ ] = (unsigned char) ( accumulator >> accumulatorBits );
+		}
+		if ( byteCount > sizeof( buffer ) - 4 )
 		{
+			output->WriteBits( buffer, BYTES_TO_BITS( byteCount ), false );
+			byteCount = 0;
+		}
+	}
 
-			if ( outputWriteIndex < maxCharsToWrite )
-				output[ outputWriteIndex ] = currentNode->value;
+	// Byte align the output so the unassigned remaining bits don't equate to some actual value.
+	// The code is complete, so ones are a prefix of the last code, which is longer than 7 bits with 256 values
+	if ( accumulatorBits > 0 )
+	{
+		int remainingBits = 8 - accumulatorBits;
+		accumulator = ( accumulator << remainingBits ) | ( ( 1 << remainingBits ) - 1 );
+		buffer[ byteCount++ ] = (unsigned char) accumulator;
+	}
+	if ( byteCount > 0 )
+		output->WriteBits( buffer, BYTES_TO_BITS( byteCount ), false );
+}
 
-			outputWriteIndex++;
+BitSize_t HuffmanEncodingTree::GetEncodedBitLength( const unsigned char *input, size_t sizeInBytes ) const
+{
+	if ( maxCodeLength == 0 )
+		return 0;
 
-			currentNode = root;
-		}
-	}
+	BitSize_t bitLength = 0;
+	for ( size_t counter = 0; counter < sizeInBytes; counter++ )
+		bitLength += encodingTable[ input[ counter ] ].bitLength;
+	return BYTES_TO_BITS( BITS_TO_BYTES( bitLength ) );
+}
 
-	return outputWriteIndex;
+unsigned HuffmanEncodingTree::DecodeArray( RakNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output )
+{
+	return DecodeInternal( input, sizeInBits, maxCharsToWrite, output, 0 );
 }
 
 // Pass an array of encoded bytes to array and a preallocated BitStream to receive the output
 void HuffmanEncodingTree::DecodeArray( unsigned char *input, BitSize_t sizeInBits, RakNet::BitStream * output )
 {
-	HuffmanEncodingTreeNode * currentNode;
-
 	if ( sizeInBits <= 0 )
 		return ;
 
 	RakNet::BitStream bitStream( input, BITS_TO_BYTES(sizeInBits), false );
+	DecodeInternal( &bitStream, sizeInBits, 0, 0, output );
+}
+
+unsigned HuffmanEncodingTree::DecodeInternal( RakNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output, RakNet::BitStream *outputBitStream )
+{
+	unsigned outputWriteIndex = 0;
+	if ( maxCodeLength == 0 )
+	{
+		input->IgnoreBits( sizeInBits );
+		return 0;
+	}
 
-	currentNode = root;
+	// The next bits are at the top of the accumulator. streamBitsLeft have not been read from input yet, and bitsLeft have not been decoded
+	unsigned char buffer[ 256 ];
+	unsigned int byteIndex = 0, byteCount = 0;
+	uint64_t accumulator = 0;
+	int accumulatorBits = 0;
+	BitSize_t streamBitsLeft = sizeInBits;
+	BitSize_t bitsLeft = sizeInBits;
 
-	// For each bit, go left if it is a 0 and right if it is a 1.  When we reach a leaf, that gives us the desired value and we restart from the root
-	for ( unsigned counter = 0; counter < sizeInBits; counter++ )
+	while ( bitsLeft > 0 )
 	{
-		if ( bitStream.ReadBit() == false )   // left!
-			currentNode = currentNode->left;
-		else
-			currentNode = currentNode->right;
+		// Fill the accumulator, a buffer from the input at a time. Past the end it is zeros
+		while ( accumulatorBits <= 56 )
+		{
+			if ( byteIndex == byteCount )
+			{
+				if ( streamBitsLeft == 0 )
+					break;
+				BitSize_t bits = streamBitsLeft < BYTES_TO_BITS( sizeof( buffer ) ) ? streamBitsLeft : BYTES_TO_BITS( sizeof( buffer ) );
+				input->ReadBits( buffer, bits, false );
+				streamBitsLeft -= bits;
+				byteCount = (unsigned int) BITS_TO_BYTES( bits );
+				byteIndex = 0;
+			}
+			accumulator |= (uint64_t) buffer[ byteIndex++ ] << ( 56 - accumulatorBits );
+			accumulatorBits += 8;
+		}
 
-		if ( currentNode->left == 0 && currentNode->right == 0 )   // Leaf
+		const LookupEntry &entry = lookupTable[ accumulator >> ( 64 - HUFFMAN_LOOKUP_BITS ) ];
+		if ( entry.valueCount > 0 && entry.bitLength <= bitsLeft )
 		{
-			output->WriteBits( &( currentNode->value ), sizeof( char ) * 8, true ); // Use WriteBits instead of Write(char) because we want to avoid TYPE_CHECKING
-			currentNode = root;
+			for ( int i = 0; i < entry.valueCount; i++ )
+			{
+				if ( outputBitStream )
+					outputBitStream->WriteBits( &entry.values[ i ], 8, true );
+				else if ( outputWriteIndex < maxCharsToWrite )
+					output[ outputWriteIndex ] = entry.values[ i ];
+				outputWriteIndex++;
+			}
+			accumulator <<= entry.bitLength;
+			accumulatorBits -= entry.bitLength;
+			bitsLeft -= entry.bitLength;
+			continue;
 		}
+
+		// A code longer than the lookup, or the end of the input
+		int length;
+		uint32_t prefix = 0;
+		for ( length = 1; length <= maxCodeLength && (BitSize_t) length <= bitsLeft; length++ )
+		{
+			prefix = (uint32_t) ( accumulator >> ( 64 - length ) );
+			if ( prefix - firstCode[ length ] < codeCount[ length ] )
+				break;
+		}
+		if ( length > maxCodeLength || (BitSize_t) length > bitsLeft )
+			break; // The padding at the end
+
+		unsigned char value = sortedValues[ firstValueIndex[ length ] + prefix - firstCode[ length ] ];
+		if ( outputBitStream )
+			outputBitStream->WriteBits( &value, 8, true );
+		else if ( outputWriteIndex < maxCharsToWrite )
+			output[ outputWriteIndex ] = value;
+		outputWriteIndex++;
+		accumulator <<= length;
+		accumulatorBits -= length;
+		bitsLeft -= length;
 	}
+
+	// Always read all of the input, as the tree walk did
+	if ( streamBitsLeft > 0 )
+		input->IgnoreBits( streamBitsLeft );
+
+	return outputWriteIndex;
 }
 
 // Insertion sort.  Slow but easy to write in this case
@@ -22,10 +22,21 @@
 #include "Export.h"
 #include "DS_LinkedList.h" 
 
+/// Codes are never longer than this, so a code and the bits left over from the last byte fit in 32 bits
+#define HUFFMAN_MAX_CODE_LENGTH 24
+
+/// Bits looked up at once when decoding. Codes up to this long, and several short codes together, decode with one lookup
+#define HUFFMAN_LOOKUP_BITS 10
+
+/// Most codes decoded by one lookup
+#define HUFFMAN_LOOKUP_SYMBOLS 3
+
 namespace RakNet
 {
 
 /// This generates special cases of the huffman encoding tree using 8 bit keys with the additional condition that unused combinations of 8 bits are treated as a frequency of 1
+/// \details Codes are canonical: ordered by length, then by byte value. So the length of the code for each byte value is enough to rebuild the tree, as GenerateFromCodeLengths() does.
+/// Decoding looks up HUFFMAN_LOOKUP_BITS bits at a time in a table, rather than walking the tree a bit at a time.
 class RAK_DLL_EXPORT HuffmanEncodingTree
 {
 
@@ -39,33 +50,67 @@ public:
 	/// \param [out] output The bitstream to write to
 	void EncodeArray( unsigned char *input, size_t sizeInBytes, RakNet::BitStream * output );
 
+	/// \brief Returns how many bits EncodeArray() would write for \a input, including the padding to a byte boundary.
+	/// \param [in] input Array of bytes to encode
+	/// \param [in] sizeInBytes size of \a input
+	BitSize_t GetEncodedBitLength( const unsigned char *input, size_t sizeInBytes ) const;
+
 	// \brief Decodes an array encoded by EncodeArray().
 	unsigned DecodeArray( RakNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output );
 	void DecodeArray( unsigned char *input, BitSize_t sizeInBits, RakNet::BitStream * output );
 
 	/// \brief Given a frequency table of 256 elements, all with a frequency of 1 or more, generate the tree.
+	/// \details Codes that would be longer than HUFFMAN_MAX_CODE_LENGTH are shortened, by lengthening codes of more frequent values.
 	void GenerateFromFrequencyTable( unsigned int frequencyTable[ 256 ] );
 
+	/// \brief Generate the tree from the length of the code for each byte value, as returned by GetCodeLengths() from another tree.
+	/// \param[in] codeLengths 256 lengths, each from 1 to HUFFMAN_MAX_CODE_LENGTH, which must make a complete prefix code
+	/// \return false if the lengths are not valid, in which case the tree is empty
+	bool GenerateFromCodeLengths( const unsigned char codeLengths[ 256 ] );
+
+	/// \brief Get the length of the code for each byte value, which is all GenerateFromCodeLengths() needs to make the same tree.
+	/// \param[out] codeLengths 256 lengths, or all 0 if the tree is empty
+	void GetCodeLengths( unsigned char codeLengths[ 256 ] ) const;
+
 	/// \brief Free the memory used by the tree.
 	void FreeMemory( void );
 
 private:
 
-	/// The root node of the tree 
-
-	HuffmanEncodingTreeNode *root;
-
-	/// Used to hold bit encoding for one character
-
-
+	/// Used to hold bit encoding for one character, right aligned
 	struct CharacterEncoding
 	{
-		unsigned char* encoding;
-		unsigned short bitLength;
+		uint32_t code;
+		unsigned char bitLength;
 	};
 
 	CharacterEncoding encodingTable[ 256 ];
 
+	/// Values decoded from the next HUFFMAN_LOOKUP_BITS bits, and how many of the bits their codes took. No values if the first code is longer
+	struct LookupEntry
+	{
+		unsigned char values[ HUFFMAN_LOOKUP_SYMBOLS ];
+		unsigned char valueCount;
+		unsigned char bitLength;
+	};
+
+	LookupEntry lookupTable[ 1 << HUFFMAN_LOOKUP_BITS ];
+
+	/// For codes longer than HUFFMAN_LOOKUP_BITS, decoded a bit at a time: for each length, the first code, how many codes, and where their values start in sortedValues
+	uint32_t firstCode[ HUFFMAN_MAX_CODE_LENGTH + 1 ];
+	unsigned short codeCount[ HUFFMAN_MAX_CODE_LENGTH + 1 ];
+	unsigned short firstValueIndex[ HUFFMAN_MAX_CODE_LENGTH + 1 ];
+	unsigned char sortedValues[ 256 ];
+
+	/// Length of the longest code, or 0 if the tree is empty
+	int maxCodeLength;
+
+	/// Assigns the canonical codes and builds the decoding tables from the lengths in encodingTable
+	void GenerateCodes( void );
+
+	/// Decodes to \a output, or to \a outputBitStream if it is not 0
+	unsigned DecodeInternal( RakNet::BitStream * input, BitSize_t sizeInBits, size_t maxCharsToWrite, unsigned char *output, RakNet::BitStream *outputBitStream );
+
 	void InsertNodeIntoSortedList( HuffmanEncodingTreeNode * node, DataStructures::LinkedList<HuffmanEncodingTreeNode *> *huffmanEncodingTreeNodeList ) const;
 };
 
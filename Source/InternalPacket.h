@@ -51,7 +51,7 @@ struct InternalPacketFixedSizeTransmissionHeader
 	// Used only with sequenced messages
 	OrderingIndexType sequencingIndex;
 	///What ordering channel this packet is on, if the reliability type uses ordering channels
-	unsigned char orderingChannel;
+	OrderingChannelType orderingChannel;
 	///The ID of the split packet, if we have split packets.  This is the maximum number of split messages we can send simultaneously per connection.
 	SplitPacketIdType splitPacketId;
 	///If this is a split packet, the index into the array of subsplit packets
@@ -88,6 +88,10 @@ struct InternalPacket : public InternalPacketFixedSizeTransmissionHeader
 //	bool allowWindowUpdate;
 	///When this packet was created
 	RakNet::TimeUS creationTime;
+	/// If not 0, an unreliable packet still in the send buffer at this time is discarded instead of sent
+	RakNet::TimeUS deadline;
+	/// If not 0, a newer unreliable message with the same key replaces this one while it is still unsent
+	uint32_t coalescingKey;
 	///The resendNext time to take action on this packet
 	RakNet::TimeUS nextActionTime;
 	// For debugging
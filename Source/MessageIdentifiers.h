@@ -421,7 +421,9 @@ enum DefaultMessageIDTypes
 	ID_NAT_REQUEST_BOUND_ADDRESSES,
 	ID_NAT_RESPOND_BOUND_ADDRESSES,
 	ID_FCM2_UPDATE_USER_CONTEXT,
-	ID_RESERVED_3,
+	/// RakPeer - A connected system started sending from a new address, such as after a NAT rebinding, and the connection was moved to it without reconnecting.
+	/// Packet::systemAddress is the new address, and the SystemAddress following the message ID is the old one. See RakPeerInterface::AllowConnectionMigration()
+	ID_CONNECTION_MIGRATION,
 	ID_RESERVED_4,
 	ID_RESERVED_5,
 	ID_RESERVED_6,
@@ -126,6 +126,7 @@ RakNetSocket2* RakNet::CreateNonblockingBoundSocket(const char *bindAddr
 		bbp.setBroadcast=true;
 		bbp.setIPHdrIncl=false;
 		bbp.doNotFragment=false;
+		bbp.reusePort=false;
 		bbp.pollingThreadPriority=0;
 		bbp.eventHandler=eventHandler;
 		bbp.remotePortRakNetWasStartedOn_PS3_PS4_PSP2=0;
@@ -0,0 +1,197 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "OfflineRateLimiter.h"
+#include "SuperFastHash.h"
+#include "RakMemoryOverride.h"
+#include <string.h>
+
+using namespace RakNet;
+
+OfflineRateLimitSettings::OfflineRateLimitSettings()
+{
+	addressMessagesPerSecond=0.0f;
+	addressBurst=0;
+	prefixMessagesPerSecond=0.0f;
+	prefixBurst=0;
+	ipv4PrefixLength=24;
+	ipv6PrefixLength=48;
+}
+
+void OfflineRateLimiter::Sketch::Refill( void )
+{
+	for (int row=0; row < OFFLINE_RATE_LIMITER_DEPTH; row++)
+	{
+		for (int column=0; column < OFFLINE_RATE_LIMITER_WIDTH; column++)
+		{
+			// Negative means full. The time is set when the bucket is first used
+			buckets[row][column].tokens=-1.0f;
+			buckets[row][column].lastUpdate=0;
+		}
+	}
+}
+bool OfflineRateLimiter::Sketch::Update( const unsigned char *key, int keyLength, const uint32_t *seeds, float messagesPerSecond, float burst, RakNet::TimeMS time, Bucket **keyBuckets )
+{
+	bool allowed=false;
+	int row;
+	for (row=0; row < OFFLINE_RATE_LIMITER_DEPTH; row++)
+	{
+		uint32_t hash = SuperFastHashIncremental((const char*) key, keyLength, seeds[row]);
+		Bucket *bucket = &buckets[row][hash % OFFLINE_RATE_LIMITER_WIDTH];
+		if (bucket->tokens < 0.0f)
+			bucket->tokens=burst;
+		else
+		{
+			// Unsigned difference, so this is correct when the time wraps
+			bucket->tokens += (float) (RakNet::TimeMS) (time-bucket->lastUpdate) * messagesPerSecond / 1000.0f;
+			if (bucket->tokens > burst)
+				bucket->tokens=burst;
+		}
+		bucket->lastUpdate=time;
+		if (bucket->tokens >= 1.0f)
+			allowed=true;
+		keyBuckets[row]=bucket;
+	}
+	return allowed;
+}
+void OfflineRateLimiter::Sketch::Take( Bucket **keyBuckets )
+{
+	// The fullest bucket is the best estimate for this key. The others are shared with busier keys, so stop at 0 rather than go into debt for them.
+	for (int row=0; row < OFFLINE_RATE_LIMITER_DEPTH; row++)
+	{
+		keyBuckets[row]->tokens-=1.0f;
+		if (keyBuckets[row]->tokens < 0.0f)
+			keyBuckets[row]->tokens=0.0f;
+	}
+}
+
+OfflineRateLimiter::OfflineRateLimiter()
+{
+	addressSketch=RakNet::OP_NEW<Sketch>(_FILE_AND_LINE_);
+	prefixSketch=RakNet::OP_NEW<Sketch>(_FILE_AND_LINE_);
+	Seed(0);
+	ResetStatistics();
+}
+OfflineRateLimiter::~OfflineRateLimiter()
+{
+	RakNet::OP_DELETE(addressSketch,_FILE_AND_LINE_);
+	RakNet::OP_DELETE(prefixSketch,_FILE_AND_LINE_);
+}
+void OfflineRateLimiter::SetSettings( const OfflineRateLimitSettings &_settings )
+{
+	settings=_settings;
+	if (settings.ipv4PrefixLength>32)
+		settings.ipv4PrefixLength=32;
+	if (settings.ipv6PrefixLength>128)
+		settings.ipv6PrefixLength=128;
+	if (settings.addressBurst<1)
+		settings.addressBurst=1;
+	if (settings.prefixBurst<1)
+		settings.prefixBurst=1;
+	addressSketch->Refill();
+	prefixSketch->Refill();
+}
+const OfflineRateLimitSettings& OfflineRateLimiter::GetSettings( void ) const
+{
+	return settings;
+}
+void OfflineRateLimiter::Seed( uint32_t seed )
+{
+	// Spread one seed over the rows. Each row only needs to hash differently from the others
+	for (int row=0; row < OFFLINE_RATE_LIMITER_DEPTH; row++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		seeds[row]=seed;
+	}
+	addressSketch->Refill();
+	prefixSketch->Refill();
+}
+int OfflineRateLimiter::GetKey( const SystemAddress &systemAddress, bool usePrefix, unsigned char *key ) const
+{
+	int addressLength;
+	const unsigned char *address;
+#if RAKNET_SUPPORT_IPV6==1
+	static const unsigned char v4MappedPrefix[12]={0,0,0,0,0,0,0,0,0,0,0xFF,0xFF};
+	if (systemAddress.GetIPVersion()==6 &&
+		memcmp(&systemAddress.address.addr6.sin6_addr, v4MappedPrefix, sizeof(v4MappedPrefix))!=0)
+	{
+		address=(const unsigned char*) &systemAddress.address.addr6.sin6_addr;
+		addressLength=16;
+	}
+	else if (systemAddress.GetIPVersion()==6)
+	{
+		// IPv4-mapped, so it shares buckets with the IPv4 address
+		address=(const unsigned char*) &systemAddress.address.addr6.sin6_addr + 12;
+		addressLength=4;
+	}
+	else
+#endif
+	{
+		address=(const unsigned char*) &systemAddress.address.addr4.sin_addr;
+		addressLength=4;
+	}
+
+	// The first byte keeps IPv4 and IPv6 keys, and address and prefix keys, apart
+	key[0]=(unsigned char) addressLength | (usePrefix ? 0x80 : 0);
+	memcpy(key+1, address, addressLength);
+	if (usePrefix)
+	{
+		int prefixLength = addressLength==4 ? settings.ipv4PrefixLength : settings.ipv6PrefixLength;
+		for (int bit=prefixLength; bit < addressLength*8; bit++)
+			key[1+(bit>>3)]&=(unsigned char) ~(0x80 >> (bit&7));
+	}
+	return 1+addressLength;
+}
+bool OfflineRateLimiter::Allow( const SystemAddress &systemAddress, RakNet::TimeMS time )
+{
+	unsigned char key[17];
+	int keyLength;
+	Bucket *addressBuckets[OFFLINE_RATE_LIMITER_DEPTH], *prefixBuckets[OFFLINE_RATE_LIMITER_DEPTH];
+	const bool limitAddress = settings.addressMessagesPerSecond > 0.0f;
+	const bool limitPrefix = settings.prefixMessagesPerSecond > 0.0f;
+
+	if (limitAddress)
+	{
+		keyLength=GetKey(systemAddress, false, key);
+		if (addressSketch->Update(key, keyLength, seeds, settings.addressMessagesPerSecond, (float) settings.addressBurst, time, addressBuckets)==false)
+		{
+			statistics.messagesDroppedByAddress++;
+			return false;
+		}
+	}
+
+	if (limitPrefix)
+	{
+		keyLength=GetKey(systemAddress, true, key);
+		if (prefixSketch->Update(key, keyLength, seeds, settings.prefixMessagesPerSecond, (float) settings.prefixBurst, time, prefixBuckets)==false)
+		{
+			statistics.messagesDroppedByPrefix++;
+			return false;
+		}
+	}
+
+	// Both limits allow the message, so take the tokens
+	if (limitAddress)
+		Sketch::Take(addressBuckets);
+	if (limitPrefix)
+		Sketch::Take(prefixBuckets);
+	statistics.messagesAllowed++;
+	return true;
+}
+void OfflineRateLimiter::GetStatistics( OfflineRateLimitStatistics *_statistics ) const
+{
+	*_statistics=statistics;
+}
+void OfflineRateLimiter::ResetStatistics( void )
+{
+	statistics.messagesAllowed=0;
+	statistics.messagesDroppedByAddress=0;
+	statistics.messagesDroppedByPrefix=0;
+}
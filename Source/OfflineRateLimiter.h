@@ -0,0 +1,119 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file OfflineRateLimiter.h
+/// \brief Per address and per prefix token buckets for messages from unconnected systems, used by RakPeer
+///
+
+#ifndef __OFFLINE_RATE_LIMITER_H
+#define __OFFLINE_RATE_LIMITER_H
+
+#include "Export.h"
+#include "RakNetTypes.h"
+
+namespace RakNet
+{
+
+/// Number of rows in each sketch. A system is only limited unfairly if it collides with a busier system in every row.
+#define OFFLINE_RATE_LIMITER_DEPTH 4
+/// Number of buckets in each row of each sketch
+#define OFFLINE_RATE_LIMITER_WIDTH 2048
+
+/// \brief Settings for RakPeerInterface::SetOfflineRateLimit()
+struct RAK_DLL_EXPORT OfflineRateLimitSettings
+{
+	OfflineRateLimitSettings();
+
+	/// Offline messages per second allowed from one address, on average. 0 to not limit by address.
+	float addressMessagesPerSecond;
+	/// Offline messages allowed from one address at once, after it has been idle. At least 1.
+	unsigned int addressBurst;
+	/// Offline messages per second allowed from all addresses in one prefix, on average. 0 to not limit by prefix.
+	float prefixMessagesPerSecond;
+	/// Offline messages allowed from one prefix at once, after it has been idle. At least 1.
+	unsigned int prefixBurst;
+	/// Length of the prefix for IPv4 addresses. Defaults to 24.
+	unsigned char ipv4PrefixLength;
+	/// Length of the prefix for IPv6 addresses. Defaults to 48.
+	unsigned char ipv6PrefixLength;
+};
+
+/// \brief Counters returned by RakPeerInterface::GetOfflineRateLimitStatistics()
+struct RAK_DLL_EXPORT OfflineRateLimitStatistics
+{
+	/// Offline messages that were processed
+	uint64_t messagesAllowed;
+	/// Offline messages dropped because their address was over the limit
+	uint64_t messagesDroppedByAddress;
+	/// Offline messages dropped because their prefix was over the limit
+	uint64_t messagesDroppedByPrefix;
+};
+
+/// \brief Token bucket rate limiter for messages from unconnected systems, such as pings and connection requests
+/// \details Buckets are kept in a count-min sketch rather than per address, so memory does not grow with the number of senders.
+/// Each address hashes to one bucket in each row, using hashes seeded with Seed(). A message is allowed if any of those buckets has a token, and takes a token from all of them.
+/// A message must be allowed by both the address and the prefix limit. Tokens are only taken once both allow it, so a message dropped by one limit does not use up the other.
+/// Addresses that share a bucket share its tokens, so a system is only limited for another system's traffic if it shares a bucket with busier systems in every row.
+/// Not thread safe. RakPeer locks a mutex around each call, since Allow() runs on the threads that read datagrams while SetSettings() runs on the user's thread.
+class RAK_DLL_EXPORT OfflineRateLimiter
+{
+public:
+	OfflineRateLimiter();
+	~OfflineRateLimiter();
+
+	/// Set the rates and bursts. Buckets are refilled to the new burst, and counters are not reset.
+	void SetSettings( const OfflineRateLimitSettings &_settings );
+	/// \return The settings passed to SetSettings()
+	const OfflineRateLimitSettings& GetSettings( void ) const;
+
+	/// Choose new hash functions and refill all buckets. Call with a random number so that senders cannot pick addresses that collide.
+	void Seed( uint32_t seed );
+
+	/// \return True if a message from \a systemAddress should be processed. Always true if no limit is set.
+	/// \param[in] time Time the message arrived
+	bool Allow( const SystemAddress &systemAddress, RakNet::TimeMS time );
+
+	/// Get the counters since construction, or since ResetStatistics()
+	void GetStatistics( OfflineRateLimitStatistics *statistics ) const;
+	/// Set all counters to 0
+	void ResetStatistics( void );
+
+protected:
+	struct Bucket
+	{
+		float tokens;
+		RakNet::TimeMS lastUpdate;
+	};
+
+	// One count-min sketch of token buckets
+	struct Sketch
+	{
+		// Fill every bucket
+		void Refill( void );
+		// Refills the buckets for the key up to \a time, writes them to \a keyBuckets, and returns true if any of them has a token
+		bool Update( const unsigned char *key, int keyLength, const uint32_t *seeds, float messagesPerSecond, float burst, RakNet::TimeMS time, Bucket **keyBuckets );
+		// Takes a token from the buckets written by Update()
+		static void Take( Bucket **keyBuckets );
+
+		Bucket buckets[OFFLINE_RATE_LIMITER_DEPTH][OFFLINE_RATE_LIMITER_WIDTH];
+	};
+
+	// Writes the address, or its prefix, and returns the number of bytes written
+	int GetKey( const SystemAddress &systemAddress, bool usePrefix, unsigned char *key ) const;
+
+	OfflineRateLimitSettings settings;
+	uint32_t seeds[OFFLINE_RATE_LIMITER_DEPTH];
+	Sketch *addressSketch, *prefixSketch;
+	OfflineRateLimitStatistics statistics;
+};
+
+} // namespace RakNet
+
+#endif
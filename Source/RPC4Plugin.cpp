@@ -18,6 +18,7 @@
 #include "RakSleep.h"
 #include "RakNetDefines.h"
 #include "DS_Queue.h"
+#include "BitStreamView.h"
 //#include "GetTime.h"
 
 using namespace RakNet;
@@ -520,7 +521,7 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 {
 	if (packet->data[0]==ID_RPC_PLUGIN)
 	{
-		RakNet::BitStream bsIn(packet->data,packet->length,false);
+		RakNet::BitStreamView bsIn(packet);
 		bsIn.IgnoreBytes(2);
 
 		if (packet->data[1]==ID_RPC4_CALL)
@@ -545,7 +546,7 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 				void ( *fp ) ( RakNet::BitStream *, Packet * );
 				fp = registeredNonblockingFunctions.ItemAtIndex(skhi);
 				bsIn.AlignReadToByteBoundary();
-				fp(&bsIn,packet);
+				fp(bsIn.GetBitStream(),packet);
 			}
 			else
 			{
@@ -564,7 +565,7 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 				fp = registeredBlockingFunctions.ItemAtIndex(skhi);
 				RakNet::BitStream returnData;
 				bsIn.AlignReadToByteBoundary();
-				fp(&bsIn, &returnData, packet);
+				fp(bsIn.GetBitStream(), &returnData, packet);
 
 				RakNet::BitStream out;
 				out.Write((MessageID) ID_RPC_PLUGIN);
@@ -581,16 +582,17 @@ PluginReceiveResult RPC4::OnReceive(Packet *packet)
 			bsIn.ReadCompressed(sharedIdentifier);
 			DataStructures::HashIndex functionIndex;
 			functionIndex = localSlots.GetIndexOf(sharedIdentifier);
+			// The parameters are read in place, rather than copied for the slots
 			RakNet::BitStream serializedParameters;
-            bsIn.AlignReadToByteBoundary();
-			bsIn.Read(&serializedParameters);
+			bsIn.AlignReadToByteBoundary();
+			bsIn.ReadView(&serializedParameters, bsIn.GetNumberOfUnreadBits());
 			InvokeSignal(functionIndex, &serializedParameters, packet);
 		}
 		else
 		{
 			RakAssert(packet->data[1]==ID_RPC4_RETURN);
 			blockingReturnValue.Reset();
-			blockingReturnValue.Write(bsIn);
+			blockingReturnValue.Write(bsIn.GetBitStream());
 			gotBlockingReturnValue=true;
 		}
 		
@@ -65,6 +65,7 @@ RakNetCommandParser::RakNetCommandParser()
 	RegisterCommand(0,"GetNumberOfAddresses","( void );");
 	RegisterCommand(1,"GetLocalIP","( unsigned int index );");
 	RegisterCommand(1,"AllowConnectionResponseIPMigration","( bool allow );");
+	RegisterCommand(1,"AllowConnectionMigration","( bool allow );");
 	RegisterCommand(4,"AdvertiseSystem","( const char *host, unsigned short remotePort, const char *data, int dataLength );");
 	RegisterCommand(2,"SetIncomingPassword","( const char* passwordData, int passwordDataLength );");
 	RegisterCommand(0,"GetIncomingPassword","( void );");
@@ -264,6 +265,11 @@ bool RakNetCommandParser::OnCommand(const char *command, unsigned numParameters,
 		peer->AllowConnectionResponseIPMigration(atoi(parameterList[0])!=0);
 		ReturnResult(command, transport, systemAddress);
 	}
+	else if (strcmp(command, "AllowConnectionMigration")==0)
+	{
+		peer->AllowConnectionMigration(atoi(parameterList[0])!=0);
+		ReturnResult(command, transport, systemAddress);
+	}
 	else if (strcmp(command, "AdvertiseSystem")==0)
 	{
 		peer->AdvertiseSystem(parameterList[0], (unsigned short) atoi(parameterList[1]),parameterList[2],atoi(parameterList[3]));
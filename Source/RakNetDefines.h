@@ -132,6 +132,12 @@
 #define RAKNET_SUPPORT_IPV6 0
 #endif
 
+// If 1, SocketDescriptor::useIOUring selects RNS2_Linux_IOUring on Linux.
+// Requires linux/io_uring.h from kernel 6.0 or later to compile. Older kernels at runtime fall back to regular sockets.
+#ifndef RAKNET_SUPPORT_IO_URING
+#define RAKNET_SUPPORT_IO_URING 0
+#endif
+
 
 
 
@@ -185,6 +191,13 @@
 #define USE_ALLOCA 1
 #endif
 
+// Most ordering channels that a remote system can make one connection keep state for. Channels this system sends on first do not count.
+// State for each channel stays allocated until disconnect, so a remote system that uses more than this is disconnected with ID_CONNECTION_LOST,
+// rather than letting it allocate state for every channel id
+#ifndef MAX_ORDERING_CHANNELS_PER_CONNECTION
+#define MAX_ORDERING_CHANNELS_PER_CONNECTION 4096
+#endif
+
 
 
 
@@ -33,6 +33,9 @@ using namespace RakNet;
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
 #endif
 
 #ifdef TEST_NATIVE_CLIENT_ON_WINDOWS
@@ -48,6 +51,7 @@ using namespace RakNet;
 #include "RakNetSocket2_Berkley.cpp"
 #include "RakNetSocket2_Berkley_NativeClient.cpp"
 #include "RakNetSocket2_WindowsStore8.cpp"
+#include "RakNetSocket2_Linux_IOUring.cpp"
 #undef RAKNET_SOCKET_2_INLINE_FUNCTIONS
 
 #endif
@@ -100,6 +104,16 @@ RakNetSocket2* RakNetSocket2Allocator::AllocRNS2(void)
 #endif
 	return s2;
 }
+RakNetSocket2* RakNetSocket2Allocator::AllocRNS2_IOUring(void)
+{
+#if !defined(_WIN32) && !defined(__native_client__) && !defined(WINDOWS_STORE_RT) && RAKNET_SUPPORT_IO_URING==1
+	RakNetSocket2* s2 = RakNet::OP_NEW<RNS2_Linux_IOUring>(_FILE_AND_LINE_);
+	s2->SetSocketType(RNS2T_LINUX);
+	return s2;
+#else
+	return AllocRNS2();
+#endif
+}
 void RakNetSocket2::GetMyIP( SystemAddress addresses[MAXIMUM_NUMBER_OF_INTERNAL_IDS] )
 {
 #if defined(WINDOWS_STORE_RT)
@@ -285,7 +299,7 @@ bool IRNS2_Berkley::IsPortInUse(unsigned short port, const char *hostAddress, un
 	bbp.port=port; bbp.hostAddress=(char*) hostAddress;	bbp.addressFamily=addressFamily;
 	bbp.type=type; bbp.protocol=0; bbp.nonBlockingSocket=false;
 	bbp.setBroadcast=false;	bbp.doNotFragment=false; bbp.protocol=0;
-	bbp.setIPHdrIncl=false;
+	bbp.setIPHdrIncl=false; bbp.reusePort=false;
 	SystemAddress boundAddress;
 	RNS2_Berkley *rns2 = (RNS2_Berkley*) RakNetSocket2Allocator::AllocRNS2();
 	RNS2BindResult bindResult = rns2->Bind(&bbp, _FILE_AND_LINE_);
@@ -376,6 +390,28 @@ unsigned RNS2_Berkley::RecvFromLoopInt(void)
 	return 0;
 
 }
+unsigned int RNS2_Berkley::PollRecvFrom(void)
+{
+	unsigned int count=0;
+	for (;;)
+	{
+		RNS2RecvStruct *recvFromStruct;
+		recvFromStruct=binding.eventHandler->AllocRNS2RecvStruct(_FILE_AND_LINE_);
+		if (recvFromStruct == NULL)
+			break;
+		recvFromStruct->socket=this;
+		RecvFromBlocking(recvFromStruct);
+		if (recvFromStruct->bytesRead<=0)
+		{
+			binding.eventHandler->DeallocRNS2RecvStruct(recvFromStruct, _FILE_AND_LINE_);
+			break;
+		}
+		RakAssert(recvFromStruct->systemAddress.GetPort());
+		binding.eventHandler->OnRNS2Recv(recvFromStruct);
+		count++;
+	}
+	return count;
+}
 RNS2_Berkley::RNS2_Berkley()
 {
 	rns2Socket=(RNS2Socket)INVALID_SOCKET;
@@ -424,6 +460,12 @@ void RNS2_Berkley::BlockOnStopRecvPollingThread(void)
 	bsp.ttl=0;
 	Send(&bsp, _FILE_AND_LINE_);
 
+#if defined(SO_REUSEPORT)
+	// Datagrams sent to a SO_REUSEPORT group may be delivered to another socket in the group. Shutting down reads wakes recvfrom instead.
+	if (binding.reusePort)
+		shutdown__( rns2Socket, SHUT_RD );
+#endif
+
 	RakNet::TimeMS timeout = RakNet::GetTimeMS()+1000;
 	while ( isRecvFromLoopThreadActive.GetValue()>0 && RakNet::GetTimeMS()<timeout )
 	{
@@ -34,6 +34,9 @@
 typedef int PP_Resource;
 #endif
 
+// Classic BPF instruction, from linux/filter.h
+struct sock_filter;
+
 namespace RakNet
 {
 
@@ -91,6 +94,8 @@ class RakNetSocket2Allocator
 {
 public:
 	static RakNetSocket2* AllocRNS2(void);
+	// Same as AllocRNS2(), except that on Linux with RAKNET_SUPPORT_IO_URING an RNS2_Linux_IOUring is returned
+	static RakNetSocket2* AllocRNS2_IOUring(void);
 	static void DeallocRNS2(RakNetSocket2 *s);
 };
 
@@ -264,6 +269,7 @@ struct RNS2_BerkleyBindParameters
 	int setBroadcast;
 	int setIPHdrIncl;
 	int doNotFragment;
+	int reusePort; // SO_REUSEPORT, where supported
 	int pollingThreadPriority;
 	RNS2EventHandler *eventHandler;
 	unsigned short remotePortRakNetWasStartedOn_PS3_PS4_PSP2;
@@ -288,11 +294,18 @@ public:
 	RNS2_Berkley();
 	virtual ~RNS2_Berkley();
 	int CreateRecvPollingThread(int threadPriority);
+	// For non-blocking sockets read by the owner instead of a polling thread: passes datagrams to the event handler until the socket would block
+	// Returns how many datagrams were read
+	unsigned int PollRecvFrom(void);
 	void SignalStopRecvPollingThread(void);
-	void BlockOnStopRecvPollingThread(void);
+	virtual void BlockOnStopRecvPollingThread(void);
 	const RNS2_BerkleyBindParameters *GetBindings(void) const;
 	RNS2Socket GetSocket(void) const;
 	void SetDoNotFragment( int opt );
+	// Linux only: attach a classic BPF program with SO_ATTACH_FILTER, so datagrams it returns 0 for are dropped before recvfrom wakes up.
+	// For UDP sockets the program sees the UDP header at offset 0, so the payload starts at offset 8.
+	// Returns false if socket filters are not supported, or the kernel rejected the program.
+	bool AttachPacketFilter( const ::sock_filter *program, unsigned short programLength );
 
 protected:
 	// Used by other classes
@@ -308,6 +321,7 @@ protected:
 	void SetSocketOptions(void);
 	void SetBroadcastSocket(int broadcast);
 	void SetIPHdrIncl(int ipHdrIncl);
+	void SetReusePort(int reusePort);
 	void RecvFromBlocking(RNS2RecvStruct *recvFromStruct);
 	void RecvFromBlockingIPV4(RNS2RecvStruct *recvFromStruct);
 	void RecvFromBlockingIPV4And6(RNS2RecvStruct *recvFromStruct);
@@ -315,7 +329,7 @@ protected:
 	RNS2Socket rns2Socket;
 	RNS2_BerkleyBindParameters binding;
 
-	unsigned RecvFromLoopInt(void);
+	virtual unsigned RecvFromLoopInt(void);
 	RakNet::LocklessUint32_t isRecvFromLoopThreadActive;
 	volatile bool endThreads;
 	// Constructor not called!
@@ -444,6 +458,40 @@ protected:
 	static void GetMyIPIPV4And6( SystemAddress addresses[MAXIMUM_NUMBER_OF_INTERNAL_IDS] );
 };
 
+#if RAKNET_SUPPORT_IO_URING==1
+struct RNS2_IOUringRing;
+struct RNS2_IOUringSendSlot;
+struct RNS2_IOUringRecvBuffers;
+
+// Receives with a multishot recvmsg into a ring of kernel-selected buffers, so one submission serves many datagrams.
+// Sends are copied into preallocated slots and queued with sendmsg, using a kernel submission thread when allowed so no system call is made per datagram.
+// If io_uring cannot be set up, behaves as RNS2_Linux.
+class RNS2_Linux_IOUring : public RNS2_Linux
+{
+public:
+	RNS2_Linux_IOUring();
+	virtual ~RNS2_Linux_IOUring();
+	RNS2BindResult Bind( RNS2_BerkleyBindParameters *bindParameters, const char *file, unsigned int line );
+	RNS2SendResult Send( RNS2_SendParameters *sendParameters, const char *file, unsigned int line );
+	void BlockOnStopRecvPollingThread(void);
+	bool IsUsingIOUring(void) const;
+
+protected:
+	unsigned RecvFromLoopInt(void);
+	bool InitRings(void);
+	void FreeRings(void);
+	bool SubmitMultishotRecv(void);
+	void RecycleRecvBuffer(unsigned short bufferId);
+	void ReapSendCompletions(bool wait);
+
+	RNS2_IOUringRing *sendRing, *recvRing;
+	RNS2_IOUringRecvBuffers *recvBuffers;
+	RNS2_IOUringSendSlot *sendSlots;
+	DataStructures::Queue<unsigned short> freeSendSlots;
+	SimpleMutex sendMutex;
+};
+#endif // RAKNET_SUPPORT_IO_URING
+
 #endif // Linux
 
 #endif // #elif !defined(WINDOWS_STORE_RT)
@@ -20,6 +20,68 @@
 
 #include "Itoa.h"
 
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+#define RNS2_KERNEL_RECEIVE_TIMESTAMPS
+#include <sys/time.h>
+
+// The kernel stamps datagrams with the realtime clock. Return the same moment in the time base of RakNet::GetTimeUS()
+static RakNet::TimeUS KernelTimestampToTimeUS(const struct timespec *timestamp)
+{
+	RakNet::TimeUS timeUS=RakNet::GetTimeUS();
+	timeval now;
+	gettimeofday(&now, 0);
+	long long ageUS=((long long) now.tv_sec-(long long) timestamp->tv_sec)*1000000 + (now.tv_usec-timestamp->tv_nsec/1000);
+	// If the realtime clock was changed, the timestamp is meaningless
+	if (ageUS<0 || ageUS>10000000 || (RakNet::TimeUS) ageUS>timeUS)
+		return timeUS;
+	return timeUS-(RakNet::TimeUS) ageUS;
+}
+
+// Return the time in the SCM_TIMESTAMPNS control message, or the current time if there is none
+static RakNet::TimeUS GetKernelReceiveTime(struct msghdr *msg)
+{
+	for (struct cmsghdr *cmsg=CMSG_FIRSTHDR(msg); cmsg; cmsg=CMSG_NXTHDR(msg, cmsg))
+	{
+		if (cmsg->cmsg_level==SOL_SOCKET && cmsg->cmsg_type==SCM_TIMESTAMPNS)
+		{
+			struct timespec timestamp;
+			memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+			return KernelTimestampToTimeUS(&timestamp);
+		}
+	}
+	return RakNet::GetTimeUS();
+}
+#endif
+
+// recvfrom, also returning when the datagram arrived. Where the kernel supports it, this is when the kernel received it, rather than when recvfrom returned
+static int RecvFromWithTime(RNS2Socket rns2Socket, char *data, int dataLength, sockaddr *from, socklen_t *fromLength, RakNet::TimeUS *timeRead)
+{
+#if defined(RNS2_KERNEL_RECEIVE_TIMESTAMPS)
+	struct iovec iov;
+	iov.iov_base=data;
+	iov.iov_len=dataLength;
+	char control[CMSG_SPACE(sizeof(struct timespec))];
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name=from;
+	msg.msg_namelen=*fromLength;
+	msg.msg_iov=&iov;
+	msg.msg_iovlen=1;
+	msg.msg_control=control;
+	msg.msg_controllen=sizeof(control);
+	int bytesRead=(int) recvmsg(rns2Socket, &msg, 0);
+	*fromLength=msg.msg_namelen;
+	if (bytesRead>0)
+		*timeRead=GetKernelReceiveTime(&msg);
+	return bytesRead;
+#else
+	int bytesRead=recvfrom__(rns2Socket, data, dataLength, 0, from, fromLength);
+	if (bytesRead>0)
+		*timeRead=RakNet::GetTimeUS();
+	return bytesRead;
+#endif
+}
+
 void RNS2_Berkley::SetSocketOptions(void)
 {
 	int r;
@@ -43,6 +105,12 @@ void RNS2_Berkley::SetSocketOptions(void)
 	r = setsockopt__( rns2Socket, SOL_SOCKET, SO_SNDBUF, ( char * ) & sock_opt, sizeof ( sock_opt ) );
 	RakAssert(r==0);
 
+#if defined(RNS2_KERNEL_RECEIVE_TIMESTAMPS)
+	// So timeRead is when the datagram arrived, not when the receive thread got to it. Do not assert, ignore failure
+	sock_opt=1;
+	setsockopt__( rns2Socket, SOL_SOCKET, SO_TIMESTAMPNS, ( char * ) & sock_opt, sizeof ( sock_opt ) );
+#endif
+
 }
 
 void RNS2_Berkley::SetNonBlockingSocket(unsigned long nonblocking)
@@ -67,6 +135,28 @@ void RNS2_Berkley::SetIPHdrIncl(int ipHdrIncl)
 
 		setsockopt__( rns2Socket, IPPROTO_IP, IP_HDRINCL, ( char * ) & ipHdrIncl, sizeof( ipHdrIncl ) );
 
+}
+void RNS2_Berkley::SetReusePort(int reusePort)
+{
+#if defined(SO_REUSEPORT)
+	if (reusePort)
+		setsockopt__( rns2Socket, SOL_SOCKET, SO_REUSEPORT, ( char * ) & reusePort, sizeof( reusePort ) );
+#else
+	(void) reusePort;
+#endif
+}
+bool RNS2_Berkley::AttachPacketFilter( const ::sock_filter *program, unsigned short programLength )
+{
+#if defined(__linux__) && defined(SO_ATTACH_FILTER)
+	struct sock_fprog fprog;
+	fprog.len=programLength;
+	fprog.filter=(::sock_filter *) program;
+	return setsockopt__( rns2Socket, SOL_SOCKET, SO_ATTACH_FILTER, ( char * ) & fprog, sizeof( fprog ) )==0;
+#else
+	(void) program;
+	(void) programLength;
+	return false;
+#endif
 }
 void RNS2_Berkley::SetDoNotFragment( int opt )
 {
@@ -175,6 +265,7 @@ RNS2BindResult RNS2_Berkley::BindSharedIPV4( RNS2_BerkleyBindParameters *bindPar
 	SetNonBlockingSocket(bindParameters->nonBlockingSocket);
 	SetBroadcastSocket(bindParameters->setBroadcast);
 	SetIPHdrIncl(bindParameters->setIPHdrIncl);
+	SetReusePort(bindParameters->reusePort);
 
 	// Fill in the rest of the address structure
 	boundAddress.address.addr4.sin_family = AF_INET;
@@ -301,6 +392,8 @@ RNS2BindResult RNS2_Berkley::BindSharedIPV4And6( RNS2_BerkleyBindParameters *bin
 		if (rns2Socket == -1)
 			return BR_FAILED_TO_BIND_SOCKET;
 
+		// Must be set before bind
+		SetReusePort(bindParameters->reusePort);
 
 
 
@@ -359,7 +452,6 @@ void RNS2_Berkley::RecvFromBlockingIPV4And6(RNS2RecvStruct *recvFromStruct)
 	socklen_t* socketlenPtr=(socklen_t*) &sockLen;
 	memset(&their_addr,0,sizeof(their_addr));
 	int dataOutSize;
-	const int flag=0;
 
 
 
@@ -382,7 +474,7 @@ void RNS2_Berkley::RecvFromBlockingIPV4And6(RNS2RecvStruct *recvFromStruct)
 	dataOutSize=MAXIMUM_MTU_SIZE;
 
 
-	recvFromStruct->bytesRead = recvfrom__(rns2Socket, recvFromStruct->data, dataOutSize, flag, sockAddrPtr, socketlenPtr );
+	recvFromStruct->bytesRead = RecvFromWithTime(rns2Socket, recvFromStruct->data, dataOutSize, sockAddrPtr, socketlenPtr, &recvFromStruct->timeRead );
 
 #if defined(_WIN32) && defined(_DEBUG) && !defined(WINDOWS_PHONE_8)
 	if (recvFromStruct->bytesRead==-1)
@@ -412,7 +504,6 @@ void RNS2_Berkley::RecvFromBlockingIPV4And6(RNS2RecvStruct *recvFromStruct)
 
 	if (recvFromStruct->bytesRead<=0)
 		return;
-	recvFromStruct->timeRead=RakNet::GetTimeUS();
 
 
 
@@ -450,7 +541,6 @@ void RNS2_Berkley::RecvFromBlockingIPV4(RNS2RecvStruct *recvFromStruct)
 	socklen_t* socketlenPtr=(socklen_t*) &sockLen;
 	sockaddr_in sa;
 	memset(&sa,0,sizeof(sockaddr_in));
-	const int flag=0;
 	
 	
 
@@ -479,7 +569,7 @@ void RNS2_Berkley::RecvFromBlockingIPV4(RNS2RecvStruct *recvFromStruct)
 		sockAddrPtr=(sockaddr*) &sa;
 	}
 
-	recvFromStruct->bytesRead = recvfrom__( GetSocket(), recvFromStruct->data, sizeof(recvFromStruct->data), flag, sockAddrPtr, socketlenPtr );
+	recvFromStruct->bytesRead = RecvFromWithTime( GetSocket(), recvFromStruct->data, sizeof(recvFromStruct->data), sockAddrPtr, socketlenPtr, &recvFromStruct->timeRead );
 
 
 
@@ -519,7 +609,6 @@ void RNS2_Berkley::RecvFromBlockingIPV4(RNS2RecvStruct *recvFromStruct)
 
 		return;
 	}
-	recvFromStruct->timeRead=RakNet::GetTimeUS();
 
 
 
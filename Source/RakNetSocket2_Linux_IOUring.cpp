@@ -0,0 +1,504 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "EmptyHeader.h"
+
+#ifdef RAKNET_SOCKET_2_INLINE_FUNCTIONS
+
+#ifndef RAKNETSOCKET2_LINUX_IOURING_CPP
+#define RAKNETSOCKET2_LINUX_IOURING_CPP
+
+#if !defined(_WIN32) && !defined(__native_client__) && !defined(WINDOWS_STORE_RT) && RAKNET_SUPPORT_IO_URING==1
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// Number of datagrams the kernel can have queued for the receive thread without a new buffer being provided. Must be a power of 2
+static const unsigned int IOURING_RECV_BUFFER_COUNT=256;
+// Room for SCM_TIMESTAMPNS
+#if defined(RNS2_KERNEL_RECEIVE_TIMESTAMPS)
+static const unsigned int IOURING_RECV_CONTROL_SIZE=CMSG_SPACE(sizeof(struct timespec));
+#else
+static const unsigned int IOURING_RECV_CONTROL_SIZE=0;
+#endif
+static const unsigned int IOURING_RECV_BUFFER_SIZE=MAXIMUM_MTU_SIZE+sizeof(io_uring_recvmsg_out)+sizeof(sockaddr_in6)+IOURING_RECV_CONTROL_SIZE;
+static const unsigned short IOURING_RECV_BUFFER_GROUP=0;
+// Number of sends in flight before Send() waits for a completion
+static const unsigned int IOURING_SEND_SLOT_COUNT=256;
+// How long the kernel submission thread spins after the last send before sleeping
+static const unsigned int IOURING_SQPOLL_IDLE_MS=50;
+static const unsigned long long IOURING_RECV_USER_DATA=0xFFFFFFFFFFFFFFFFULL;
+// Posted from the send ring to the receive ring to end the wait of the receive thread
+static const unsigned long long IOURING_WAKE_USER_DATA=0xFFFFFFFFFFFFFFFEULL;
+
+namespace RakNet
+{
+
+struct RNS2_IOUringRing
+{
+	int fd;
+	unsigned int flags;
+	void *sqRingPtr, *cqRingPtr;
+	size_t sqRingSize, cqRingSize;
+	io_uring_sqe *sqes;
+	size_t sqesSize;
+	unsigned *sqHead, *sqTail, *sqMask, *sqFlags;
+	unsigned *cqHead, *cqTail, *cqMask;
+	io_uring_cqe *cqes;
+};
+
+struct RNS2_IOUringRecvBuffers
+{
+	io_uring_buf *bufRing;
+	unsigned short *bufRingTail;
+	size_t bufRingSize;
+	char *data;
+	msghdr msg;
+};
+
+// Not registered with IORING_REGISTER_BUFFERS. Fixed reads and writes carry no address, which an unbound UDP socket needs,
+// and a plain send rejects registered buffers with EINVAL. Only a zero copy send takes them, which costs two completions per datagram and was no faster for datagrams of MTU size.
+struct RNS2_IOUringSendSlot
+{
+	msghdr msg;
+	iovec iov;
+	sockaddr_storage address;
+	char data[MAXIMUM_MTU_SIZE];
+};
+
+static int IOUringEnter(int fd, unsigned int toSubmit, unsigned int minComplete, unsigned int flags)
+{
+	return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static void IOUringFreeRing(RNS2_IOUringRing *ring)
+{
+	if (ring->sqes!=MAP_FAILED)
+		munmap(ring->sqes, ring->sqesSize);
+	if (ring->cqRingPtr!=MAP_FAILED && ring->cqRingPtr!=ring->sqRingPtr)
+		munmap(ring->cqRingPtr, ring->cqRingSize);
+	if (ring->sqRingPtr!=MAP_FAILED)
+		munmap(ring->sqRingPtr, ring->sqRingSize);
+	if (ring->fd>=0)
+		close(ring->fd);
+	RakNet::OP_DELETE(ring, _FILE_AND_LINE_);
+}
+
+static RNS2_IOUringRing* IOUringCreateRing(unsigned int entries, io_uring_params *p)
+{
+	int fd = (int) syscall(__NR_io_uring_setup, entries, p);
+	if (fd<0)
+		return 0;
+
+	RNS2_IOUringRing *ring = RakNet::OP_NEW<RNS2_IOUringRing>(_FILE_AND_LINE_);
+	ring->fd=fd;
+	ring->flags=p->flags;
+	ring->sqRingPtr=MAP_FAILED;
+	ring->cqRingPtr=MAP_FAILED;
+	ring->sqes=(io_uring_sqe*) MAP_FAILED;
+	ring->sqRingSize=p->sq_off.array+p->sq_entries*sizeof(unsigned);
+	ring->cqRingSize=p->cq_off.cqes+p->cq_entries*sizeof(io_uring_cqe);
+	ring->sqesSize=p->sq_entries*sizeof(io_uring_sqe);
+
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (ring->cqRingSize>ring->sqRingSize)
+			ring->sqRingSize=ring->cqRingSize;
+		ring->cqRingSize=ring->sqRingSize;
+	}
+	ring->sqRingPtr=mmap(0, ring->sqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (ring->sqRingPtr==MAP_FAILED)
+	{
+		IOUringFreeRing(ring);
+		return 0;
+	}
+	if (p->features & IORING_FEAT_SINGLE_MMAP)
+		ring->cqRingPtr=ring->sqRingPtr;
+	else
+	{
+		ring->cqRingPtr=mmap(0, ring->cqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (ring->cqRingPtr==MAP_FAILED)
+		{
+			IOUringFreeRing(ring);
+			return 0;
+		}
+	}
+	ring->sqes=(io_uring_sqe*) mmap(0, ring->sqesSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (ring->sqes==MAP_FAILED)
+	{
+		IOUringFreeRing(ring);
+		return 0;
+	}
+
+	char *sq=(char*) ring->sqRingPtr;
+	char *cq=(char*) ring->cqRingPtr;
+	ring->sqHead=(unsigned*) (sq+p->sq_off.head);
+	ring->sqTail=(unsigned*) (sq+p->sq_off.tail);
+	ring->sqMask=(unsigned*) (sq+p->sq_off.ring_mask);
+	ring->sqFlags=(unsigned*) (sq+p->sq_off.flags);
+	ring->cqHead=(unsigned*) (cq+p->cq_off.head);
+	ring->cqTail=(unsigned*) (cq+p->cq_off.tail);
+	ring->cqMask=(unsigned*) (cq+p->cq_off.ring_mask);
+	ring->cqes=(io_uring_cqe*) (cq+p->cq_off.cqes);
+
+	// Submission queue entries are always used in order, so the indirection array is the identity
+	unsigned *sqArray=(unsigned*) (sq+p->sq_off.array);
+	for (unsigned int i=0; i < p->sq_entries; i++)
+		sqArray[i]=i;
+	return ring;
+}
+
+// Returns 0 if the submission queue is full
+static io_uring_sqe* IOUringGetSQE(RNS2_IOUringRing *ring)
+{
+	unsigned head=__atomic_load_n(ring->sqHead, __ATOMIC_ACQUIRE);
+	unsigned tail=*ring->sqTail;
+	if (tail-head > *ring->sqMask)
+		return 0;
+	io_uring_sqe *sqe=&ring->sqes[tail & *ring->sqMask];
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	return sqe;
+}
+
+// Publishes the entry returned by IOUringGetSQE and, unless the kernel is polling the queue, submits it
+static void IOUringSubmit(RNS2_IOUringRing *ring)
+{
+	__atomic_store_n(ring->sqTail, *ring->sqTail+1, __ATOMIC_RELEASE);
+	if (ring->flags & IORING_SETUP_SQPOLL)
+	{
+		// Pairs with the kernel setting IORING_SQ_NEED_WAKEUP before its thread sleeps
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(ring->sqFlags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+			IOUringEnter(ring->fd, 0, 0, IORING_ENTER_SQ_WAKEUP);
+	}
+	else
+		IOUringEnter(ring->fd, 1, 0, 0);
+}
+
+RNS2_Linux_IOUring::RNS2_Linux_IOUring()
+{
+	sendRing=0;
+	recvRing=0;
+	recvBuffers=0;
+	sendSlots=0;
+}
+RNS2_Linux_IOUring::~RNS2_Linux_IOUring()
+{
+	FreeRings();
+}
+bool RNS2_Linux_IOUring::IsUsingIOUring(void) const
+{
+	return sendRing!=0;
+}
+RNS2BindResult RNS2_Linux_IOUring::Bind( RNS2_BerkleyBindParameters *bindParameters, const char *file, unsigned int line )
+{
+	RNS2BindResult br = BindShared(bindParameters, file, line);
+	if (br==BR_SUCCESS && InitRings()==false)
+	{
+		// Kernel too old or io_uring disabled. Keep working as a regular socket.
+		FreeRings();
+	}
+	return br;
+}
+bool RNS2_Linux_IOUring::InitRings(void)
+{
+	io_uring_params p;
+
+	// Send ring. Try to have the kernel poll the submission queue so that sending does not need a system call.
+	// The polling thread spins, so on a single core it only takes time away from the application.
+	if (sysconf(_SC_NPROCESSORS_ONLN)>1)
+	{
+		memset(&p, 0, sizeof(p));
+		p.flags=IORING_SETUP_SQPOLL;
+		p.sq_thread_idle=IOURING_SQPOLL_IDLE_MS;
+		sendRing=IOUringCreateRing(IOURING_SEND_SLOT_COUNT, &p);
+	}
+	if (sendRing==0)
+	{
+		memset(&p, 0, sizeof(p));
+		sendRing=IOUringCreateRing(IOURING_SEND_SLOT_COUNT, &p);
+		if (sendRing==0)
+			return false;
+	}
+	sendSlots=RakNet::OP_NEW_ARRAY<RNS2_IOUringSendSlot>(IOURING_SEND_SLOT_COUNT, _FILE_AND_LINE_);
+	for (unsigned int i=0; i < IOURING_SEND_SLOT_COUNT; i++)
+		freeSendSlots.Push((unsigned short) i, _FILE_AND_LINE_);
+
+	// Receive ring. Completions, not submissions, are what accumulate, so make room for every buffer
+	memset(&p, 0, sizeof(p));
+	p.flags=IORING_SETUP_CQSIZE;
+	p.cq_entries=IOURING_RECV_BUFFER_COUNT*2;
+	recvRing=IOUringCreateRing(4, &p);
+	if (recvRing==0)
+		return false;
+
+	recvBuffers=RakNet::OP_NEW<RNS2_IOUringRecvBuffers>(_FILE_AND_LINE_);
+	recvBuffers->bufRingSize=IOURING_RECV_BUFFER_COUNT*sizeof(io_uring_buf);
+	recvBuffers->bufRing=(io_uring_buf*) mmap(0, recvBuffers->bufRingSize, PROT_READ|PROT_WRITE, MAP_ANONYMOUS|MAP_PRIVATE, -1, 0);
+	recvBuffers->data=(char*) rakMalloc_Ex(IOURING_RECV_BUFFER_COUNT*IOURING_RECV_BUFFER_SIZE, _FILE_AND_LINE_);
+	if (recvBuffers->bufRing==MAP_FAILED)
+	{
+		recvBuffers->bufRing=0;
+		return false;
+	}
+	// The ring tail overlays the reserved field of the first buffer
+	recvBuffers->bufRingTail=&((io_uring_buf_ring*) recvBuffers->bufRing)->tail;
+	*recvBuffers->bufRingTail=0;
+
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr=(unsigned long long) (size_t) recvBuffers->bufRing;
+	reg.ring_entries=IOURING_RECV_BUFFER_COUNT;
+	reg.bgid=IOURING_RECV_BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, recvRing->fd, IORING_REGISTER_PBUF_RING, &reg, 1)!=0)
+		return false;
+	for (unsigned short i=0; i < IOURING_RECV_BUFFER_COUNT; i++)
+		RecycleRecvBuffer(i);
+
+	// Only the sizes matter for a multishot recvmsg. The kernel lays out the header, address, control messages and payload in each buffer.
+	memset(&recvBuffers->msg, 0, sizeof(recvBuffers->msg));
+	recvBuffers->msg.msg_namelen=sizeof(sockaddr_in6);
+	recvBuffers->msg.msg_controllen=IOURING_RECV_CONTROL_SIZE;
+	return true;
+}
+void RNS2_Linux_IOUring::FreeRings(void)
+{
+	if (sendRing)
+	{
+		// Sends may still reference their slots
+		RakNet::TimeMS timeout = RakNet::GetTimeMS()+1000;
+		sendMutex.Lock();
+		while (freeSendSlots.Size()<IOURING_SEND_SLOT_COUNT && RakNet::GetTimeMS()<timeout)
+			ReapSendCompletions(true);
+		sendMutex.Unlock();
+		IOUringFreeRing(sendRing);
+		sendRing=0;
+	}
+	if (recvRing)
+	{
+		IOUringFreeRing(recvRing);
+		recvRing=0;
+	}
+	if (sendSlots)
+	{
+		RakNet::OP_DELETE_ARRAY(sendSlots, _FILE_AND_LINE_);
+		sendSlots=0;
+	}
+	freeSendSlots.Clear(_FILE_AND_LINE_);
+	if (recvBuffers)
+	{
+		if (recvBuffers->bufRing)
+			munmap(recvBuffers->bufRing, recvBuffers->bufRingSize);
+		rakFree_Ex(recvBuffers->data, _FILE_AND_LINE_);
+		RakNet::OP_DELETE(recvBuffers, _FILE_AND_LINE_);
+		recvBuffers=0;
+	}
+}
+void RNS2_Linux_IOUring::RecycleRecvBuffer(unsigned short bufferId)
+{
+	unsigned short tail=*recvBuffers->bufRingTail;
+	io_uring_buf *buf=&recvBuffers->bufRing[tail & (IOURING_RECV_BUFFER_COUNT-1)];
+	buf->addr=(unsigned long long) (size_t) (recvBuffers->data+bufferId*IOURING_RECV_BUFFER_SIZE);
+	buf->len=IOURING_RECV_BUFFER_SIZE;
+	buf->bid=bufferId;
+	__atomic_store_n(recvBuffers->bufRingTail, (unsigned short) (tail+1), __ATOMIC_RELEASE);
+}
+bool RNS2_Linux_IOUring::SubmitMultishotRecv(void)
+{
+	io_uring_sqe *sqe=IOUringGetSQE(recvRing);
+	if (sqe==0)
+		return false;
+	sqe->opcode=IORING_OP_RECVMSG;
+	sqe->fd=rns2Socket;
+	sqe->addr=(unsigned long long) (size_t) &recvBuffers->msg;
+	sqe->len=1;
+	sqe->ioprio=IORING_RECV_MULTISHOT;
+	sqe->flags=IOSQE_BUFFER_SELECT;
+	sqe->buf_group=IOURING_RECV_BUFFER_GROUP;
+	sqe->user_data=IOURING_RECV_USER_DATA;
+	IOUringSubmit(recvRing);
+	return true;
+}
+unsigned RNS2_Linux_IOUring::RecvFromLoopInt(void)
+{
+	if (recvRing==0)
+		return RNS2_Berkley::RecvFromLoopInt();
+
+	isRecvFromLoopThreadActive.Increment();
+
+	SubmitMultishotRecv();
+	while ( endThreads == false )
+	{
+		unsigned head=*recvRing->cqHead;
+		unsigned tail=__atomic_load_n(recvRing->cqTail, __ATOMIC_ACQUIRE);
+		if (head==tail)
+		{
+			// BlockOnStopRecvPollingThread() sends a datagram to this socket, which ends the wait
+			IOUringEnter(recvRing->fd, 0, 1, IORING_ENTER_GETEVENTS);
+			continue;
+		}
+
+		bool resubmit=false;
+		for (; head!=tail; head++)
+		{
+			io_uring_cqe *cqe=&recvRing->cqes[head & *recvRing->cqMask];
+			if (cqe->user_data==IOURING_RECV_USER_DATA && (cqe->flags & IORING_CQE_F_MORE)==0)
+				resubmit=true;
+			if ((cqe->flags & IORING_CQE_F_BUFFER)==0)
+				continue;
+
+			unsigned short bufferId=(unsigned short) (cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+			char *buffer=recvBuffers->data+bufferId*IOURING_RECV_BUFFER_SIZE;
+			io_uring_recvmsg_out *out=(io_uring_recvmsg_out*) buffer;
+			if (cqe->res>0 && (out->flags & MSG_TRUNC)==0 && out->payloadlen>0 && out->payloadlen<=MAXIMUM_MTU_SIZE)
+			{
+				RNS2RecvStruct *recvFromStruct=binding.eventHandler->AllocRNS2RecvStruct(_FILE_AND_LINE_);
+				if (recvFromStruct != NULL)
+				{
+					sockaddr *name=(sockaddr*) (buffer+sizeof(io_uring_recvmsg_out));
+					recvFromStruct->socket=this;
+					recvFromStruct->bytesRead=out->payloadlen;
+#if defined(RNS2_KERNEL_RECEIVE_TIMESTAMPS)
+					struct msghdr control;
+					memset(&control, 0, sizeof(control));
+					control.msg_control=buffer+sizeof(io_uring_recvmsg_out)+recvBuffers->msg.msg_namelen;
+					control.msg_controllen=out->controllen;
+					recvFromStruct->timeRead=GetKernelReceiveTime(&control);
+#else
+					recvFromStruct->timeRead=RakNet::GetTimeUS();
+#endif
+					memcpy(recvFromStruct->data, buffer+sizeof(io_uring_recvmsg_out)+recvBuffers->msg.msg_namelen+recvBuffers->msg.msg_controllen, out->payloadlen);
+					if (name->sa_family==AF_INET)
+					{
+						memcpy(&recvFromStruct->systemAddress.address.addr4,name,sizeof(sockaddr_in));
+						recvFromStruct->systemAddress.debugPort=ntohs(recvFromStruct->systemAddress.address.addr4.sin_port);
+					}
+#if RAKNET_SUPPORT_IPV6==1
+					else
+					{
+						memcpy(&recvFromStruct->systemAddress.address.addr6,name,sizeof(sockaddr_in6));
+						recvFromStruct->systemAddress.debugPort=ntohs(recvFromStruct->systemAddress.address.addr6.sin6_port);
+					}
+#endif
+					RakAssert(recvFromStruct->systemAddress.GetPort());
+					binding.eventHandler->OnRNS2Recv(recvFromStruct);
+				}
+			}
+			RecycleRecvBuffer(bufferId);
+		}
+		__atomic_store_n(recvRing->cqHead, head, __ATOMIC_RELEASE);
+
+		// The kernel ends a multishot receive when it runs out of buffers or on error
+		if (resubmit && endThreads==false)
+			SubmitMultishotRecv();
+	}
+	isRecvFromLoopThreadActive.Decrement();
+	return 0;
+}
+void RNS2_Linux_IOUring::ReapSendCompletions(bool wait)
+{
+	unsigned head=*sendRing->cqHead;
+	unsigned tail=__atomic_load_n(sendRing->cqTail, __ATOMIC_ACQUIRE);
+	if (head==tail && wait)
+	{
+		IOUringEnter(sendRing->fd, 0, 1, IORING_ENTER_GETEVENTS);
+		tail=__atomic_load_n(sendRing->cqTail, __ATOMIC_ACQUIRE);
+	}
+	for (; head!=tail; head++)
+	{
+		io_uring_cqe *cqe=&sendRing->cqes[head & *sendRing->cqMask];
+		if (cqe->res<0)
+		{
+			RAKNET_DEBUG_PRINTF("io_uring sendmsg failed with code %i.\n", cqe->res);
+		}
+		if (cqe->user_data<IOURING_SEND_SLOT_COUNT)
+			freeSendSlots.Push((unsigned short) cqe->user_data, _FILE_AND_LINE_);
+	}
+	__atomic_store_n(sendRing->cqHead, head, __ATOMIC_RELEASE);
+}
+void RNS2_Linux_IOUring::BlockOnStopRecvPollingThread(void)
+{
+	endThreads=true;
+
+	// A datagram sent to a SO_REUSEPORT group may go to another socket, and shutdown() does not complete a pending io_uring receive.
+	// Post a completion directly to the receive ring instead.
+	if (recvRing)
+	{
+		sendMutex.Lock();
+		io_uring_sqe *sqe=IOUringGetSQE(sendRing);
+		if (sqe)
+		{
+			sqe->opcode=IORING_OP_MSG_RING;
+			sqe->fd=recvRing->fd;
+			sqe->off=IOURING_WAKE_USER_DATA;
+			sqe->user_data=IOURING_WAKE_USER_DATA;
+			IOUringSubmit(sendRing);
+		}
+		sendMutex.Unlock();
+	}
+
+	RNS2_Linux::BlockOnStopRecvPollingThread();
+}
+RNS2SendResult RNS2_Linux_IOUring::Send( RNS2_SendParameters *sendParameters, const char *file, unsigned int line )
+{
+	// TTL is a socket option, so it cannot be changed for a queued send
+	if (sendRing==0 || sendParameters->ttl>0 || sendParameters->length<=0 || sendParameters->length>MAXIMUM_MTU_SIZE)
+		return RNS2_Linux::Send(sendParameters, file, line);
+
+	sendMutex.Lock();
+	ReapSendCompletions(false);
+	while (freeSendSlots.Size()==0)
+		ReapSendCompletions(true);
+	io_uring_sqe *sqe=IOUringGetSQE(sendRing);
+	if (sqe==0)
+	{
+		// Only possible if the kernel thread has not yet consumed earlier entries
+		sendMutex.Unlock();
+		return RNS2_Linux::Send(sendParameters, file, line);
+	}
+	unsigned short slotIndex=freeSendSlots.Pop();
+	RNS2_IOUringSendSlot *slot=&sendSlots[slotIndex];
+	memcpy(slot->data, sendParameters->data, sendParameters->length);
+	slot->iov.iov_base=slot->data;
+	slot->iov.iov_len=sendParameters->length;
+	memset(&slot->msg, 0, sizeof(slot->msg));
+	slot->msg.msg_iov=&slot->iov;
+	slot->msg.msg_iovlen=1;
+	slot->msg.msg_name=&slot->address;
+	if (sendParameters->systemAddress.address.addr4.sin_family==AF_INET)
+	{
+		memcpy(&slot->address, &sendParameters->systemAddress.address.addr4, sizeof(sockaddr_in));
+		slot->msg.msg_namelen=sizeof(sockaddr_in);
+	}
+	else
+	{
+#if RAKNET_SUPPORT_IPV6==1
+		memcpy(&slot->address, &sendParameters->systemAddress.address.addr6, sizeof(sockaddr_in6));
+		slot->msg.msg_namelen=sizeof(sockaddr_in6);
+#endif
+	}
+	sqe->opcode=IORING_OP_SENDMSG;
+	sqe->fd=rns2Socket;
+	sqe->addr=(unsigned long long) (size_t) &slot->msg;
+	sqe->len=1;
+	sqe->user_data=slotIndex;
+	IOUringSubmit(sendRing);
+	sendMutex.Unlock();
+	return sendParameters->length;
+}
+
+} // namespace RakNet
+
+#endif // Linux && RAKNET_SUPPORT_IO_URING
+
+#endif // file header
+
+#endif // #ifdef RAKNET_SOCKET_2_INLINE_FUNCTIONS
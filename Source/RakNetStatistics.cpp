@@ -52,6 +52,8 @@ void RAK_DLL_EXPORT RakNet::StatisticsToString( RakNetStatistics *s, char *buffe
 			"Total message bytes pushed         %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Current packetloss                 %.1f%%\n"
 			"Average packetloss                 %.1f%%\n"
+			"MTU size                           %i\n"
+			"Discovered MTU size                %i\n"
 			"Elapsed connection time in seconds %" PRINTF_64_BIT_MODIFIER "u\n",
 			(long long unsigned int) s->valueOverLastSecond[ACTUAL_BYTES_SENT],
 			(long long unsigned int) s->valueOverLastSecond[ACTUAL_BYTES_RECEIVED],
@@ -61,6 +63,8 @@ void RAK_DLL_EXPORT RakNet::StatisticsToString( RakNetStatistics *s, char *buffe
 			(long long unsigned int) s->runningTotal[USER_MESSAGE_BYTES_PUSHED],
 			s->packetlossLastSecond*100.0f,
 			s->packetlossTotal*100.0f,
+			s->MTUSize,
+			s->discoveredMTUSize,
 			(long long unsigned int) (uint64_t)((RakNet::GetTimeUS()-s->connectionStartTime)/1000000)
 			);
 
@@ -95,6 +99,7 @@ void RAK_DLL_EXPORT RakNet::StatisticsToString( RakNetStatistics *s, char *buffe
 			"Message bytes per second pushed      %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Message bytes per second returned	  %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Message bytes per second ignored     %" PRINTF_64_BIT_MODIFIER "u\n"
+			"Message bytes per second discarded   %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Total bytes sent                     %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Total bytes received                 %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Total message bytes sent             %" PRINTF_64_BIT_MODIFIER "u\n"
@@ -102,12 +107,15 @@ void RAK_DLL_EXPORT RakNet::StatisticsToString( RakNetStatistics *s, char *buffe
 			"Total message bytes pushed           %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Total message bytes returned		  %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Total message bytes ignored          %" PRINTF_64_BIT_MODIFIER "u\n"
+			"Total message bytes discarded        %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Messages in send buffer, by priority %i,%i,%i,%i\n"
 			"Bytes in send buffer, by priority    %i,%i,%i,%i\n"
 			"Messages in resend buffer            %i\n"
 			"Bytes in resend buffer               %" PRINTF_64_BIT_MODIFIER "u\n"
 			"Current packetloss                   %.1f%%\n"
 			"Average packetloss                   %.1f%%\n"
+			"MTU size                             %i\n"
+			"Discovered MTU size                  %i\n"
 			"Elapsed connection time in seconds   %" PRINTF_64_BIT_MODIFIER "u\n",
 			(long long unsigned int) s->valueOverLastSecond[ACTUAL_BYTES_SENT],
 			(long long unsigned int) s->valueOverLastSecond[ACTUAL_BYTES_RECEIVED],
@@ -116,6 +124,7 @@ void RAK_DLL_EXPORT RakNet::StatisticsToString( RakNetStatistics *s, char *buffe
 			(long long unsigned int) s->valueOverLastSecond[USER_MESSAGE_BYTES_PUSHED],
 			(long long unsigned int) s->valueOverLastSecond[USER_MESSAGE_BYTES_RECEIVED_PROCESSED],
 			(long long unsigned int) s->valueOverLastSecond[USER_MESSAGE_BYTES_RECEIVED_IGNORED],
+			(long long unsigned int) s->valueOverLastSecond[USER_MESSAGE_BYTES_DISCARDED],
 			(long long unsigned int) s->runningTotal[ACTUAL_BYTES_SENT],
 			(long long unsigned int) s->runningTotal[ACTUAL_BYTES_RECEIVED],
 			(long long unsigned int) s->runningTotal[USER_MESSAGE_BYTES_SENT],
@@ -123,12 +132,15 @@ void RAK_DLL_EXPORT RakNet::StatisticsToString( RakNetStatistics *s, char *buffe
 			(long long unsigned int) s->runningTotal[USER_MESSAGE_BYTES_PUSHED],
 			(long long unsigned int) s->runningTotal[USER_MESSAGE_BYTES_RECEIVED_PROCESSED],
 			(long long unsigned int) s->runningTotal[USER_MESSAGE_BYTES_RECEIVED_IGNORED],
+			(long long unsigned int) s->runningTotal[USER_MESSAGE_BYTES_DISCARDED],
 			s->messageInSendBuffer[IMMEDIATE_PRIORITY],s->messageInSendBuffer[HIGH_PRIORITY],s->messageInSendBuffer[MEDIUM_PRIORITY],s->messageInSendBuffer[LOW_PRIORITY],
 			(unsigned int) s->bytesInSendBuffer[IMMEDIATE_PRIORITY],(unsigned int) s->bytesInSendBuffer[HIGH_PRIORITY],(unsigned int) s->bytesInSendBuffer[MEDIUM_PRIORITY],(unsigned int) s->bytesInSendBuffer[LOW_PRIORITY],
 			s->messagesInResendBuffer,
 			(long long unsigned int) s->bytesInResendBuffer,
 			s->packetlossLastSecond*100.0f,
 			s->packetlossTotal*100.0f,
+			s->MTUSize,
+			s->discoveredMTUSize,
 			(long long unsigned int) (uint64_t)((RakNet::GetTimeUS()-s->connectionStartTime)/1000000)
 			);
 
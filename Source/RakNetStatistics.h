@@ -48,6 +48,9 @@ enum RNSPerSecondMetrics
 	/// How many actual bytes were received, including overead and acks.
 	ACTUAL_BYTES_RECEIVED,
 
+	/// How many user message bytes were pushed, but discarded without being sent. This happens to unreliable messages that pass their send deadline or the unreliable timeout.
+	USER_MESSAGE_BYTES_DISCARDED,
+
 	/// \internal
 	RNS_PER_SECOND_METRICS_COUNT
 };
@@ -99,6 +102,12 @@ struct RAK_DLL_EXPORT RakNetStatistics
 	/// What is the average total packetloss over the lifetime of the connection?
 	float packetlossTotal;
 
+	/// Datagram size currently used for this connection, including the UDP header. Starts at the size found in the connection handshake and changes with path MTU discovery.
+	int MTUSize;
+
+	/// Largest datagram size confirmed by a path MTU discovery probe, or 0 if no probe has been acknowledged yet.
+	int discoveredMTUSize;
+
 	RakNetStatistics& operator +=(const RakNetStatistics& other)
 	{
 		unsigned i;
@@ -91,6 +91,8 @@ enum ConnectionState
 /// \sa NetworkIDObject.h
 typedef unsigned char UniqueIDType;
 typedef unsigned short SystemIndex;
+/// Ordering channel used with sequenced and ordered sends. See NUMBER_OF_ORDERED_STREAMS for the valid range
+typedef unsigned short OrderingChannelType;
 typedef unsigned char RPCIndex;
 const int MAX_RPC_MAP_SIZE=((RPCIndex)-1)-1;
 const int UNDEFINED_RPC_INDEX=((RPCIndex)-1);
@@ -182,6 +184,24 @@ struct RAK_DLL_EXPORT SocketDescriptor
 
 	/// XBOX only: set IPPROTO_VDP if you want to use VDP. If enabled, this socket does not support broadcast to 255.255.255.255
 	unsigned int extraSocketOptions;
+
+	/// Linux only: bind with SO_REUSEPORT, so other sockets (in this or another RakPeer instance) can bind the same port.
+	/// The kernel hashes each remote address to one socket in the group, so a remote system always arrives on the same socket.
+	/// To spread connections over several update threads, start one RakPeer per thread with the same port and reusePort set.
+	bool reusePort;
+
+	/// Linux only: number of sockets to open on this port, each with its own receive thread. Values above 1 imply \a reusePort.
+	/// Defaults to 1. Additional sockets share the connection socket index of this descriptor.
+	unsigned short reusePortSocketCount;
+
+	/// Linux only: send and receive through io_uring instead of sendto and a blocking recvfrom. Defaults to false.
+	/// \pre RAKNET_SUPPORT_IO_URING must be set to 1 in RakNetDefines.h. Otherwise, or if the kernel does not support it, regular sockets are used.
+	bool useIOUring;
+
+	/// Linux only: attach a socket filter so the kernel drops datagrams that cannot be RakNet datagrams, instead of waking up the receive thread for them.
+	/// Offline messages must have a known identifier, their minimum length and OFFLINE_MESSAGE_DATA_ID. Other datagrams must be from the reliability layer.
+	/// Defaults to false. Do not set this if SetIncomingDatagramEventHandler() is used to receive other protocols on this socket.
+	bool attachPacketFilter;
 };
 
 extern bool NonNumericHostString( const char *host );
@@ -463,6 +483,12 @@ const NetworkID UNASSIGNED_NETWORK_ID = (uint64_t) -1;
 
 const int PING_TIMES_ARRAY_SIZE = 5;
 
+/// Size of the key used to authenticate ID_CONNECTION_MIGRATION
+const int CONNECTION_MIGRATION_KEY_LENGTH = 16;
+
+/// Size of the secret used to generate handshake cookies
+const int HANDSHAKE_COOKIE_KEY_LENGTH = 16;
+
 struct RAK_DLL_EXPORT uint24_t
 {
 	uint32_t val;
@@ -25,6 +25,21 @@
 #include <unistd.h>
 #endif
 
+#if defined(__linux__) && !defined(__native_client__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <errno.h>
+#include <linux/filter.h>
+#define RAKPEER_SUPPORTS_EPOLL
+// Event data for the epoll loop is the index into socketList, or one of these
+static const uint64_t EPOLL_TIMER_EVENT=(uint64_t)-1;
+static const uint64_t EPOLL_WAKEUP_EVENT=(uint64_t)-2;
+#if defined(SO_ATTACH_FILTER)
+#define RAKPEER_SUPPORTS_PACKET_FILTER
+#endif
+#endif
+
 // #if defined(new)
 // #pragma push_macro("new")
 // #undef new
@@ -39,6 +54,7 @@
 #include "DS_HuffmanEncodingTree.h"
 #include "Rand.h"
 #include "PluginInterface2.h"
+#include "BitStreamChain.h"
 #include "StringCompressor.h"
 #include "StringTable.h"
 #include "NetworkIDObject.h"
@@ -53,6 +69,7 @@
 #include "SuperFastHash.h"
 #include "RakAlloca.h"
 #include "WSAStartupSingleton.h"
+#include "RakPeerGroup.h"
 
 #ifdef USE_THREADED_SEND
 #include "SendToThread.h"
@@ -124,6 +141,12 @@ struct RakPeerAndIndex
 };
 */
 
+// How long a connection we initiated must go without hearing from the remote system, while we wait for acks, before we send ID_CONNECTION_MIGRATION. Also the minimum time between those sends
+static const RakNet::TimeMS CONNECTION_MIGRATION_REQUEST_INTERVAL_MS=1000;
+
+// Handshake cookies are valid for between one and two of these intervals
+static const RakNet::TimeMS HANDSHAKE_COOKIE_INTERVAL_MS=5000;
+
 static const unsigned int MAX_OFFLINE_DATA_LENGTH=400; // I set this because I limit ID_CONNECTION_REQUEST to 512 bytes, and the password is appended to that packet.
 
 // Used to distinguish between offline messages with data, and messages from the reliability layer
@@ -134,6 +157,141 @@ static const unsigned int MAX_OFFLINE_DATA_LENGTH=400; // I set this because I l
 // Make sure highest bit is 0, so isValid in DatagramHeaderFormat is false
 static const unsigned char OFFLINE_MESSAGE_DATA_ID[16]={0x00,0xFF,0xFF,0x00,0xFE,0xFE,0xFE,0xFE,0xFD,0xFD,0xFD,0xFD,0x12,0x34,0x56,0x78};
 
+// Layout of each offline message. Used to classify datagrams in ProcessNetworkPacket, and to build the socket filter
+struct OfflineMessageFormat
+{
+	MessageID messageId;
+	// Minimum length, or the only length if exactLength is true
+	unsigned int length;
+	bool exactLength;
+	// Where OFFLINE_MESSAGE_DATA_ID starts
+	unsigned int offlineDataIdOffset;
+};
+static const OfflineMessageFormat offlineMessageFormats[]=
+{
+	{ID_UNCONNECTED_PING, sizeof(MessageID)+sizeof(RakNet::Time)+sizeof(OFFLINE_MESSAGE_DATA_ID), false, sizeof(MessageID)+sizeof(RakNet::Time)},
+	{ID_UNCONNECTED_PING_OPEN_CONNECTIONS, sizeof(MessageID)+sizeof(RakNet::Time)+sizeof(OFFLINE_MESSAGE_DATA_ID), false, sizeof(MessageID)+sizeof(RakNet::Time)},
+	{ID_UNCONNECTED_PONG, (unsigned int) (sizeof(MessageID)+sizeof(RakNet::TimeMS)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, (unsigned int) (sizeof(MessageID)+sizeof(RakNet::Time)+RakNetGUID::size())},
+	{ID_OUT_OF_BAND_INTERNAL, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, (unsigned int) (sizeof(MessageID)+RakNetGUID::size())},
+	{ID_OPEN_CONNECTION_REPLY_1, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_OPEN_CONNECTION_REPLY_2, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_OPEN_CONNECTION_REQUEST_1, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_OPEN_CONNECTION_REQUEST_2, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_CONNECTION_ATTEMPT_FAILED, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_NO_FREE_INCOMING_CONNECTIONS, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_CONNECTION_BANNED, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_ALREADY_CONNECTED, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_IP_RECENTLY_CONNECTED, (unsigned int) (sizeof(MessageID)+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), false, sizeof(MessageID)},
+	{ID_CONNECTION_MIGRATION, (unsigned int) (sizeof(MessageID)+sizeof(OFFLINE_MESSAGE_DATA_ID)+RakNetGUID::size()+sizeof(uint32_t)+SHA1_LENGTH), true, sizeof(MessageID)},
+	{ID_INCOMPATIBLE_PROTOCOL_VERSION, (unsigned int) (sizeof(MessageID)*2+RakNetGUID::size()+sizeof(OFFLINE_MESSAGE_DATA_ID)), true, sizeof(MessageID)*2},
+};
+
+// offlineMessageFormats indexed by the first byte of a datagram, or 0 if that byte never starts an offline message
+struct OfflineMessageFormatLookup
+{
+	OfflineMessageFormatLookup()
+	{
+		memset(formats, 0, sizeof(formats));
+		for (unsigned int i=0; i < sizeof(offlineMessageFormats)/sizeof(offlineMessageFormats[0]); i++)
+			formats[offlineMessageFormats[i].messageId]=&offlineMessageFormats[i];
+	}
+	const OfflineMessageFormat *formats[256];
+};
+static const OfflineMessageFormatLookup offlineMessageFormatLookup;
+
+// The reason for all this is that the reliability layer has no way to tell between offline messages that arrived late for a player that is now connected,
+// and a regular encoding. So I insert OFFLINE_MESSAGE_DATA_ID into the stream, the encoding of which is essentially impossible to hit by chance
+static inline bool IsOfflineMessage( const char *data, const int length )
+{
+	// Too short to be anything, so ignored as an offline message
+	if (length <= 2)
+		return true;
+
+	// Reliability layer datagrams have the high bit set, so they stop here
+	const OfflineMessageFormat *format = offlineMessageFormatLookup.formats[(unsigned char) data[0]];
+	if (format==0)
+		return false;
+	if (format->exactLength ? (size_t) length != format->length : (size_t) length < format->length)
+		return false;
+	if ((size_t) length < format->offlineDataIdOffset + sizeof(OFFLINE_MESSAGE_DATA_ID))
+		return false;
+	return memcmp(data+format->offlineDataIdOffset, OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID))==0;
+}
+
+#if defined(RAKPEER_SUPPORTS_PACKET_FILTER)
+// A socket filter on a UDP socket sees the UDP header before the datagram
+static const unsigned int PACKET_FILTER_UDP_HEADER_LENGTH=8;
+static const unsigned int PACKET_FILTER_MAX_LENGTH=128;
+
+// Offset from the instruction after \a from to \a to, as a conditional jump stores it
+static inline __u8 PacketFilterJumpOffset( unsigned short from, unsigned short to )
+{
+	RakAssert(to > from && to-(from+1) <= 255);
+	return (__u8) (to-(from+1));
+}
+
+// Writes a socket filter that passes the datagrams ProcessNetworkPacket could accept, and returns its length
+static unsigned short GenerateOfflinePacketFilter( struct sock_filter program[PACKET_FILTER_MAX_LENGTH] )
+{
+#if LIBCAT_SECURITY==1
+	// Connected datagrams are encrypted, so any first byte is possible. Only the length can be checked
+	const unsigned int formatCount=0;
+	const unsigned int unknownResult=0xFFFFFFFF;
+#else
+	const unsigned int formatCount=sizeof(offlineMessageFormats)/sizeof(offlineMessageFormats[0]);
+	const unsigned int unknownResult=0;
+#endif
+	// 4 instructions for the length and the isValid bit, 5 for each offline message, and 3 returns
+	const unsigned short programLength=(unsigned short) (4+formatCount*5+3);
+	const unsigned short rejectIndex=programLength-2, acceptIndex=programLength-1;
+	RakAssert(programLength<=PACKET_FILTER_MAX_LENGTH);
+
+	// Absolute word loads are big endian
+	const uint32_t offlineDataIdStart=
+		((uint32_t) OFFLINE_MESSAGE_DATA_ID[0]<<24) | ((uint32_t) OFFLINE_MESSAGE_DATA_ID[1]<<16) |
+		((uint32_t) OFFLINE_MESSAGE_DATA_ID[2]<<8) | (uint32_t) OFFLINE_MESSAGE_DATA_ID[3];
+	unsigned short pc=0;
+
+	// ProcessOfflineNetworkPacket ignores datagrams of 2 bytes or less
+	program[pc]=(struct sock_filter) BPF_STMT(BPF_LD|BPF_W|BPF_LEN, 0); pc++;
+	program[pc]=(struct sock_filter) BPF_JUMP(BPF_JMP|BPF_JGT|BPF_K, PACKET_FILTER_UDP_HEADER_LENGTH+2, 0, PacketFilterJumpOffset(pc, rejectIndex)); pc++;
+	// Datagrams from the reliability layer start with the isValid bit, which offline messages never have
+	program[pc]=(struct sock_filter) BPF_STMT(BPF_LD|BPF_B|BPF_ABS, PACKET_FILTER_UDP_HEADER_LENGTH); pc++;
+	program[pc]=(struct sock_filter) BPF_JUMP(BPF_JMP|BPF_JSET|BPF_K, 0x80, PacketFilterJumpOffset(pc, acceptIndex), 0); pc++;
+
+	for (unsigned int i=0; i < formatCount; i++)
+	{
+		const OfflineMessageFormat &format = offlineMessageFormats[i];
+		program[pc]=(struct sock_filter) BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, format.messageId, 0, 4); pc++;
+		program[pc]=(struct sock_filter) BPF_STMT(BPF_LD|BPF_W|BPF_LEN, 0); pc++;
+		program[pc]=(struct sock_filter) BPF_JUMP(BPF_JMP|(format.exactLength ? BPF_JEQ : BPF_JGE)|BPF_K, PACKET_FILTER_UDP_HEADER_LENGTH+format.length, 0, PacketFilterJumpOffset(pc, rejectIndex)); pc++;
+		program[pc]=(struct sock_filter) BPF_STMT(BPF_LD|BPF_W|BPF_ABS, PACKET_FILTER_UDP_HEADER_LENGTH+format.offlineDataIdOffset); pc++;
+		program[pc]=(struct sock_filter) BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, offlineDataIdStart, PacketFilterJumpOffset(pc, acceptIndex), PacketFilterJumpOffset(pc, rejectIndex)); pc++;
+	}
+
+	// Unknown first byte
+	program[pc]=(struct sock_filter) BPF_STMT(BPF_RET|BPF_K, unknownResult); pc++;
+	program[pc]=(struct sock_filter) BPF_STMT(BPF_RET|BPF_K, 0); pc++;
+	program[pc]=(struct sock_filter) BPF_STMT(BPF_RET|BPF_K, 0xFFFFFFFF); pc++;
+	RakAssert(pc==programLength);
+	return programLength;
+}
+#endif
+
+static void AttachOfflinePacketFilter( RakNetSocket2 *s )
+{
+#if defined(RAKPEER_SUPPORTS_PACKET_FILTER)
+	if (s->IsBerkleySocket()==false)
+		return;
+	struct sock_filter program[PACKET_FILTER_MAX_LENGTH];
+	unsigned short programLength=GenerateOfflinePacketFilter(program);
+	// If the kernel refuses, the socket works as if no filter was asked for
+	((RNS2_Berkley*) s)->AttachPacketFilter(program, programLength);
+#else
+	(void) s;
+#endif
+}
+
 struct PacketFollowedByData
 {
 	Packet p;
@@ -216,6 +374,12 @@ RakPeer::RakPeer()
 	endThreads = true;
 	isMainLoopThreadActive = false;
 	incomingDatagramEventHandler=0;
+	useEpollNetworkLoop=false;
+	epollFd=-1;
+	epollTimerFd=-1;
+	epollWakeupFd=-1;
+	peerGroup=0;
+	peerGroupThreadIndex=0;
 
 
 
@@ -231,11 +395,13 @@ RakPeer::RakPeer()
 	for (unsigned int i=0; i < MAXIMUM_NUMBER_OF_INTERNAL_IDS; i++)
 		ipList[i]=UNASSIGNED_SYSTEM_ADDRESS;
 	allowConnectionResponseIPMigration = false;
+	allowConnectionMigration = false;
 	//incomingPasswordLength=outgoingPasswordLength=0;
 	incomingPasswordLength=0;
 	splitMessageProgressInterval=0;
 	//unreliableTimeout=0;
 	unreliableTimeout=1000;
+	pathMTUDiscovery=false;
 	maxOutgoingBPS=0;
 	firstExternalID=UNASSIGNED_SYSTEM_ADDRESS;
 	myGuid=UNASSIGNED_RAKNET_GUID;
@@ -268,6 +434,7 @@ RakPeer::RakPeer()
 
 	quitAndDataEvents.InitEvent();
 	limitConnectionFrequencyFromTheSameIP=false;
+	useHandshakeCookies=false;
 	ResetSendReceipt();
 }
 
@@ -328,6 +495,16 @@ RakPeer::~RakPeer()
 // \return False on failure (can't create socket or thread), true on success.
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 StartupResult RakPeer::Startup( unsigned int maxConnections, SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority )
+{
+	return StartupInternal(maxConnections, socketDescriptors, socketDescriptorCount, threadPriority, 0);
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+StartupResult RakPeer::Startup( unsigned int maxConnections, RakPeerGroup *group )
+{
+	return StartupInternal(maxConnections, 0, 0, -99999, group);
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+StartupResult RakPeer::StartupInternal( unsigned int maxConnections, SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority, RakPeerGroup *group )
 {
 	if (IsActive())
 		return RAKNET_ALREADY_STARTED;
@@ -363,13 +540,33 @@ StartupResult RakPeer::Startup( unsigned int maxConnections, SocketDescriptor *s
 		rnr.SeedMT( GenerateSeedFromGuid() );
 	}
 
+	// Anyone who could predict the key could forge cookies, and anyone who could predict the rate limiter seed could pick addresses
+	// that share a victim's buckets, so both come from the operating system rather than rnr
+	uint32_t offlineRateLimiterSeed;
+	if (fillBufferSecure(handshakeCookieKey, HANDSHAKE_COOKIE_KEY_LENGTH)==false ||
+		fillBufferSecure(&offlineRateLimiterSeed, sizeof(offlineRateLimiterSeed))==false)
+	{
+		RakAssert("fillBufferSecure failed in RakPeer::Startup" && 0);
+		return STARTUP_OTHER_FAILURE;
+	}
+	offlineRateLimiter.Seed(offlineRateLimiterSeed);
+
 	//RakPeerAndIndex rpai[32];
 	//RakAssert(socketDescriptorCount<32);
 
-	RakAssert(socketDescriptors && socketDescriptorCount>=1);
+	if (group)
+	{
+		// The group's sockets are used instead
+		if (group->IsActive()==false)
+			return INVALID_SOCKET_DESCRIPTORS;
+	}
+	else
+	{
+		RakAssert(socketDescriptors && socketDescriptorCount>=1);
 
-	if (socketDescriptors==0 || socketDescriptorCount<1)
-		return INVALID_SOCKET_DESCRIPTORS;
+		if (socketDescriptors==0 || socketDescriptorCount<1)
+			return INVALID_SOCKET_DESCRIPTORS;
+	}
 
 	//unsigned short localPort;
 	//localPort=socketDescriptors[0].port;
@@ -381,164 +578,49 @@ StartupResult RakPeer::Startup( unsigned int maxConnections, SocketDescriptor *s
 
 	DerefAllSockets();
 
-
 	int i;
-	// Go through all socket descriptors and precreate sockets on the specified addresses
-	for (i=0; i<socketDescriptorCount; i++)
+	if (group)
 	{
-		/*
-		const char *addrToBind;
-		if (socketDescriptors[i].hostAddress[0]==0)
-			addrToBind=0;
-		else
-			addrToBind=socketDescriptors[i].hostAddress;
-			*/
-
-
-
-
-
-
-
-
-
-		/*
-#if RAKNET_SUPPORT_IPV6==1
-		if (SocketLayer::IsSocketFamilySupported(addrToBind, socketDescriptors[i].socketFamily)==false)
-			return SOCKET_FAMILY_NOT_SUPPORTED;
+		// These belong to the group, which receives on them. This instance only sends on them
+		group->GetSockets(socketList);
+		peerGroup=group;
+	}
+	else
+	{
+		// Made before binding, since the epoll loop needs non-blocking sockets and the receive threads blocking ones.
+		// If the loop cannot be made, fall back to the receive threads
+		bool useEpoll=false;
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+		if (useEpollNetworkLoop)
+			useEpoll=CreateEpollNetworkLoop();
 #endif
-
-		if (socketDescriptors[i].port!=0 && SocketLayer::IsPortInUse(socketDescriptors[i].port, addrToBind, socketDescriptors[i].socketFamily)==true)
+		StartupResult bindResult = BindSockets(socketDescriptors, socketDescriptorCount, threadPriority, useEpoll, this, socketList);
+		if (bindResult!=RAKNET_STARTED)
 		{
+			CloseEpollNetworkLoop();
 			DerefAllSockets();
-			return SOCKET_PORT_ALREADY_IN_USE;
-		}
-
-		RakNetSocket* rns = 0;
-		if (socketDescriptors[i].remotePortRakNetWasStartedOn_PS3_PSP2==0)
-		{
-			rns = SocketLayer::CreateBoundSocket( this, socketDescriptors[i].port, socketDescriptors[i].blockingSocket, addrToBind, 100, socketDescriptors[i].extraSocketOptions, socketDescriptors[i].socketFamily, socketDescriptors[i].chromeInstance );
+			return bindResult;
 		}
-		else
+		if (useEpoll && AddSocketsToEpollNetworkLoop()==false)
 		{
-#if defined(_PS3) || defined(__PS3__) || defined(SN_TARGET_PS3) || defined(_PS4)
-			rns = SocketLayer::CreateBoundSocket_PS3Lobby( socketDescriptors[i].port, socketDescriptors[i].blockingSocket, addrToBind, socketDescriptors[i].socketFamily );
-#elif  defined(SN_TARGET_PSP2)
-			rns = SocketLayer::CreateBoundSocket_PSP2( socketDescriptors[i].port, socketDescriptors[i].blockingSocket, addrToBind, socketDescriptors[i].socketFamily );
-#endif
-		}
-		*/
-
-		RakNetSocket2 *r2 = RakNetSocket2Allocator::AllocRNS2();
-		r2->SetUserConnectionSocketIndex(i);
-		#if defined(__native_client__)
-		NativeClientBindParameters ncbp;
-		RNS2_NativeClient * nativeClientSocket = (RNS2_NativeClient*) r2;
-		ncbp.eventHandler=this;
-		ncbp.forceHostAddress=(char*) socketDescriptors[i].hostAddress;
-		ncbp.is_ipv6=socketDescriptors[i].socketFamily==AF_INET6;
-		ncbp.nativeClientInstance=socketDescriptors[i].chromeInstance;
-		ncbp.port=socketDescriptors[i].port;
-		nativeClientSocket->Bind(&ncbp, _FILE_AND_LINE_);
-		#elif defined(WINDOWS_STORE_RT)
-		RNS2BindResult br;
-		((RNS2_WindowsStore8*) r2)->SetRecvEventHandler(this);
-		br = ((RNS2_WindowsStore8*) r2)->Bind(ref new Platform::String());
-		if (br!=BR_SUCCESS)
-		{
-			RakNetSocket2Allocator::DeallocRNS2(r2);
+			CloseEpollNetworkLoop();
 			DerefAllSockets();
-			return SOCKET_FAILED_TO_BIND;
+			return FAILED_TO_CREATE_NETWORK_THREAD;
 		}
-		#else
-		if (r2->IsBerkleySocket())
-		{
-			RNS2_BerkleyBindParameters bbp;
-			bbp.port=socketDescriptors[i].port;
-			bbp.hostAddress=(char*) socketDescriptors[i].hostAddress;
-			bbp.addressFamily=socketDescriptors[i].socketFamily;
-			bbp.type=SOCK_DGRAM;
-			bbp.protocol=socketDescriptors[i].extraSocketOptions;
-			bbp.nonBlockingSocket=false;
-			bbp.setBroadcast=true;
-			bbp.setIPHdrIncl=false;
-			bbp.doNotFragment=false;
-			bbp.pollingThreadPriority=threadPriority;
-			bbp.eventHandler=this;
-			bbp.remotePortRakNetWasStartedOn_PS3_PS4_PSP2=socketDescriptors[i].remotePortRakNetWasStartedOn_PS3_PSP2;
-			RNS2BindResult br = ((RNS2_Berkley*) r2)->Bind(&bbp, _FILE_AND_LINE_);
-
-			if (
-			#if RAKNET_SUPPORT_IPV6==0
-				socketDescriptors[i].socketFamily!=AF_INET ||
-			#endif
-				br==BR_REQUIRES_RAKNET_SUPPORT_IPV6_DEFINE)
-			{
-				RakNetSocket2Allocator::DeallocRNS2(r2);
-				DerefAllSockets();
-				return SOCKET_FAMILY_NOT_SUPPORTED;
-			}
-			else if (br==BR_FAILED_TO_BIND_SOCKET)
-			{
-				RakNetSocket2Allocator::DeallocRNS2(r2);
-				DerefAllSockets();
-				return SOCKET_PORT_ALREADY_IN_USE;
-			}
-			else if (br==BR_FAILED_SEND_TEST)
-			{
-				RakNetSocket2Allocator::DeallocRNS2(r2);
-				DerefAllSockets();
-				return SOCKET_FAILED_TEST_SEND;
-			}
-			else
-			{
-				RakAssert(br==BR_SUCCESS);
-			}
-		}
-		else
-		{
-			RakAssert("TODO" && 0);
-		}
-		#endif
-/*
-
-		SystemAddress saOut;
-		SocketLayer::GetSystemAddress( rns, &saOut );
-		rns->SetBoundAddress(saOut);
-		rns->SetRemotePortRakNetWasStartedOn(socketDescriptors[i].remotePortRakNetWasStartedOn_PS3_PSP2);
-		rns->SetChromeInstance(socketDescriptors[i].chromeInstance);
-		rns->SetExtraSocketOptions(socketDescriptors[i].extraSocketOptions);
-		rns->SetUserConnectionSocketIndex(i);
-		rns->SetBlockingSocket(socketDescriptors[i].blockingSocket);
-
-#if RAKNET_SUPPORT_IPV6==0
-		if (addrToBind==0)
-			rns->SetBoundAddressToLoopback(4);
-#endif
+	}
 
-		// GetBoundAddress is asynch, which isn't supported by this architecture
-#if !defined(__native_client__)
-		int zero=0;
-		if (SocketLayer::SendTo(rns, (const char*) &zero,4, rns->GetBoundAddress(), _FILE_AND_LINE_)!=0)
+	// The group has its own receive threads, and the epoll loop reads the sockets on the update thread
+	if (peerGroup==0 && epollFd==-1)
+	{
+#if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
+		for (i=0; i<(int) socketList.Size(); i++)
 		{
-			DerefAllSockets();
-			return SOCKET_FAILED_TEST_SEND;
+			if (socketList[i]->IsBerkleySocket())
+				((RNS2_Berkley*) socketList[i])->CreateRecvPollingThread(threadPriority);
 		}
 #endif
-		*/
-
-		socketList.Push(r2, _FILE_AND_LINE_ );
-
 	}
 
-#if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
-	for (i=0; i<socketDescriptorCount; i++)
-	{
-		if (socketList[i]->IsBerkleySocket())
-			((RNS2_Berkley*) socketList[i])->CreateRecvPollingThread(threadPriority);
-	}
-#endif
-
 // #if !defined(_XBOX) && !defined(_XBOX_720_COMPILE_AS_WINDOWS) && !defined(X360)
 	for (i=0; i < MAXIMUM_NUMBER_OF_INTERNAL_IDS; i++)
 	{
@@ -616,7 +698,12 @@ StartupResult RakPeer::Startup( unsigned int maxConnections, SocketDescriptor *s
 		ClearBufferedPackets();
 		ClearSocketQueryOutput();
 
-		if ( isMainLoopThreadActive == false )
+		if (peerGroup)
+		{
+			// One of the group's threads runs the update cycle from now on
+			peerGroup->AddPeer(this);
+		}
+		else if ( isMainLoopThreadActive == false )
 		{
 #if RAKPEER_USER_THREADED!=1
 
@@ -1052,17 +1139,21 @@ void RakPeer::Shutdown( unsigned int blockDuration, unsigned char orderingChanne
 
 	activeSystemListSize=0;
 
-	quitAndDataEvents.SetEvent();
+	SignalNetworkLoop();
 
 	endThreads = true;
 
+	// Once removed, the group no longer passes datagrams to this instance or updates it
+	if (peerGroup)
+		peerGroup->RemovePeer(this);
+
 //	RakNet::TimeMS timeout;
 #if RAKPEER_USER_THREADED!=1
 
 #if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
 	for (i=0; i < socketList.Size(); i++)
 	{
-		if (socketList[i]->IsBerkleySocket())
+		if (peerGroup==0 && socketList[i]->IsBerkleySocket())
 		{
 			((RNS2_Berkley *)socketList[i])->SignalStopRecvPollingThread();
 		}
@@ -1101,7 +1192,7 @@ void RakPeer::Shutdown( unsigned int blockDuration, unsigned char orderingChanne
 #if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
 	for (i=0; i < socketList.Size(); i++)
 	{
-		if (socketList[i]->IsBerkleySocket())
+		if (peerGroup==0 && socketList[i]->IsBerkleySocket())
 		{
 			((RNS2_Berkley *)socketList[i])->BlockOnStopRecvPollingThread();
 		}
@@ -1111,6 +1202,9 @@ void RakPeer::Shutdown( unsigned int blockDuration, unsigned char orderingChanne
 
 #endif // RAKPEER_USER_THREADED!=1
 
+	// The update thread has stopped, so nothing reads these any more
+	CloseEpollNetworkLoop();
+
 //	char c=0;
 //	unsigned int socketIndex;
 	// remoteSystemList in Single thread
@@ -1153,6 +1247,7 @@ void RakPeer::Shutdown( unsigned int blockDuration, unsigned char orderingChanne
 	*/
 
 	DerefAllSockets();
+	peerGroup=0;
 
 	ClearBufferedCommands();
 	ClearBufferedPackets();
@@ -1244,6 +1339,14 @@ uint32_t RakPeer::IncrementNextSendReceipt(void)
 	return returned;
 }
 
+// Converts the relative deadline passed to Send() to an absolute time, so time spent in bufferedCommands counts against it
+static RakNet::TimeUS GetDeadlineFromNow(RakNet::TimeMS deadlineMS)
+{
+	if (deadlineMS==0)
+		return 0;
+	return RakNet::GetTimeUS() + (RakNet::TimeUS) deadlineMS * (RakNet::TimeUS) 1000;
+}
+
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Description:
 // Sends a block of data to the specified system that you are connected to.
@@ -1263,7 +1366,7 @@ uint32_t RakPeer::IncrementNextSendReceipt(void)
 // Returns:
 // \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-uint32_t RakPeer::Send( const char *data, const int length, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber )
+uint32_t RakPeer::Send( const char *data, const int length, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber, RakNet::TimeMS deadlineMS, uint32_t coalescingKey )
 {
 #ifdef _DEBUG
 	RakAssert( data && length > 0 );
@@ -1304,7 +1407,7 @@ uint32_t RakPeer::Send( const char *data, const int length, PacketPriority prior
 		return usedSendReceipt;
 	}
 
-	SendBuffered(data, length*8, priority, reliability, orderingChannel, systemIdentifier, broadcast, RemoteSystemStruct::NO_ACTION, usedSendReceipt);
+	SendBuffered(data, length*8, priority, reliability, orderingChannel, systemIdentifier, broadcast, RemoteSystemStruct::NO_ACTION, usedSendReceipt, GetDeadlineFromNow(deadlineMS), coalescingKey);
 
 	return usedSendReceipt;
 }
@@ -1321,7 +1424,7 @@ void RakPeer::SendLoopback( const char *data, const int length )
 	PushBackPacket(packet, false);
 }
 
-uint32_t RakPeer::Send( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber )
+uint32_t RakPeer::Send( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber, RakNet::TimeMS deadlineMS, uint32_t coalescingKey )
 {
 #ifdef _DEBUG
 	RakAssert( bitStream->GetNumberOfBytesUsed() > 0 );
@@ -1363,7 +1466,7 @@ uint32_t RakPeer::Send( const RakNet::BitStream * bitStream, PacketPriority prio
 
 	// Sends need to be buffered and processed in the update thread because the systemAddress associated with the reliability layer can change,
 	// from that thread, resulting in a send to the wrong player!  While I could mutex the systemAddress, that is much slower than doing this
-	SendBuffered((const char*)bitStream->GetData(), bitStream->GetNumberOfBitsUsed(), priority, reliability, orderingChannel, systemIdentifier, broadcast, RemoteSystemStruct::NO_ACTION, usedSendReceipt);
+	SendBuffered((const char*)bitStream->GetData(), bitStream->GetNumberOfBitsUsed(), priority, reliability, orderingChannel, systemIdentifier, broadcast, RemoteSystemStruct::NO_ACTION, usedSendReceipt, GetDeadlineFromNow(deadlineMS), coalescingKey);
 
 
 	return usedSendReceipt;
@@ -1389,7 +1492,7 @@ uint32_t RakPeer::Send( const RakNet::BitStream * bitStream, PacketPriority prio
 // \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 // \return False if we are not connected to the specified recipient.  True otherwise
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-uint32_t RakPeer::SendList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber )
+uint32_t RakPeer::SendList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber, RakNet::TimeMS deadlineMS, uint32_t coalescingKey )
 {
 #ifdef _DEBUG
 	RakAssert( data );
@@ -1416,10 +1519,24 @@ uint32_t RakPeer::SendList( const char **data, const int *lengths, const int num
 	else
 		usedSendReceipt=IncrementNextSendReceipt();
 
-	SendBufferedList(data, lengths, numParameters, priority, reliability, orderingChannel, systemIdentifier, broadcast, RemoteSystemStruct::NO_ACTION, usedSendReceipt);
+	SendBufferedList(data, lengths, numParameters, priority, reliability, orderingChannel, systemIdentifier, broadcast, RemoteSystemStruct::NO_ACTION, usedSendReceipt, GetDeadlineFromNow(deadlineMS), coalescingKey);
 
 	return usedSendReceipt;
 }
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Sends the segments of a BitStreamChain as one message, gathering them into the send buffer with SendList
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+uint32_t RakPeer::SendChain( const RakNet::BitStreamChain *chain, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber, RakNet::TimeMS deadlineMS, uint32_t coalescingKey )
+{
+#ifdef _DEBUG
+	RakAssert( chain->GetNumberOfBytesUsed() > 0 );
+#endif
+
+	if ( chain->GetNumberOfBytesUsed() == 0 )
+		return 0;
+
+	return SendList(chain->GetSegmentData(), chain->GetSegmentLengths(), chain->GetSegmentCount(), priority, reliability, orderingChannel, systemIdentifier, broadcast, forceReceiptNumber, deadlineMS, coalescingKey);
+}
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Description:
@@ -1658,6 +1775,8 @@ void RakPeer::CancelConnectionAttempt( const SystemAddress target )
 #endif
 			RakNet::OP_DELETE(requestedConnectionQueue[i], _FILE_AND_LINE_ );
 			requestedConnectionQueue.RemoveAtIndex(i);
+			if (peerGroup)
+				peerGroup->ReleaseAddress(target, this);
 			break;
 		}
 		else
@@ -1813,48 +1932,13 @@ void RakPeer::GetSystemList(DataStructures::List<SystemAddress> &addresses, Data
 //
 // Parameters
 // IP - Dotted IP address.  Can use * as a wildcard, such as 128.0.0.* will ban
-// All IP addresses starting with 128.0.0
+// All IP addresses starting with 128.0.0. CIDR ranges such as 10.0.0.0/8 and IPv6 addresses also work
 // milliseconds - how many ms for a temporary ban.  Use 0 for a permanent ban
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::AddToBanList( const char *IP, RakNet::TimeMS milliseconds )
 {
-	unsigned index;
-	RakNet::TimeMS time = RakNet::GetTimeMS();
-
-	if ( IP == 0 || IP[ 0 ] == 0 || strlen( IP ) > 15 )
-		return ;
-
-	// If this guy is already in the ban list, do nothing
-	index = 0;
-
-	banListMutex.Lock();
-
-	for ( ; index < banList.Size(); index++ )
-	{
-		if ( strcmp( IP, banList[ index ]->IP ) == 0 )
-		{
-			// Already in the ban list.  Just update the time
-			if (milliseconds==0)
-				banList[ index ]->timeout=0; // Infinite
-			else
-				banList[ index ]->timeout=time+milliseconds;
-			banListMutex.Unlock();
-			return;
-		}
-	}
-
-	banListMutex.Unlock();
-
-	BanStruct *banStruct = RakNet::OP_NEW<BanStruct>( _FILE_AND_LINE_ );
-	banStruct->IP = (char*) rakMalloc_Ex( 16, _FILE_AND_LINE_ );
-	if (milliseconds==0)
-		banStruct->timeout=0; // Infinite
-	else
-		banStruct->timeout=time+milliseconds;
-	strcpy( banStruct->IP, IP );
-	banListMutex.Lock();
-	banList.Insert( banStruct, _FILE_AND_LINE_ );
-	banListMutex.Unlock();
+	banList.RemoveExpired(RakNet::GetTimeMS());
+	banList.Add(IP, milliseconds);
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1867,36 +1951,7 @@ void RakPeer::AddToBanList( const char *IP, RakNet::TimeMS milliseconds )
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::RemoveFromBanList( const char *IP )
 {
-	unsigned index;
-	BanStruct *temp;
-
-	if ( IP == 0 || IP[ 0 ] == 0 || strlen( IP ) > 15 )
-		return ;
-
-	index = 0;
-	temp=0;
-
-	banListMutex.Lock();
-
-	for ( ; index < banList.Size(); index++ )
-	{
-		if ( strcmp( IP, banList[ index ]->IP ) == 0 )
-		{
-			temp = banList[ index ];
-			banList[ index ] = banList[ banList.Size() - 1 ];
-			banList.RemoveAtIndex( banList.Size() - 1 );
-			break;
-		}
-	}
-
-	banListMutex.Unlock();
-
-	if (temp)
-	{
-		rakFree_Ex(temp->IP, _FILE_AND_LINE_ );
-		RakNet::OP_DELETE(temp, _FILE_AND_LINE_);
-	}
-
+	banList.Remove(IP);
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -1905,25 +1960,32 @@ void RakPeer::RemoveFromBanList( const char *IP )
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::ClearBanList( void )
 {
-	unsigned index;
-	index = 0;
-	banListMutex.Lock();
-
-	for ( ; index < banList.Size(); index++ )
-	{
-		rakFree_Ex(banList[ index ]->IP, _FILE_AND_LINE_ );
-		RakNet::OP_DELETE(banList[ index ], _FILE_AND_LINE_);
-	}
-
-	banList.Clear(false, _FILE_AND_LINE_);
-
-	banListMutex.Unlock();
+	banList.Clear();
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::SetLimitIPConnectionFrequency(bool b)
 {
 	limitConnectionFrequencyFromTheSameIP=b;
 }
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetHandshakeCookies(bool b)
+{
+	useHandshakeCookies=b;
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetOfflineRateLimit( const OfflineRateLimitSettings &settings )
+{
+	offlineRateLimiterMutex.Lock();
+	offlineRateLimiter.SetSettings(settings);
+	offlineRateLimiterMutex.Unlock();
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::GetOfflineRateLimitStatistics( OfflineRateLimitStatistics *statistics ) const
+{
+	offlineRateLimiterMutex.Lock();
+	offlineRateLimiter.GetStatistics(statistics);
+	offlineRateLimiterMutex.Unlock();
+}
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Description:
@@ -1938,87 +2000,7 @@ void RakPeer::SetLimitIPConnectionFrequency(bool b)
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool RakPeer::IsBanned( const char *IP )
 {
-	unsigned banListIndex, characterIndex;
-	RakNet::TimeMS time;
-	BanStruct *temp;
-
-	if ( IP == 0 || IP[ 0 ] == 0 || strlen( IP ) > 15 )
-		return false;
-
-	banListIndex = 0;
-
-	if ( banList.Size() == 0 )
-		return false; // Skip the mutex if possible
-
-	time = RakNet::GetTimeMS();
-
-	banListMutex.Lock();
-
-	while ( banListIndex < banList.Size() )
-	{
-		if (banList[ banListIndex ]->timeout>0 && banList[ banListIndex ]->timeout<time)
-		{
-			// Delete expired ban
-			temp = banList[ banListIndex ];
-			banList[ banListIndex ] = banList[ banList.Size() - 1 ];
-			banList.RemoveAtIndex( banList.Size() - 1 );
-			rakFree_Ex(temp->IP, _FILE_AND_LINE_ );
-			RakNet::OP_DELETE(temp, _FILE_AND_LINE_);
-		}
-		else
-		{
-			characterIndex = 0;
-
-#ifdef _MSC_VER
-#pragma warning( disable : 4127 ) // warning C4127: conditional expression is constant
-#endif
-			while ( true )
-			{
-				if ( banList[ banListIndex ]->IP[ characterIndex ] == IP[ characterIndex ] )
-				{
-					// Equal characters
-
-					if ( IP[ characterIndex ] == 0 )
-					{
-						banListMutex.Unlock();
-						// End of the string and the strings match
-
-						return true;
-					}
-
-					characterIndex++;
-				}
-
-				else
-				{
-					if ( banList[ banListIndex ]->IP[ characterIndex ] == 0 || IP[ characterIndex ] == 0 )
-					{
-						// End of one of the strings
-						break;
-					}
-
-					// Characters do not match
-					if ( banList[ banListIndex ]->IP[ characterIndex ] == '*' )
-					{
-						banListMutex.Unlock();
-
-						// Domain is banned.
-						return true;
-					}
-
-					// Characters do not match and it is not a *
-					break;
-				}
-			}
-
-			banListIndex++;
-		}
-	}
-
-	banListMutex.Unlock();
-
-	// No match found.
-	return false;
+	return banList.IsBanned(IP);
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -2627,6 +2609,18 @@ void RakPeer::AllowConnectionResponseIPMigration( bool allow )
 	allowConnectionResponseIPMigration = allow;
 }
 
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Description:
+// Allow systems that connect to us to keep their connection when their address changes, such as when a NAT rebinds
+//
+// Parameters:
+// allow - True to allow this behavior, false to not allow.  Defaults to false.  Applies to connections made after the call
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::AllowConnectionMigration( bool allow )
+{
+	allowConnectionMigration = allow;
+}
+
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Description:
 // Sends a message ID_ADVERTISE_SYSTEM to the remote unconnected system.
@@ -2681,6 +2675,16 @@ void RakPeer::SetUnreliableTimeout(RakNet::TimeMS timeoutMS)
 		remoteSystemList[ i ].reliabilityLayer.SetUnreliableTimeout(unreliableTimeout);
 }
 
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+// Enable or disable path MTU discovery on connections
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetPathMTUDiscovery(bool enabled)
+{
+	pathMTUDiscovery=enabled;
+	for ( unsigned short i = 0; i < maximumNumberOfPeers; i++ )
+		remoteSystemList[ i ].reliabilityLayer.SetPathMTUDiscovery(pathMTUDiscovery);
+}
+
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 // Send a message to host, with the IP socket option TTL set to 3
 // This message will not reach the host, but will open the router.
@@ -2952,6 +2956,163 @@ void RakPeer::SetIncomingDatagramEventHandler( bool (*_incomingDatagramEventHand
 	incomingDatagramEventHandler=_incomingDatagramEventHandler;
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SetEpollNetworkLoop( bool enabled )
+{
+	RakAssert(IsActive()==false);
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+	if (IsActive()==false)
+		useEpollNetworkLoop=enabled;
+#else
+	(void) enabled;
+#endif
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SignalNetworkLoop(void)
+{
+	RakPeerGroup *group = peerGroup;
+	if (group)
+	{
+		group->SignalUpdateThread(peerGroupThreadIndex);
+		return;
+	}
+
+	quitAndDataEvents.SetEvent();
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+	if (epollWakeupFd!=-1)
+	{
+		// Checked again under the lock, as Shutdown may be closing it
+		epollWakeupMutex.Lock();
+		if (epollWakeupFd!=-1)
+		{
+			uint64_t one=1;
+			ssize_t r = write(epollWakeupFd, &one, sizeof(one));
+			(void) r;
+		}
+		epollWakeupMutex.Unlock();
+	}
+#endif
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool RakPeer::CreateEpollNetworkLoop(void)
+{
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+	epollFd = epoll_create1(0);
+	// Same period as the WaitOnEvent timeout of the threaded loop
+	epollTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+	int wakeupFd = eventfd(0, EFD_NONBLOCK);
+	epollWakeupMutex.Lock();
+	epollWakeupFd=wakeupFd;
+	epollWakeupMutex.Unlock();
+	if (epollFd==-1 || epollTimerFd==-1 || epollWakeupFd==-1)
+	{
+		CloseEpollNetworkLoop();
+		return false;
+	}
+
+	struct itimerspec period;
+	period.it_interval.tv_sec=0;
+	period.it_interval.tv_nsec=10*1000000;
+	period.it_value=period.it_interval;
+	struct epoll_event ev;
+	ev.events=EPOLLIN;
+	if (timerfd_settime(epollTimerFd, 0, &period, 0)!=0 ||
+		(ev.data.u64=EPOLL_TIMER_EVENT, epoll_ctl(epollFd, EPOLL_CTL_ADD, epollTimerFd, &ev))!=0 ||
+		(ev.data.u64=EPOLL_WAKEUP_EVENT, epoll_ctl(epollFd, EPOLL_CTL_ADD, epollWakeupFd, &ev))!=0)
+	{
+		CloseEpollNetworkLoop();
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool RakPeer::AddSocketsToEpollNetworkLoop(void)
+{
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+	struct epoll_event ev;
+	ev.events=EPOLLIN;
+	for (unsigned int i=0; i < socketList.Size(); i++)
+	{
+		if (socketList[i]->IsBerkleySocket()==false)
+			continue;
+		ev.data.u64=i;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, ((RNS2_Berkley*) socketList[i])->GetSocket(), &ev)!=0)
+			return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::CloseEpollNetworkLoop(void)
+{
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+	// Once this is -1, SignalNetworkLoop no longer writes to it, so the number cannot be reused for another file while it does
+	epollWakeupMutex.Lock();
+	if (epollWakeupFd!=-1)
+		close(epollWakeupFd);
+	epollWakeupFd=-1;
+	epollWakeupMutex.Unlock();
+	if (epollTimerFd!=-1)
+		close(epollTimerFd);
+	epollTimerFd=-1;
+	if (epollFd!=-1)
+		close(epollFd);
+	epollFd=-1;
+#endif
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::RunEpollNetworkLoop(BitStream &updateBitStream)
+{
+#if defined(RAKPEER_SUPPORTS_EPOLL)
+	const int MAX_EPOLL_EVENTS=64;
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	uint64_t counter;
+	while ( endThreads == false )
+	{
+		if (userUpdateThreadPtr)
+			userUpdateThreadPtr(this, userUpdateThreadData);
+
+		RunUpdateCycle(updateBitStream);
+
+		int eventCount = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, -1);
+		if (eventCount < 0 && errno!=EINTR)
+		{
+			// Should not happen, but wait as the threaded loop does rather than spin
+			quitAndDataEvents.WaitOnEvent(10);
+			continue;
+		}
+		for (int eventIndex=0; eventIndex < eventCount; eventIndex++)
+		{
+			if (events[eventIndex].data.u64==EPOLL_TIMER_EVENT)
+			{
+				ssize_t r = read(epollTimerFd, &counter, sizeof(counter));
+				(void) r;
+			}
+			else if (events[eventIndex].data.u64==EPOLL_WAKEUP_EVENT)
+			{
+				ssize_t r = read(epollWakeupFd, &counter, sizeof(counter));
+				(void) r;
+			}
+			else
+			{
+				// Sockets are only added at startup, so the index is valid
+				((RNS2_Berkley*) socketList[(unsigned int) events[eventIndex].data.u64])->PollRecvFrom();
+			}
+		}
+	}
+
+	// Shutdown closes the descriptors once isMainLoopThreadActive is false. It closes them under this lock, so taking it here orders the reads above before the close
+	epollWakeupMutex.Lock();
+	epollWakeupMutex.Unlock();
+#else
+	(void) updateBitStream;
+#endif
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 bool RakPeer::SendOutOfBand(const char *host, unsigned short remotePort, const char *data, BitSize_t dataLength, unsigned connectionSocketIndex )
 {
 	if ( IsActive() == false )
@@ -3274,6 +3435,9 @@ ConnectionAttemptResult RakPeer::SendConnectionRequest( const char* host, unsign
 	}
 	requestedConnectionQueue.Push(rcs, _FILE_AND_LINE_ );
 	requestedConnectionQueueMutex.Unlock();
+	// So the group passes the replies to this instance
+	if (peerGroup)
+		peerGroup->ClaimAddress(systemAddress, this);
 
 	return CONNECTION_ATTEMPT_STARTED;
 }
@@ -3328,6 +3492,9 @@ ConnectionAttemptResult RakPeer::SendConnectionRequest( const char* host, unsign
 	}
 	requestedConnectionQueue.Push(rcs, _FILE_AND_LINE_ );
 	requestedConnectionQueueMutex.Unlock();
+	// So the group passes the replies to this instance
+	if (peerGroup)
+		peerGroup->ClaimAddress(systemAddress, this);
 
 	return CONNECTION_ATTEMPT_STARTED;
 }
@@ -3479,38 +3646,128 @@ void RakPeer::ParseConnectionRequestPacket( RakPeer::RemoteSystemStruct *remoteS
 	if ( incomingPasswordLength != passwordLength ||
 		memcmp( password, incomingPassword, incomingPasswordLength ) != 0 )
 	{
-		CAT_AUDIT_PRINTF("AUDIT: Invalid password\n");
-		// This one we only send once since we don't care if it arrives.
-		RakNet::BitStream bitStream;
-		bitStream.Write((MessageID)ID_INVALID_PASSWORD);
-		bitStream.Write(GetGuidFromSystemAddress(UNASSIGNED_SYSTEM_ADDRESS));
-		SendImmediate((char*) bitStream.GetData(), bitStream.GetNumberOfBytesUsed(), IMMEDIATE_PRIORITY, RELIABLE, 0, systemAddress, false, false, RakNet::GetTimeUS(), 0);
-		remoteSystem->connectMode=RemoteSystemStruct::DISCONNECT_ASAP_SILENTLY;
-		return;
+		CAT_AUDIT_PRINTF("AUDIT: Invalid password\n");
+		// This one we only send once since we don't care if it arrives.
+		RakNet::BitStream bitStream;
+		bitStream.Write((MessageID)ID_INVALID_PASSWORD);
+		bitStream.Write(GetGuidFromSystemAddress(UNASSIGNED_SYSTEM_ADDRESS));
+		SendImmediate((char*) bitStream.GetData(), bitStream.GetNumberOfBytesUsed(), IMMEDIATE_PRIORITY, RELIABLE, 0, systemAddress, false, false, RakNet::GetTimeUS(), 0);
+		remoteSystem->connectMode=RemoteSystemStruct::DISCONNECT_ASAP_SILENTLY;
+		return;
+	}
+
+	// OK
+	remoteSystem->connectMode=RemoteSystemStruct::HANDLING_CONNECTION_REQUEST;
+
+	OnConnectionRequest( remoteSystem, incomingTimestamp );
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::OnConnectionRequest( RakPeer::RemoteSystemStruct *remoteSystem, RakNet::Time incomingTimestamp )
+{
+	RakNet::BitStream bitStream;
+	bitStream.Write((MessageID)ID_CONNECTION_REQUEST_ACCEPTED);
+	bitStream.Write(remoteSystem->systemAddress);
+	SystemIndex systemIndex = (SystemIndex) GetIndexFromSystemAddress( remoteSystem->systemAddress, true );
+	RakAssert(systemIndex!=65535);
+	bitStream.Write(systemIndex);
+	for (unsigned int i=0; i < MAXIMUM_NUMBER_OF_INTERNAL_IDS; i++)
+		bitStream.Write(ipList[i]);
+	bitStream.Write(incomingTimestamp);
+	bitStream.Write(RakNet::GetTime());
+	if (allowConnectionMigration)
+	{
+		// Older versions stop reading before this, so when no key can be made the connection just cannot migrate.
+		// Anyone who could predict the key could move the connection to their own address, so it comes from the operating system rather than rnr
+		if (fillBufferSecure(remoteSystem->connectionMigrationKey, CONNECTION_MIGRATION_KEY_LENGTH))
+		{
+			remoteSystem->hasConnectionMigrationKey=true;
+			bitStream.WriteAlignedBytes(remoteSystem->connectionMigrationKey, CONNECTION_MIGRATION_KEY_LENGTH);
+			// So the group passes ID_CONNECTION_MIGRATION from this system to this instance
+			if (peerGroup)
+				peerGroup->ClaimConnectionMigrationGuid(remoteSystem->guid, this);
+		}
+	}
+
+	SendImmediate((char*)bitStream.GetData(), bitStream.GetNumberOfBitsUsed(), IMMEDIATE_PRIORITY, RELIABLE_ORDERED, 0, remoteSystem->systemAddress, false, false, RakNet::GetTimeUS(), 0);
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+void RakPeer::SendConnectionMigrationRequest( RakPeer::RemoteSystemStruct *remoteSystem )
+{
+	RakNet::BitStream bitStream;
+	bitStream.Write((MessageID)ID_CONNECTION_MIGRATION);
+	bitStream.WriteAlignedBytes((const unsigned char*) OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
+	bitStream.Write(myGuid);
+	bitStream.Write(++remoteSystem->connectionMigrationSequence);
+	unsigned char hmac[SHA1_LENGTH];
+	CSHA1::HMAC(remoteSystem->connectionMigrationKey, CONNECTION_MIGRATION_KEY_LENGTH, bitStream.GetData(), bitStream.GetNumberOfBytesUsed(), hmac);
+	bitStream.WriteAlignedBytes(hmac, SHA1_LENGTH);
+
+	unsigned i;
+	for (i=0; i < pluginListNTS.Size(); i++)
+		pluginListNTS[i]->OnDirectSocketSend((const char*)bitStream.GetData(), bitStream.GetNumberOfBitsUsed(), remoteSystem->systemAddress);
+
+	RNS2_SendParameters bsp;
+	bsp.data = (char*) bitStream.GetData();
+	bsp.length = bitStream.GetNumberOfBytesUsed();
+	bsp.systemAddress = remoteSystem->systemAddress;
+	remoteSystem->rakNetSocket->Send(&bsp, _FILE_AND_LINE_);
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool RakPeer::GetConnectionMigrationGuid( const char *data, int length, RakNetGUID *guid )
+{
+	if (length < 1 || (unsigned char) data[0]!=ID_CONNECTION_MIGRATION || IsOfflineMessage(data, length)==false)
+		return false;
+	RakNet::BitStream bsIn((unsigned char*) data,length,false);
+	bsIn.IgnoreBytes(sizeof(MessageID));
+	bsIn.IgnoreBytes(sizeof(OFFLINE_MESSAGE_DATA_ID));
+	return bsIn.Read(*guid);
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+bool RakPeer::AllowOfflineMessage( const SystemAddress &systemAddress, RakNet::TimeUS timeRead )
+{
+	offlineRateLimiterMutex.Lock();
+	bool allow = offlineRateLimiter.Allow(systemAddress, (RakNet::TimeMS) (timeRead/1000));
+	offlineRateLimiterMutex.Unlock();
+	return allow;
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+uint32_t RakPeer::GenerateHandshakeCookie(const SystemAddress &systemAddress, RakNet::TimeMS interval)
+{
+	// Only the address and port, so padding in the sockaddr does not matter
+	unsigned char input[sizeof(RakNet::TimeMS)+16+sizeof(unsigned short)];
+	int inputLength=0;
+	memcpy(input, &interval, sizeof(interval));
+	inputLength+=sizeof(interval);
+#if RAKNET_SUPPORT_IPV6==1
+	if (systemAddress.GetIPVersion()==6)
+	{
+		memcpy(input+inputLength, &systemAddress.address.addr6.sin6_addr, 16);
+		inputLength+=16;
 	}
+	else
+#endif
+	{
+		memcpy(input+inputLength, &systemAddress.address.addr4.sin_addr, 4);
+		inputLength+=4;
+	}
+	memcpy(input+inputLength, &systemAddress.address.addr4.sin_port, sizeof(unsigned short));
+	inputLength+=sizeof(unsigned short);
 
-	// OK
-	remoteSystem->connectMode=RemoteSystemStruct::HANDLING_CONNECTION_REQUEST;
-
-	OnConnectionRequest( remoteSystem, incomingTimestamp );
+	unsigned char hmac[SHA1_LENGTH];
+	CSHA1::HMAC(handshakeCookieKey, HANDSHAKE_COOKIE_KEY_LENGTH, input, inputLength, hmac);
+	uint32_t cookie;
+	memcpy(&cookie, hmac, sizeof(cookie));
+	return cookie;
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void RakPeer::OnConnectionRequest( RakPeer::RemoteSystemStruct *remoteSystem, RakNet::Time incomingTimestamp )
+bool RakPeer::VerifyHandshakeCookie(const SystemAddress &systemAddress, uint32_t cookie)
 {
-	RakNet::BitStream bitStream;
-	bitStream.Write((MessageID)ID_CONNECTION_REQUEST_ACCEPTED);
-	bitStream.Write(remoteSystem->systemAddress);
-	SystemIndex systemIndex = (SystemIndex) GetIndexFromSystemAddress( remoteSystem->systemAddress, true );
-	RakAssert(systemIndex!=65535);
-	bitStream.Write(systemIndex);
-	for (unsigned int i=0; i < MAXIMUM_NUMBER_OF_INTERNAL_IDS; i++)
-		bitStream.Write(ipList[i]);
-	bitStream.Write(incomingTimestamp);
-	bitStream.Write(RakNet::GetTime());
-
-	SendImmediate((char*)bitStream.GetData(), bitStream.GetNumberOfBitsUsed(), IMMEDIATE_PRIORITY, RELIABLE_ORDERED, 0, remoteSystem->systemAddress, false, false, RakNet::GetTimeUS(), 0);
+	// Accept a cookie from the previous interval, in case it was generated just before the interval changed
+	RakNet::TimeMS interval = RakNet::GetTimeMS()/HANDSHAKE_COOKIE_INTERVAL_MS;
+	return GenerateHandshakeCookie(systemAddress, interval)==cookie ||
+		GenerateHandshakeCookie(systemAddress, interval-1)==cookie;
 }
-
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::NotifyAndFlagForShutdown( const SystemAddress systemAddress, bool performImmediate, unsigned char orderingChannel, PacketPriority disconnectionNotificationPriority )
 {
@@ -3603,6 +3860,7 @@ RakPeer::RemoteSystemStruct * RakPeer::AssignSystemAddressToRemoteSystemList( co
 			remoteSystem->reliabilityLayer.Reset(true, remoteSystem->MTUSize, useSecurity);
 			remoteSystem->reliabilityLayer.SetSplitMessageProgressInterval(splitMessageProgressInterval);
 			remoteSystem->reliabilityLayer.SetUnreliableTimeout(unreliableTimeout);
+			remoteSystem->reliabilityLayer.SetPathMTUDiscovery(pathMTUDiscovery);
 			remoteSystem->reliabilityLayer.SetTimeoutTime(defaultTimeoutTime);
 			AddToActiveSystemList(assignedIndex);
 			if (incomingRakNetSocket->GetBoundAddress()==bindingAddress)
@@ -3709,6 +3967,9 @@ RakPeer::RemoteSystemStruct * RakPeer::AssignSystemAddressToRemoteSystemList( co
 			remoteSystem->connectionTime = time;
 			remoteSystem->myExternalSystemAddress = UNASSIGNED_SYSTEM_ADDRESS;
 			remoteSystem->lastReliableSend=time;
+			remoteSystem->hasConnectionMigrationKey=false;
+			remoteSystem->connectionMigrationSequence=0;
+			remoteSystem->lastConnectionMigrationRequest=0;
 
 #ifdef _DEBUG
 			int indexLoopupCheck=GetIndexFromSystemAddress( systemAddress, true );
@@ -3827,6 +4088,9 @@ void RakPeer::ReferenceRemoteSystem(const SystemAddress &sa, unsigned int remote
 		cur->next=rsi;
 	}
 
+	if (peerGroup)
+		peerGroup->ClaimAddress(sa, this);
+
 // #ifdef _DEBUG
 // 	for ( int remoteSystemIndex = 0; remoteSystemIndex < maximumNumberOfPeers; ++remoteSystemIndex )
 // 	{
@@ -3860,6 +4124,8 @@ void RakPeer::DereferenceRemoteSystem(const SystemAddress &sa)
 				last->next=cur->next;
 			}
 			remoteSystemIndexPool.Release(cur,_FILE_AND_LINE_);
+			if (peerGroup)
+				peerGroup->ReleaseAddress(sa, this);
 			break;
 		}
 		last=cur;
@@ -4000,6 +4266,13 @@ bool RakPeer::AllowIncomingConnections(void) const
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 void RakPeer::DeallocRNS2RecvStruct(RNS2RecvStruct *s, const char *file, unsigned int line)
 {
+	// Allocated by the group, so return it there
+	if (peerGroup)
+	{
+		peerGroup->DeallocRNS2RecvStruct(s, file, line);
+		return;
+	}
+
 	bufferedPacketsFreePoolMutex.Lock();
 	bufferedPacketsFreePool.Push(s, file, line);
 	bufferedPacketsFreePoolMutex.Unlock();
@@ -4075,7 +4348,7 @@ void RakPeer::PingInternal( const SystemAddress target, bool performImmediate, P
 void RakPeer::CloseConnectionInternal( const AddressOrGUID& systemIdentifier, bool sendDisconnectionNotification, bool performImmediate, unsigned char orderingChannel, PacketPriority disconnectionNotificationPriority )
 {
 #ifdef _DEBUG
-	RakAssert(orderingChannel < 32);
+	RakAssert(orderingChannel < NUMBER_OF_ORDERED_STREAMS);
 #endif
 
 	if (systemIdentifier.IsUndefined())
@@ -4115,6 +4388,13 @@ void RakPeer::CloseConnectionInternal( const AddressOrGUID& systemIdentifier, bo
 					// Found the index to stop
 					// printf("--- Address %s has become inactive\n", remoteSystemList[index].systemAddress.ToString());
 					remoteSystemList[index].isActive = false;
+					// Another instance in the group can take this address now
+					if (peerGroup)
+					{
+						peerGroup->ReleaseAddress(target, this);
+						if (remoteSystemList[index].hasConnectionMigrationKey)
+							peerGroup->ReleaseConnectionMigrationGuid(remoteSystemList[index].guid, this);
+					}
 
 					remoteSystemList[index].guid=UNASSIGNED_RAKNET_GUID;
 
@@ -4144,7 +4424,7 @@ void RakPeer::CloseConnectionInternal( const AddressOrGUID& systemIdentifier, bo
 	}
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void RakPeer::SendBuffered( const char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt )
+void RakPeer::SendBuffered( const char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt, RakNet::TimeUS deadline, uint32_t coalescingKey )
 {
 	BufferedCommandStruct *bcs;
 
@@ -4170,17 +4450,19 @@ void RakPeer::SendBuffered( const char *data, BitSize_t numberOfBitsToSend, Pack
 	bcs->broadcast=broadcast;
 	bcs->connectionMode=connectionMode;
 	bcs->receipt=receipt;
+	bcs->deadline=deadline;
+	bcs->coalescingKey=coalescingKey;
 	bcs->command=BufferedCommandStruct::BCS_SEND;
 	bufferedCommands.Push(bcs);
 
 	if (priority==IMMEDIATE_PRIORITY)
 	{
 		// Forces pending sends to go out now, rather than waiting to the next update interval
-		quitAndDataEvents.SetEvent();
+		SignalNetworkLoop();
 	}
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-void RakPeer::SendBufferedList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt )
+void RakPeer::SendBufferedList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt, RakNet::TimeUS deadline, uint32_t coalescingKey )
 {
 	BufferedCommandStruct *bcs;
 	unsigned int totalLength=0;
@@ -4231,17 +4513,19 @@ void RakPeer::SendBufferedList( const char **data, const int *lengths, const int
 	bcs->broadcast=broadcast;
 	bcs->connectionMode=connectionMode;
 	bcs->receipt=receipt;
+	bcs->deadline=deadline;
+	bcs->coalescingKey=coalescingKey;
 	bcs->command=BufferedCommandStruct::BCS_SEND;
 	bufferedCommands.Push(bcs);
 
 	if (priority==IMMEDIATE_PRIORITY)
 	{
 		// Forces pending sends to go out now, rather than waiting to the next update interval
-		quitAndDataEvents.SetEvent();
+		SignalNetworkLoop();
 	}
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
-bool RakPeer::SendImmediate( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, bool useCallerDataAllocation, RakNet::TimeUS currentTime, uint32_t receipt )
+bool RakPeer::SendImmediate( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, bool useCallerDataAllocation, RakNet::TimeUS currentTime, uint32_t receipt, RakNet::TimeUS deadline, uint32_t coalescingKey )
 {
 	unsigned *sendList;
 	unsigned sendListSize;
@@ -4318,7 +4602,7 @@ bool RakPeer::SendImmediate( char *data, BitSize_t numberOfBitsToSend, PacketPri
 	{
 		// Send may split the packet and thus deallocate data.  Don't assume data is valid if we use the callerAllocationData
 		bool useData = useCallerDataAllocation && callerDataAllocationUsed==false && sendListIndex+1==sendListSize;
-		remoteSystemList[sendList[sendListIndex]].reliabilityLayer.Send( data, numberOfBitsToSend, priority, reliability, orderingChannel, useData==false, remoteSystemList[sendList[sendListIndex]].MTUSize, currentTime, receipt );
+		remoteSystemList[sendList[sendListIndex]].reliabilityLayer.Send( data, numberOfBitsToSend, priority, reliability, orderingChannel, useData==false, remoteSystemList[sendList[sendListIndex]].MTUSize, currentTime, receipt, deadline, coalescingKey );
 		if (useData)
 			callerDataAllocationUsed=true;
 
@@ -4468,19 +4752,20 @@ void RakPeer::GenerateGUID(void)
 namespace RakNet {
 bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data, const int length, RakPeer *rakPeer, RakNetSocket2* rakNetSocket, bool *isOfflineMessage, RakNet::TimeUS timeRead )
 {
-	(void) timeRead;
 	RakPeer::RemoteSystemStruct *remoteSystem;
 	RakNet::Packet *packet;
 	unsigned i;
 
 
-	char str1[64];
-	systemAddress.ToString(false, str1);
-	if (rakPeer->IsBanned( str1 ))
+	if (rakPeer->banList.IsBanned( systemAddress ))
 	{
 		for (i=0; i < rakPeer->pluginListNTS.Size(); i++)
 			rakPeer->pluginListNTS[i]->OnDirectSocketReceive(data, length*8, systemAddress);
 
+		// Don't let spoofed datagrams from a banned range turn us into a flood of ID_CONNECTION_BANNED
+		if (rakPeer->AllowOfflineMessage(systemAddress, timeRead)==false)
+			return true;
+
 		RakNet::BitStream bs;
 		bs.Write((MessageID)ID_CONNECTION_BANNED);
 		bs.WriteAlignedBytes((const unsigned char*) OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID));
@@ -4506,57 +4791,14 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 	}
 
 
-
-	// The reason for all this is that the reliability layer has no way to tell between offline messages that arrived late for a player that is now connected,
-	// and a regular encoding. So I insert OFFLINE_MESSAGE_DATA_ID into the stream, the encoding of which is essentially impossible to hit by chance
-	if (length <=2)
-	{
-		*isOfflineMessage=true;
-	}
-	else if (
-		((unsigned char)data[0] == ID_UNCONNECTED_PING ||
-		(unsigned char)data[0] == ID_UNCONNECTED_PING_OPEN_CONNECTIONS) &&
-		length >= sizeof(unsigned char) + sizeof(RakNet::Time) + sizeof(OFFLINE_MESSAGE_DATA_ID))
-	{
-		*isOfflineMessage=memcmp(data+sizeof(unsigned char) + sizeof(RakNet::Time), OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID))==0;
-	}
-	else if ((unsigned char)data[0] == ID_UNCONNECTED_PONG && (size_t) length >= sizeof(unsigned char) + sizeof(RakNet::TimeMS) + RakNetGUID::size() + sizeof(OFFLINE_MESSAGE_DATA_ID))
-	{
-		*isOfflineMessage=memcmp(data+sizeof(unsigned char) + sizeof(RakNet::Time) + RakNetGUID::size(), OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID))==0;
-	}
-	else if (
-		(unsigned char)data[0] == ID_OUT_OF_BAND_INTERNAL	&&
-		(size_t) length >= sizeof(MessageID) + RakNetGUID::size() + sizeof(OFFLINE_MESSAGE_DATA_ID))
-	{
-		*isOfflineMessage=memcmp(data+sizeof(MessageID) + RakNetGUID::size(), OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID))==0;
-	}
-	else if (
-		(
-		(unsigned char)data[0] == ID_OPEN_CONNECTION_REPLY_1 ||
-		(unsigned char)data[0] == ID_OPEN_CONNECTION_REPLY_2 ||
-		(unsigned char)data[0] == ID_OPEN_CONNECTION_REQUEST_1 ||
-		(unsigned char)data[0] == ID_OPEN_CONNECTION_REQUEST_2 ||
-		(unsigned char)data[0] == ID_CONNECTION_ATTEMPT_FAILED ||
-		(unsigned char)data[0] == ID_NO_FREE_INCOMING_CONNECTIONS ||
-		(unsigned char)data[0] == ID_CONNECTION_BANNED ||
-		(unsigned char)data[0] == ID_ALREADY_CONNECTED ||
-		(unsigned char)data[0] == ID_IP_RECENTLY_CONNECTED) &&
-		(size_t) length >= sizeof(MessageID) + RakNetGUID::size() + sizeof(OFFLINE_MESSAGE_DATA_ID))
-	{
-		*isOfflineMessage=memcmp(data+sizeof(MessageID), OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID))==0;
-	}
-	else if (((unsigned char)data[0] == ID_INCOMPATIBLE_PROTOCOL_VERSION&&
-		(size_t) length == sizeof(MessageID)*2 + RakNetGUID::size() + sizeof(OFFLINE_MESSAGE_DATA_ID)))
-	{
-		*isOfflineMessage=memcmp(data+sizeof(MessageID)*2, OFFLINE_MESSAGE_DATA_ID, sizeof(OFFLINE_MESSAGE_DATA_ID))==0;
-	}
-	else
-	{
-		*isOfflineMessage=false;
-	}
+	*isOfflineMessage=IsOfflineMessage(data, length);
 
 	if (*isOfflineMessage)
 	{
+		// Drop before plugins or replies see it
+		if (rakPeer->AllowOfflineMessage(systemAddress, timeRead)==false)
+			return true;
+
 		for (i=0; i < rakPeer->pluginListNTS.Size(); i++)
 			rakPeer->pluginListNTS[i]->OnDirectSocketReceive(data, length*8, systemAddress);
 
@@ -4663,6 +4905,50 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 			packet->guid.systemIndex=packet->systemAddress.systemIndex;
 			rakPeer->AddPacketToProducer(packet);
 		}
+		else if ((unsigned char)(data)[0] == ID_CONNECTION_MIGRATION)
+		{
+			// A system that connected to us says it is now at this address
+			RakNet::BitStream bsIn((unsigned char*) data,length,false);
+			bsIn.IgnoreBytes(sizeof(MessageID));
+			bsIn.IgnoreBytes(sizeof(OFFLINE_MESSAGE_DATA_ID));
+			RakNetGUID guid;
+			uint32_t sequence;
+			bsIn.Read(guid);
+			bsIn.Read(sequence);
+
+			remoteSystem=rakPeer->GetRemoteSystemFromGUID(guid, true);
+			if (remoteSystem==0 ||
+				remoteSystem->hasConnectionMigrationKey==false ||
+				remoteSystem->weInitiatedTheConnection==true ||
+				remoteSystem->connectMode!=RakPeer::RemoteSystemStruct::CONNECTED ||
+				remoteSystem->systemAddress==systemAddress ||
+				sequence <= remoteSystem->connectionMigrationSequence ||
+				rakPeer->GetRemoteSystemFromSystemAddress(systemAddress, true, false)!=0)
+				return true;
+
+			unsigned char hmac[SHA1_LENGTH];
+			CSHA1::HMAC(remoteSystem->connectionMigrationKey, CONNECTION_MIGRATION_KEY_LENGTH, (unsigned char*) data, length-SHA1_LENGTH, hmac);
+			if (memcmp(hmac, data+length-SHA1_LENGTH, SHA1_LENGTH)!=0)
+				return true;
+
+			SystemAddress oldAddress = remoteSystem->systemAddress;
+			remoteSystem->connectionMigrationSequence=sequence;
+			remoteSystem->rakNetSocket=rakNetSocket;
+			rakPeer->ReferenceRemoteSystem(systemAddress, rakPeer->GetRemoteSystemIndex(oldAddress));
+
+			packet=rakPeer->AllocPacket(sizeof(MessageID)+sizeof(SystemAddress), _FILE_AND_LINE_);
+			RakNet::BitStream bsOut(packet->data, packet->length, false);
+			bsOut.ResetWritePointer();
+			bsOut.Write((MessageID)ID_CONNECTION_MIGRATION);
+			bsOut.Write(oldAddress);
+			packet->bitSize=bsOut.GetNumberOfBitsUsed();
+			packet->length=bsOut.GetNumberOfBytesUsed();
+			packet->systemAddress = systemAddress;
+			packet->systemAddress.systemIndex = remoteSystem->remoteSystemIndex;
+			packet->guid = remoteSystem->guid;
+			packet->guid.systemIndex=packet->systemAddress.systemIndex;
+			rakPeer->AddPacketToProducer(packet);
+		}
 		else if ((unsigned char)(data)[0] == (MessageID)ID_OPEN_CONNECTION_REPLY_1)
 		{
 			for (i=0; i < rakPeer->pluginListNTS.Size(); i++)
@@ -4673,6 +4959,7 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 			bsIn.IgnoreBytes(sizeof(OFFLINE_MESSAGE_DATA_ID));
 			RakNetGUID serverGuid;
 			bsIn.Read(serverGuid);
+			// 0 = no cookie, 1 = cookie and public key, 2 = cookie only
 			unsigned char serverHasSecurity;
 			uint32_t cookie;
 			(void) cookie;
@@ -4697,7 +4984,7 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 				rcs=rakPeer->requestedConnectionQueue[i];
 				if (rcs->systemAddress==systemAddress)
 				{
-					if (serverHasSecurity)
+					if (serverHasSecurity==1)
 					{
 #if LIBCAT_SECURITY==1
 						unsigned char public_key[cat::EasyHandshake::PUBLIC_KEY_BYTES];
@@ -5030,6 +5317,8 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 				{
 					connectionAttemptCancelled=true;
 					rakPeer->requestedConnectionQueue.RemoveAtIndex(i);
+					if (rakPeer->peerGroup)
+						rakPeer->peerGroup->ReleaseAddress(systemAddress, rakPeer);
 
 #if LIBCAT_SECURITY==1
 					CAT_AUDIT_PRINTF("AUDIT: Connection attempt canceled so deleting rcs->client_handshake object %x\n", rcs->client_handshake);
@@ -5106,6 +5395,12 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 			}
 			else
 #endif // LIBCAT_SECURITY
+			if (rakPeer->useHandshakeCookies)
+			{
+				bsOut.Write((unsigned char) 2); // HasCookie Yes, no public key
+				bsOut.Write(rakPeer->GenerateHandshakeCookie(systemAddress, RakNet::GetTimeMS()/HANDSHAKE_COOKIE_INTERVAL_MS));
+			}
+			else
 				bsOut.Write((unsigned char) 0);  // HasCookie oN
 
 			// MTU. Lower MTU if it is exceeds our own limit
@@ -5174,7 +5469,15 @@ bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data,
 #endif
 				}
 			}
+			else
 #endif // LIBCAT_SECURITY
+			if (rakPeer->useHandshakeCookies)
+			{
+				// Drop requests from addresses that never got our reply, before looking up or allocating anything for them
+				uint32_t cookie;
+				if (bs.Read(cookie)==false || rakPeer->VerifyHandshakeCookie(systemAddress, cookie)==false)
+					return true;
+			}
 
 			bs.Read(bindingAddress);
 			uint16_t mtu;
@@ -5369,6 +5672,19 @@ void ProcessNetworkPacket( SystemAddress systemAddress, const char *data, const
 #endif // LIBCAT_SECURITY
 
 	RakAssert(systemAddress.GetPort());
+	RakPeer::RemoteSystemStruct *remoteSystem;
+
+	// Nearly all traffic is from connected systems, so look the sender up first. Offline messages are only parsed if it is not connected, or if the datagram looks like one.
+	remoteSystem = rakPeer->GetRemoteSystemFromSystemAddress( systemAddress, true, true );
+	if ( remoteSystem && IsOfflineMessage(data, length)==false && rakPeer->banList.IsBanned( systemAddress )==false )
+	{
+		// HandleSocketReceiveFromConnectedPlayer is only safe to be called from the same thread as Update, which is this thread
+		remoteSystem->reliabilityLayer.HandleSocketReceiveFromConnectedPlayer(
+			data, length, systemAddress, rakPeer->pluginListNTS, remoteSystem->MTUSize,
+			rakNetSocket, &rnr, timeRead, updateBitStream);
+		return;
+	}
+
 	bool isOfflineMessage;
 	if (ProcessOfflineNetworkPacket(systemAddress, data, length, rakPeer, rakNetSocket, &isOfflineMessage, timeRead))
 	{
@@ -5376,9 +5692,8 @@ void ProcessNetworkPacket( SystemAddress systemAddress, const char *data, const
 	}
 
 //	RakNet::Packet *packet;
-	RakPeer::RemoteSystemStruct *remoteSystem;
 
-	// See if this datagram came from a connected system
+	// See if this datagram came from a connected system. Processing an offline message can add one
 	remoteSystem = rakPeer->GetRemoteSystemFromSystemAddress( systemAddress, true, true );
 	if ( remoteSystem )
 	{
@@ -5426,11 +5741,193 @@ void RakPeer::DerefAllSockets(void)
 	unsigned int i;
 	for (i=0; i < socketList.Size(); i++)
 	{
-		delete socketList[i];
+		// Sockets from a RakPeerGroup belong to the group
+		if (peerGroup==0)
+			delete socketList[i];
 	}
 	socketList.Clear(false, _FILE_AND_LINE_);
 }
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+StartupResult RakPeer::BindSockets( SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority, bool nonBlockingSocket, RNS2EventHandler *eventHandler, DataStructures::List<RakNetSocket2* > &sockets )
+{
+	int i;
+	// Go through all socket descriptors and precreate sockets on the specified addresses
+	for (i=0; i<socketDescriptorCount; i++)
+	{
+		/*
+		const char *addrToBind;
+		if (socketDescriptors[i].hostAddress[0]==0)
+			addrToBind=0;
+		else
+			addrToBind=socketDescriptors[i].hostAddress;
+			*/
+
+
+
+
+
+
+
+
+
+		/*
+#if RAKNET_SUPPORT_IPV6==1
+		if (SocketLayer::IsSocketFamilySupported(addrToBind, socketDescriptors[i].socketFamily)==false)
+			return SOCKET_FAMILY_NOT_SUPPORTED;
+#endif
+
+		if (socketDescriptors[i].port!=0 && SocketLayer::IsPortInUse(socketDescriptors[i].port, addrToBind, socketDescriptors[i].socketFamily)==true)
+		{
+			return SOCKET_PORT_ALREADY_IN_USE;
+		}
+
+		RakNetSocket* rns = 0;
+		if (socketDescriptors[i].remotePortRakNetWasStartedOn_PS3_PSP2==0)
+		{
+			rns = SocketLayer::CreateBoundSocket( this, socketDescriptors[i].port, socketDescriptors[i].blockingSocket, addrToBind, 100, socketDescriptors[i].extraSocketOptions, socketDescriptors[i].socketFamily, socketDescriptors[i].chromeInstance );
+		}
+		else
+		{
+#if defined(_PS3) || defined(__PS3__) || defined(SN_TARGET_PS3) || defined(_PS4)
+			rns = SocketLayer::CreateBoundSocket_PS3Lobby( socketDescriptors[i].port, socketDescriptors[i].blockingSocket, addrToBind, socketDescriptors[i].socketFamily );
+#elif  defined(SN_TARGET_PSP2)
+			rns = SocketLayer::CreateBoundSocket_PSP2( socketDescriptors[i].port, socketDescriptors[i].blockingSocket, addrToBind, socketDescriptors[i].socketFamily );
+#endif
+		}
+		*/
+
+		RakNetSocket2 *r2 = socketDescriptors[i].useIOUring ? RakNetSocket2Allocator::AllocRNS2_IOUring() : RakNetSocket2Allocator::AllocRNS2();
+		r2->SetUserConnectionSocketIndex(i);
+		#if defined(__native_client__)
+		NativeClientBindParameters ncbp;
+		RNS2_NativeClient * nativeClientSocket = (RNS2_NativeClient*) r2;
+		ncbp.eventHandler=eventHandler;
+		ncbp.forceHostAddress=(char*) socketDescriptors[i].hostAddress;
+		ncbp.is_ipv6=socketDescriptors[i].socketFamily==AF_INET6;
+		ncbp.nativeClientInstance=socketDescriptors[i].chromeInstance;
+		ncbp.port=socketDescriptors[i].port;
+		nativeClientSocket->Bind(&ncbp, _FILE_AND_LINE_);
+		#elif defined(WINDOWS_STORE_RT)
+		RNS2BindResult br;
+		((RNS2_WindowsStore8*) r2)->SetRecvEventHandler(eventHandler);
+		br = ((RNS2_WindowsStore8*) r2)->Bind(ref new Platform::String());
+		if (br!=BR_SUCCESS)
+		{
+			RakNetSocket2Allocator::DeallocRNS2(r2);
+			return SOCKET_FAILED_TO_BIND;
+		}
+		#else
+		if (r2->IsBerkleySocket())
+		{
+			RNS2_BerkleyBindParameters bbp;
+			bbp.port=socketDescriptors[i].port;
+			bbp.hostAddress=(char*) socketDescriptors[i].hostAddress;
+			bbp.addressFamily=socketDescriptors[i].socketFamily;
+			bbp.type=SOCK_DGRAM;
+			bbp.protocol=socketDescriptors[i].extraSocketOptions;
+			// The epoll loop reads until the socket would block
+			bbp.nonBlockingSocket=nonBlockingSocket;
+			bbp.setBroadcast=true;
+			bbp.setIPHdrIncl=false;
+			bbp.doNotFragment=false;
+			bbp.reusePort=socketDescriptors[i].reusePort || socketDescriptors[i].reusePortSocketCount>1;
+			bbp.pollingThreadPriority=threadPriority;
+			bbp.eventHandler=eventHandler;
+			bbp.remotePortRakNetWasStartedOn_PS3_PS4_PSP2=socketDescriptors[i].remotePortRakNetWasStartedOn_PS3_PSP2;
+			RNS2BindResult br = ((RNS2_Berkley*) r2)->Bind(&bbp, _FILE_AND_LINE_);
+
+			if (
+			#if RAKNET_SUPPORT_IPV6==0
+				socketDescriptors[i].socketFamily!=AF_INET ||
+			#endif
+				br==BR_REQUIRES_RAKNET_SUPPORT_IPV6_DEFINE)
+			{
+				RakNetSocket2Allocator::DeallocRNS2(r2);
+				return SOCKET_FAMILY_NOT_SUPPORTED;
+			}
+			else if (br==BR_FAILED_TO_BIND_SOCKET)
+			{
+				RakNetSocket2Allocator::DeallocRNS2(r2);
+				return SOCKET_PORT_ALREADY_IN_USE;
+			}
+			else if (br==BR_FAILED_SEND_TEST)
+			{
+				RakNetSocket2Allocator::DeallocRNS2(r2);
+				return SOCKET_FAILED_TEST_SEND;
+			}
+			else
+			{
+				RakAssert(br==BR_SUCCESS);
+			}
+		}
+		else
+		{
+			RakAssert("TODO" && 0);
+		}
+		#endif
+/*
+
+		SystemAddress saOut;
+		SocketLayer::GetSystemAddress( rns, &saOut );
+		rns->SetBoundAddress(saOut);
+		rns->SetRemotePortRakNetWasStartedOn(socketDescriptors[i].remotePortRakNetWasStartedOn_PS3_PSP2);
+		rns->SetChromeInstance(socketDescriptors[i].chromeInstance);
+		rns->SetExtraSocketOptions(socketDescriptors[i].extraSocketOptions);
+		rns->SetUserConnectionSocketIndex(i);
+		rns->SetBlockingSocket(socketDescriptors[i].blockingSocket);
+
+#if RAKNET_SUPPORT_IPV6==0
+		if (addrToBind==0)
+			rns->SetBoundAddressToLoopback(4);
+#endif
+
+		// GetBoundAddress is asynch, which isn't supported by this architecture
+#if !defined(__native_client__)
+		int zero=0;
+		if (SocketLayer::SendTo(rns, (const char*) &zero,4, rns->GetBoundAddress(), _FILE_AND_LINE_)!=0)
+		{
+			return SOCKET_FAILED_TEST_SEND;
+		}
+#endif
+		*/
+
+		if (socketDescriptors[i].attachPacketFilter)
+			AttachOfflinePacketFilter(r2);
+
+		sockets.Push(r2, _FILE_AND_LINE_ );
+
+	}
+
+#if !defined(__native_client__) && !defined(WINDOWS_STORE_RT) && defined(SO_REUSEPORT)
+	// Additional SO_REUSEPORT sockets go after the ones for the descriptors, so sockets[i] remains the first socket for descriptor i
+	for (i=0; i<socketDescriptorCount; i++)
+	{
+		if (socketDescriptors[i].reusePortSocketCount<=1 || sockets[i]->IsBerkleySocket()==false)
+			continue;
+
+		RNS2_BerkleyBindParameters bbp;
+		memcpy(&bbp, ((RNS2_Berkley*) sockets[i])->GetBindings(), sizeof(RNS2_BerkleyBindParameters));
+		// If the port was autoassigned, bind the other sockets to the same one
+		bbp.port=sockets[i]->GetBoundAddress().GetPort();
+		for (unsigned short reuseIndex=1; reuseIndex < socketDescriptors[i].reusePortSocketCount; reuseIndex++)
+		{
+			RakNetSocket2 *r2 = socketDescriptors[i].useIOUring ? RakNetSocket2Allocator::AllocRNS2_IOUring() : RakNetSocket2Allocator::AllocRNS2();
+			r2->SetUserConnectionSocketIndex(i);
+			if (((RNS2_Berkley*) r2)->Bind(&bbp, _FILE_AND_LINE_)!=BR_SUCCESS)
+			{
+				RakNetSocket2Allocator::DeallocRNS2(r2);
+				return SOCKET_PORT_ALREADY_IN_USE;
+			}
+			if (socketDescriptors[i].attachPacketFilter)
+				AttachOfflinePacketFilter(r2);
+			sockets.Push(r2, _FILE_AND_LINE_ );
+		}
+	}
+#endif
+
+	return RAKNET_STARTED;
+}
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 unsigned int RakPeer::GetRakNetSocketFromUserConnectionSocketIndex(unsigned int userIndex) const
 {
 	unsigned int i;
@@ -5556,7 +6053,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 				timeMS = (RakNet::TimeMS)(timeNS/(RakNet::TimeUS)1000);
 			}
 
-			callerDataAllocationUsed=SendImmediate((char*)bcs->data, bcs->numberOfBitsToSend, bcs->priority, bcs->reliability, bcs->orderingChannel, bcs->systemIdentifier, bcs->broadcast, true, timeNS, bcs->receipt);
+			callerDataAllocationUsed=SendImmediate((char*)bcs->data, bcs->numberOfBitsToSend, bcs->priority, bcs->reliability, bcs->orderingChannel, bcs->systemIdentifier, bcs->broadcast, true, timeNS, bcs->receipt, bcs->deadline, bcs->coalescingKey);
 			if ( callerDataAllocationUsed==false )
 				rakFree_Ex(bcs->data, _FILE_AND_LINE_ );
 
@@ -5655,6 +6152,8 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 						packet->systemAddress = rcs->systemAddress;
 						AddPacketToProducer(packet);
 					}
+					if (peerGroup)
+						peerGroup->ReleaseAddress(rcs->systemAddress, this);
 
 #if LIBCAT_SECURITY==1
 					CAT_AUDIT_PRINTF("AUDIT: Connection attempt FAILED so deleting rcs->client_handshake object %x\n", rcs->client_handshake);
@@ -5757,6 +6256,9 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 		requestedConnectionQueueMutex.Unlock();
 	}
 
+	// Only takes the ban list lock when a timed ban is due
+	banList.RemoveExpired(RakNet::GetTimeMS());
+
 	// remoteSystemList in network thread
 	for ( activeSystemListIndex = 0; activeSystemListIndex < activeSystemListSize; ++activeSystemListIndex )
 	//for ( remoteSystemIndex = 0; remoteSystemIndex < remoteSystemListSize; ++remoteSystemIndex )
@@ -5798,6 +6300,8 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 			}
 
 			remoteSystem->reliabilityLayer.Update( remoteSystem->rakNetSocket, systemAddress, remoteSystem->MTUSize, timeNS, maxOutgoingBPS, pluginListNTS, &rnr, updateBitStream ); // systemAddress only used for the internet simulator test
+			// Path MTU discovery may have changed the datagram size
+			remoteSystem->MTUSize=remoteSystem->reliabilityLayer.GetPathMTU();
 
 			// Check for failure conditions
 			if ( remoteSystem->reliabilityLayer.IsDeadConnection() ||
@@ -5856,7 +6360,22 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 				PingInternal( systemAddress, true, UNRELIABLE );
 
 				// Update again immediately after this tick so the ping goes out right away
-				quitAndDataEvents.SetEvent();
+				SignalNetworkLoop();
+			}
+
+			// Silent while our messages go unacknowledged. If our NAT rebound, the remote system is sending to an address that no longer reaches us
+			if ( remoteSystem->connectMode==RemoteSystemStruct::CONNECTED && remoteSystem->hasConnectionMigrationKey && remoteSystem->weInitiatedTheConnection &&
+				timeMS > remoteSystem->reliabilityLayer.GetTimeLastDatagramArrived() &&
+				timeMS - remoteSystem->reliabilityLayer.GetTimeLastDatagramArrived() > CONNECTION_MIGRATION_REQUEST_INTERVAL_MS &&
+				timeMS - remoteSystem->lastConnectionMigrationRequest > CONNECTION_MIGRATION_REQUEST_INTERVAL_MS)
+			{
+				RakNetStatistics rakNetStatistics;
+				rnss=remoteSystem->reliabilityLayer.GetStatistics(&rakNetStatistics);
+				if (rnss->messagesInResendBuffer>0)
+				{
+					remoteSystem->lastConnectionMigrationRequest=timeMS;
+					SendConnectionMigrationRequest(remoteSystem);
+				}
 			}
 
 			// Find whoever has the lowest player ID
@@ -5939,7 +6458,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 							PingInternal( systemAddress, true, UNRELIABLE );
 
 							// Update again immediately after this tick so the ping goes out right away
-							quitAndDataEvents.SetEvent();
+							SignalNetworkLoop();
 
 							RakNet::BitStream inBitStream((unsigned char *) data, byteSize, false);
 							SystemAddress bsSystemAddress;
@@ -6017,7 +6536,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 						SendImmediate( (char*)outBitStream.GetData(), outBitStream.GetNumberOfBitsUsed(), IMMEDIATE_PRIORITY, UNRELIABLE, 0, systemAddress, false, false, RakNet::GetTimeUS(), 0 );
 
 						// Update again immediately after this tick so the ping goes out right away
-						quitAndDataEvents.SetEvent();
+						SignalNetworkLoop();
 
 						rakFree_Ex(data, _FILE_AND_LINE_ );
 					}
@@ -6090,6 +6609,7 @@ bool RakPeer::RunUpdateCycle(BitStream &updateBitStream )
 								inBitStream.Read(sendPingTime);
 								inBitStream.Read(sendPongTime);
 								OnConnectedPong(sendPingTime, sendPongTime, remoteSystem);
+								remoteSystem->hasConnectionMigrationKey=inBitStream.ReadAlignedBytes(remoteSystem->connectionMigrationKey, CONNECTION_MIGRATION_KEY_LENGTH);
 
 								// Find a free remote system struct to use
 								//						RakNet::BitStream casBitS(data, byteSize, false);
@@ -6192,7 +6712,9 @@ void RakPeer::OnRNS2Recv(RNS2RecvStruct *recvStruct)
 	}
 
 	PushBufferedPacket(recvStruct);
-	quitAndDataEvents.SetEvent();
+	// The epoll loop reads on the update thread, which runs an update cycle next anyway
+	if (epollFd==-1)
+		SignalNetworkLoop();
 }
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
@@ -6281,6 +6803,13 @@ RAK_THREAD_DECLARATION(RakNet::UpdateNetworkLoop)
 		if (rakPeer->userUpdateThreadPtr)
 			rakPeer->userUpdateThreadPtr(rakPeer, rakPeer->userUpdateThreadData);
 
+		if (rakPeer->epollFd!=-1)
+		{
+			// Returns when endThreads is set
+			rakPeer->RunEpollNetworkLoop(updateBitStream);
+			break;
+		}
+
 		rakPeer->RunUpdateCycle(updateBitStream);
 
 		// Pending sends go out this often, unless quitAndDataEvents is set
@@ -35,6 +35,8 @@
 #include "NativeFeatureIncludes.h"
 #include "SecureHandshake.h"
 #include "LocklessTypes.h"
+#include "BanList.h"
+#include "OfflineRateLimiter.h"
 #include "DS_Queue.h"
 
 namespace RakNet {
@@ -77,6 +79,14 @@ public:
 	/// \return RAKNET_STARTED on success, otherwise appropriate failure enumeration.
 	StartupResult Startup( unsigned int maxConnections, SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority=-99999 );
 
+	/// \brief Starts on the sockets and update threads of a RakPeerGroup, rather than opening sockets and starting threads of its own.
+	/// \details Datagrams are passed to this instance by the group, based on the address they came from. See RakPeerGroup.
+	/// \note Multiple calls while already active are ignored.  To call this function again with different settings, you must first call Shutdown().
+	/// \param[in] maxConnections Maximum number of connections between this instance of RakPeer and another instance of RakPeer.
+	/// \param[in] group A RakPeerGroup that was started with RakPeerGroup::Startup(). It must not be shut down until this instance is.
+	/// \return RAKNET_STARTED on success, INVALID_SOCKET_DESCRIPTORS if \a group was not started, otherwise appropriate failure enumeration.
+	StartupResult Startup( unsigned int maxConnections, RakPeerGroup *group );
+
 	/// If you accept connections, you must call this or else security will not be enabled for incoming connections.
 	/// This feature requires more round trips, bandwidth, and CPU time for the connection handshake
 	/// x64 builds require under 25% of the CPU time of other builds
@@ -218,8 +228,10 @@ public:
 	/// \param[in] systemIdentifier Who to send this packet to, or in the case of broadcasting who not to send it to. Pass either a SystemAddress structure or a RakNetGUID structure. Use UNASSIGNED_SYSTEM_ADDRESS or to specify none
 	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
 	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
-	uint32_t Send( const char *data, const int length, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0 );
+	uint32_t Send( const char *data, const int length, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 );
 
 	/// \brief "Send" to yourself rather than a remote system.
 	/// \details The message will be processed through the plugins and returned to the game as usual.
@@ -239,9 +251,11 @@ public:
 	/// \param[in] systemIdentifier System Address or RakNetGUID to send this packet to, or in the case of broadcasting, the address not to send it to.  Use UNASSIGNED_SYSTEM_ADDRESS to specify none.
 	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
 	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
 	/// \note COMMON MISTAKE: When writing the first byte, bitStream->Write((unsigned char) ID_MY_TYPE) be sure it is casted to a byte, and you are not writing a 4 byte enumeration.
-	uint32_t Send( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0 );
+	uint32_t Send( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 );
 
 	/// \brief Sends multiple blocks of data, concatenating them automatically.
 	///
@@ -262,8 +276,24 @@ public:
 	/// \param[in] systemIdentifier System Address or RakNetGUID to send this packet to, or in the case of broadcasting, the address not to send it to.  Use UNASSIGNED_SYSTEM_ADDRESS to specify none.
 	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
 	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
-	uint32_t SendList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0 );
+	uint32_t SendList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 );
+
+	/// \brief Sends the segments of a BitStreamChain as one message, the same as SendList() with the chain's segments.
+	/// \details The segments are gathered straight into the send buffer, so what they reference is copied once, and can be changed again as soon as this returns.
+	/// \param[in] chain The segments to send
+	/// \param[in] priority Priority level to send on.  See PacketPriority.h
+	/// \param[in] reliability How reliably to send this data.  See PacketPriority.h
+	/// \param[in] orderingChannel Channel to order the messages on, when using ordered or sequenced messages. Messages are only ordered relative to other messages on the same stream.
+	/// \param[in] systemIdentifier System Address or RakNetGUID to send this packet to, or in the case of broadcasting, the address not to send it to.  Use UNASSIGNED_SYSTEM_ADDRESS to specify none.
+	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
+	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
+	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
+	uint32_t SendChain( const RakNet::BitStreamChain *chain, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 );
 
 	/// \brief Gets a message from the incoming message queue.
 	/// \details Use DeallocatePacket() to deallocate the message after you are done with it.
@@ -328,6 +358,7 @@ public:
 	/// \brief Bans an IP from connecting.
 	/// \details Banned IPs persist between connections but are not saved on shutdown nor loaded on startup.
 	/// \param[in] IP Dotted IP address. You can use * for a wildcard address, such as 128.0.0. * will ban all IP addresses starting with 128.0.0.
+	/// CIDR ranges such as 10.0.0.0/8 and, with RAKNET_SUPPORT_IPV6, IPv6 addresses and ranges such as 2001:db8::/32 are also accepted.
 	/// \param[in] milliseconds Gives time in milli seconds for a temporary ban of the IP address.  Use 0 for a permanent ban.
 	void AddToBanList( const char *IP, RakNet::TimeMS milliseconds=0 );
 
@@ -347,6 +378,22 @@ public:
 	/// \details This is a security measure which is disabled by default, but can be set to true to prevent attackers from using up all connection slots.
 	/// \param[in] b True to limit connections from the same ip to at most 1 per 100 milliseconds.
 	void SetLimitIPConnectionFrequency(bool b);
+
+	/// \brief Require connecting systems to echo a cookie from ID_OPEN_CONNECTION_REPLY_1 before any state is kept for them.
+	/// \details The cookie is a keyed hash of the remote address and the time, so a flood of connection requests from spoofed addresses is dropped without touching the connection list.
+	/// \note Systems connecting to us must be running a version that understands the cookie. Has no effect with secure connections, which always use a cookie.
+	/// \param[in] b True to require cookies. Defaults to false.
+	void SetHandshakeCookies(bool b);
+
+	/// \brief Limit how often unconnected systems can send us offline messages, such as pings, ID_ADVERTISE_SYSTEM, out of band messages and connection requests.
+	/// \details Without a limit, every offline message is answered, so spoofed pings can use us to flood another system.
+	/// Messages over the limit are dropped. Limits are per address and per address prefix, using token buckets in a fixed amount of memory.
+	/// \param[in] settings Rates and bursts. A rate of 0 turns off that limit. Both limits are off by default.
+	void SetOfflineRateLimit( const OfflineRateLimitSettings &settings );
+
+	/// \brief Get how many offline messages were allowed and dropped by the limit set with SetOfflineRateLimit().
+	/// \param[out] statistics Counters since the RakPeer was created
+	void GetOfflineRateLimitStatistics( OfflineRateLimitStatistics *statistics ) const;
 	
 	// --------------------------------------------------------------------------------------------Pinging Functions - Functions dealing with the automatic ping mechanism--------------------------------------------------------------------------------------------
 	/// Send a ping to the specified connected system.
@@ -488,6 +535,13 @@ public:
 	/// \param[in] allow - True to allow this behavior, false to not allow. Defaults to false. Value persists between connections.
 	void AllowConnectionResponseIPMigration( bool allow );
 
+	/// \brief Allow systems that connect to us to keep their connection when their address changes, such as when a mobile client's NAT rebinds.
+	/// \details While enabled, each new incoming connection is given a random key. If that system stops hearing from us while it has unacknowledged messages, it sends an offline message authenticated with the key, and the connection is moved to the address that message came from.
+	/// Reliability state and queued messages are kept, and you get ID_CONNECTION_MIGRATION.
+	/// \note Only the system that accepted the connection needs to call this. The key is sent unencrypted unless secure connections are enabled.
+	/// \param[in] allow - True to allow this behavior, false to not allow. Defaults to false. Applies to connections made after the call.
+	void AllowConnectionMigration( bool allow );
+
 	/// \brief Sends a one byte message ID_ADVERTISE_SYSTEM to the remote unconnected system.
 	/// This will send our external IP outside the LAN along with some user data to the remote system.
 	/// \pre The sender and recipient must already be started via a successful call to Initialize
@@ -516,6 +570,14 @@ public:
 	/// \param[in] timeoutMS How many ms to wait before simply not sending an unreliable message.
 	void SetUnreliableTimeout(RakNet::TimeMS timeoutMS);
 
+	/// \brief Enable or disable path MTU discovery on connections.
+	/// While enabled, each connection periodically sends padded probe datagrams to find the largest datagram size that reaches the remote system, starting from the size found during the connection handshake.
+	/// If reliable messages stop getting through at the current size, the connection falls back to a conservative size and searches again. Messages queued but not yet sent are split again when the size drops.
+	/// Probes wait for congestion control like other datagrams, and probes for a larger size also stay within SetPerConnectionOutgoingBandwidthLimit().
+	/// GetMTUSize() and RakNetStatistics::MTUSize return the size in use.  Defaults to false.
+	/// \param[in] enabled True to enable path MTU discovery
+	void SetPathMTUDiscovery(bool enabled);
+
 	/// \brief Send a message to a host, with the IP socket option TTL set to 3.
 	/// \details This message will not reach the host, but will open the router.
 	/// \param[in] host The address of the remote host in dotted notation.
@@ -584,6 +646,14 @@ public:
 	/// RNS2RecvStruct will only remain valid for the duration of the call
 	virtual void SetIncomingDatagramEventHandler( bool (*_incomingDatagramEventHandler)(RNS2RecvStruct *) );
 
+	/// Linux only: receive on all sockets from RakNet's update thread, using one epoll loop, instead of starting a blocking receive thread per socket.
+	/// The loop also waits on a timerfd for the regular update tick, and on an eventfd so sends with IMMEDIATE_PRIORITY and incoming datagrams are handled without delay.
+	/// With this enabled, RakPeer runs on a single internal thread no matter how many SocketDescriptors are passed to Startup().
+	/// Must be called while offline. Has no effect on other platforms, or when started with a RakPeerGroup.
+	/// If the epoll instance, timerfd or eventfd cannot be created, Startup() uses the receive threads instead.
+	/// \param[in] enabled True to use the epoll loop. Defaults to false.
+	virtual void SetEpollNetworkLoop( bool enabled );
+
 	// --------------------------------------------------------------------------------------------Network Simulator Functions--------------------------------------------------------------------------------------------
 	/// Adds simulated ping and packet loss to the outgoing data flow.
 	/// To simulate bi-directional ping and packet loss, you should call this on both the sender and the recipient, with half the total ping and packetloss value on each.
@@ -681,6 +751,13 @@ public:
 		// Reference counted socket to send back on
 		RakNetSocket2* rakNetSocket;
 		SystemIndex remoteSystemIndex;
+		// Issued by the system that accepted the connection. Authenticates ID_CONNECTION_MIGRATION
+		bool hasConnectionMigrationKey;
+		unsigned char connectionMigrationKey[CONNECTION_MIGRATION_KEY_LENGTH];
+		// Highest ID_CONNECTION_MIGRATION sequence number sent or accepted, so old requests cannot be replayed
+		uint32_t connectionMigrationSequence;
+		// When we last sent ID_CONNECTION_MIGRATION to this system
+		RakNet::TimeMS lastConnectionMigrationRequest;
 
 #if LIBCAT_SECURITY==1
 		// Cached answer used internally by RakPeer to prevent DoS attacks based on the connexion handshake
@@ -702,6 +779,7 @@ protected:
 	friend RAK_THREAD_DECLARATION(UpdateNetworkLoop);
 	//friend RAK_THREAD_DECLARATION(RecvFromLoop);
 	friend RAK_THREAD_DECLARATION(UDTConnect);
+	friend class RakPeerGroup;
 
 	friend bool ProcessOfflineNetworkPacket( SystemAddress systemAddress, const char *data, const int length, RakPeer *rakPeer, RakNetSocket2* rakNetSocket, bool *isOfflineMessage, RakNet::TimeUS timeRead );
 	friend void ProcessNetworkPacket( const SystemAddress systemAddress, const char *data, const int length, RakPeer *rakPeer, RakNet::TimeUS timeRead, BitStream &updateBitStream );
@@ -724,6 +802,12 @@ protected:
 	///Parse out a connection request packet
 	void ParseConnectionRequestPacket( RakPeer::RemoteSystemStruct *remoteSystem, const SystemAddress &systemAddress, const char *data, int byteSize);
 	void OnConnectionRequest( RakPeer::RemoteSystemStruct *remoteSystem, RakNet::Time incomingTimestamp );
+	///Tell a system we connected to that we may have a new address. Sent when it goes silent, in case our NAT rebound
+	void SendConnectionMigrationRequest( RakPeer::RemoteSystemStruct *remoteSystem );
+	///If \a data is ID_CONNECTION_MIGRATION, read the GUID of the system that sent it. Used by RakPeerGroup to route it
+	static bool GetConnectionMigrationGuid( const char *data, int length, RakNetGUID *guid );
+	///Returns false if an offline message from this address is over the limit set with SetOfflineRateLimit(). Thread safe
+	bool AllowOfflineMessage( const SystemAddress &systemAddress, RakNet::TimeUS timeRead );
 	///Send a reliable disconnect packet to this player and disconnect them when it is delivered
 	void NotifyAndFlagForShutdown( const SystemAddress systemAddress, bool performImmediate, unsigned char orderingChannel, PacketPriority disconnectionNotificationPriority );
 	///Returns how many remote systems initiated a connection to us
@@ -819,16 +903,10 @@ protected:
 	// bool isSocketLayerBlocking;
 	// bool continualPing,isRecvfromThreadActive,isMainLoopThreadActive, endThreads, isSocketLayerBlocking;
 	unsigned int validationInteger;
-	SimpleMutex incomingQueueMutex, banListMutex; //,synchronizedMemoryQueueMutex, automaticVariableSynchronizationMutex;
+	SimpleMutex incomingQueueMutex; //,synchronizedMemoryQueueMutex, automaticVariableSynchronizationMutex;
 	//DataStructures::Queue<Packet *> incomingpacketSingleProducerConsumer; //, synchronizedMemorypacketSingleProducerConsumer;
 	// BitStream enumerationData;
 
-	struct BanStruct
-	{
-		char *IP;
-		RakNet::TimeMS timeout; // 0 for none
-	};
-
 	struct RequestedConnectionStruct
 	{
 		SystemAddress systemAddress;
@@ -860,7 +938,10 @@ protected:
 #endif
 
 	//DataStructures::List<DataStructures::List<MemoryBlock>* > automaticVariableSynchronizationList;
-	DataStructures::List<BanStruct*> banList;
+	BanList banList;
+	// Allow() is called wherever datagrams are read, and the settings and statistics are used from user threads
+	OfflineRateLimiter offlineRateLimiter;
+	mutable SimpleMutex offlineRateLimiterMutex;
 	// Threadsafe, and not thread safe
 	DataStructures::List<PluginInterface2*> pluginListTS, pluginListNTS;
 
@@ -874,7 +955,7 @@ protected:
 		BitSize_t numberOfBitsToSend;
 		PacketPriority priority;
 		PacketReliability reliability;
-		char orderingChannel;
+		OrderingChannelType orderingChannel;
 		AddressOrGUID systemIdentifier;
 		bool broadcast;
 		RemoteSystemStruct::ConnectMode connectionMode;
@@ -888,6 +969,8 @@ protected:
 		RakNetSocket2* socket;
 		unsigned short port;
 		uint32_t receipt;
+		RakNet::TimeUS deadline;
+		uint32_t coalescingKey;
 		enum {BCS_SEND, BCS_CLOSE_CONNECTION, BCS_GET_SOCKET, BCS_CHANGE_SYSTEM_ADDRESS,/* BCS_USE_USER_SOCKET, BCS_REBIND_SOCKET_ADDRESS, BCS_RPC, BCS_RPC_SHIFT,*/ BCS_DO_NOTHING} command;
 	};
 
@@ -925,9 +1008,9 @@ protected:
 	void PingInternal( const SystemAddress target, bool performImmediate, PacketReliability reliability );
 	// This stores the user send calls to be handled by the update thread.  This way we don't have thread contention over systemAddresss
 	void CloseConnectionInternal( const AddressOrGUID& systemIdentifier, bool sendDisconnectionNotification, bool performImmediate, unsigned char orderingChannel, PacketPriority disconnectionNotificationPriority );
-	void SendBuffered( const char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt );
-	void SendBufferedList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt );
-	bool SendImmediate( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, bool useCallerDataAllocation, RakNet::TimeUS currentTime, uint32_t receipt );
+	void SendBuffered( const char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt, RakNet::TimeUS deadline=0, uint32_t coalescingKey=0 );
+	void SendBufferedList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, RemoteSystemStruct::ConnectMode connectionMode, uint32_t receipt, RakNet::TimeUS deadline=0, uint32_t coalescingKey=0 );
+	bool SendImmediate( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, bool useCallerDataAllocation, RakNet::TimeUS currentTime, uint32_t receipt, RakNet::TimeUS deadline=0, uint32_t coalescingKey=0 );
 	//bool HandleBufferedRPC(BufferedCommandStruct *bcs, RakNet::TimeMS time);
 	void ClearBufferedCommands(void);
 	void ClearBufferedPackets(void);
@@ -945,6 +1028,14 @@ protected:
 	// Smart pointer so I can return the object to the user
 	DataStructures::List<RakNetSocket2* > socketList;
 	void DerefAllSockets(void);
+	// Creates and binds a socket for each descriptor, then the extra SO_REUSEPORT sockets, and adds them to sockets. Used by Startup() and RakPeerGroup
+	// On failure, sockets that were already created are left in sockets
+	static StartupResult BindSockets( SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority, bool nonBlockingSocket, RNS2EventHandler *eventHandler, DataStructures::List<RakNetSocket2* > &sockets );
+	StartupResult StartupInternal( unsigned int maxConnections, SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority, RakPeerGroup *group );
+	// Set while started with a RakPeerGroup, which owns socketList and runs the update cycle
+	RakPeerGroup *peerGroup;
+	// Which of the group's update threads runs this instance
+	unsigned int peerGroupThreadIndex;
 	unsigned int GetRakNetSocketFromUserConnectionSocketIndex(unsigned int userIndex) const;
 	// Used for RPC replies
 	RakNet::BitStream *replyFromTargetBS;
@@ -970,10 +1061,13 @@ protected:
 	//unsigned int lastUserUpdateCycle;
 	/// True to allow connection accepted packets from anyone.  False to only allow these packets from servers we requested a connection to.
 	bool allowConnectionResponseIPMigration;
+	/// True to issue connection migration keys to incoming connections, and to accept ID_CONNECTION_MIGRATION
+	bool allowConnectionMigration;
 
 	SystemAddress firstExternalID;
 	int splitMessageProgressInterval;
 	RakNet::TimeMS unreliableTimeout;
+	bool pathMTUDiscovery;
 
 	bool (*incomingDatagramEventHandler)(RNS2RecvStruct *);
 
@@ -989,7 +1083,28 @@ protected:
 
 
 	SignaledEvent quitAndDataEvents;
+	// Wakes the update thread, including the epoll loop if in use
+	void SignalNetworkLoop(void);
+	// Update thread body when the epoll loop is in use
+	void RunEpollNetworkLoop(BitStream &updateBitStream);
+	// Creates epollFd, epollTimerFd and epollWakeupFd. Returns false, with none of them open, if any cannot be created
+	bool CreateEpollNetworkLoop(void);
+	// Registers socketList with epollFd
+	bool AddSocketsToEpollNetworkLoop(void);
+	// Closes what CreateEpollNetworkLoop opened. Only call once the update thread has stopped
+	void CloseEpollNetworkLoop(void);
+	bool useEpollNetworkLoop;
+	// Set while started with the epoll loop, or -1
+	int epollFd, epollTimerFd;
+	// eventfd written by SignalNetworkLoop, or -1. Guarded by epollWakeupMutex, so it is not written after it is closed
+	int epollWakeupFd;
+	SimpleMutex epollWakeupMutex;
 	bool limitConnectionFrequencyFromTheSameIP;
+	bool useHandshakeCookies;
+	// Regenerated on Startup
+	unsigned char handshakeCookieKey[HANDSHAKE_COOKIE_KEY_LENGTH];
+	uint32_t GenerateHandshakeCookie(const SystemAddress &systemAddress, RakNet::TimeMS interval);
+	bool VerifyHandshakeCookie(const SystemAddress &systemAddress, uint32_t cookie);
 
 	SimpleMutex packetAllocationPoolMutex;
 	DataStructures::MemoryPool<Packet> packetAllocationPool;
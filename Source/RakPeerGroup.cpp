@@ -0,0 +1,365 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include "RakPeerGroup.h"
+#include "RakPeer.h"
+#include "RakThread.h"
+#include "RakSleep.h"
+#include "RakAssert.h"
+#include "BitStream.h"
+
+using namespace RakNet;
+
+namespace RakNet
+{
+RAK_THREAD_DECLARATION(RakPeerGroupUpdateLoop)
+{
+	RakPeerGroup::UpdateThread *updateThread = ( RakPeerGroup::UpdateThread * ) arguments;
+	RakPeerGroup *group = updateThread->group;
+
+	BitStream updateBitStream( MAXIMUM_MTU_SIZE
+#if LIBCAT_SECURITY==1
+		+ cat::AuthenticatedEncryption::OVERHEAD_BYTES
+#endif
+		);
+
+	updateThread->isActive = true;
+
+	while ( group->endThreads == false )
+	{
+		group->RunUpdateCycles(updateThread, updateBitStream);
+
+		// Pending sends go out this often, unless an instance on this thread signals
+		updateThread->updateEvent.WaitOnEvent(10);
+	}
+
+	updateThread->isActive = false;
+	return 0;
+}
+}
+
+RakPeerGroup::RakPeerGroup()
+{
+	updateThreads=0;
+	updateThreadCount=0;
+	endThreads=true;
+	unknownSenderHandler=0;
+	unknownSenderHandlerData=0;
+}
+RakPeerGroup::~RakPeerGroup()
+{
+	Shutdown();
+}
+StartupResult RakPeerGroup::Startup( SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, unsigned int _updateThreadCount, int threadPriority )
+{
+	if (IsActive())
+		return RAKNET_ALREADY_STARTED;
+
+	RakAssert(socketDescriptors && socketDescriptorCount>=1);
+	if (socketDescriptors==0 || socketDescriptorCount<1)
+		return INVALID_SOCKET_DESCRIPTORS;
+
+	if (threadPriority==-99999)
+	{
+#if   defined(_WIN32)
+		threadPriority=0;
+#else
+		threadPriority=1000;
+#endif
+	}
+
+	// Blocking sockets, each with its own receive thread
+	StartupResult bindResult = RakPeer::BindSockets(socketDescriptors, socketDescriptorCount, threadPriority, false, this, socketList);
+	if (bindResult!=RAKNET_STARTED)
+	{
+		DerefAllSockets();
+		return bindResult;
+	}
+
+	if (_updateThreadCount<1)
+		_updateThreadCount=1;
+	updateThreadCount=_updateThreadCount;
+	updateThreads=RakNet::OP_NEW_ARRAY<UpdateThread>(updateThreadCount, _FILE_AND_LINE_);
+	endThreads=false;
+	unsigned int i;
+	for (i=0; i < updateThreadCount; i++)
+	{
+		updateThreads[i].group=this;
+		updateThreads[i].isActive=false;
+		updateThreads[i].peerCount=0;
+		updateThreads[i].updateEvent.InitEvent();
+	}
+	bool threadsCreated=true;
+	for (i=0; i < updateThreadCount; i++)
+	{
+		if (RakNet::RakThread::Create(RakPeerGroupUpdateLoop, &updateThreads[i], threadPriority)!=0)
+		{
+			threadsCreated=false;
+			break;
+		}
+	}
+	// Wait for the threads that did start, so Shutdown() can stop them
+	for (unsigned int j=0; j < i; j++)
+	{
+		while (updateThreads[j].isActive==false)
+			RakSleep(10);
+	}
+	if (threadsCreated==false)
+	{
+		Shutdown();
+		return FAILED_TO_CREATE_NETWORK_THREAD;
+	}
+
+#if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
+	for (i=0; i < socketList.Size(); i++)
+	{
+		if (socketList[i]->IsBerkleySocket())
+			((RNS2_Berkley*) socketList[i])->CreateRecvPollingThread(threadPriority);
+	}
+#endif
+
+	return RAKNET_STARTED;
+}
+void RakPeerGroup::Shutdown( void )
+{
+	unsigned int i;
+
+	// RakPeer::Shutdown() calls RemovePeer(), so work on a copy
+	DataStructures::List<RakPeer*> peers;
+	peersMutex.Lock();
+	peers=peerList;
+	peersMutex.Unlock();
+	for (i=0; i < peers.Size(); i++)
+		peers[i]->Shutdown(0);
+
+	if (updateThreads==0 && socketList.Size()==0)
+		return;
+
+	endThreads=true;
+
+#if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
+	for (i=0; i < socketList.Size(); i++)
+	{
+		if (socketList[i]->IsBerkleySocket())
+			((RNS2_Berkley *)socketList[i])->SignalStopRecvPollingThread();
+	}
+#endif
+
+	for (i=0; i < updateThreadCount; i++)
+	{
+		updateThreads[i].updateEvent.SetEvent();
+		while (updateThreads[i].isActive)
+			RakSleep(15);
+		updateThreads[i].updateEvent.CloseEvent();
+	}
+	RakNet::OP_DELETE_ARRAY(updateThreads, _FILE_AND_LINE_);
+	updateThreads=0;
+	updateThreadCount=0;
+
+#if !defined(__native_client__) && !defined(WINDOWS_STORE_RT)
+	for (i=0; i < socketList.Size(); i++)
+	{
+		if (socketList[i]->IsBerkleySocket())
+			((RNS2_Berkley *)socketList[i])->BlockOnStopRecvPollingThread();
+	}
+#endif
+
+	DerefAllSockets();
+	ClearRecvStructPool();
+}
+void RakPeerGroup::RunUpdateCycles( UpdateThread *updateThread, BitStream &updateBitStream )
+{
+	updateThread->peersMutex.Lock();
+	for (unsigned int i=0; i < updateThread->peers.Size(); i++)
+	{
+		RakPeer *rakPeer = updateThread->peers[i];
+		if (rakPeer->userUpdateThreadPtr)
+			rakPeer->userUpdateThreadPtr(rakPeer, rakPeer->userUpdateThreadData);
+		rakPeer->RunUpdateCycle(updateBitStream);
+	}
+	updateThread->peersMutex.Unlock();
+}
+bool RakPeerGroup::IsActive( void ) const
+{
+	return endThreads==false;
+}
+void RakPeerGroup::SetUnknownSenderHandler( RakPeerInterface *(*_unknownSenderHandler)(RNS2RecvStruct *, void *), void *_unknownSenderHandlerData )
+{
+	peersMutex.Lock();
+	unknownSenderHandler=_unknownSenderHandler;
+	unknownSenderHandlerData=_unknownSenderHandlerData;
+	peersMutex.Unlock();
+}
+unsigned int RakPeerGroup::GetPeerCount( void ) const
+{
+	return peerList.Size();
+}
+void RakPeerGroup::OnRNS2Recv(RNS2RecvStruct *recvStruct)
+{
+	RakPeer *rakPeer=0;
+
+	// Locked until the datagram is queued, so the instance cannot be removed in between
+	peersMutex.Lock();
+	RakPeer **owner = addressOwners.Peek(recvStruct->systemAddress);
+	RakNetGUID guid;
+	// A system that moved to a new address. Only the instance it is connected to can move the connection
+	if (owner==0 && RakPeer::GetConnectionMigrationGuid(recvStruct->data, recvStruct->bytesRead, &guid))
+		owner = migrationGuidOwners.Peek(guid);
+	if (owner)
+		rakPeer=*owner;
+	else if (unknownSenderHandler)
+	{
+		rakPeer=(RakPeer*) unknownSenderHandler(recvStruct, unknownSenderHandlerData);
+		RakAssert(rakPeer==0 || rakPeer->peerGroup==this);
+		if (rakPeer && rakPeer->peerGroup!=this)
+			rakPeer=0;
+	}
+	else if (peerList.Size()>0)
+		rakPeer=peerList[0];
+
+	if (rakPeer)
+		rakPeer->OnRNS2Recv(recvStruct);
+	peersMutex.Unlock();
+
+	if (rakPeer==0)
+		DeallocRNS2RecvStruct(recvStruct, _FILE_AND_LINE_);
+}
+void RakPeerGroup::DeallocRNS2RecvStruct(RNS2RecvStruct *s, const char *file, unsigned int line)
+{
+	recvStructPoolMutex.Lock();
+	recvStructPool.Push(s, file, line);
+	recvStructPoolMutex.Unlock();
+}
+RNS2RecvStruct *RakPeerGroup::AllocRNS2RecvStruct(const char *file, unsigned int line)
+{
+	recvStructPoolMutex.Lock();
+	if (recvStructPool.Size()>0)
+	{
+		RNS2RecvStruct *s = recvStructPool.Pop();
+		recvStructPoolMutex.Unlock();
+		return s;
+	}
+	recvStructPoolMutex.Unlock();
+	return RakNet::OP_NEW<RNS2RecvStruct>(file,line);
+}
+void RakPeerGroup::AddPeer( RakPeer *peer )
+{
+	RakAssert(updateThreadCount>0);
+
+	// The thread with the fewest instances
+	peersMutex.Lock();
+	unsigned int threadIndex=0;
+	for (unsigned int i=1; i < updateThreadCount; i++)
+	{
+		if (updateThreads[i].peerCount < updateThreads[threadIndex].peerCount)
+			threadIndex=i;
+	}
+	updateThreads[threadIndex].peerCount++;
+	peerList.Push(peer, _FILE_AND_LINE_);
+	peersMutex.Unlock();
+
+	peer->peerGroupThreadIndex=threadIndex;
+	updateThreads[threadIndex].peersMutex.Lock();
+	updateThreads[threadIndex].peers.Push(peer, _FILE_AND_LINE_);
+	updateThreads[threadIndex].peersMutex.Unlock();
+	peer->isMainLoopThreadActive=true;
+}
+void RakPeerGroup::RemovePeer( RakPeer *peer )
+{
+	unsigned int i;
+
+	// Not nested with peersMutex, which the update threads take in ClaimAddress()
+	UpdateThread *updateThread = &updateThreads[peer->peerGroupThreadIndex];
+	updateThread->peersMutex.Lock();
+	i = updateThread->peers.GetIndexOf(peer);
+	if (i!=(unsigned int) -1)
+		updateThread->peers.RemoveAtIndexFast(i);
+	updateThread->peersMutex.Unlock();
+
+	peersMutex.Lock();
+	i = peerList.GetIndexOf(peer);
+	if (i!=(unsigned int) -1)
+	{
+		peerList.RemoveAtIndex(i);
+		updateThread->peerCount--;
+	}
+	DataStructures::List<RakPeer*> owners;
+	DataStructures::List<SystemAddress> addresses;
+	addressOwners.GetAsList(owners, addresses, _FILE_AND_LINE_);
+	for (i=0; i < owners.Size(); i++)
+	{
+		if (owners[i]==peer)
+			addressOwners.Remove(addresses[i], _FILE_AND_LINE_);
+	}
+	DataStructures::List<RakNetGUID> guids;
+	owners.Clear(true, _FILE_AND_LINE_);
+	migrationGuidOwners.GetAsList(owners, guids, _FILE_AND_LINE_);
+	for (i=0; i < owners.Size(); i++)
+	{
+		if (owners[i]==peer)
+			migrationGuidOwners.Remove(guids[i], _FILE_AND_LINE_);
+	}
+	peersMutex.Unlock();
+
+	peer->isMainLoopThreadActive=false;
+}
+void RakPeerGroup::ClaimAddress( const SystemAddress &systemAddress, RakPeer *peer )
+{
+	peersMutex.Lock();
+	if (addressOwners.HasData(systemAddress)==false)
+		addressOwners.Push(systemAddress, peer, _FILE_AND_LINE_);
+	peersMutex.Unlock();
+}
+void RakPeerGroup::ReleaseAddress( const SystemAddress &systemAddress, RakPeer *peer )
+{
+	peersMutex.Lock();
+	RakPeer **owner = addressOwners.Peek(systemAddress);
+	if (owner && *owner==peer)
+		addressOwners.Remove(systemAddress, _FILE_AND_LINE_);
+	peersMutex.Unlock();
+}
+void RakPeerGroup::ClaimConnectionMigrationGuid( const RakNetGUID &guid, RakPeer *peer )
+{
+	peersMutex.Lock();
+	if (migrationGuidOwners.HasData(guid)==false)
+		migrationGuidOwners.Push(guid, peer, _FILE_AND_LINE_);
+	peersMutex.Unlock();
+}
+void RakPeerGroup::ReleaseConnectionMigrationGuid( const RakNetGUID &guid, RakPeer *peer )
+{
+	peersMutex.Lock();
+	RakPeer **owner = migrationGuidOwners.Peek(guid);
+	if (owner && *owner==peer)
+		migrationGuidOwners.Remove(guid, _FILE_AND_LINE_);
+	peersMutex.Unlock();
+}
+void RakPeerGroup::SignalUpdateThread( unsigned int threadIndex )
+{
+	if (threadIndex < updateThreadCount)
+		updateThreads[threadIndex].updateEvent.SetEvent();
+}
+void RakPeerGroup::GetSockets( DataStructures::List<RakNetSocket2* > &sockets ) const
+{
+	for (unsigned int i=0; i < socketList.Size(); i++)
+		sockets.Push(socketList[i], _FILE_AND_LINE_);
+}
+void RakPeerGroup::DerefAllSockets( void )
+{
+	for (unsigned int i=0; i < socketList.Size(); i++)
+		delete socketList[i];
+	socketList.Clear(false, _FILE_AND_LINE_);
+}
+void RakPeerGroup::ClearRecvStructPool( void )
+{
+	recvStructPoolMutex.Lock();
+	while (recvStructPool.Size()>0)
+		RakNet::OP_DELETE(recvStructPool.Pop(), _FILE_AND_LINE_);
+	recvStructPoolMutex.Unlock();
+}
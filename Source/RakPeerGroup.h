@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file RakPeerGroup.h
+/// \brief Sockets and update threads shared by many instances of RakPeer in one process
+///
+
+#ifndef __RAK_PEER_GROUP_H
+#define __RAK_PEER_GROUP_H
+
+#include "Export.h"
+#include "RakNetTypes.h"
+#include "RakNetSocket2.h"
+#include "SimpleMutex.h"
+#include "SignaledEvent.h"
+#include "DS_List.h"
+#include "DS_Queue.h"
+#include "DS_Hash.h"
+
+namespace RakNet
+{
+/// Forward declarations
+class RakPeer;
+class RakPeerInterface;
+class BitStream;
+
+/// Size of the hash from remote addresses to the instance that handles them
+#define RAK_PEER_GROUP_ADDRESS_HASH_SIZE 8192
+
+/// \brief Sockets and update threads shared by many instances of RakPeer
+/// \details Each instance started with RakPeerInterface::Startup(maxConnections, group) sends on the group's sockets, and is updated by one of the group's threads, rather than opening sockets and starting threads of its own.
+/// This lets one process run many instances, such as one per match, when each costs only its connections.
+///
+/// Datagrams are passed to an instance based on the address they came from.
+/// An instance takes an address when it starts connecting to it, or when a system at that address connects to it, and gives it up when that connection ends.
+/// Datagrams from any other address, such as a connection request from a new system, go to the handler set with SetUnknownSenderHandler(), or to the instance that was started first if there is none.
+/// The exception is ID_CONNECTION_MIGRATION, sent by a system whose address changed. It goes to the instance that gave that system its migration key, found by the GUID in the message. See RakPeerInterface::AllowConnectionMigration().
+/// Only one instance can talk to each remote address at a time.
+class RAK_DLL_EXPORT RakPeerGroup : public RNS2EventHandler
+{
+public:
+	RakPeerGroup();
+	virtual ~RakPeerGroup();
+
+	/// \brief Opens the sockets and starts the threads
+	/// \param[in] socketDescriptors Same as for RakPeerInterface::Startup()
+	/// \param[in] socketDescriptorCount The size of the \a socketDescriptors array
+	/// \param[in] updateThreadCount How many threads run the update cycles of the instances. Instances are spread over them as they start.
+	/// \param[in] threadPriority Same as for RakPeerInterface::Startup()
+	/// \return RAKNET_STARTED on success, otherwise appropriate failure enumeration.
+	StartupResult Startup( SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, unsigned int updateThreadCount, int threadPriority=-99999 );
+
+	/// \brief Shuts down any instances that were started on this group without notifying their connections, then stops the threads and closes the sockets
+	void Shutdown( void );
+
+	/// \return True between Startup() and Shutdown()
+	bool IsActive( void ) const;
+
+	/// \brief Chooses which instance gets datagrams from addresses that no instance has taken
+	/// \details The handler returns the instance that should process the datagram, or 0 to drop it. It must be an instance started on this group.
+	/// It is called from a receive thread, with the group locked, so it must not start or shut down instances.
+	/// \param[in] _unknownSenderHandler C callback function, or 0 to send these datagrams to the instance started first
+	/// \param[in] _unknownSenderHandlerData Passed to the callback
+	void SetUnknownSenderHandler( RakPeerInterface *(*_unknownSenderHandler)(RNS2RecvStruct *, void *), void *_unknownSenderHandlerData );
+
+	/// \return The number of instances started on this group
+	unsigned int GetPeerCount( void ) const;
+
+	/// \internal
+	virtual void OnRNS2Recv(RNS2RecvStruct *recvStruct);
+	/// \internal
+	virtual void DeallocRNS2RecvStruct(RNS2RecvStruct *s, const char *file, unsigned int line);
+	/// \internal
+	virtual RNS2RecvStruct *AllocRNS2RecvStruct(const char *file, unsigned int line);
+	/// \internal Pass datagrams from \a systemAddress to \a peer, unless another instance already has it
+	void ClaimAddress( const SystemAddress &systemAddress, RakPeer *peer );
+	/// \internal Stop passing datagrams from \a systemAddress to \a peer
+	void ReleaseAddress( const SystemAddress &systemAddress, RakPeer *peer );
+	/// \internal Pass ID_CONNECTION_MIGRATION from the system with \a guid to \a peer, unless another instance already has it
+	void ClaimConnectionMigrationGuid( const RakNetGUID &guid, RakPeer *peer );
+	/// \internal Stop passing ID_CONNECTION_MIGRATION from the system with \a guid to \a peer
+	void ReleaseConnectionMigrationGuid( const RakNetGUID &guid, RakPeer *peer );
+
+protected:
+	friend class RakPeer;
+
+	struct UpdateThread
+	{
+		RakPeerGroup *group;
+		// Instances this thread updates. Locked while it runs their update cycles
+		DataStructures::List<RakPeer*> peers;
+		SimpleMutex peersMutex;
+		// Size of peers, for choosing a thread without waiting for its update cycle. Locked by the group's peersMutex
+		unsigned int peerCount;
+		SignaledEvent updateEvent;
+		volatile bool isActive;
+	};
+	friend RAK_THREAD_DECLARATION(RakPeerGroupUpdateLoop);
+
+	// Runs the update cycle of each instance on updateThread
+	void RunUpdateCycles( UpdateThread *updateThread, BitStream &updateBitStream );
+
+	// Called by RakPeer::Startup() and RakPeer::Shutdown()
+	void AddPeer( RakPeer *peer );
+	void RemovePeer( RakPeer *peer );
+	void SignalUpdateThread( unsigned int threadIndex );
+	void GetSockets( DataStructures::List<RakNetSocket2* > &sockets ) const;
+	void DerefAllSockets( void );
+	void ClearRecvStructPool( void );
+
+	DataStructures::List<RakNetSocket2* > socketList;
+	UpdateThread *updateThreads;
+	unsigned int updateThreadCount;
+	volatile bool endThreads;
+
+	// Instances in the order they started, and which instance has each address. Read by the receive threads
+	DataStructures::List<RakPeer*> peerList;
+	DataStructures::Hash<SystemAddress, RakPeer*, RAK_PEER_GROUP_ADDRESS_HASH_SIZE, SystemAddress::ToInteger> addressOwners;
+	// Which instance gave each remote system its connection migration key
+	DataStructures::Hash<RakNetGUID, RakPeer*, RAK_PEER_GROUP_ADDRESS_HASH_SIZE, RakNetGUID::ToUint32> migrationGuidOwners;
+	SimpleMutex peersMutex;
+
+	RakPeerInterface *(*unknownSenderHandler)(RNS2RecvStruct *, void *);
+	void *unknownSenderHandlerData;
+
+	DataStructures::Queue<RNS2RecvStruct*> recvStructPool;
+	SimpleMutex recvStructPoolMutex;
+};
+
+} // namespace RakNet
+
+#endif
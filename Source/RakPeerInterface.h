@@ -29,9 +29,13 @@ namespace RakNet
 {
 // Forward declarations
 class BitStream;
+class BitStreamChain;
 class PluginInterface2;
 struct RPCMap;
 struct RakNetStatistics;
+struct OfflineRateLimitSettings;
+struct OfflineRateLimitStatistics;
+class RakPeerGroup;
 struct RakNetBandwidth;
 class RouterInterface;
 class NetworkIDManager;
@@ -63,6 +67,14 @@ public:
 	/// \return RAKNET_STARTED on success, otherwise appropriate failure enumeration.
 	virtual StartupResult Startup( unsigned int maxConnections, SocketDescriptor *socketDescriptors, unsigned socketDescriptorCount, int threadPriority=-99999 )=0;
 
+	/// \brief Starts on the sockets and update threads of a RakPeerGroup, rather than opening sockets and starting threads of its own.
+	/// \details Datagrams are passed to this instance by the group, based on the address they came from. See RakPeerGroup.
+	/// Multiple calls while already active are ignored.  To call this function again with different settings, you must first call Shutdown().
+	/// \param[in] maxConnections The maximum number of connections between this instance of RakPeer and another instance of RakPeer.
+	/// \param[in] group A RakPeerGroup that was started with RakPeerGroup::Startup(). It must not be shut down until this instance is.
+	/// \return RAKNET_STARTED on success, INVALID_SOCKET_DESCRIPTORS if \a group was not started, otherwise appropriate failure enumeration.
+	virtual StartupResult Startup( unsigned int maxConnections, RakPeerGroup *group )=0;
+
 	/// If you accept connections, you must call this or else security will not be enabled for incoming connections.
 	/// This feature requires more round trips, bandwidth, and CPU time for the connection handshake
 	/// x64 builds require under 25% of the CPU time of other builds
@@ -190,12 +202,14 @@ public:
 	/// \param[in] length The size in bytes of the data to send
 	/// \param[in] priority What priority level to send on.  See PacketPriority.h
 	/// \param[in] reliability How reliability to send this data.  See PacketPriority.h
-	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on. Messages are only ordered relative to other messages on the same stream
+	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on, from 0 to NUMBER_OF_ORDERED_STREAMS-1. Messages are only ordered relative to other messages on the same stream. Channels 128 and higher use one extra header byte
 	/// \param[in] systemIdentifier Who to send this packet to, or in the case of broadcasting who not to send it to.  Pass either a SystemAddress structure or a RakNetGUID structure. Use UNASSIGNED_SYSTEM_ADDRESS or to specify none
 	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
 	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
-	virtual uint32_t Send( const char *data, const int length, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0 )=0;
+	virtual uint32_t Send( const char *data, const int length, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 )=0;
 
 	/// "Send" to yourself rather than a remote system. The message will be processed through the plugins and returned to the game as usual
 	/// This function works anytime
@@ -208,13 +222,15 @@ public:
 	/// \param[in] bitStream The bitstream to send
 	/// \param[in] priority What priority level to send on.  See PacketPriority.h
 	/// \param[in] reliability How reliability to send this data.  See PacketPriority.h
-	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on. Messages are only ordered relative to other messages on the same stream
+	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on, from 0 to NUMBER_OF_ORDERED_STREAMS-1. Messages are only ordered relative to other messages on the same stream. Channels 128 and higher use one extra header byte
 	/// \param[in] systemIdentifier Who to send this packet to, or in the case of broadcasting who not to send it to. Pass either a SystemAddress structure or a RakNetGUID structure. Use UNASSIGNED_SYSTEM_ADDRESS or to specify none
 	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
 	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
 	/// \note COMMON MISTAKE: When writing the first byte, bitStream->Write((unsigned char) ID_MY_TYPE) be sure it is casted to a byte, and you are not writing a 4 byte enumeration.
-	virtual uint32_t Send( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0 )=0;
+	virtual uint32_t Send( const RakNet::BitStream * bitStream, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 )=0;
 
 	/// Sends multiple blocks of data, concatenating them automatically.
 	///
@@ -231,12 +247,28 @@ public:
 	/// \param[in] numParameters Length of the arrays data and lengths
 	/// \param[in] priority What priority level to send on.  See PacketPriority.h
 	/// \param[in] reliability How reliability to send this data.  See PacketPriority.h
-	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on. Messages are only ordered relative to other messages on the same stream
+	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on, from 0 to NUMBER_OF_ORDERED_STREAMS-1. Messages are only ordered relative to other messages on the same stream. Channels 128 and higher use one extra header byte
 	/// \param[in] systemIdentifier Who to send this packet to, or in the case of broadcasting who not to send it to. Pass either a SystemAddress structure or a RakNetGUID structure. Use UNASSIGNED_SYSTEM_ADDRESS or to specify none
 	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
 	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
 	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
-	virtual uint32_t SendList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, char orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0 )=0;
+	virtual uint32_t SendList( const char **data, const int *lengths, const int numParameters, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 )=0;
+
+	/// Sends the segments of a BitStreamChain as one message, the same as SendList() with the chain's segments.
+	/// The segments are gathered straight into the send buffer, so what they reference is copied once, and can be changed again as soon as this returns.
+	/// \param[in] chain The segments to send
+	/// \param[in] priority What priority level to send on.  See PacketPriority.h
+	/// \param[in] reliability How reliability to send this data.  See PacketPriority.h
+	/// \param[in] orderingChannel When using ordered or sequenced messages, what channel to order these on, from 0 to NUMBER_OF_ORDERED_STREAMS-1. Messages are only ordered relative to other messages on the same stream. Channels 128 and higher use one extra header byte
+	/// \param[in] systemIdentifier Who to send this packet to, or in the case of broadcasting who not to send it to. Pass either a SystemAddress structure or a RakNetGUID structure. Use UNASSIGNED_SYSTEM_ADDRESS or to specify none
+	/// \param[in] broadcast True to send this packet to all connected systems. If true, then systemAddress specifies who not to send the packet to.
+	/// \param[in] forceReceipt If 0, will automatically determine the receipt number to return. If non-zero, will return what you give it.
+	/// \param[in] deadlineMS If non-zero, and \a reliability is UNRELIABLE, UNRELIABLE_SEQUENCED, or UNRELIABLE_WITH_ACK_RECEIPT, the message is discarded rather than sent if it is still waiting in the send buffer this many milliseconds after this call. UNRELIABLE_WITH_ACK_RECEIPT returns ID_SND_RECEIPT_LOSS in that case.
+	/// \param[in] coalescingKey If non-zero, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, an unsent message to the same system with the same key is discarded and this message takes its place in the send buffer. Use for state updates where only the latest matters, such as one key per replicated object.
+	/// \return 0 on bad input. Otherwise a number that identifies this message. If \a reliability is a type that returns a receipt, on a later call to Receive() you will get ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS with bytes 1-4 inclusive containing this number
+	virtual uint32_t SendChain( const RakNet::BitStreamChain *chain, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, const AddressOrGUID systemIdentifier, bool broadcast, uint32_t forceReceiptNumber=0, RakNet::TimeMS deadlineMS=0, uint32_t coalescingKey=0 )=0;
 
 	/// Gets a message from the incoming message queue.
 	/// Use DeallocatePacket() to deallocate the message after you are done with it.
@@ -296,6 +328,7 @@ public:
 
 	/// Bans an IP from connecting.  Banned IPs persist between connections but are not saved on shutdown nor loaded on startup.
 	/// param[in] IP Dotted IP address. Can use * as a wildcard, such as 128.0.0.* will ban all IP addresses starting with 128.0.0
+	/// CIDR ranges such as 10.0.0.0/8 and, with RAKNET_SUPPORT_IPV6, IPv6 addresses and ranges such as 2001:db8::/32 are also accepted
 	/// \param[in] milliseconds how many ms for a temporary ban.  Use 0 for a permanent ban
 	virtual void AddToBanList( const char *IP, RakNet::TimeMS milliseconds=0 )=0;
 
@@ -316,6 +349,22 @@ public:
 	/// \param[in] b True to limit connections from the same ip to at most 1 per 100 milliseconds.
 	virtual void SetLimitIPConnectionFrequency(bool b)=0;
 
+	/// Require connecting systems to echo a cookie from ID_OPEN_CONNECTION_REPLY_1 before any state is kept for them
+	/// The cookie is a keyed hash of the remote address and the time, so a flood of connection requests from spoofed addresses is dropped without touching the connection list.
+	/// \note Systems connecting to us must be running a version that understands the cookie. Has no effect with secure connections, which always use a cookie.
+	/// \param[in] b True to require cookies. Defaults to false.
+	virtual void SetHandshakeCookies(bool b)=0;
+
+	/// Limit how often unconnected systems can send us offline messages, such as pings, ID_ADVERTISE_SYSTEM, out of band messages and connection requests
+	/// Without a limit, every offline message is answered, so spoofed pings can use us to flood another system.
+	/// Messages over the limit are dropped. Limits are per address and per address prefix, using token buckets in a fixed amount of memory.
+	/// \param[in] settings Rates and bursts. A rate of 0 turns off that limit. Both limits are off by default.
+	virtual void SetOfflineRateLimit( const OfflineRateLimitSettings &settings )=0;
+
+	/// Get how many offline messages were allowed and dropped by the limit set with SetOfflineRateLimit()
+	/// \param[out] statistics Counters since the RakPeer was created
+	virtual void GetOfflineRateLimitStatistics( OfflineRateLimitStatistics *statistics ) const=0;
+
 	// --------------------------------------------------------------------------------------------Pinging Functions - Functions dealing with the automatic ping mechanism--------------------------------------------------------------------------------------------
 	/// Send a ping to the specified connected system.
 	/// \pre The sender and recipient must already be started via a successful call to Startup()
@@ -455,6 +504,13 @@ public:
 	/// \param[in] allow - True to allow this behavior, false to not allow. Defaults to false. Value persists between connections
 	virtual void AllowConnectionResponseIPMigration( bool allow )=0;
 
+	/// Allow systems that connect to us to keep their connection when their address changes, such as when a mobile client's NAT rebinds.
+	/// While enabled, each new incoming connection is given a random key. If that system stops hearing from us while it has unacknowledged messages, it sends an offline message authenticated with the key, and the connection is moved to the address that message came from.
+	/// Reliability state and queued messages are kept, and you get ID_CONNECTION_MIGRATION.
+	/// \note Only the system that accepted the connection needs to call this. The key is sent unencrypted unless secure connections are enabled.
+	/// \param[in] allow - True to allow this behavior, false to not allow. Defaults to false. Applies to connections made after the call
+	virtual void AllowConnectionMigration( bool allow )=0;
+
 	/// Sends a one byte message ID_ADVERTISE_SYSTEM to the remote unconnected system.
 	/// This will tell the remote system our external IP outside the LAN along with some user data.
 	/// \pre The sender and recipient must already be started via a successful call to Initialize
@@ -483,6 +539,14 @@ public:
 	/// \param[in] timeoutMS How many ms to wait before simply not sending an unreliable message.
 	virtual void SetUnreliableTimeout(RakNet::TimeMS timeoutMS)=0;
 
+	/// Enable or disable path MTU discovery on connections.
+	/// While enabled, each connection periodically sends padded probe datagrams to find the largest datagram size that reaches the remote system, starting from the size found during the connection handshake.
+	/// If reliable messages stop getting through at the current size, the connection falls back to a conservative size and searches again. Messages queued but not yet sent are split again when the size drops.
+	/// Probes wait for congestion control like other datagrams, and probes for a larger size also stay within SetPerConnectionOutgoingBandwidthLimit().
+	/// GetMTUSize() and RakNetStatistics::MTUSize return the size in use.  Defaults to false.
+	/// \param[in] enabled True to enable path MTU discovery
+	virtual void SetPathMTUDiscovery(bool enabled)=0;
+
 	/// Send a message to host, with the IP socket option TTL set to 3
 	/// This message will not reach the host, but will open the router.
 	/// Used for NAT-Punchthrough
@@ -548,6 +612,13 @@ public:
 	/// For RakNet connected systems, the first bit is always 1. So for your own game packets, make sure the first bit is always 0.
 	virtual void SetIncomingDatagramEventHandler( bool (*_incomingDatagramEventHandler)(RNS2RecvStruct *) )=0;
 
+	/// Linux only: receive on all sockets from RakNet's update thread, using one epoll loop, instead of starting a blocking receive thread per socket.
+	/// The loop also waits on a timerfd for the regular update tick, and on an eventfd so sends with IMMEDIATE_PRIORITY and incoming datagrams are handled without delay.
+	/// With this enabled, RakPeer runs on a single internal thread no matter how many SocketDescriptors are passed to Startup().
+	/// Must be called while offline. Has no effect on other platforms.
+	/// \param[in] enabled True to use the epoll loop. Defaults to false.
+	virtual void SetEpollNetworkLoop( bool enabled )=0;
+
 	// --------------------------------------------------------------------------------------------Network Simulator Functions--------------------------------------------------------------------------------------------
 	/// Adds simulated ping and packet loss to the outgoing data flow.
 	/// To simulate bi-directional ping and packet loss, you should call this on both the sender and the recipient, with half the total ping and packetloss value on each.
@@ -41,6 +41,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include "Rand.h"
+#if defined(_WIN32)
+#include "WindowsIncludes.h"
+#include <wincrypt.h>
+// For CryptGenRandom
+#pragma comment(lib, "Advapi32.lib")
+#elif !defined(__APPLE__) && !defined(__FreeBSD__) && !defined(__OpenBSD__) && !defined(__NetBSD__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#endif
 
 //
 // uint32 must be an unsigned integer type capable of holding at least 32
@@ -91,6 +104,54 @@ void fillBufferMT( void *buffer, unsigned int bytes )
 {
 	fillBufferMT(buffer, bytes, _state, _next, _left);
 }
+bool fillBufferSecure( void *buffer, unsigned int bytes )
+{
+#if defined(_WIN32)
+	HCRYPTPROV provider;
+	if (CryptAcquireContext(&provider, 0, 0, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT | CRYPT_SILENT)==FALSE)
+		return false;
+	BOOL success = CryptGenRandom(provider, bytes, (BYTE*) buffer);
+	CryptReleaseContext(provider, 0);
+	return success!=FALSE;
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__NetBSD__)
+	arc4random_buf(buffer, bytes);
+	return true;
+#else
+	unsigned char *out = (unsigned char*) buffer;
+#if defined(SYS_getrandom)
+	while (bytes > 0)
+	{
+		long result = syscall(SYS_getrandom, out, bytes, 0);
+		if (result < 0)
+		{
+			if (errno==EINTR)
+				continue;
+			// Kernels before 3.17 do not have getrandom
+			break;
+		}
+		out+=result;
+		bytes-=(unsigned int) result;
+	}
+	if (bytes==0)
+		return true;
+#endif
+	int fd = open("/dev/urandom", O_RDONLY);
+	if (fd==-1)
+		return false;
+	while (bytes > 0)
+	{
+		ssize_t result = read(fd, out, bytes);
+		if (result < 0 && errno==EINTR)
+			continue;
+		if (result <= 0)
+			break;
+		out+=result;
+		bytes-=(unsigned int) result;
+	}
+	close(fd);
+	return bytes==0;
+#endif
+}
 
 void seedMT( unsigned int seed, unsigned int *state, unsigned int *&next, int &left )   // Defined in cokus_c.c
 {
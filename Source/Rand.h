@@ -42,6 +42,12 @@ extern float RAK_DLL_EXPORT frandomMT( void );
 /// \note not threadSafe, use an instance of RakNetRandom if necessary per thread
 extern void RAK_DLL_EXPORT fillBufferMT( void *buffer, unsigned int bytes );
 
+/// Randomizes a buffer from the operating system's cryptographically secure generator
+/// Use for keys and anything else that must not be predictable, since the output of the generator above reveals its state
+/// \note threadSafe
+/// \return false if the operating system could not supply the bytes
+extern bool RAK_DLL_EXPORT fillBufferSecure( void *buffer, unsigned int bytes );
+
 namespace RakNet {
 
 // Same thing as above functions, but not global
@@ -15,6 +15,7 @@
 #include "MessageIdentifiers.h"
 #include "RakPeerInterface.h"
 #include "BitStream.h"
+#include "BitStreamView.h"
 
 using namespace RakNet;
 
@@ -139,7 +140,7 @@ PluginReceiveResult RelayPlugin::OnReceive(Packet *packet)
 		{
 		case RPE_MESSAGE_TO_SERVER_FROM_CLIENT:
 			{
-				BitStream bsIn(packet->data, packet->length, false);
+				BitStreamView bsIn(packet);
 				bsIn.IgnoreBytes(sizeof(MessageID)*2);
 				PacketPriority priority;
 				PacketReliability reliability;
@@ -152,8 +153,6 @@ PluginReceiveResult RelayPlugin::OnReceive(Packet *packet)
 				bsIn.Read(orderingChannel);
 				RakString key;
 				bsIn.ReadCompressed(key);
-				BitStream bsData;
-				bsIn.Read(&bsData);
 				StrAndGuidAndRoom **strAndGuid = strToGuidHash.Peek(key);
 				StrAndGuidAndRoom **strAndGuidSender = guidToStrHash.Peek(packet->guid);
 				if (strAndGuid && strAndGuidSender)
@@ -163,7 +162,8 @@ PluginReceiveResult RelayPlugin::OnReceive(Packet *packet)
 					bsOut.WriteCasted<MessageID>(RPE_MESSAGE_TO_CLIENT_FROM_SERVER);
 					bsOut.WriteCompressed( (*strAndGuidSender)->str );
 					bsOut.AlignWriteToByteBoundary();
-					bsOut.Write(bsData);
+					// The rest of the packet is the message, copied straight from it
+					bsOut.Write(bsIn.GetBitStream());
 					SendUnified(&bsOut, priority, reliability, orderingChannel, (*strAndGuid)->guid, false);
 				}
 
@@ -374,7 +374,7 @@ void RelayPlugin::SendChatRoomsList(RakNetGUID target)
 }
 void RelayPlugin::OnGroupMessageFromClient(Packet *packet)
 {
-	BitStream bsIn(packet->data, packet->length, false);
+	BitStreamView bsIn(packet);
 	bsIn.IgnoreBytes(sizeof(MessageID)*2);
 
 	PacketPriority priority;
@@ -386,13 +386,14 @@ void RelayPlugin::OnGroupMessageFromClient(Packet *packet)
 	bsIn.Read(cIn);
 	reliability = (PacketReliability) cIn;
 	bsIn.Read(orderingChannel);
-	BitStream bsData;
-	bsIn.Read(&bsData);
 	
 	StrAndGuidAndRoom **strAndGuidSender = guidToStrHash.Peek(packet->guid);
 	if (strAndGuidSender)
 	{
-		SendMessageToRoom(strAndGuidSender,&bsData);
+		// The rest of the packet is the message, pointed at rather than copied. SendMessageToRoom() rewinds the stream it is given, so it cannot be bsIn
+		BitStream message;
+		bsIn.ReadView(&message, bsIn.GetNumberOfUnreadBits());
+		SendMessageToRoom(strAndGuidSender,&message);
 	}
 }
 void RelayPlugin::OnJoinGroupRequestFromClient(Packet *packet)
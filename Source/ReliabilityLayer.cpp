@@ -42,10 +42,20 @@ double Ceil(double d) {if (((double)((int)d))==d) return d; return (int) (d+1.0)
 #if CC_TIME_TYPE_BYTES==4
 static const CCTimeType MAX_TIME_BETWEEN_PACKETS= 350; // 350 milliseconds
 static const CCTimeType HISTOGRAM_RESTART_CYCLE=10000; // Every 10 seconds reset the histogram
+static const CCTimeType PATH_MTU_PROBE_TIMEOUT=1000; // A probe not acked in 1 second is lost
+static const CCTimeType PATH_MTU_RAISE_INTERVAL=600000; // Search for a larger MTU every 10 minutes
 #else
 static const CCTimeType MAX_TIME_BETWEEN_PACKETS= 350000; // 350 milliseconds
 //static const CCTimeType HISTOGRAM_RESTART_CYCLE=10000000; // Every 10 seconds reset the histogram
+static const CCTimeType PATH_MTU_PROBE_TIMEOUT=1000000; // A probe not acked in 1 second is lost
+static const CCTimeType PATH_MTU_RAISE_INTERVAL=600000000; // Search for a larger MTU every 10 minutes
 #endif
+// Path MTU discovery: lost probes before a size is given up on, and search resolution in bytes
+static const int PATH_MTU_MAX_PROBES=3;
+static const int PATH_MTU_SEARCH_GRANULARITY=16;
+// Size to fall back to, and resend count of a reliable message that triggers confirmation of the current size
+static const int PATH_MTU_FALLBACK_SIZE=576;
+static const unsigned int PATH_MTU_BLACK_HOLE_RESENDS=3;
 static const int DEFAULT_HAS_RECEIVED_PACKET_QUEUE_SIZE=512;
 static const CCTimeType STARTING_TIME_BETWEEN_PACKETS=MAX_TIME_BETWEEN_PACKETS;
 //static const long double TIME_BETWEEN_PACKETS_INCREASE_MULTIPLIER_DEFAULT=.02;
@@ -259,6 +269,14 @@ int RakNet::SplitPacketChannelComp( SplitPacketIdType const &key, SplitPacketCha
 #endif
 	return 1;
 }
+int RakNet::OrderingChannelComp( OrderingChannelType const &key, OrderingChannel* const &data )
+{
+	if (key < data->orderingChannel)
+		return -1;
+	if (key == data->orderingChannel)
+		return 0;
+	return 1;
+}
 
 // DEFINE_MULTILIST_PTR_TO_MEMBER_COMPARISONS( InternalPacket, SplitPacketIndexType, splitPacketIndex )
 /*
@@ -359,6 +377,11 @@ void ReliabilityLayer::Reset( bool resetVariables, int MTUSize, bool _useSecurit
 		(void) _useSecurity;
 #endif // LIBCAT_SECURITY
 		congestionManager.Init(RakNet::GetTimeUS(), MTUSize - UDP_HEADER_SIZE);
+#if LIBCAT_SECURITY==1
+		if (_useSecurity)
+			MTUSize += cat::AuthenticatedEncryption::OVERHEAD_BYTES;
+#endif // LIBCAT_SECURITY
+		pathMTU = MTUSize;
 	}
 }
 
@@ -383,12 +406,9 @@ RakNet::TimeMS ReliabilityLayer::GetTimeoutTime(void)
 //-------------------------------------------------------------------------------------------------------
 void ReliabilityLayer::InitializeVariables( void )
 {
-	memset( orderedWriteIndex, 0, NUMBER_OF_ORDERED_STREAMS * sizeof(OrderingIndexType));
-	memset( sequencedWriteIndex, 0, NUMBER_OF_ORDERED_STREAMS * sizeof(OrderingIndexType) );
-	memset( orderedReadIndex, 0, NUMBER_OF_ORDERED_STREAMS * sizeof(OrderingIndexType) );
-	memset( highestSequencedReadIndex, 0, NUMBER_OF_ORDERED_STREAMS * sizeof(OrderingIndexType) );
 	memset( &statistics, 0, sizeof( statistics ) );
-	memset( &heapIndexOffsets, 0, sizeof( heapIndexOffsets ) );
+	lastOrderingChannel=0;
+	remoteOrderingChannelCount=0;
 	
 	statistics.connectionStartTime = RakNet::GetTimeUS();
 	splitPacketId = 0;
@@ -404,6 +424,17 @@ void ReliabilityLayer::InitializeVariables( void )
 	unreliableTimeout=0;
 	lastBpsClear=0;
 
+	pathMTUDiscoveryEnabled=false;
+	pathMTU=MAXIMUM_MTU_SIZE;
+	discoveredPathMTU=0;
+	pathMTUFailedSize=MAXIMUM_MTU_SIZE+1;
+	pathMTUProbeSize=0;
+	pathMTUProbeFailures=0;
+	pathMTUProbeInFlight=false;
+	pathMTUConfirming=false;
+	pathMTUProbeSentTime=0;
+	pathMTUNextProbeTime=0;
+
 	// Disable packet pairs
 	countdownToNextPacketPair=15;
 
@@ -523,15 +554,18 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 	orderingList.Clear(false, _FILE_AND_LINE_);
 	*/
 
-	for (i=0; i < NUMBER_OF_ORDERED_STREAMS; i++)
+	for (i=0; i < orderingChannelList.Size(); i++)
 	{
-		for (j=0; j < orderingHeaps[i].Size(); j++)
+		for (j=0; j < orderingChannelList[i]->orderingHeap.Size(); j++)
 		{
-			FreeInternalPacketData(orderingHeaps[i][j], _FILE_AND_LINE_ );
-			ReleaseToInternalPacketPool( orderingHeaps[i][j] );
+			FreeInternalPacketData(orderingChannelList[i]->orderingHeap[j], _FILE_AND_LINE_ );
+			ReleaseToInternalPacketPool( orderingChannelList[i]->orderingHeap[j] );
 		}
-		orderingHeaps[i].Clear(true, _FILE_AND_LINE_);
+		RakNet::OP_DELETE(orderingChannelList[i], _FILE_AND_LINE_);
 	}
+	orderingChannelList.Clear(false, _FILE_AND_LINE_);
+	lastOrderingChannel=0;
+	remoteOrderingChannelCount=0;
 
 	//resendList.ForEachData(DeleteInternalPacket);
 	//	resendTree.Clear(_FILE_AND_LINE_);
@@ -563,6 +597,7 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 		resendLinkedListHead=0;
 	}
 	unacknowledgedBytes=0;
+	pathMTUProbeInFlight=false;
 
 	//	acknowlegements.Clear(_FILE_AND_LINE_);
 
@@ -574,6 +609,7 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 	}
 
 	outgoingPacketBuffer.Clear(true, _FILE_AND_LINE_);
+	coalescedMessages.Clear(_FILE_AND_LINE_);
 
 #ifdef _DEBUG
 	for (unsigned i = 0; i < delayList.Size(); i++ )
@@ -769,6 +805,9 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 					}
 				}
 
+				if (pathMTUProbeInFlight && datagramNumber==pathMTUProbeDatagramNumber)
+					OnPathMTUProbeAcked(timeRead);
+
 				MessageNumberNode *messageNumberNode = GetMessageNumberNodeByDatagramIndex(datagramNumber, &whenSent);
 				if (messageNumberNode)
 				{
@@ -830,7 +869,9 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 			//RakAssert(incomingNAKs.ranges[i].maxIndex.val-incomingNAKs.ranges[i].minIndex.val<1000);
 			for (messageNumber=incomingNAKs.ranges[i].minIndex; messageNumber >= incomingNAKs.ranges[i].minIndex && messageNumber <= incomingNAKs.ranges[i].maxIndex; messageNumber++)
 			{
-				congestionManager.OnNAK(timeRead, messageNumber);
+				// A lost path MTU probe says nothing about congestion
+				if (pathMTUProbeInFlight==false || messageNumber!=pathMTUProbeDatagramNumber)
+					congestionManager.OnNAK(timeRead, messageNumber);
 
 				// REMOVEME
 				//				printf("%p NAK %i\n", this, dhf.datagramNumber.val);
@@ -885,6 +926,10 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 		SendAcknowledgementPacket( dhf.datagramNumber, 0);
 #endif
 
+		// Path MTU probes carry only padding
+		if (IsPaddingAtReadOffset(&socketData))
+			return true;
+
 		InternalPacket* internalPacket = CreateInternalPacketFromBitStream( &socketData, timeRead );
 		if (internalPacket==0)
 		{
@@ -934,6 +979,22 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 						ReleaseToInternalPacketPool( internalPacket );
 						goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 					}
+
+					// Channel state is never freed before disconnect, so limit how many channels the remote system can make us allocate.
+					// The datagram was already acknowledged, so a dropped message would never be resent and its channel would stall. Drop the connection instead
+					if ( remoteOrderingChannelCount >= MAX_ORDERING_CHANNELS_PER_CONNECTION &&
+						orderingChannelList.HasData( internalPacket->orderingChannel ) == false )
+					{
+						for (unsigned int messageHandlerIndex=0; messageHandlerIndex < messageHandlerList.Size(); messageHandlerIndex++)
+							messageHandlerList[messageHandlerIndex]->OnReliabilityLayerNotification("remoteOrderingChannelCount >= MAX_ORDERING_CHANNELS_PER_CONNECTION", BYTES_TO_BITS(length), systemAddress, true);
+
+						bpsMetrics[(int) USER_MESSAGE_BYTES_RECEIVED_IGNORED].Push1(timeRead,BITS_TO_BYTES(internalPacket->dataBitLength));
+
+						FreeInternalPacketData(internalPacket, _FILE_AND_LINE_ );
+						ReleaseToInternalPacketPool( internalPacket );
+						KillConnection();
+						return true;
+					}
 				}
 
 				// 8/12/09 was previously not checking if the message was reliable. However, on packetloss this would mean you'd eventually exceed the
@@ -1249,6 +1310,12 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 					internalPacket->reliability == UNRELIABLE_SEQUENCED ||
 					internalPacket->reliability == RELIABLE_ORDERED)
 				{
+					// Channels the local system already sent on do not count toward the limit
+					const unsigned int orderingChannelCount = orderingChannelList.Size();
+					OrderingChannel *orderingChannel = GetOrderingChannel(internalPacket->orderingChannel);
+					if (orderingChannelList.Size()!=orderingChannelCount)
+						remoteOrderingChannelCount++;
+
 #ifdef PRINT_TO_FILE_RELIABLE_ORDERED_TEST
 
 					// ___________________
@@ -1280,14 +1347,14 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 #endif
 
 
-					if (internalPacket->orderingIndex==orderedReadIndex[internalPacket->orderingChannel])
+					if (internalPacket->orderingIndex==orderingChannel->orderedReadIndex)
 					{
 						// Has current ordering index
 						if (internalPacket->reliability == RELIABLE_SEQUENCED ||
 							internalPacket->reliability == UNRELIABLE_SEQUENCED)
 						{
 							// Is sequenced
-							if (IsOlderOrderedPacket(internalPacket->sequencingIndex,highestSequencedReadIndex[internalPacket->orderingChannel])==false)
+							if (IsOlderOrderedPacket(internalPacket->sequencingIndex,orderingChannel->highestSequencedReadIndex)==false)
 							{
 								// Expected or highest known value
 
@@ -1314,7 +1381,7 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 								// Update highest sequence
 								// 6/26/2012 - Did not have the +1 in the next statement
 								// Means a duplicated RELIABLE_SEQUENCED or UNRELIABLE_SEQUENCED packet would be returned to the user
-								highestSequencedReadIndex[internalPacket->orderingChannel] = internalPacket->sequencingIndex+(OrderingIndexType)1;
+								orderingChannel->highestSequencedReadIndex = internalPacket->sequencingIndex+(OrderingIndexType)1;
 
 								// Fallthrough, returned to user below
 							}
@@ -1350,10 +1417,10 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 							if (packetId==ID_USER_PACKET_ENUM+1 && fp)
 							{
 								fprintf(fp, "outputting immediate %i, %s. OI=%i. SI=%i.", receivedPacketNumber, type, internalPacket->orderingIndex.val, internalPacket->sequencingIndex);
-								if (orderingHeaps[internalPacket->orderingChannel].Size()==0)
+								if (orderingChannel->orderingHeap.Size()==0)
 									fprintf(fp, "heap empty\n");
 								else
-									fprintf(fp, "heap head=%i\n", orderingHeaps[internalPacket->orderingChannel].Peek()->orderingIndex.val);
+									fprintf(fp, "heap head=%i\n", orderingChannel->orderingHeap.Peek()->orderingIndex.val);
 
 								if (receivedPacketNumber<packetNumber)
 								{
@@ -1369,14 +1436,14 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 							}
 #endif
 
-							orderedReadIndex[internalPacket->orderingChannel]++;
-							highestSequencedReadIndex[internalPacket->orderingChannel] = 0;
+							orderingChannel->orderedReadIndex++;
+							orderingChannel->highestSequencedReadIndex = 0;
 
 							// Return off heap until order lost
-							while (orderingHeaps[internalPacket->orderingChannel].Size()>0 &&
-								orderingHeaps[internalPacket->orderingChannel].Peek()->orderingIndex==orderedReadIndex[internalPacket->orderingChannel])
+							while (orderingChannel->orderingHeap.Size()>0 &&
+								orderingChannel->orderingHeap.Peek()->orderingIndex==orderingChannel->orderedReadIndex)
 							{
-								internalPacket = orderingHeaps[internalPacket->orderingChannel].Pop(0);
+								internalPacket = orderingChannel->orderingHeap.Pop(0);
 
 #ifdef PRINT_TO_FILE_RELIABLE_ORDERED_TEST
 								BitStream bitStream2(internalPacket->data, BITS_TO_BYTES(internalPacket->dataBitLength), false);
@@ -1414,11 +1481,11 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 
 								if (internalPacket->reliability == RELIABLE_ORDERED)
 								{
-									orderedReadIndex[internalPacket->orderingChannel]++;
+									orderingChannel->orderedReadIndex++;
 								}
 								else
 								{
-									highestSequencedReadIndex[internalPacket->orderingChannel] = internalPacket->sequencingIndex;
+									orderingChannel->highestSequencedReadIndex = internalPacket->sequencingIndex;
 								}
 							}
 
@@ -1426,29 +1493,29 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 							goto CONTINUE_SOCKET_DATA_PARSE_LOOP;
 						}
 					}
-					else if (IsOlderOrderedPacket(internalPacket->orderingIndex,orderedReadIndex[internalPacket->orderingChannel])==false)
+					else if (IsOlderOrderedPacket(internalPacket->orderingIndex,orderingChannel->orderedReadIndex)==false)
 					{
 						// internalPacket->_orderingIndex is greater
 						// If a message has a greater ordering index, and is sequenced or ordered, buffer it
 						// Sequenced has a lower heap weight, ordered has max sequenced weight
 
 						// Keep orderedHoleCount count small
-						if (orderingHeaps[internalPacket->orderingChannel].Size()==0)
-							heapIndexOffsets[internalPacket->orderingChannel]=orderedReadIndex[internalPacket->orderingChannel];
+						if (orderingChannel->orderingHeap.Size()==0)
+							orderingChannel->heapIndexOffset=orderingChannel->orderedReadIndex;
 
-						reliabilityHeapWeightType orderedHoleCount = internalPacket->orderingIndex-heapIndexOffsets[internalPacket->orderingChannel];
+						reliabilityHeapWeightType orderedHoleCount = internalPacket->orderingIndex-orderingChannel->heapIndexOffset;
 						reliabilityHeapWeightType weight = orderedHoleCount*1048576;
 						if (internalPacket->reliability == RELIABLE_SEQUENCED ||
 							internalPacket->reliability == UNRELIABLE_SEQUENCED)
 							weight+=internalPacket->sequencingIndex;
 						else
 							weight+=(1048576-1);
-						orderingHeaps[internalPacket->orderingChannel].Push(weight, internalPacket, _FILE_AND_LINE_);
+						orderingChannel->orderingHeap.Push(weight, internalPacket, _FILE_AND_LINE_);
 
 #ifdef PRINT_TO_FILE_RELIABLE_ORDERED_TEST
 						if (packetId==ID_USER_PACKET_ENUM+1 && fp)
 						{
-						fprintf(fp, "Heap push %i, %s, weight=%" PRINTF_64_BIT_MODIFIER "u. OI=%i. waiting on %i. SI=%i.\n", receivedPacketNumber, type, weight, internalPacket->orderingIndex.val, orderedReadIndex[internalPacket->orderingChannel].val, internalPacket->sequencingIndex);
+						fprintf(fp, "Heap push %i, %s, weight=%" PRINTF_64_BIT_MODIFIER "u. OI=%i. waiting on %i. SI=%i.\n", receivedPacketNumber, type, weight, internalPacket->orderingIndex.val, orderingChannel->orderedReadIndex.val, internalPacket->sequencingIndex);
 						fflush(fp);
 						}
 #endif
@@ -1534,9 +1601,9 @@ BitSize_t ReliabilityLayer::Receive( unsigned char **data )
 // bitStream contains the data to send
 // priority is what priority to send the data at
 // reliability is what reliability to use
-// ordering channel is from 0 to 255 and specifies what stream to use
+// ordering channel is from 0 to NUMBER_OF_ORDERED_STREAMS-1 and specifies what stream to use
 //-------------------------------------------------------------------------------------------------------
-bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, unsigned char orderingChannel, bool makeDataCopy, int MTUSize, CCTimeType currentTime, uint32_t receipt )
+bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, bool makeDataCopy, int MTUSize, CCTimeType currentTime, uint32_t receipt, CCTimeType deadline, uint32_t coalescingKey )
 {
 #ifdef _DEBUG
 	RakAssert( !( reliability >= NUMBER_OF_RELIABILITIES || reliability < 0 ) );
@@ -1547,6 +1614,7 @@ bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPri
 
 #if CC_TIME_TYPE_BYTES==4
 	currentTime/=1000;
+	deadline/=1000;
 #endif
 
 	(void) MTUSize;
@@ -1620,6 +1688,15 @@ bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPri
 //			internalPacket->reliability=RELIABLE_SEQUENCED_WITH_ACK_RECEIPT;
 	}
 
+	// Only unreliable messages can be dropped, so a deadline on anything else (including upgraded split packets) is ignored
+	if ( internalPacket->reliability == UNRELIABLE ||
+		internalPacket->reliability == UNRELIABLE_SEQUENCED ||
+		internalPacket->reliability == UNRELIABLE_WITH_ACK_RECEIPT )
+		internalPacket->deadline=deadline;
+	if ( internalPacket->reliability == UNRELIABLE ||
+		internalPacket->reliability == UNRELIABLE_SEQUENCED )
+		internalPacket->coalescingKey=coalescingKey;
+
 	//	++sendMessageNumberIndex;
 
 	if ( internalPacket->reliability == RELIABLE_SEQUENCED ||
@@ -1630,9 +1707,10 @@ bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPri
 		)
 	{
 		// Assign the sequence stream and index
+		OrderingChannel *oc = GetOrderingChannel(orderingChannel);
 		internalPacket->orderingChannel = orderingChannel;
-		internalPacket->orderingIndex = orderedWriteIndex[ orderingChannel ];
-		internalPacket->sequencingIndex = sequencedWriteIndex[ orderingChannel ]++;
+		internalPacket->orderingIndex = oc->orderedWriteIndex;
+		internalPacket->sequencingIndex = oc->sequencedWriteIndex++;
 
 		// This packet supersedes all other sequenced packets on the same ordering channel
 		// Delete all packets in all send lists that are sequenced and on the same ordering channel
@@ -1651,9 +1729,10 @@ bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPri
 	else if ( internalPacket->reliability == RELIABLE_ORDERED || internalPacket->reliability == RELIABLE_ORDERED_WITH_ACK_RECEIPT )
 	{
 		// Assign the ordering channel and index
+		OrderingChannel *oc = GetOrderingChannel(orderingChannel);
 		internalPacket->orderingChannel = orderingChannel;
-		internalPacket->orderingIndex = orderedWriteIndex[ orderingChannel ] ++;
-		sequencedWriteIndex[ orderingChannel ]=0;
+		internalPacket->orderingIndex = oc->orderedWriteIndex ++;
+		oc->sequencedWriteIndex=0;
 	}
 
 	if ( splitPacket )   // If it uses a secure header it will be generated here
@@ -1673,7 +1752,10 @@ bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPri
 
 	RakAssert(internalPacket->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 	RakAssert(internalPacket->messageNumberAssigned==false);
-	outgoingPacketBuffer.Push( GetNextWeight(internalPacket->priority), internalPacket, _FILE_AND_LINE_  );
+	if (internalPacket->coalescingKey!=0)
+		outgoingPacketBuffer.Push( CoalesceOutgoingPacket(internalPacket), internalPacket, _FILE_AND_LINE_  );
+	else
+		outgoingPacketBuffer.Push( GetNextWeight(internalPacket->priority), internalPacket, _FILE_AND_LINE_  );
 	RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 	statistics.messageInSendBuffer[(int)internalPacket->priority]++;
 	statistics.bytesInSendBuffer[(int)internalPacket->priority]+=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
@@ -1880,6 +1962,9 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 		}
 	}
 
+	// What congestion control leaves for a path MTU probe after this update's datagrams
+	int probeTransmissionBandwidth=0, probeRetransmissionBandwidth=0;
+
 	if (hasDataToSendOrResend==true)
 	{
 		InternalPacket *internalPacket;
@@ -1914,7 +1999,8 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 					if ( time - internalPacket->nextActionTime < (((CCTimeType)-1)/2) )
 					{
 						nextPacketBitLength = internalPacket->headerLength + internalPacket->dataBitLength;
-						if ( datagramSizeSoFar + nextPacketBitLength > GetMaxDatagramSizeExcludingMessageHeaderBits() )
+						// A message split before the path MTU was lowered goes alone in its datagram
+						if ( datagramSizeSoFar!=0 && datagramSizeSoFar + nextPacketBitLength > GetMaxDatagramSizeExcludingMessageHeaderBits() )
 						{
 							// Gathers all PushPackets()
 							PushDatagram();
@@ -1933,6 +2019,9 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 
 						PushPacket(time,internalPacket,true); // Affects GetNewTransmissionBandwidth()
 						internalPacket->timesSent++;
+						// Start confirming the current size once per message, so later resends do not restart a confirmation in progress
+						if (internalPacket->timesSent==PATH_MTU_BLACK_HOLE_RESENDS && pathMTUDiscoveryEnabled && pathMTU>PATH_MTU_FALLBACK_SIZE)
+							pathMTUConfirming=true;
 						congestionManager.OnResend(time, internalPacket->nextActionTime);
 						internalPacket->retransmissionTime = congestionManager.GetRTOForRetransmission(internalPacket->timesSent);
 						internalPacket->nextActionTime = internalPacket->retransmissionTime+time;
@@ -1972,6 +2061,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 		{
 			statistics.isLimitedByCongestionControl=true;
 		}
+		probeRetransmissionBandwidth=retransmissionBandwidth-(int)BITS_TO_BYTES(allDatagramSizesSoFar);
 
 		if ((int)BITS_TO_BYTES(allDatagramSizesSoFar)<transmissionBandwidth)
 		{
@@ -2011,16 +2101,36 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 						RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 						statistics.messageInSendBuffer[(int)internalPacket->priority]--;
 						statistics.bytesInSendBuffer[(int)internalPacket->priority]-=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
+						bpsMetrics[(int) USER_MESSAGE_BYTES_DISCARDED].Push1(time,BITS_TO_BYTES(internalPacket->dataBitLength));
+						if (internalPacket->coalescingKey!=0)
+							RemoveCoalescedPacket(internalPacket);
 						ReleaseToInternalPacketPool( internalPacket );
 						continue;
 					}
 
+					// Unreliable message that was not sent before the deadline given to Send(). Flag invalid, and it is removed above on the next iteration
+					if (internalPacket->deadline!=0 && time - internalPacket->deadline < (((CCTimeType)-1)/2))
+					{
+						if (internalPacket->reliability==UNRELIABLE_WITH_ACK_RECEIPT)
+						{
+							InternalPacket *ackReceipt = AllocateFromInternalPacketPool();
+							AllocInternalPacketData(ackReceipt, 5,  false, _FILE_AND_LINE_ );
+							ackReceipt->dataBitLength=BYTES_TO_BITS(5);
+							ackReceipt->data[0]=(MessageID)ID_SND_RECEIPT_LOSS;
+							memcpy(ackReceipt->data+sizeof(MessageID), &internalPacket->sendReceiptSerial, sizeof(uint32_t));
+							outputQueue.Push(ackReceipt, _FILE_AND_LINE_ );
+						}
+						FreeInternalPacketData(internalPacket, _FILE_AND_LINE_ );
+						internalPacket->data=0;
+						RemoveFromUnreliableLinkedList(internalPacket);
+						continue;
+					}
+
 					internalPacket->headerLength=GetMessageHeaderLengthBits(internalPacket);
 					nextPacketBitLength = internalPacket->headerLength + internalPacket->dataBitLength;
-					if ( datagramSizeSoFar + nextPacketBitLength > GetMaxDatagramSizeExcludingMessageHeaderBits() )
+					if ( datagramSizeSoFar!=0 && datagramSizeSoFar + nextPacketBitLength > GetMaxDatagramSizeExcludingMessageHeaderBits() )
 					{
 						// Hit MTU. May still push packets if smaller ones exist at a lower priority
-						RakAssert(datagramSizeSoFar!=0);
 						RakAssert(internalPacket->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 						break;
 					}
@@ -2043,6 +2153,8 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 					RakAssert(internalPacket->messageNumberAssigned==false);
 					statistics.messageInSendBuffer[(int)internalPacket->priority]--;
 					statistics.bytesInSendBuffer[(int)internalPacket->priority]-=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
+					if (internalPacket->coalescingKey!=0)
+						RemoveCoalescedPacket(internalPacket);
 					if (isReliable
 						/*
 						I thought about this and agree that UNRELIABLE_SEQUENCED_WITH_ACK_RECEIPT and RELIABLE_SEQUENCED_WITH_ACK_RECEIPT is not useful unless you also know if the message was discarded.
@@ -2135,6 +2247,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 				PushDatagram();
 			}
 		}
+		probeTransmissionBandwidth=transmissionBandwidth-(int)BITS_TO_BYTES(allDatagramSizesSoFar);
 
 
 		for (unsigned int datagramIndex=0; datagramIndex < packetsToSendThisUpdateDatagramBoundaries.Size(); datagramIndex++)
@@ -2236,6 +2349,25 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 		// 			sendPacketSet[3].IsEmpty()==false;
 	}
 
+	if (pathMTUDiscoveryEnabled && UpdatePathMTUDiscovery(time)!=0)
+	{
+		if (hasDataToSendOrResend==false)
+		{
+			probeTransmissionBandwidth = congestionManager.GetTransmissionBandwidth(time, timeSinceLastTick, unacknowledgedBytes, false);
+			probeRetransmissionBandwidth = congestionManager.GetRetransmissionBandwidth(time, timeSinceLastTick, unacknowledgedBytes, false);
+		}
+
+		// A probe is sent when a data datagram could be. Confirming the current size stands in for resends, so it is not held back by the outgoing bandwidth limit
+		bool canSendProbe;
+		if (pathMTUConfirming)
+			canSendProbe=probeRetransmissionBandwidth>0;
+		else
+			canSendProbe=probeTransmissionBandwidth>0 &&
+				(bitsPerSecondLimit==0 || BITS_TO_BYTES(bitsPerSecondLimit) >= bpsMetrics[(int) ACTUAL_BYTES_SENT].GetBPS1(time) + pathMTUProbeSize);
+		if (canSendProbe)
+			SendPathMTUProbe(s, systemAddress, time, rnr, updateBitStream);
+	}
+
 
 	// Keep on top of deleting old unreliable split packets so they don't clog the list.
 	//DeleteOldUnreliableSplitPackets( time );
@@ -2317,7 +2449,7 @@ void ReliabilityLayer::SendBitStream( RakNetSocket2 *s, SystemAddress &systemAdd
 
 	bpsMetrics[(int) ACTUAL_BYTES_SENT].Push1(currentTime,length);
 
-	RakAssert(length <= congestionManager.GetMTU());
+	RakAssert(length <= MAXIMUM_MTU_SIZE - UDP_HEADER_SIZE);
 
 #ifdef USE_THREADED_SEND
 	SendToThread::SendToThreadBlock *block =  SendToThread::AllocateBlock();
@@ -2389,6 +2521,253 @@ void ReliabilityLayer::SetUnreliableTimeout(RakNet::TimeMS timeoutMS)
 #endif
 }
 
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::SetPathMTUDiscovery(bool enabled)
+{
+	pathMTUDiscoveryEnabled=enabled;
+	if (enabled==false)
+	{
+		EndPathMTUProbeFlight();
+		pathMTUProbeSize=0;
+		pathMTUConfirming=false;
+	}
+}
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::SetPathMTU(int mtu)
+{
+	bool lowered = mtu < pathMTU;
+	pathMTU=mtu;
+#if LIBCAT_SECURITY==1
+	if (useSecurity)
+		mtu -= cat::AuthenticatedEncryption::OVERHEAD_BYTES;
+#endif
+	congestionManager.SetMTU(mtu - UDP_HEADER_SIZE);
+	if (lowered)
+		ResplitQueuedPackets();
+}
+//-------------------------------------------------------------------------------------------------------
+int ReliabilityLayer::GetNextPathMTUProbeSize(void) const
+{
+	if (pathMTU>=MAXIMUM_MTU_SIZE)
+		return 0;
+	// Try the largest size first, since it usually gets through
+	if (pathMTUFailedSize>MAXIMUM_MTU_SIZE)
+		return MAXIMUM_MTU_SIZE;
+	if (pathMTUFailedSize-pathMTU<=PATH_MTU_SEARCH_GRANULARITY)
+		return 0;
+	return (pathMTU+pathMTUFailedSize)/2;
+}
+//-------------------------------------------------------------------------------------------------------
+int ReliabilityLayer::UpdatePathMTUDiscovery(CCTimeType time)
+{
+	if (pathMTUNextProbeTime==0)
+	{
+		// Let the connection settle before the first probe
+		pathMTUNextProbeTime=time+PATH_MTU_PROBE_TIMEOUT;
+		return 0;
+	}
+
+	if (pathMTUConfirming && pathMTUProbeSize!=pathMTU)
+	{
+		// Confirming the current size takes over from any search in progress
+		EndPathMTUProbeFlight();
+		pathMTUProbeSize=pathMTU;
+		pathMTUProbeFailures=0;
+	}
+
+	if (pathMTUProbeInFlight)
+	{
+		if (time - pathMTUProbeSentTime < PATH_MTU_PROBE_TIMEOUT)
+			return 0;
+
+		EndPathMTUProbeFlight();
+		if (++pathMTUProbeFailures < PATH_MTU_MAX_PROBES)
+			return pathMTUProbeSize;
+
+		pathMTUProbeFailures=0;
+		if (pathMTUConfirming)
+		{
+			// Datagrams of the current size no longer get through
+			pathMTUConfirming=false;
+			pathMTUFailedSize=pathMTU;
+			discoveredPathMTU=0;
+			SetPathMTU(PATH_MTU_FALLBACK_SIZE);
+		}
+		else
+			pathMTUFailedSize=pathMTUProbeSize;
+		pathMTUProbeSize=0;
+		pathMTUNextProbeTime=time;
+	}
+
+	if (pathMTUProbeSize!=0)
+		return pathMTUProbeSize;
+
+	//if (time < pathMTUNextProbeTime)
+	if ( time - pathMTUNextProbeTime > (((CCTimeType)-1)/2) )
+		return 0;
+
+	pathMTUProbeSize = GetNextPathMTUProbeSize();
+	if (pathMTUProbeSize==0)
+	{
+		// Search finished. Start over later in case the path changed
+		pathMTUFailedSize=MAXIMUM_MTU_SIZE+1;
+		pathMTUNextProbeTime=time+PATH_MTU_RAISE_INTERVAL;
+	}
+	return pathMTUProbeSize;
+}
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::SendPathMTUProbe(RakNetSocket2 *s, SystemAddress &systemAddress, CCTimeType time, RakNetRandom *rnr, BitStream &updateBitStream)
+{
+	// The probe is a data datagram holding only padding. The remote system acks it like any other datagram.
+	DatagramHeaderFormat dhfProbe;
+	dhfProbe.isACK=false;
+	dhfProbe.isNAK=false;
+	dhfProbe.isPacketPair=false;
+	dhfProbe.isContinuousSend=false;
+	dhfProbe.needsBAndAs=congestionManager.GetIsInSlowStart();
+	dhfProbe.datagramNumber=congestionManager.GetAndIncrementNextDatagramSequenceNumber();
+#if INCLUDE_TIMESTAMP_WITH_DATAGRAMS==1
+	dhfProbe.sourceSystemTime=RakNet::GetTimeUS();
+#endif
+	AddFirstToDatagramHistory(dhfProbe.datagramNumber, time);
+
+	int paddedLength = pathMTUProbeSize - UDP_HEADER_SIZE;
+#if LIBCAT_SECURITY==1
+	if (useSecurity)
+		paddedLength -= cat::AuthenticatedEncryption::OVERHEAD_BYTES;
+#endif
+	updateBitStream.Reset();
+	dhfProbe.Serialize(&updateBitStream);
+	updateBitStream.PadWithZeroToByteLength(paddedLength);
+
+	pathMTUProbeInFlight=true;
+	pathMTUProbeDatagramNumber=dhfProbe.datagramNumber;
+	pathMTUProbeSentTime=time;
+	// Holds back data the way an unacknowledged datagram of this size would
+	unacknowledgedBytes+=pathMTUProbeSize;
+
+	congestionManager.OnSendBytes(time,pathMTUProbeSize);
+	SendBitStream( s, systemAddress, &updateBitStream, rnr, time );
+}
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::OnPathMTUProbeAcked(CCTimeType time)
+{
+	EndPathMTUProbeFlight();
+	if (pathMTUProbeSize>pathMTU)
+		SetPathMTU(pathMTUProbeSize);
+	if (pathMTUProbeSize>discoveredPathMTU)
+		discoveredPathMTU=pathMTUProbeSize;
+	pathMTUProbeSize=0;
+	pathMTUProbeFailures=0;
+	pathMTUConfirming=false;
+	pathMTUNextProbeTime=time;
+}
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::EndPathMTUProbeFlight(void)
+{
+	if (pathMTUProbeInFlight==false)
+		return;
+	RakAssert(unacknowledgedBytes>=(unsigned int) pathMTUProbeSize);
+	unacknowledgedBytes-=pathMTUProbeSize;
+	pathMTUProbeInFlight=false;
+}
+//-------------------------------------------------------------------------------------------------------
+// Parts of one split message in outgoingPacketBuffer, see ResplitQueuedPackets
+struct QueuedSplitMessage
+{
+	unsigned int partCount;
+	BitSize_t bitLength;
+	unsigned int partByteLength;
+	InternalPacket *whole;
+};
+void ReliabilityLayer::ResplitQueuedPackets(void)
+{
+	const BitSize_t maxDatagramBits = GetMaxDatagramSizeExcludingMessageHeaderBits();
+	DataStructures::OrderedList<SplitPacketIdType, SplitPacketIdType> splitPacketIds;
+	unsigned int i, index;
+	bool objectExists;
+	for (i=0; i < outgoingPacketBuffer.Size(); i++)
+	{
+		InternalPacket *internalPacket = outgoingPacketBuffer[i];
+		if (internalPacket->splitPacketCount!=0 && GetMessageHeaderLengthBits(internalPacket) + internalPacket->dataBitLength > maxDatagramBits)
+			splitPacketIds.Insert(internalPacket->splitPacketId, internalPacket->splitPacketId, false, _FILE_AND_LINE_);
+	}
+	if (splitPacketIds.Size()==0)
+		return;
+
+	DataStructures::List<QueuedSplitMessage> messages;
+	QueuedSplitMessage emptyMessage = {0, 0, 0, 0};
+	for (i=0; i < splitPacketIds.Size(); i++)
+		messages.Push(emptyMessage, _FILE_AND_LINE_);
+	for (i=0; i < outgoingPacketBuffer.Size(); i++)
+	{
+		InternalPacket *internalPacket = outgoingPacketBuffer[i];
+		if (internalPacket->splitPacketCount==0)
+			continue;
+		index=splitPacketIds.GetIndexFromKey(internalPacket->splitPacketId, &objectExists);
+		if (objectExists==false)
+			continue;
+		messages[index].partCount++;
+		messages[index].bitLength+=internalPacket->dataBitLength;
+		if (internalPacket->splitPacketIndex+1 < internalPacket->splitPacketCount)
+			messages[index].partByteLength=(unsigned int) BITS_TO_BYTES(internalPacket->dataBitLength);
+	}
+
+	// Take out the parts of messages with every part still queued, and put them back together.
+	// A message with parts already sent keeps its parts, since the remote system expects the part count it was sent with
+	DataStructures::List<InternalPacket*> keptPackets;
+	DataStructures::List<reliabilityHeapWeightType> keptWeights;
+	while (outgoingPacketBuffer.Size())
+	{
+		reliabilityHeapWeightType weight = outgoingPacketBuffer.PeekWeight();
+		InternalPacket *internalPacket = outgoingPacketBuffer.Pop(0);
+		if (internalPacket->splitPacketCount!=0)
+		{
+			index=splitPacketIds.GetIndexFromKey(internalPacket->splitPacketId, &objectExists);
+			if (objectExists && messages[index].partCount==internalPacket->splitPacketCount)
+			{
+				QueuedSplitMessage &message = messages[index];
+				if (message.whole==0)
+				{
+					message.whole=AllocateFromInternalPacketPool();
+					*message.whole=*internalPacket;
+					AllocInternalPacketData(message.whole, (unsigned int) BITS_TO_BYTES(message.bitLength), false, _FILE_AND_LINE_);
+					message.whole->dataBitLength=message.bitLength;
+				}
+				memcpy(message.whole->data + internalPacket->splitPacketIndex*message.partByteLength, internalPacket->data, (size_t) BITS_TO_BYTES(internalPacket->dataBitLength));
+				statistics.messageInSendBuffer[(int)internalPacket->priority]--;
+				statistics.bytesInSendBuffer[(int)internalPacket->priority]-=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
+				FreeInternalPacketData(internalPacket, _FILE_AND_LINE_ );
+				ReleaseToInternalPacketPool( internalPacket );
+				continue;
+			}
+		}
+		keptPackets.Push(internalPacket, _FILE_AND_LINE_);
+		keptWeights.Push(weight, _FILE_AND_LINE_);
+	}
+
+	// Popped in heap order, so the weights are already in order
+	outgoingPacketBuffer.StartSeries();
+	for (i=0; i < keptPackets.Size(); i++)
+		outgoingPacketBuffer.PushSeries(keptWeights[i], keptPackets[i], _FILE_AND_LINE_);
+
+	// Split again at the current MTU. The parts go to the back of their priority level
+	for (i=0; i < messages.Size(); i++)
+	{
+		if (messages[i].whole)
+			SplitPacket(messages[i].whole);
+	}
+}
+//-------------------------------------------------------------------------------------------------------
+bool ReliabilityLayer::IsPaddingAtReadOffset(RakNet::BitStream *bitStream) const
+{
+	// Every message header starts with a reliability byte and a nonzero 16 bit length, so three zero bytes can only be padding
+	BitSize_t byteOffset = BITS_TO_BYTES(bitStream->GetReadOffset());
+	if (byteOffset + 3 > bitStream->GetNumberOfBytesUsed())
+		return false;
+	const unsigned char *data = bitStream->GetData() + byteOffset;
+	return data[0]==0 && data[1]==0 && data[2]==0;
+}
 //-------------------------------------------------------------------------------------------------------
 // This will return true if we should not send at this time
 //-------------------------------------------------------------------------------------------------------
@@ -2540,6 +2919,41 @@ void ReliabilityLayer::SendAcknowledgementPacket( const DatagramSequenceNumberTy
 
 }
 
+//-------------------------------------------------------------------------------------------------------
+// Ordering channels under 128 are written as a single byte, which is the same encoding used when only 32 channels existed.
+// Higher channels set the high bit of the first byte, and write the remaining bits in a second byte.
+//-------------------------------------------------------------------------------------------------------
+static inline unsigned int GetOrderingChannelByteLength( OrderingChannelType orderingChannel )
+{
+	return orderingChannel < 0x80 ? 1 : 2;
+}
+static inline void WriteOrderingChannel( RakNet::BitStream *bitStream, OrderingChannelType orderingChannel )
+{
+	unsigned char tempChar;
+	if (orderingChannel < 0x80)
+	{
+		tempChar=(unsigned char) orderingChannel; bitStream->WriteAlignedVar8((const char*)& tempChar);
+	}
+	else
+	{
+		tempChar=(unsigned char) (0x80 | (orderingChannel & 0x7F)); bitStream->WriteAlignedVar8((const char*)& tempChar);
+		tempChar=(unsigned char) (orderingChannel >> 7); bitStream->WriteAlignedVar8((const char*)& tempChar);
+	}
+}
+static inline bool ReadOrderingChannel( RakNet::BitStream *bitStream, OrderingChannelType &orderingChannel )
+{
+	unsigned char tempChar;
+	if (bitStream->ReadAlignedVar8((char*)& tempChar)==false)
+		return false;
+	orderingChannel=tempChar & 0x7F;
+	if ((tempChar & 0x80)==0)
+		return true;
+	if (bitStream->ReadAlignedVar8((char*)& tempChar)==false)
+		return false;
+	orderingChannel|=(OrderingChannelType) tempChar << 7;
+	return true;
+}
+
 //-------------------------------------------------------------------------------------------------------
 // Parse an internalPacket and figure out how many header bits would be
 // written.  Returns that number
@@ -2548,6 +2962,7 @@ BitSize_t ReliabilityLayer::GetMaxMessageHeaderLengthBits( void )
 {
 	InternalPacket ip;
 	ip.reliability=RELIABLE_SEQUENCED;
+	ip.orderingChannel=NUMBER_OF_ORDERED_STREAMS-1;
 	ip.splitPacketCount=1;
 	return GetMessageHeaderLengthBits(&ip);
 }
@@ -2592,7 +3007,7 @@ BitSize_t ReliabilityLayer::GetMessageHeaderLengthBits( const InternalPacket *co
 		)
 	{
 		bitLength += 8*3; // bitStream->Write(internalPacket->orderingIndex); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED.
-		bitLength += 8*1; // tempChar=internalPacket->orderingChannel; bitStream->WriteAlignedVar8((const char*)& tempChar); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED. 5 bits needed, write one byte
+		bitLength += 8*GetOrderingChannelByteLength(internalPacket->orderingChannel); // WriteOrderingChannel(bitStream, internalPacket->orderingChannel); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED.
 	}
 	if (internalPacket->splitPacketCount>0)
 	{
@@ -2654,7 +3069,7 @@ BitSize_t ReliabilityLayer::WriteToBitStreamFromInternalPacket( RakNet::BitStrea
 		)
 	{
 		bitStream->Write(internalPacket->orderingIndex); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED.
-		tempChar=internalPacket->orderingChannel; bitStream->WriteAlignedVar8((const char*)& tempChar); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED. 5 bits needed, write one byte
+		WriteOrderingChannel(bitStream, internalPacket->orderingChannel); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED. 1 or 2 bytes
 	}
 
 	if (internalPacket->splitPacketCount>0)
@@ -2690,6 +3105,9 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 	if ( bitStream->GetNumberOfUnreadBits() < (int) sizeof( internalPacket->reliableMessageNumber ) * 8 )
 		return 0; // leftover bits
 
+	if (IsPaddingAtReadOffset(bitStream))
+		return 0; // Rest of the datagram is padding
+
 	internalPacket = AllocateFromInternalPacketPool();
 	if (internalPacket==0)
 	{
@@ -2734,7 +3152,7 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 		)
 	{
 		bitStream->Read(internalPacket->orderingIndex); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED. 4 bytes.
-		readSuccess=bitStream->ReadAlignedVar8((char*)& internalPacket->orderingChannel); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED. 5 bits needed, Read one byte
+		readSuccess=ReadOrderingChannel(bitStream, internalPacket->orderingChannel); // Used for UNRELIABLE_SEQUENCED, RELIABLE_SEQUENCED, RELIABLE_ORDERED. 1 or 2 bytes
 	}
 	else
 		internalPacket->orderingChannel=0;
@@ -2760,7 +3178,7 @@ InternalPacket* ReliabilityLayer::CreateInternalPacketFromBitStream( RakNet::Bit
 	if (readSuccess==false ||
 		internalPacket->dataBitLength==0 ||
 		internalPacket->reliability>=NUMBER_OF_RELIABILITIES ||
-		internalPacket->orderingChannel>=32 || 
+		internalPacket->orderingChannel>=NUMBER_OF_ORDERED_STREAMS || 
 		(hasSplitPacket && (internalPacket->splitPacketIndex >= internalPacket->splitPacketCount)))
 	{
 		// If this assert hits, encoding is garbage
@@ -3032,6 +3450,32 @@ void ReliabilityLayer::SplitPacket( InternalPacket *internalPacket )
 		rakFree_Ex(internalPacketArray, _FILE_AND_LINE_ );
 }
 
+//-------------------------------------------------------------------------------------------------------
+// Returns the state for the specified ordering channel, allocating it on first use
+//-------------------------------------------------------------------------------------------------------
+OrderingChannel* ReliabilityLayer::GetOrderingChannel( OrderingChannelType orderingChannel )
+{
+	if (lastOrderingChannel && lastOrderingChannel->orderingChannel==orderingChannel)
+		return lastOrderingChannel;
+
+	bool objectExists;
+	unsigned index;
+	index=orderingChannelList.GetIndexFromKey(orderingChannel, &objectExists);
+	if (objectExists==false)
+	{
+		OrderingChannel *newChannel = RakNet::OP_NEW<OrderingChannel>( _FILE_AND_LINE_ );
+		newChannel->orderingChannel=orderingChannel;
+		newChannel->orderedWriteIndex=0;
+		newChannel->sequencedWriteIndex=0;
+		newChannel->orderedReadIndex=0;
+		newChannel->highestSequencedReadIndex=0;
+		newChannel->heapIndexOffset=0;
+		orderingChannelList.InsertAtIndex(newChannel, index, _FILE_AND_LINE_);
+	}
+	lastOrderingChannel=orderingChannelList[index];
+	return lastOrderingChannel;
+}
+
 //-------------------------------------------------------------------------------------------------------
 // Insert a packet into the split packet list
 //-------------------------------------------------------------------------------------------------------
@@ -3193,6 +3637,21 @@ InternalPacket * ReliabilityLayer::BuildPacketFromSplitPacketList( SplitPacketCh
 	InternalPacket * internalPacket, *splitPacket;
 	// int splitPacketPartLength;
 
+	// Parts are in the order they arrived, which differs from the order they were sent when one is resent, so put each at its index.
+	// Only a misbehaving sender repeats an index or sends one past the count
+	for (j=0; j < splitPacketChannel->splitPacketList.Size(); j++)
+	{
+		while (splitPacketChannel->splitPacketList[j]->splitPacketIndex!=j)
+		{
+			splitPacket=splitPacketChannel->splitPacketList[j];
+			SplitPacketIndexType target=splitPacket->splitPacketIndex;
+			if (target>=splitPacketChannel->splitPacketList.Size() || splitPacketChannel->splitPacketList[target]->splitPacketIndex==target)
+				break;
+			splitPacketChannel->splitPacketList[j]=splitPacketChannel->splitPacketList[target];
+			splitPacketChannel->splitPacketList[target]=splitPacket;
+		}
+	}
+
 	// Reconstruct
 	internalPacket = CreateInternalPacketCopy( splitPacketChannel->splitPacketList[0], 0, 0, time );
 	internalPacket->dataBitLength=0;
@@ -3305,6 +3764,8 @@ InternalPacket * ReliabilityLayer::CreateInternalPacketCopy( InternalPacket *ori
 
 	copy->dataBitLength = dataByteLength << 3;
 	copy->creationTime = time;
+	copy->deadline = 0;
+	copy->coalescingKey = 0;
 	copy->nextActionTime = 0;
 	copy->orderingIndex = original->orderingIndex;
 	copy->sequencingIndex = original->sequencingIndex;
@@ -3410,6 +3871,8 @@ RakNetStatistics * ReliabilityLayer::GetStatistics( RakNetStatistics *rns )
 	rns->BPSLimitByCongestionControl=statistics.BPSLimitByCongestionControl;
 	rns->isLimitedByOutgoingBandwidthLimit=statistics.isLimitedByOutgoingBandwidthLimit;
 	rns->BPSLimitByOutgoingBandwidthLimit=statistics.BPSLimitByOutgoingBandwidthLimit;
+	rns->MTUSize=pathMTU;
+	rns->discoveredMTUSize=discoveredPathMTU;
 
 	return rns;
 }
@@ -3684,6 +4147,8 @@ InternalPacket* ReliabilityLayer::AllocateFromInternalPacketPool(void)
 	ip->allocationScheme=InternalPacket::NORMAL;
 	ip->data=0;
 	ip->timesSent=0;
+	ip->deadline=0;
+	ip->coalescingKey=0;
 	return ip;
 }
 //-------------------------------------------------------------------------------------------------------
@@ -3947,6 +4412,42 @@ reliabilityHeapWeightType ReliabilityLayer::GetNextWeight(int priorityLevel)
 	}
 	return next;
 }
+//-------------------------------------------------------------------------------------------------------
+reliabilityHeapWeightType ReliabilityLayer::CoalesceOutgoingPacket(InternalPacket *internalPacket)
+{
+	CoalescedMessage *existing = coalescedMessages.Peek(internalPacket->coalescingKey);
+	if (existing==0)
+	{
+		CoalescedMessage cm;
+		cm.internalPacket=internalPacket;
+		cm.weight=GetNextWeight(internalPacket->priority);
+		coalescedMessages.Push(internalPacket->coalescingKey, cm, _FILE_AND_LINE_);
+		return cm.weight;
+	}
+
+	InternalPacket *older = existing->internalPacket;
+	if (older->data!=0)
+	{
+		// Flag invalid. It is removed from outgoingPacketBuffer and counted as discarded when it reaches the top of the heap
+		FreeInternalPacketData(older, _FILE_AND_LINE_ );
+		older->data=0;
+		RemoveFromUnreliableLinkedList(older);
+	}
+
+	// Inherit the place in line, otherwise a key updated faster than the link drains would never be sent
+	if (older->priority!=internalPacket->priority)
+		existing->weight=GetNextWeight(internalPacket->priority);
+	existing->internalPacket=internalPacket;
+	return existing->weight;
+}
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::RemoveCoalescedPacket(InternalPacket *internalPacket)
+{
+	// Only remove the entry if it was not since taken over by a newer message with the same key
+	CoalescedMessage *existing = coalescedMessages.Peek(internalPacket->coalescingKey);
+	if (existing && existing->internalPacket==internalPacket)
+		coalescedMessages.Remove(internalPacket->coalescingKey, _FILE_AND_LINE_);
+}
 
 //-------------------------------------------------------------------------------------------------------
 // #if defined(RELIABILITY_LAYER_NEW_UNDEF_ALLOCATING_QUEUE)
@@ -33,6 +33,7 @@
 #include "DS_MemoryPool.h"
 #include "RakNetDefines.h"
 #include "DS_Heap.h"
+#include "DS_Hash.h"
 #include "BitStream.h"
 #include "NativeFeatureIncludes.h"
 #include "SecureHandshake.h"
@@ -48,8 +49,10 @@
 #define INCLUDE_TIMESTAMP_WITH_DATAGRAMS 0
 #endif
 
-/// Number of ordered streams available. You can use up to 32 ordered streams
-#define NUMBER_OF_ORDERED_STREAMS 32 // 2^5
+/// Number of ordered streams available. You can use up to 32768 ordered streams
+/// Channels under 128 are written with one byte, so peers that only use channels 0 to 31 remain compatible with older versions
+/// Per-channel state is only allocated once a channel is used, so unused channels cost nothing
+#define NUMBER_OF_ORDERED_STREAMS 32768 // 2^15
 
 #define RESEND_TREE_ORDER 32
 
@@ -80,6 +83,31 @@ struct SplitPacketChannel//<SplitPacketChannel>
 };
 int RAK_DLL_EXPORT SplitPacketChannelComp( SplitPacketIdType const &key, SplitPacketChannel* const &data );
 
+// State for one ordering channel, for both the send and receive directions. See the algorithm description in ReliabilityLayer
+struct OrderingChannel
+{
+	OrderingChannelType orderingChannel;
+	// Sender increments this by 1 for every ordered message sent
+	OrderingIndexType orderedWriteIndex;
+	// Sender increments by 1 for every sequenced message sent. Resets to 0 when an ordered message is sent
+	OrderingIndexType sequencedWriteIndex;
+	// Next expected index for ordered messages.
+	OrderingIndexType orderedReadIndex;
+	// Highest value received for sequencedWriteIndex for the current value of orderedReadIndex on the same channel.
+	OrderingIndexType highestSequencedReadIndex;
+	OrderingIndexType heapIndexOffset;
+	DataStructures::Heap<reliabilityHeapWeightType, InternalPacket*, false> orderingHeap;
+};
+int RAK_DLL_EXPORT OrderingChannelComp( OrderingChannelType const &key, OrderingChannel* const &data );
+
+// Unsent message in outgoingPacketBuffer that was sent with a coalescing key, and its weight in that heap
+struct CoalescedMessage
+{
+	InternalPacket *internalPacket;
+	reliabilityHeapWeightType weight;
+	static unsigned long ToUint32( const uint32_t &coalescingKey ) {return coalescingKey;}
+};
+
 // Helper class
 struct BPSTracker
 {
@@ -159,13 +187,15 @@ public:
 	/// \param[in] numberOfBitsToSend The length of \a data in bits
 	/// \param[in] priority The priority level for the send
 	/// \param[in] reliability The reliability type for the send
-	/// \param[in] orderingChannel 0 to 31.  Specifies what channel to use, for relational ordering and sequencing of packets.
+	/// \param[in] orderingChannel 0 to NUMBER_OF_ORDERED_STREAMS-1.  Specifies what channel to use, for relational ordering and sequencing of packets.
 	/// \param[in] makeDataCopy If true \a data will be copied.  Otherwise, only a pointer will be stored.
 	/// \param[in] MTUSize maximum datagram size
 	/// \param[in] currentTime Current time, as per RakNet::GetTimeMS()
 	/// \param[in] receipt This number will be returned back with ID_SND_RECEIPT_ACKED or ID_SND_RECEIPT_LOSS and is only returned with the reliability types that contain RECEIPT in the name
+	/// \param[in] deadline If not 0, and \a reliability is unreliable, discard the message if it is still unsent at this time. Same units as \a currentTime
+	/// \param[in] coalescingKey If not 0, and \a reliability is UNRELIABLE or UNRELIABLE_SEQUENCED, replaces an unsent message that was sent with the same key
 	/// \return True or false for success or failure.
-	bool Send( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, unsigned char orderingChannel, bool makeDataCopy, int MTUSize, CCTimeType currentTime, uint32_t receipt );
+	bool Send( char *data, BitSize_t numberOfBitsToSend, PacketPriority priority, PacketReliability reliability, OrderingChannelType orderingChannel, bool makeDataCopy, int MTUSize, CCTimeType currentTime, uint32_t receipt, CCTimeType deadline=0, uint32_t coalescingKey=0 );
 
 	/// Call once per game cycle.  Handles internal lists and actually does the send.
 	/// \param[in] s the communication  end point
@@ -203,6 +233,12 @@ public:
 
 	void SetSplitMessageProgressInterval(int interval);
 	void SetUnreliableTimeout(RakNet::TimeMS timeoutMS);
+	/// Enables or disables in-session path MTU discovery. Defaults to false.
+	/// While enabled, padded probe datagrams are periodically sent to find the largest datagram that reaches the remote system, and the MTU falls back to a conservative size if datagrams at the current size stop arriving.
+	/// Probes are sent only when congestion control has room for a datagram, and count as unacknowledged data until acknowledged or lost.
+	void SetPathMTUDiscovery(bool enabled);
+	/// \return The datagram size currently in use, including the UDP header. Starts at the size negotiated in the connection handshake.
+	int GetPathMTU(void) const {return pathMTU;}
 	/// Has a lot of time passed since the last ack
 	bool AckTimeout(RakNet::Time curTime);
 	CCTimeType GetNextSendTime(void) const;
@@ -331,6 +367,35 @@ private:
 	int splitMessageProgressInterval;
 	CCTimeType unreliableTimeout;
 
+	// Path MTU discovery. Sizes include the UDP header.
+	bool pathMTUDiscoveryEnabled;
+	int pathMTU;
+	// 0 until a probe is acknowledged
+	int discoveredPathMTU;
+	// Smallest size known not to get through
+	int pathMTUFailedSize;
+	// Size being probed, 0 if none. The probe waits for congestion control until pathMTUProbeInFlight is set
+	int pathMTUProbeSize;
+	int pathMTUProbeFailures;
+	bool pathMTUProbeInFlight;
+	// Probing at pathMTU because reliable messages are being lost
+	bool pathMTUConfirming;
+	DatagramSequenceNumberType pathMTUProbeDatagramNumber;
+	CCTimeType pathMTUProbeSentTime;
+	CCTimeType pathMTUNextProbeTime;
+	void SetPathMTU(int mtu);
+	int GetNextPathMTUProbeSize(void) const;
+	// Advances the search and returns the size of the probe to send, or 0
+	int UpdatePathMTUDiscovery(CCTimeType time);
+	void SendPathMTUProbe(RakNetSocket2 *s, SystemAddress &systemAddress, CCTimeType time, RakNetRandom *rnr, BitStream &updateBitStream);
+	void OnPathMTUProbeAcked(CCTimeType time);
+	// The probe in flight stops counting toward unacknowledgedBytes
+	void EndPathMTUProbeFlight(void);
+	// Splits messages in outgoingPacketBuffer again if their parts no longer fit in a datagram
+	void ResplitQueuedPackets(void);
+	// Zero padding, as appended to packet pairs and path MTU probes, is at the read offset
+	bool IsPaddingAtReadOffset(RakNet::BitStream *bitStream) const;
+
 	struct MessageNumberNode
 	{
 		DatagramSequenceNumberType messageNumber;
@@ -402,6 +467,11 @@ private:
 	reliabilityHeapWeightType outgoingPacketBufferNextWeights[NUMBER_OF_PRIORITIES];
 	void InitHeapWeights(void);
 	reliabilityHeapWeightType GetNextWeight(int priorityLevel);
+	// Returns the heap weight for a new unreliable message. If an unsent message with the same coalescing key is in outgoingPacketBuffer, it is flagged for discard, and its weight is reused so the new message takes its place in line
+	reliabilityHeapWeightType CoalesceOutgoingPacket(InternalPacket *internalPacket);
+	// Called when a message with a coalescing key leaves outgoingPacketBuffer
+	void RemoveCoalescedPacket(InternalPacket *internalPacket);
+	DataStructures::Hash<uint32_t, CoalescedMessage, 256, CoalescedMessage::ToUint32> coalescedMessages;
 //	unsigned int messageInSendBuffer[NUMBER_OF_PRIORITIES];
 //	double bytesInSendBuffer[NUMBER_OF_PRIORITIES];
 
@@ -421,7 +491,7 @@ private:
 	RakNetStatistics statistics;
 
 	// Algorithm for blending ordered and sequenced on the same channel:
-	// 1. Each ordered message transmits OrderingIndexType orderedWriteIndex. There are NUMBER_OF_ORDERED_STREAMS independent values of these. The value
+	// 1. Each ordered message transmits OrderingIndexType orderedWriteIndex. There is one independent value of these per OrderingChannel. The value
 	//    starts at 0. Every time an ordered message is sent, the value increments by 1
 	// 2. Each sequenced message contains the current value of orderedWriteIndex for that channel, and additionally OrderingIndexType sequencedWriteIndex. 
 	//    sequencedWriteIndex resets to 0 every time orderedWriteIndex increments. It increments by 1 every time a sequenced message is sent.
@@ -438,16 +508,14 @@ private:
 	//    Messages are pushed off until the heap is empty, or the next message to be returned does not preserve the ordered index
 	//    For an empty heap, the heap weight should start at the lowest value based on the next expected ordering index, to avoid variable overflow
 
-	// Sender increments this by 1 for every ordered message sent
-	OrderingIndexType orderedWriteIndex[NUMBER_OF_ORDERED_STREAMS];
-	// Sender increments by 1 for every sequenced message sent. Resets to 0 when an ordered message is sent
-	OrderingIndexType sequencedWriteIndex[NUMBER_OF_ORDERED_STREAMS];
-	// Next expected index for ordered messages.
-	OrderingIndexType orderedReadIndex[NUMBER_OF_ORDERED_STREAMS];
-	// Highest value received for sequencedWriteIndex for the current value of orderedReadIndex on the same channel.
-	OrderingIndexType highestSequencedReadIndex[NUMBER_OF_ORDERED_STREAMS];
-	DataStructures::Heap<reliabilityHeapWeightType, InternalPacket*, false> orderingHeaps[NUMBER_OF_ORDERED_STREAMS];
-	OrderingIndexType heapIndexOffsets[NUMBER_OF_ORDERED_STREAMS];
+	// Ordering channels that have been used, in either direction. Sorted by channel
+	DataStructures::OrderedList<OrderingChannelType, OrderingChannel*, OrderingChannelComp> orderingChannelList;
+	// Most recently used entry in orderingChannelList, since consecutive messages usually use the same channel
+	OrderingChannel *lastOrderingChannel;
+	// Entries in orderingChannelList first used by the remote system, limited to MAX_ORDERING_CHANNELS_PER_CONNECTION
+	unsigned int remoteOrderingChannelCount;
+	/// Returns the state for the specified channel, allocating it on first use
+	OrderingChannel* GetOrderingChannel( OrderingChannelType orderingChannel );
 
 	
 
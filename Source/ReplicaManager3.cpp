@@ -16,6 +16,7 @@
 #include "MessageIdentifiers.h"
 #include "RakPeerInterface.h"
 #include "NetworkIDManager.h"
+#include "BitStreamView.h"
 
 using namespace RakNet;
 
@@ -83,8 +84,10 @@ ReplicaManager3::ReplicaManager3()
 	defaultSendParameters.sendReceipt=0;
 	autoSerializeInterval=30;
 	lastAutoSerializeOccurance=0;
+	bitStreamArena=0;
 	autoCreateConnections=true;
 	autoDestroyConnections=true;
+	deserializeInPlace=false;
 	currentlyDeallocatingReplica=0;
 
 	for (unsigned int i=0; i < 255; i++)
@@ -501,6 +504,34 @@ void ReplicaManager3::SetDefaultPacketReliability(PacketReliability def)
 
 // --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
 
+void ReplicaManager3::SetBitStreamArena(BitStreamArena *arena)
+{
+	bitStreamArena=arena;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+BitStreamArena* ReplicaManager3::GetBitStreamArena(void) const
+{
+	return bitStreamArena;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void ReplicaManager3::SetDeserializeInPlace(bool inPlace)
+{
+	deserializeInPlace=inPlace;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
+bool ReplicaManager3::GetDeserializeInPlace(void) const
+{
+	return deserializeInPlace;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------
+
 void ReplicaManager3::SetAutoSerializeInterval(RakNet::Time intervalMS)
 {
 	autoSerializeInterval=intervalMS;
@@ -915,7 +946,10 @@ void ReplicaManager3::Update(void)
 
 			sp.messageTimestamp=0;
 			for (int i=0; i < RM3_NUM_OUTPUT_BITSTREAM_CHANNELS; i++)
+			{
 				sp.pro[i]=defaultSendParameters;
+				sp.outputBitstream[i].SetArena(bitStreamArena);
+			}
 			index2=0;
 			for (index=0; index < world->connectionList.Size(); index++)
 			{
@@ -1260,7 +1294,7 @@ PluginReceiveResult ReplicaManager3::OnSerialize(Packet *packet, unsigned char *
 
 	RM3World *world = worldsArray[worldId];
 	RakAssert(world->networkIDManager);
-	RakNet::BitStream bsIn(packetData,packetDataLength,false);
+	RakNet::BitStreamView bsIn(packetData,packetDataLength);
 	bsIn.IgnoreBytes(packetDataOffset);
 
 	struct DeserializeParameters ds;
@@ -1282,7 +1316,10 @@ PluginReceiveResult ReplicaManager3::OnSerialize(Packet *packet, unsigned char *
 			{
 				bsIn.ReadCompressed(bitsUsed);
 				bsIn.AlignReadToByteBoundary();
-				bsIn.Read(ds.serializationBitstream[z], bitsUsed);
+				if (deserializeInPlace)
+					bsIn.ReadView(&ds.serializationBitstream[z], bitsUsed);
+				else
+					bsIn.Read(ds.serializationBitstream[z], bitsUsed);
 			}
 		}
 		replica->Deserialize(&ds);
@@ -1526,7 +1563,7 @@ SendSerializeIfChangedResult Connection_RM3::SendSerialize(RakNet::Replica3 *rep
 			sum+=serializationData[z].GetNumberOfBitsUsed();
 	}
 
-	RakNet::BitStream out;
+	RakNet::BitStream out(replica->replicaManager ? replica->replicaManager->GetBitStreamArena() : 0);
 	BitSize_t bitsPerChannel[RM3_NUM_OUTPUT_BITSTREAM_CHANNELS];
 
 	if (sum==0)
@@ -235,6 +235,25 @@ public:
 	/// \param[in] intervalMS How frequently to autoserialize all objects. This controls the maximum number of game object updates per second.
 	void SetAutoSerializeInterval(RakNet::Time intervalMS);
 
+	/// \brief Write serializations into \a arena rather than the heap
+	/// \details The BitStreams passed to Replica3::Serialize() in SerializeParameters::outputBitstream, and the BitStreams they are sent in, grow into \a arena when they do not fit in BITSTREAM_STACK_ALLOCATION_SIZE.
+	/// They are all destroyed before Update() returns, so \a arena can be reset once per frame, such as after calling RakPeerInterface::Receive().
+	/// Defaults to 0, to use the heap.
+	/// \param[in] arena Arena to use, or 0 to use the heap. Must remain valid while set.
+	void SetBitStreamArena(BitStreamArena *arena);
+
+	/// \return What was passed to SetBitStreamArena()
+	BitStreamArena* GetBitStreamArena(void) const;
+
+	/// \brief Have Replica3::Deserialize() read each channel in place in the packet, rather than from a copy
+	/// \details The BitStreams in DeserializeParameters::serializationBitstream then do not own their data, so Deserialize() may only read from them, and must not keep them or pointers into them after it returns.
+	/// Defaults to false, to copy each channel.
+	/// \param[in] inPlace True to read in place
+	void SetDeserializeInPlace(bool inPlace);
+
+	/// \return What was passed to SetDeserializeInPlace()
+	bool GetDeserializeInPlace(void) const;
+
 	/// \brief Return the connections that we think have an instance of the specified Replica3 instance
 	/// \details This can be wrong, for example if that system locally deleted the outside the scope of ReplicaManager3, if QueryRemoteConstruction() returned false, or if DeserializeConstruction() returned false.
 	/// \param[in] replica The replica to check against.
@@ -332,9 +351,11 @@ protected:
 	unsigned int ReferenceInternal(RakNet::Replica3 *replica3, WorldId worldId);
 
 	PRO defaultSendParameters;
+	BitStreamArena *bitStreamArena;
 	RakNet::Time autoSerializeInterval;
 	RakNet::Time lastAutoSerializeOccurance;
 	bool autoCreateConnections, autoDestroyConnections;
+	bool deserializeInPlace;
 	Replica3 *currentlyDeallocatingReplica;
 	// Set on the first call to ReferenceInternal(), and should never be changed after that
 	// Used to lookup in Replica3LSRComp. I don't want to rely on GetNetworkID() in case it changes at runtime
@@ -415,6 +436,7 @@ struct SerializeParameters
 };
 
 /// \ingroup REPLICA_MANAGER_GROUP3
+/// \note serializationBitstream reads from the packet, without copying it, so only read from it, and only during Replica3::Deserialize()
 struct DeserializeParameters
 {
 	RakNet::BitStream serializationBitstream[RM3_NUM_OUTPUT_BITSTREAM_CHANNELS];
@@ -332,18 +332,19 @@ StringCompressor::StringCompressor()
 void StringCompressor::GenerateTreeFromStrings( unsigned char *input, unsigned inputLength, uint8_t languageId )
 {
 	HuffmanEncodingTree *huffmanEncodingTree;
-	if (huffmanEncodingTrees.Has(languageId))
-	{
-		huffmanEncodingTree = huffmanEncodingTrees.Get(languageId);
-		RakNet::OP_DELETE(huffmanEncodingTree, _FILE_AND_LINE_);
-	}
-
 	unsigned index;
 	unsigned int frequencyTable[ 256 ];
 
+	// Keep the existing tree, rather than leaving a deleted one in the map
 	if ( inputLength == 0 )
 		return ;
 
+	if (huffmanEncodingTrees.Has(languageId))
+	{
+		huffmanEncodingTree = huffmanEncodingTrees.Get(languageId);
+		RakNet::OP_DELETE(huffmanEncodingTree, _FILE_AND_LINE_);
+	}
+
 	// Zero out the frequency table
 	memset( frequencyTable, 0, sizeof( frequencyTable ) );
 
@@ -357,10 +358,91 @@ void StringCompressor::GenerateTreeFromStrings( unsigned char *input, unsigned i
 	huffmanEncodingTrees.Set(languageId, huffmanEncodingTree);
 }
 
+void StringCompressor::AddTrainingSample( const unsigned char *input, unsigned inputLength, uint8_t languageId )
+{
+	unsigned int *frequencyTable;
+	if (trainingFrequencies.Has(languageId))
+		frequencyTable = trainingFrequencies.Get(languageId);
+	else
+	{
+		frequencyTable = RakNet::OP_NEW_ARRAY<unsigned int>( 256, _FILE_AND_LINE_ );
+		memset( frequencyTable, 0, sizeof(unsigned int) * 256 );
+		trainingFrequencies.Set(languageId, frequencyTable);
+	}
+
+	for ( unsigned index = 0; index < inputLength; index++ )
+	{
+		// Halve all the counts rather than overflow, which keeps their proportions
+		if ( ++frequencyTable[ input[ index ] ] == 0xFFFFFFFF )
+		{
+			for ( unsigned value = 0; value < 256; value++ )
+				frequencyTable[ value ] >>= 1;
+		}
+	}
+}
+
+bool StringCompressor::FinishTraining( uint8_t languageId )
+{
+	if (trainingFrequencies.Has(languageId)==false)
+		return false;
+	unsigned int *frequencyTable = trainingFrequencies.Get(languageId);
+	trainingFrequencies.Delete(languageId);
+
+	HuffmanEncodingTree *huffmanEncodingTree = RakNet::OP_NEW<HuffmanEncodingTree>( _FILE_AND_LINE_ );
+	huffmanEncodingTree->GenerateFromFrequencyTable( frequencyTable );
+	RakNet::OP_DELETE_ARRAY(frequencyTable, _FILE_AND_LINE_);
+
+	if (huffmanEncodingTrees.Has(languageId))
+		RakNet::OP_DELETE(huffmanEncodingTrees.Get(languageId), _FILE_AND_LINE_);
+	huffmanEncodingTrees.Set(languageId, huffmanEncodingTree);
+	return true;
+}
+
+bool StringCompressor::WriteLanguage( uint8_t languageId, RakNet::BitStream *output ) const
+{
+	if (huffmanEncodingTrees.Has(languageId)==false)
+		return false;
+
+	unsigned char codeLengths[ 256 ];
+	huffmanEncodingTrees.Get(languageId)->GetCodeLengths( codeLengths );
+
+	// Lengths are 1 to HUFFMAN_MAX_CODE_LENGTH, so 5 bits each
+	for ( unsigned index = 0; index < 256; index++ )
+		output->WriteBits( codeLengths + index, 5, true );
+	return true;
+}
+
+bool StringCompressor::ReadLanguage( RakNet::BitStream *input, uint8_t languageId )
+{
+	if ( input->GetNumberOfUnreadBits() < 256 * 5 )
+		return false;
+
+	unsigned char codeLengths[ 256 ];
+	for ( unsigned index = 0; index < 256; index++ )
+	{
+		codeLengths[ index ] = 0;
+		input->ReadBits( codeLengths + index, 5, true );
+	}
+
+	HuffmanEncodingTree *huffmanEncodingTree = RakNet::OP_NEW<HuffmanEncodingTree>( _FILE_AND_LINE_ );
+	if ( huffmanEncodingTree->GenerateFromCodeLengths( codeLengths ) == false )
+	{
+		RakNet::OP_DELETE(huffmanEncodingTree, _FILE_AND_LINE_);
+		return false;
+	}
+
+	if (huffmanEncodingTrees.Has(languageId))
+		RakNet::OP_DELETE(huffmanEncodingTrees.Get(languageId), _FILE_AND_LINE_);
+	huffmanEncodingTrees.Set(languageId, huffmanEncodingTree);
+	return true;
+}
+
 StringCompressor::~StringCompressor()
 {
 	for (unsigned i=0; i < huffmanEncodingTrees.Size(); i++)
 		RakNet::OP_DELETE(huffmanEncodingTrees[i], _FILE_AND_LINE_);
+	for (unsigned i=0; i < trainingFrequencies.Size(); i++)
+		RakNet::OP_DELETE_ARRAY(trainingFrequencies[i], _FILE_AND_LINE_);
 }
 
 void StringCompressor::EncodeString( const char *input, int maxCharsToWrite, RakNet::BitStream *output, uint8_t languageId )
@@ -376,8 +458,6 @@ void StringCompressor::EncodeString( const char *input, int maxCharsToWrite, Rak
 		return ;
 	}
 
-	RakNet::BitStream encodedBitStream;
-
 	uint32_t stringBitLength;
 
 	int charsToWrite;
@@ -387,13 +467,12 @@ void StringCompressor::EncodeString( const char *input, int maxCharsToWrite, Rak
 	else
 		charsToWrite = maxCharsToWrite - 1;
 
-	huffmanEncodingTree->EncodeArray( ( unsigned char* ) input, charsToWrite, &encodedBitStream );
-
-	stringBitLength = (uint32_t) encodedBitStream.GetNumberOfBitsUsed();
+	// The length comes first, so work it out rather than encoding to a temporary bitstream and copying
+	stringBitLength = (uint32_t) huffmanEncodingTree->GetEncodedBitLength( ( const unsigned char* ) input, charsToWrite );
 
 	output->WriteCompressed( stringBitLength );
 
-	output->WriteBits( encodedBitStream.GetData(), stringBitLength );
+	huffmanEncodingTree->EncodeArray( ( unsigned char* ) input, charsToWrite, output );
 }
 
 bool StringCompressor::DecodeString( char *output, int maxCharsToWrite, RakNet::BitStream *input, uint8_t languageId )
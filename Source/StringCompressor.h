@@ -61,6 +61,33 @@ public:
 	/// \param[in] inputLength Length of \a input
 	/// \param[in] languageID An identifier for the language / string table to generate the tree for.  English is automatically created with ID 0 in the constructor.
 	void GenerateTreeFromStrings( unsigned char *input, unsigned inputLength, uint8_t languageId );
+
+	/// Counts the characters in a sample of traffic, such as one chat line, toward a tree for \a languageId.
+	/// Call as many times as you have samples, then FinishTraining() to replace the tree.
+	/// Not threadsafe, so train before strings are sent from other threads.
+	/// \param[in] input An array of bytes which should point to text.
+	/// \param[in] inputLength Length of \a input
+	/// \param[in] languageID An identifier for the language / string table being trained.
+	void AddTrainingSample( const unsigned char *input, unsigned inputLength, uint8_t languageId );
+
+	/// Generates the tree for \a languageId from the samples passed to AddTrainingSample(), and frees the counts.
+	/// \param[in] languageID An identifier for the language / string table being trained.
+	/// \return false if no samples were added for \a languageId, in which case the tree is unchanged.
+	bool FinishTraining( uint8_t languageId );
+
+	/// Writes the tree for \a languageId, so the remote system can call ReadLanguage() and decode strings compressed with it.
+	/// The tree is written as the length of the code for each character, 5 bits each.
+	/// \param[in] languageID Which language to write
+	/// \param[out] output The bitstream to write to
+	/// \return false if there is no tree for \a languageId
+	bool WriteLanguage( uint8_t languageId, RakNet::BitStream *output ) const;
+
+	/// Reads a tree written by WriteLanguage() and uses it for \a languageId, replacing any existing tree.
+	/// Not threadsafe, as with GenerateTreeFromStrings().
+	/// \param[in] input The bitstream to read from
+	/// \param[in] languageID The identifier to use for the tree that was read
+	/// \return false if the data is short or not a valid tree, in which case the tree for \a languageId is unchanged
+	bool ReadLanguage( RakNet::BitStream *input, uint8_t languageId );
 	
  	/// Writes input to output, compressed.  Takes care of the null terminator for you.
 	/// \param[in] input Pointer to an ASCII string
@@ -104,6 +131,9 @@ private:
 	
 	/// Pointer to the huffman encoding trees.
 	DataStructures::Map<int, HuffmanEncodingTree *> huffmanEncodingTrees;
+
+	/// Character counts from AddTrainingSample(), per language, until FinishTraining() is called
+	DataStructures::Map<int, unsigned int *> trainingFrequencies;
 	
 	static int referenceCount;
 };